@@ -1425,6 +1425,11 @@ static const setting_t gconf_defaults[] =
     .type = "i",
     .def  = G_STRINGIFY(MCE_DEFAULT_DISPLAY_OFF_OVERRIDE),
   },
+  {
+    .key  = MCE_SETTING_DISPLAY_SPECULATIVE_RESUME,
+    .type = "i",
+    .def  = G_STRINGIFY(MCE_DEFAULT_DISPLAY_SPECULATIVE_RESUME),
+  },
   {
     .key  = MCE_SETTING_TK_AUTO_BLANK_DISABLE,
     .type = "i",
@@ -1802,6 +1807,21 @@ static const setting_t gconf_defaults[] =
     .type = "i",
     .def  = G_STRINGIFY(MCE_DEFAULT_MEMNOTIFY_CRITICAL_ACTIVE)
   },
+  {
+    .key  = MCE_SETTING_MEMNOTIFY_WARNING_STALL,
+    .type = "i",
+    .def  = G_STRINGIFY(MCE_DEFAULT_MEMNOTIFY_WARNING_STALL)
+  },
+  {
+    .key  = MCE_SETTING_MEMNOTIFY_CRITICAL_STALL,
+    .type = "i",
+    .def  = G_STRINGIFY(MCE_DEFAULT_MEMNOTIFY_CRITICAL_STALL)
+  },
+  {
+    .key  = MCE_SETTING_MEMNOTIFY_STALL_WINDOW,
+    .type = "i",
+    .def  = G_STRINGIFY(MCE_DEFAULT_MEMNOTIFY_STALL_WINDOW)
+  },
   {
     .key  = MCE_SETTING_TK_EXCEPT_LEN_CALL_IN,
     .type = "i",
@@ -25,6 +25,7 @@
 #include "mce.h"
 #include "mce-log.h"
 #include "mce-lib.h"
+#include "mce-journal.h"
 
 #include <mce/mode-names.h>
 
@@ -56,6 +57,9 @@ datapipe_struct resume_detected_event_pipe;
 /** Non-synthetized user activity; read only */
 datapipe_struct user_activity_event_pipe;
 
+/** Input that is likely to turn display on, warrants cpu boost; read only */
+datapipe_struct cpu_boost_event_pipe;
+
 /** State of display; read only */
 datapipe_struct display_state_curr_pipe;
 
@@ -259,6 +263,35 @@ datapipe_struct fpstate_pipe;
 /** fingerprint is enrolling; read only */
 datapipe_struct enroll_in_progress_pipe;
 
+/** Total number of datapipe executions */
+static guint datapipe_exec_total = 0;
+
+/** Total number of datapipe executions skipped as unchanged */
+static guint datapipe_skip_total = 0;
+
+/** Datapipe execution waiting in the run queue */
+typedef struct
+{
+	datapipe_struct  *datapipe;	/**< The datapipe to execute */
+	gpointer          indata;	/**< The latest posted data */
+	caching_policy_t  cache_indata;	/**< The latest caching policy */
+} datapipe_queued_t;
+
+/** Queued executions to run at the end of the outermost execution */
+static GQueue datapipe_run_queue = G_QUEUE_INIT;
+
+/** Current datapipe execution nesting level */
+static guint datapipe_exec_depth = 0;
+
+/** Deepest datapipe execution nesting level seen */
+static guint datapipe_exec_depth_max = 0;
+
+/** Total number of queued datapipe executions */
+static guint datapipe_queued_total = 0;
+
+/** Total number of queued values replaced by later values */
+static guint datapipe_collapsed_total = 0;
+
 /**
  * Execute the input triggers of a datapipe
  *
@@ -345,6 +378,24 @@ EXIT:
 	return retval;
 }
 
+/**
+ * Execute the output triggers of a datapipe without journaling
+ *
+ * @param datapipe The datapipe to execute
+ * @param data The data to feed to the triggers
+ */
+static void datapipe_run_output_triggers(const datapipe_struct *const datapipe,
+					 gconstpointer data)
+{
+	void (*trigger)(gconstpointer input);
+	gint i;
+
+	for (i = 0; (trigger = g_slist_nth_data(datapipe->output_triggers,
+						i)) != NULL; i++) {
+		trigger(data);
+	}
+}
+
 /**
  * Execute the output triggers of a datapipe
  *
@@ -357,9 +408,7 @@ void datapipe_exec_output_triggers(const datapipe_struct *const datapipe,
 				   gconstpointer indata,
 				   const data_source_t use_cache)
 {
-	void (*trigger)(gconstpointer input);
 	gconstpointer data;
-	gint i;
 
 	if (datapipe == NULL) {
 		mce_log(LL_ERR,
@@ -370,17 +419,50 @@ void datapipe_exec_output_triggers(const datapipe_struct *const datapipe,
 
 	data = (use_cache == USE_CACHE) ? datapipe->cached_data : indata;
 
-	for (i = 0; (trigger = g_slist_nth_data(datapipe->output_triggers,
-						i)) != NULL; i++) {
-		trigger(data);
-	}
+	mce_journal_record(datapipe, data, MCE_JOURNAL_FLAG_OUTPUT_ONLY,
+			   datapipe_exec_depth);
+
+	datapipe_run_output_triggers(datapipe, data);
 
 EXIT:
 	return;
 }
 
 /**
- * Execute the datapipe
+ * Check whether datapipe execution can be skipped as unchanged
+ *
+ * Applies only to datapipes initialized with FIRE_ON_CHANGE policy,
+ * and only when fresh data is fed in. Explicit re-execution using
+ * the cached value always fires.
+ *
+ * @param datapipe The datapipe to check
+ * @param data The data that would be fed to output triggers
+ * @param use_cache USE_CACHE if executing cached data,
+ *                  USE_INDATA if executing new data
+ * @return TRUE if execution is not needed, FALSE otherwise
+ */
+static gboolean datapipe_is_unchanged(datapipe_struct *const datapipe,
+				      gconstpointer data,
+				      const data_source_t use_cache)
+{
+	gboolean unchanged = FALSE;
+
+	if( !datapipe->change_only || use_cache == USE_CACHE )
+		goto EXIT;
+
+	if( !datapipe->have_outdata || datapipe->last_outdata != data )
+		goto EXIT;
+
+	datapipe->skip_count += 1;
+	datapipe_skip_total  += 1;
+	unchanged = TRUE;
+
+EXIT:
+	return unchanged;
+}
+
+/**
+ * Execute the datapipe without run queue handling
  *
  * @param datapipe The datapipe to execute
  * @param indata The input data to run through the datapipe
@@ -390,10 +472,10 @@ EXIT:
  *                     DONT_CACHE_INDATA to keep the old data
  * @return The processed data
  */
-gconstpointer datapipe_exec_full(datapipe_struct *const datapipe,
-				 gpointer indata,
-				 const data_source_t use_cache,
-				 const caching_policy_t cache_indata)
+static gconstpointer datapipe_exec_real(datapipe_struct *const datapipe,
+					gpointer indata,
+					const data_source_t use_cache,
+					const caching_policy_t cache_indata)
 {
 	gconstpointer outdata = NULL;
 
@@ -416,6 +498,17 @@ gconstpointer datapipe_exec_full(datapipe_struct *const datapipe,
 		datapipe->cached_data = indata;
 	}
 
+	datapipe->exec_count += 1;
+	datapipe_exec_total  += 1;
+
+	/* Read only datapipes output the indata as is -> the whole
+	 * execution can be skipped if the value is not changing */
+	if( datapipe->read_only == READ_ONLY &&
+	    datapipe_is_unchanged(datapipe, indata, use_cache) ) {
+		outdata = indata;
+		goto EXIT;
+	}
+
 	/* Execute input value callbacks */
 	datapipe_exec_input_triggers(datapipe, indata, USE_INDATA);
 
@@ -435,13 +528,174 @@ gconstpointer datapipe_exec_full(datapipe_struct *const datapipe,
 		datapipe->cached_data = (gpointer)outdata;
 	}
 
+	/* Skip output triggers if the filtered value is not changing */
+	if( datapipe->read_only != READ_ONLY &&
+	    datapipe_is_unchanged(datapipe, outdata, use_cache) )
+		goto EXIT;
+
+	/* Update before executing triggers, so that possible
+	 * recursive executions compare against the latest value */
+	datapipe->last_outdata = outdata;
+	datapipe->have_outdata = TRUE;
+
 	/* Execute output value callbacks */
-	datapipe_exec_output_triggers(datapipe, outdata, USE_INDATA);
+	datapipe_run_output_triggers(datapipe, outdata);
 
 EXIT:
 	return outdata;
 }
 
+/**
+ * Get journal record flags describing datapipe execution
+ *
+ * @param use_cache USE_CACHE to use data from cache,
+ *                  USE_INDATA to use indata
+ * @param cache_indata caching policy used for the execution
+ * @return bitmask of mce_journal_flag_t
+ */
+static unsigned datapipe_journal_flags(const data_source_t use_cache,
+				       const caching_policy_t cache_indata)
+{
+	unsigned flags = 0;
+
+	if( use_cache == USE_CACHE )
+		flags |= MCE_JOURNAL_FLAG_USE_CACHE;
+	if( cache_indata & CACHE_INDATA )
+		flags |= MCE_JOURNAL_FLAG_CACHE_INDATA;
+	if( cache_indata & CACHE_OUTDATA )
+		flags |= MCE_JOURNAL_FLAG_CACHE_OUTDATA;
+
+	return flags;
+}
+
+/**
+ * Run queued datapipe executions
+ *
+ * Called when the outermost datapipe execution is about to finish.
+ * Executions posted while draining the queue are appended to it
+ * and handled in the same loop.
+ */
+static void datapipe_run_queue_drain(void)
+{
+	datapipe_queued_t *queued;
+
+	while( (queued = g_queue_pop_head(&datapipe_run_queue)) ) {
+		mce_journal_record(queued->datapipe, queued->indata,
+				   datapipe_journal_flags(USE_INDATA,
+							  queued->cache_indata) |
+				   MCE_JOURNAL_FLAG_QUEUED,
+				   datapipe_exec_depth);
+		datapipe_exec_real(queued->datapipe, queued->indata,
+				   USE_INDATA, queued->cache_indata);
+		g_free(queued);
+	}
+}
+
+/**
+ * Execute the datapipe
+ *
+ * @param datapipe The datapipe to execute
+ * @param indata The input data to run through the datapipe
+ * @param use_cache USE_CACHE to use data from cache,
+ *                  USE_INDATA to use indata
+ * @param cache_indata CACHE_INDATA to cache the indata,
+ *                     DONT_CACHE_INDATA to keep the old data
+ * @return The processed data
+ */
+gconstpointer datapipe_exec_full(datapipe_struct *const datapipe,
+				 gpointer indata,
+				 const data_source_t use_cache,
+				 const caching_policy_t cache_indata)
+{
+	gconstpointer outdata = NULL;
+
+	if( ++datapipe_exec_depth > datapipe_exec_depth_max ) {
+		datapipe_exec_depth_max = datapipe_exec_depth;
+		mce_log(LL_DEBUG, "datapipe cascade depth: %u",
+			datapipe_exec_depth_max);
+	}
+
+	mce_journal_record(datapipe, indata,
+			   datapipe_journal_flags(use_cache, cache_indata),
+			   datapipe_exec_depth);
+
+	outdata = datapipe_exec_real(datapipe, indata, use_cache,
+				     cache_indata);
+
+	/* Queued executions are run while still at nesting level one,
+	 * so that executions they post get queued too */
+	if( datapipe_exec_depth == 1 )
+		datapipe_run_queue_drain();
+
+	datapipe_exec_depth -= 1;
+
+	return outdata;
+}
+
+/**
+ * Execute the datapipe after the ongoing datapipe execution
+ *
+ * When called from within datapipe triggers or filters, the data is
+ * put to a run queue that is processed in order when the outermost
+ * datapipe execution finishes. If the datapipe is already queued, the
+ * earlier data is replaced, i.e. only the latest value gets executed.
+ * This flattens execution cascades and avoids executing intermediate
+ * values nobody needs. Outside datapipe execution the datapipe is
+ * executed immediately.
+ *
+ * Use only for datapipes where the latest value supersedes the
+ * earlier ones, i.e. state requests rather than events.
+ *
+ * @param datapipe The datapipe to execute
+ * @param indata The input data to run through the datapipe
+ * @param cache_indata CACHE_INDATA to cache the indata,
+ *                     DONT_CACHE_INDATA to keep the old data
+ */
+void datapipe_exec_queued(datapipe_struct *const datapipe,
+			  gpointer indata,
+			  const caching_policy_t cache_indata)
+{
+	datapipe_queued_t *queued = NULL;
+
+	if (datapipe == NULL) {
+		mce_log(LL_ERR,
+			"datapipe_exec_queued() called "
+			"without a valid datapipe");
+		goto EXIT;
+	}
+
+	/* Dynamic data can't be dropped without leaking memory */
+	if( datapipe_exec_depth == 0 || datapipe->free_cache == FREE_CACHE ) {
+		datapipe_exec_full(datapipe, indata, USE_INDATA, cache_indata);
+		goto EXIT;
+	}
+
+	for( GList *iter = datapipe_run_queue.head; iter; iter = iter->next ) {
+		datapipe_queued_t *item = iter->data;
+
+		if( item->datapipe == datapipe ) {
+			queued = item;
+			break;
+		}
+	}
+
+	if( queued ) {
+		datapipe_collapsed_total += 1;
+	}
+	else {
+		queued = g_malloc0(sizeof *queued);
+		queued->datapipe = datapipe;
+		g_queue_push_tail(&datapipe_run_queue, queued);
+		datapipe_queued_total += 1;
+	}
+
+	queued->indata       = indata;
+	queued->cache_indata = cache_indata;
+
+EXIT:
+	return;
+}
+
 /**
  * Append a filter to an existing datapipe
  *
@@ -678,18 +932,22 @@ EXIT:
  *                  READ_WRITE if it's read/write
  * @param free_cache FREE_CACHE if the cached data needs to be freed,
  *                   DONT_FREE_CACHE if the cache data should not be freed
+ * @param change_policy FIRE_ON_CHANGE if executions that would not
+ *                      change the output value can be skipped,
+ *                      FIRE_ALWAYS if every execution must run triggers
  * @param datasize Pass size of memory to copy,
  *		   or 0 if only passing pointers or data as pointers
  * @param initial_data Initial cache content
  */
-void datapipe_init(datapipe_struct *const datapipe,
-		   const read_only_policy_t read_only,
-		   const cache_free_policy_t free_cache,
-		   const gsize datasize, gpointer initial_data)
+void datapipe_init_full(datapipe_struct *const datapipe,
+			const read_only_policy_t read_only,
+			const cache_free_policy_t free_cache,
+			const change_policy_t change_policy,
+			const gsize datasize, gpointer initial_data)
 {
 	if (datapipe == NULL) {
 		mce_log(LL_ERR,
-			"datapipe_init() called "
+			"datapipe_init_full() called "
 			"without a valid datapipe");
 		goto EXIT;
 	}
@@ -701,11 +959,46 @@ void datapipe_init(datapipe_struct *const datapipe,
 	datapipe->read_only = read_only;
 	datapipe->free_cache = free_cache;
 	datapipe->cached_data = initial_data;
+	datapipe->change_only = (change_policy == FIRE_ON_CHANGE);
+	datapipe->last_outdata = NULL;
+	datapipe->have_outdata = FALSE;
+	datapipe->exec_count = 0;
+	datapipe->skip_count = 0;
+	datapipe->journal_id = 0;
+
+	/* Equality is evaluated by comparing pointer values, which
+	 * is meaningless for dynamically allocated data */
+	if (datapipe->change_only && free_cache == FREE_CACHE) {
+		mce_log(LL_WARN, "change only policy not applicable "
+			"to dynamic data; ignored");
+		datapipe->change_only = FALSE;
+	}
 
 EXIT:
 	return;
 }
 
+/**
+ * Initialise a datapipe that executes triggers on every input
+ *
+ * @param datapipe The datapipe to manipulate
+ * @param read_only READ_ONLY if the datapipe is read only,
+ *                  READ_WRITE if it's read/write
+ * @param free_cache FREE_CACHE if the cached data needs to be freed,
+ *                   DONT_FREE_CACHE if the cache data should not be freed
+ * @param datasize Pass size of memory to copy,
+ *		   or 0 if only passing pointers or data as pointers
+ * @param initial_data Initial cache content
+ */
+void datapipe_init(datapipe_struct *const datapipe,
+		   const read_only_policy_t read_only,
+		   const cache_free_policy_t free_cache,
+		   const gsize datasize, gpointer initial_data)
+{
+	datapipe_init_full(datapipe, read_only, free_cache, FIRE_ALWAYS,
+			   datasize, initial_data);
+}
+
 /**
  * Deinitialize a datapipe
  *
@@ -787,6 +1080,8 @@ void mce_datapipe_init(void)
 		      0, NULL);
 	datapipe_init(&user_activity_event_pipe, READ_ONLY, DONT_FREE_CACHE,
 		      0, NULL);
+	datapipe_init(&cpu_boost_event_pipe, READ_ONLY, DONT_FREE_CACHE,
+		      0, NULL);
 	datapipe_init(&key_backlight_brightness_pipe, READ_WRITE, DONT_FREE_CACHE,
 		      0, GINT_TO_POINTER(0));
 	datapipe_init(&keypress_event_pipe, READ_ONLY, FREE_CACHE,
@@ -803,8 +1098,8 @@ void mce_datapipe_init(void)
 		      0, GINT_TO_POINTER(TRISTATE_UNKNOWN));
 	datapipe_init(&keyboard_slide_state_pipe, READ_ONLY, DONT_FREE_CACHE,
 		      0, GINT_TO_POINTER(COVER_CLOSED));
-	datapipe_init(&keyboard_available_state_pipe, READ_ONLY, DONT_FREE_CACHE,
-		      0, GINT_TO_POINTER(COVER_CLOSED));
+	datapipe_init_full(&keyboard_available_state_pipe, READ_ONLY, DONT_FREE_CACHE,
+			   FIRE_ON_CHANGE, 0, GINT_TO_POINTER(COVER_CLOSED));
 	datapipe_init(&lid_sensor_is_working_pipe, READ_ONLY,
 		      DONT_FREE_CACHE, 0, GINT_TO_POINTER(FALSE));
 	datapipe_init(&lid_sensor_actual_pipe, READ_ONLY, DONT_FREE_CACHE,
@@ -827,12 +1122,12 @@ void mce_datapipe_init(void)
 		      0, GINT_TO_POINTER(TKLOCK_REQUEST_UNDEF));
 	datapipe_init(&interaction_expected_pipe, READ_ONLY, DONT_FREE_CACHE,
 		      0, GINT_TO_POINTER(false));
-	datapipe_init(&charger_state_pipe, READ_ONLY, DONT_FREE_CACHE,
-		      0, GINT_TO_POINTER(CHARGER_STATE_UNDEF));
-	datapipe_init(&battery_status_pipe, READ_ONLY, DONT_FREE_CACHE,
-		      0, GINT_TO_POINTER(BATTERY_STATUS_UNDEF));
-	datapipe_init(&battery_level_pipe, READ_ONLY, DONT_FREE_CACHE,
-		      0, GINT_TO_POINTER(BATTERY_LEVEL_INITIAL));
+	datapipe_init_full(&charger_state_pipe, READ_ONLY, DONT_FREE_CACHE,
+			   FIRE_ON_CHANGE, 0, GINT_TO_POINTER(CHARGER_STATE_UNDEF));
+	datapipe_init_full(&battery_status_pipe, READ_ONLY, DONT_FREE_CACHE,
+			   FIRE_ON_CHANGE, 0, GINT_TO_POINTER(BATTERY_STATUS_UNDEF));
+	datapipe_init_full(&battery_level_pipe, READ_ONLY, DONT_FREE_CACHE,
+			   FIRE_ON_CHANGE, 0, GINT_TO_POINTER(BATTERY_LEVEL_INITIAL));
 	datapipe_init(&topmost_window_pid_pipe, READ_ONLY, DONT_FREE_CACHE,
 		      0, GINT_TO_POINTER(-1));
 	datapipe_init(&camera_button_state_pipe, READ_ONLY, DONT_FREE_CACHE,
@@ -841,43 +1136,43 @@ void mce_datapipe_init(void)
 		      0, GINT_TO_POINTER(DEFAULT_INACTIVITY_DELAY));
 	datapipe_init(&audio_route_pipe, READ_ONLY, DONT_FREE_CACHE,
 		      0, GINT_TO_POINTER(AUDIO_ROUTE_UNDEF));
-	datapipe_init(&usb_cable_state_pipe, READ_ONLY, DONT_FREE_CACHE,
-		      0, GINT_TO_POINTER(USB_CABLE_UNDEF));
-	datapipe_init(&jack_sense_state_pipe, READ_ONLY, DONT_FREE_CACHE,
-		      0, GINT_TO_POINTER(COVER_UNDEF));
-	datapipe_init(&power_saving_mode_active_pipe, READ_ONLY, DONT_FREE_CACHE,
-		      0, GINT_TO_POINTER(FALSE));
-	datapipe_init(&thermal_state_pipe, READ_ONLY, DONT_FREE_CACHE,
-		      0, GINT_TO_POINTER(THERMAL_STATE_UNDEF));
+	datapipe_init_full(&usb_cable_state_pipe, READ_ONLY, DONT_FREE_CACHE,
+			   FIRE_ON_CHANGE, 0, GINT_TO_POINTER(USB_CABLE_UNDEF));
+	datapipe_init_full(&jack_sense_state_pipe, READ_ONLY, DONT_FREE_CACHE,
+			   FIRE_ON_CHANGE, 0, GINT_TO_POINTER(COVER_UNDEF));
+	datapipe_init_full(&power_saving_mode_active_pipe, READ_ONLY, DONT_FREE_CACHE,
+			   FIRE_ON_CHANGE, 0, GINT_TO_POINTER(FALSE));
+	datapipe_init_full(&thermal_state_pipe, READ_ONLY, DONT_FREE_CACHE,
+			   FIRE_ON_CHANGE, 0, GINT_TO_POINTER(THERMAL_STATE_UNDEF));
 	datapipe_init(&heartbeat_event_pipe, READ_ONLY, DONT_FREE_CACHE,
 		      0, GINT_TO_POINTER(0));
-	datapipe_init(&compositor_service_state_pipe, READ_ONLY, DONT_FREE_CACHE,
-		      0, GINT_TO_POINTER(SERVICE_STATE_UNDEF));
-	datapipe_init(&lipstick_service_state_pipe, READ_ONLY, DONT_FREE_CACHE,
-		      0, GINT_TO_POINTER(SERVICE_STATE_UNDEF));
-	datapipe_init(&devicelock_service_state_pipe, READ_ONLY, DONT_FREE_CACHE,
-		      0, GINT_TO_POINTER(SERVICE_STATE_UNDEF));
-	datapipe_init(&usbmoded_service_state_pipe, READ_ONLY, DONT_FREE_CACHE,
-		      0, GINT_TO_POINTER(SERVICE_STATE_UNDEF));
-	datapipe_init(&ngfd_service_state_pipe, READ_ONLY, DONT_FREE_CACHE,
-		      0, GINT_TO_POINTER(SERVICE_STATE_UNDEF));
+	datapipe_init_full(&compositor_service_state_pipe, READ_ONLY, DONT_FREE_CACHE,
+			   FIRE_ON_CHANGE, 0, GINT_TO_POINTER(SERVICE_STATE_UNDEF));
+	datapipe_init_full(&lipstick_service_state_pipe, READ_ONLY, DONT_FREE_CACHE,
+			   FIRE_ON_CHANGE, 0, GINT_TO_POINTER(SERVICE_STATE_UNDEF));
+	datapipe_init_full(&devicelock_service_state_pipe, READ_ONLY, DONT_FREE_CACHE,
+			   FIRE_ON_CHANGE, 0, GINT_TO_POINTER(SERVICE_STATE_UNDEF));
+	datapipe_init_full(&usbmoded_service_state_pipe, READ_ONLY, DONT_FREE_CACHE,
+			   FIRE_ON_CHANGE, 0, GINT_TO_POINTER(SERVICE_STATE_UNDEF));
+	datapipe_init_full(&ngfd_service_state_pipe, READ_ONLY, DONT_FREE_CACHE,
+			   FIRE_ON_CHANGE, 0, GINT_TO_POINTER(SERVICE_STATE_UNDEF));
 	datapipe_init(&ngfd_event_request_pipe, READ_ONLY, DONT_FREE_CACHE,
 		      0, NULL);
 
-	datapipe_init(&dsme_service_state_pipe, READ_ONLY, DONT_FREE_CACHE,
-		      0, GINT_TO_POINTER(SERVICE_STATE_UNDEF));
+	datapipe_init_full(&dsme_service_state_pipe, READ_ONLY, DONT_FREE_CACHE,
+			   FIRE_ON_CHANGE, 0, GINT_TO_POINTER(SERVICE_STATE_UNDEF));
 
-	datapipe_init(&bluez_service_state_pipe, READ_ONLY, DONT_FREE_CACHE,
-		      0, GINT_TO_POINTER(SERVICE_STATE_UNDEF));
+	datapipe_init_full(&bluez_service_state_pipe, READ_ONLY, DONT_FREE_CACHE,
+			   FIRE_ON_CHANGE, 0, GINT_TO_POINTER(SERVICE_STATE_UNDEF));
 
-	datapipe_init(&packagekit_locked_pipe, READ_ONLY, DONT_FREE_CACHE,
-		      0, GINT_TO_POINTER(FALSE));
-	datapipe_init(&osupdate_running_pipe, READ_ONLY, DONT_FREE_CACHE,
-		      0, GINT_TO_POINTER(FALSE));
-	datapipe_init(&shutting_down_pipe, READ_ONLY, DONT_FREE_CACHE,
-		      0, GINT_TO_POINTER(FALSE));
-	datapipe_init(&devicelock_state_pipe, READ_ONLY, DONT_FREE_CACHE,
-		      0, GINT_TO_POINTER(DEVICELOCK_STATE_UNDEFINED));
+	datapipe_init_full(&packagekit_locked_pipe, READ_ONLY, DONT_FREE_CACHE,
+			   FIRE_ON_CHANGE, 0, GINT_TO_POINTER(FALSE));
+	datapipe_init_full(&osupdate_running_pipe, READ_ONLY, DONT_FREE_CACHE,
+			   FIRE_ON_CHANGE, 0, GINT_TO_POINTER(FALSE));
+	datapipe_init_full(&shutting_down_pipe, READ_ONLY, DONT_FREE_CACHE,
+			   FIRE_ON_CHANGE, 0, GINT_TO_POINTER(FALSE));
+	datapipe_init_full(&devicelock_state_pipe, READ_ONLY, DONT_FREE_CACHE,
+			   FIRE_ON_CHANGE, 0, GINT_TO_POINTER(DEVICELOCK_STATE_UNDEFINED));
 	datapipe_init(&touch_detected_pipe, READ_ONLY, DONT_FREE_CACHE,
 		      0, GINT_TO_POINTER(FALSE));
 	datapipe_init(&touch_grab_wanted_pipe, READ_ONLY, DONT_FREE_CACHE,
@@ -888,24 +1183,30 @@ void mce_datapipe_init(void)
 		      0, GINT_TO_POINTER(FALSE));
 	datapipe_init(&keypad_grab_active_pipe, READ_ONLY, DONT_FREE_CACHE,
 		      0, GINT_TO_POINTER(FALSE));
-	datapipe_init(&music_playback_ongoing_pipe, READ_ONLY, DONT_FREE_CACHE,
-		      0, GINT_TO_POINTER(FALSE));
+	datapipe_init_full(&music_playback_ongoing_pipe, READ_ONLY, DONT_FREE_CACHE,
+			   FIRE_ON_CHANGE, 0, GINT_TO_POINTER(FALSE));
 	datapipe_init(&proximity_blanked_pipe, READ_ONLY, DONT_FREE_CACHE,
 		      0, GINT_TO_POINTER(FALSE));
     datapipe_init(&wristgesture_sensor_pipe, READ_ONLY, DONT_FREE_CACHE,
                0, GINT_TO_POINTER(FALSE));
-	datapipe_init(&fpd_service_state_pipe, READ_ONLY, DONT_FREE_CACHE,
-		      0, GINT_TO_POINTER(SERVICE_STATE_UNDEF));
+	datapipe_init_full(&fpd_service_state_pipe, READ_ONLY, DONT_FREE_CACHE,
+			   FIRE_ON_CHANGE, 0, GINT_TO_POINTER(SERVICE_STATE_UNDEF));
 	datapipe_init(&fpstate_pipe, READ_ONLY, DONT_FREE_CACHE,
 		      0, GINT_TO_POINTER(FPSTATE_UNSET));
-	datapipe_init(&enroll_in_progress_pipe, READ_ONLY, DONT_FREE_CACHE,
-		      0, GINT_TO_POINTER(false));
+	datapipe_init_full(&enroll_in_progress_pipe, READ_ONLY, DONT_FREE_CACHE,
+			   FIRE_ON_CHANGE, 0, GINT_TO_POINTER(false));
 }
 
 /** Free all datapipes
  */
 void mce_datapipe_quit(void)
 {
+	mce_log(LL_DEBUG, "datapipe executions: %u, skipped as unchanged: %u",
+		datapipe_exec_total, datapipe_skip_total);
+	mce_log(LL_DEBUG, "datapipe cascade depth max: %u, queued: %u,"
+		" collapsed: %u", datapipe_exec_depth_max,
+		datapipe_queued_total, datapipe_collapsed_total);
+
 	datapipe_free(&thermal_state_pipe);
 	datapipe_free(&power_saving_mode_active_pipe);
 	datapipe_free(&jack_sense_state_pipe);
@@ -937,6 +1238,7 @@ void mce_datapipe_quit(void)
 	datapipe_free(&touchscreen_event_pipe);
 	datapipe_free(&keypress_event_pipe);
 	datapipe_free(&key_backlight_brightness_pipe);
+	datapipe_free(&cpu_boost_event_pipe);
 	datapipe_free(&user_activity_event_pipe);
 	datapipe_free(&led_pattern_deactivate_pipe);
 	datapipe_free(&led_pattern_activate_pipe);
@@ -52,6 +52,12 @@ typedef struct {
 	gsize datasize;			/**< Size of data; NULL == automagic */
 	gboolean free_cache;		/**< Free the cache? */
 	gboolean read_only;		/**< Datapipe is read only */
+	gboolean change_only;		/**< Skip execution of unchanged data */
+	gconstpointer last_outdata;	/**< Latest data fed to output triggers */
+	gboolean have_outdata;		/**< last_outdata is valid */
+	guint exec_count;		/**< Number of executions */
+	guint skip_count;		/**< Number of skipped executions */
+	guint journal_id;		/**< Journal pipe id; 0 = not journaled */
 } datapipe_struct;
 
 /**
@@ -70,6 +76,14 @@ typedef enum {
 	FREE_CACHE = TRUE		/**< Free the cache */
 } cache_free_policy_t;
 
+/**
+ * Policy for executing the datapipe with unchanged data
+ */
+typedef enum {
+	FIRE_ALWAYS = FALSE,		/**< Execute triggers on every input */
+	FIRE_ON_CHANGE = TRUE		/**< Skip execution if data is unchanged */
+} change_policy_t;
+
 /**
  * Policy for the data source
  */
@@ -96,6 +110,7 @@ extern datapipe_struct led_pattern_activate_pipe;
 extern datapipe_struct led_pattern_deactivate_pipe;
 extern datapipe_struct resume_detected_event_pipe;
 extern datapipe_struct user_activity_event_pipe;
+extern datapipe_struct cpu_boost_event_pipe;
 extern datapipe_struct display_state_curr_pipe;
 extern datapipe_struct display_state_request_pipe;
 extern datapipe_struct display_state_next_pipe;
@@ -193,6 +208,9 @@ gconstpointer datapipe_exec_full(datapipe_struct *const datapipe,
 				 gpointer indata,
 				 const data_source_t use_cache,
 				 const caching_policy_t cache_indata);
+void datapipe_exec_queued(datapipe_struct *const datapipe,
+			  gpointer indata,
+			  const caching_policy_t cache_indata);
 
 /* Filters */
 void datapipe_add_filter(datapipe_struct *const datapipe,
@@ -216,6 +234,11 @@ void datapipe_init(datapipe_struct *const datapipe,
 		   const read_only_policy_t read_only,
 		   const cache_free_policy_t free_cache,
 		   const gsize datasize, gpointer initial_data);
+void datapipe_init_full(datapipe_struct *const datapipe,
+			const read_only_policy_t read_only,
+			const cache_free_policy_t free_cache,
+			const change_policy_t change_policy,
+			const gsize datasize, gpointer initial_data);
 void datapipe_free(datapipe_struct *const datapipe);
 
 /* Binding arrays */
@@ -273,10 +296,12 @@ void mce_datapipe_quit(void);
     /* But the request must always be fed to the datapipe \
      * because during already ongoing transition something \
      * else might be already queued up and we want't the \
-     * last request to reach the queue to "win". */ \
-    datapipe_exec_full(&display_state_request_pipe,\
-		       GINT_TO_POINTER(req_target),\
-		       USE_INDATA, CACHE_OUTDATA);\
+     * last request to reach the queue to "win". Requests made \
+     * from datapipe callbacks are deferred until the ongoing \
+     * datapipe execution has finished. */ \
+    datapipe_exec_queued(&display_state_request_pipe,\
+			 GINT_TO_POINTER(req_target),\
+			 CACHE_OUTDATA);\
 } while(0)
 
 #endif /* _DATAPIPE_H_ */
@@ -288,7 +313,7 @@ void mce_datapipe_quit(void);
 #define mce_datapipe_request_tklock(tklock_request) do {\
     mce_log(LL_DEBUG, "Requesting tklock=%s",\
 	    tklock_request_repr(tklock_request));\
-    datapipe_exec_full(&tklock_request_pipe,\
-		       GINT_TO_POINTER(tklock_request),\
-		       USE_INDATA, CACHE_INDATA);\
+    datapipe_exec_queued(&tklock_request_pipe,\
+			 GINT_TO_POINTER(tklock_request),\
+			 CACHE_INDATA);\
 }while(0)
@@ -43,6 +43,8 @@
 #include <string.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <signal.h>
+#include <pthread.h>
 
 #include <glib/gstdio.h>
 #include <gio/gio.h>
@@ -321,6 +323,33 @@ static void         evin_iomon_keyboard_state_update            (void);
 static bool         evin_iomon_init                             (void);
 static void         evin_iomon_quit                             (void);
 
+/* ------------------------------------------------------------------------- *
+ * EVDEV_PREFETCH
+ * ------------------------------------------------------------------------- */
+
+/** Evdev device node opened by the prefetch thread */
+typedef struct
+{
+    /** Path to the device node */
+    gchar *pf_path;
+
+    /** File descriptor for the device node, or -1 */
+    int    pf_fd;
+
+    /** Device name as reported by the driver */
+    char   pf_name[256];
+} evin_prefetch_t;
+
+static evin_prefetch_t *evin_prefetch_create                    (const char *path);
+static void             evin_prefetch_delete_cb                 (void *aptr);
+
+static void            *evin_prefetch_thread_cb                 (void *aptr);
+static void             evin_prefetch_join                      (void);
+static evin_prefetch_t *evin_prefetch_take                      (const char *path);
+static void             evin_prefetch_quit                      (void);
+
+void                    mce_input_prefetch                      (void);
+
 /* ------------------------------------------------------------------------- *
  * EVDEV_DIRECTORY_MONITORING
  * ------------------------------------------------------------------------- */
@@ -2068,6 +2097,18 @@ evin_iomon_touchscreen_cb(mce_io_mon_t *iomon, gpointer data, gsize bytes_read)
     if( submode & MCE_SUBMODE_EVEATER )
         goto EXIT;
 
+    if( (ev->type == EV_MSC && ev->code == MSC_GESTURE) ||
+        (ev->type == EV_KEY && ev->code == BTN_TOUCH && ev->value == 1) ) {
+        /* Gestures and touches while display is off are
+         * likely to lead to display power up */
+        display_state_t display_state_next =
+            datapipe_get_gint(display_state_next_pipe);
+
+        if( display_state_next != MCE_DISPLAY_ON )
+            datapipe_exec_output_triggers(&cpu_boost_event_pipe,
+                                          ev, USE_INDATA);
+    }
+
     if( ev->type == EV_MSC && ev->code == MSC_GESTURE ) {
         /* Gesture events count as actual non-synthetized
          * user activity. */
@@ -2347,19 +2388,29 @@ evin_iomon_device_add(const gchar *path)
     evin_iomon_extra_t   *extra  = 0;
     mce_io_mon_t         *iomon  = 0;
 
+    evin_prefetch_t      *pf     = 0;
+
     char  name[256];
     const gchar * const *black;
 
-    /* If we cannot open the file, abort */
-    if( (fd = open(path, O_NONBLOCK | O_RDONLY)) == -1 ) {
-        mce_log(LL_WARN, "Failed to open `%s', skipping", path);
-        goto EXIT;
+    if( (pf = evin_prefetch_take(path)) ) {
+        /* Use the device node opened during startup */
+        fd = pf->pf_fd, pf->pf_fd = -1;
+        g_strlcpy(name, pf->pf_name, sizeof name);
+        evin_prefetch_delete_cb(pf), pf = 0;
     }
+    else {
+        /* If we cannot open the file, abort */
+        if( (fd = open(path, O_NONBLOCK | O_RDONLY)) == -1 ) {
+            mce_log(LL_WARN, "Failed to open `%s', skipping", path);
+            goto EXIT;
+        }
 
-    /* Get name of the evdev node */
-    if( ioctl(fd, EVIOCGNAME(sizeof name), name) < 0 ) {
-        mce_log(LL_WARN, "ioctl(EVIOCGNAME) failed on `%s'", path);
-        goto EXIT;
+        /* Get name of the evdev node */
+        if( ioctl(fd, EVIOCGNAME(sizeof name), name) < 0 ) {
+            mce_log(LL_WARN, "ioctl(EVIOCGNAME) failed on `%s'", path);
+            goto EXIT;
+        }
     }
 
     /* Check if the device is blacklisted by name in the config files */
@@ -2705,6 +2756,12 @@ evin_iomon_init(void)
     bool  res = false;
     DIR  *dir = NULL;
 
+    /* Wait for the device nodes opened in background */
+    evin_prefetch_join();
+
+    /* Device nodes that are still present are picked from the
+     * prefetched set by evin_iomon_device_add(), everything else
+     * is opened and probed as usual */
     if( !(dir = opendir(DEV_INPUT_PATH)) ) {
         mce_log(LL_ERR, "opendir() failed; %m");
         goto EXIT;
@@ -2729,6 +2786,9 @@ EXIT:
     if( dir && closedir(dir) == -1 )
         mce_log(LL_ERR, "closedir() failed; %m");
 
+    /* Release prefetched device nodes that have disappeared */
+    evin_prefetch_quit();
+
     return res;
 }
 
@@ -2740,6 +2800,214 @@ evin_iomon_quit(void)
     evin_iomon_device_rem_all();
 }
 
+/* ========================================================================= *
+ * EVDEV_PREFETCH
+ * ========================================================================= */
+
+/** Prefetch thread id */
+static pthread_t   evin_prefetch_tid;
+
+/** Flag for: prefetch thread has been started and not joined yet */
+static bool        evin_prefetch_running = false;
+
+/** Prefetched device nodes; path -> evin_prefetch_t
+ *
+ * Populated by the prefetch thread, accessed from the main thread
+ * only after the thread has been joined.
+ */
+static GHashTable *evin_prefetch_lut = 0;
+
+/** Create prefetch entry for an evdev device node
+ *
+ * Note: Executed in the prefetch thread context.
+ *
+ * @param path  Path to the device node
+ *
+ * @return entry with open file descriptor and device name, or
+ *         NULL if the node can't be opened or probed
+ */
+static evin_prefetch_t *
+evin_prefetch_create(const char *path)
+{
+    evin_prefetch_t *self = g_malloc0(sizeof *self);
+
+    self->pf_path = g_strdup(path);
+    self->pf_fd   = open(path, O_NONBLOCK | O_RDONLY);
+
+    if( self->pf_fd == -1 )
+        goto FAIL;
+
+    if( ioctl(self->pf_fd, EVIOCGNAME(sizeof self->pf_name),
+              self->pf_name) < 0 )
+        goto FAIL;
+
+    self->pf_name[sizeof self->pf_name - 1] = 0;
+
+    return self;
+
+FAIL:
+    /* Leave diagnostics to the main thread open attempt */
+    evin_prefetch_delete_cb(self);
+    return 0;
+}
+
+/** Delete prefetch entry
+ *
+ * @param aptr  evin_prefetch_t object as void pointer
+ */
+static void
+evin_prefetch_delete_cb(void *aptr)
+{
+    evin_prefetch_t *self = aptr;
+
+    if( !self )
+        goto EXIT;
+
+    if( self->pf_fd != -1 )
+        close(self->pf_fd);
+
+    g_free(self->pf_path);
+    g_free(self);
+
+EXIT:
+    return;
+}
+
+/** Prefetch thread: open and identify evdev device nodes
+ *
+ * Opening device nodes and querying names can take a while
+ * when drivers are slow to respond. Doing it in parallel with
+ * the rest of mce initialization shortens the startup.
+ *
+ * @param aptr  (unused)
+ *
+ * @return NULL
+ */
+static void *
+evin_prefetch_thread_cb(void *aptr)
+{
+    (void)aptr;
+
+    static const char pfix[] = EVENT_FILE_PREFIX;
+
+    DIR *dir = 0;
+
+    /* Leave signal handling to the main thread */
+    sigset_t ss;
+    sigfillset(&ss);
+    pthread_sigmask(SIG_BLOCK, &ss, 0);
+
+    if( !(dir = opendir(DEV_INPUT_PATH)) )
+        goto EXIT;
+
+    struct dirent *de;
+
+    while( (de = readdir(dir)) != 0 ) {
+        if( strncmp(de->d_name, pfix, sizeof pfix - 1) )
+            continue;
+
+        gchar *path = g_strdup_printf("%s/%s", DEV_INPUT_PATH, de->d_name);
+        evin_prefetch_t *pf = evin_prefetch_create(path);
+        g_free(path);
+
+        if( pf )
+            g_hash_table_replace(evin_prefetch_lut, pf->pf_path, pf);
+    }
+
+EXIT:
+    if( dir )
+        closedir(dir);
+
+    return 0;
+}
+
+/** Start opening evdev device nodes in a background thread
+ *
+ * Should be called early on during mce startup. The prefetched
+ * device nodes are consumed when input device monitoring is
+ * initialized from mce_input_init().
+ */
+void
+mce_input_prefetch(void)
+{
+    if( evin_prefetch_running || evin_prefetch_lut )
+        goto EXIT;
+
+    evin_prefetch_lut = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                              0, evin_prefetch_delete_cb);
+
+    int err = pthread_create(&evin_prefetch_tid, 0,
+                             evin_prefetch_thread_cb, 0);
+    if( err ) {
+        mce_log(LL_WARN, "failed to start prefetch thread: %s",
+                g_strerror(err));
+        goto EXIT;
+    }
+
+    evin_prefetch_running = true;
+
+EXIT:
+    return;
+}
+
+/** Wait for the prefetch thread to finish
+ */
+static void
+evin_prefetch_join(void)
+{
+    if( !evin_prefetch_running )
+        goto EXIT;
+
+    evin_prefetch_running = false;
+
+    int64_t t0 = mce_lib_get_boot_tick();
+    pthread_join(evin_prefetch_tid, 0);
+    int64_t t1 = mce_lib_get_boot_tick();
+
+    mce_log(LL_DEBUG, "prefetched %u device nodes; waited %" G_GINT64_FORMAT
+            " ms", evin_prefetch_lut ? g_hash_table_size(evin_prefetch_lut) : 0,
+            t1 - t0);
+
+EXIT:
+    return;
+}
+
+/** Detach prefetched device node entry
+ *
+ * @param path  Path to the device node
+ *
+ * @return prefetch entry that the caller must release, or NULL
+ */
+static evin_prefetch_t *
+evin_prefetch_take(const char *path)
+{
+    evin_prefetch_t *pf = 0;
+
+    if( evin_prefetch_running || !evin_prefetch_lut )
+        goto EXIT;
+
+    if( !(pf = g_hash_table_lookup(evin_prefetch_lut, path)) )
+        goto EXIT;
+
+    g_hash_table_steal(evin_prefetch_lut, path);
+
+EXIT:
+    return pf;
+}
+
+/** Release all remaining prefetched device nodes
+ */
+static void
+evin_prefetch_quit(void)
+{
+    evin_prefetch_join();
+
+    if( evin_prefetch_lut ) {
+        g_hash_table_unref(evin_prefetch_lut),
+            evin_prefetch_lut = 0;
+    }
+}
+
 /* ========================================================================= *
  * EVDEV_DIRECTORY_MONITORING
  * ========================================================================= */
@@ -3983,6 +4251,9 @@ mce_input_exit(void)
 
     evin_iomon_quit();
 
+    /* Release device nodes in case startup did not get to using them */
+    evin_prefetch_quit();
+
     /* Reset input grab state machines */
     evin_ts_grab_quit();
     evin_input_grab_reset(&evin_kp_grab_state);
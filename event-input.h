@@ -114,6 +114,7 @@
  * Functions
  * ========================================================================= */
 
+void     mce_input_prefetch(void);
 gboolean mce_input_init(void);
 void     mce_input_exit(void);
 
@@ -29,10 +29,46 @@
 #include <mce/dbus-names.h>
 #include <mce/mode-names.h>
 
+/* ========================================================================= *
+ * TYPES
+ * ========================================================================= */
+
+/** Items included in state snapshot */
+typedef enum
+{
+    COMMON_STATE_DISPLAY_STATUS,
+    COMMON_STATE_TKLOCK_MODE,
+    COMMON_STATE_CALL_STATE,
+    COMMON_STATE_CALL_TYPE,
+    COMMON_STATE_USB_CABLE_STATE,
+    COMMON_STATE_CHARGER_STATE,
+    COMMON_STATE_BATTERY_STATUS,
+    COMMON_STATE_BATTERY_LEVEL,
+    COMMON_STATE_PSM_STATE,
+    COMMON_STATE_RADIO_MASTER,
+    COMMON_STATE_INACTIVITY,
+
+    COMMON_STATE_COUNT
+} common_state_t;
+
 /* ========================================================================= *
  * PROTOTYPES
  * ========================================================================= */
 
+// STATE_SNAPSHOT
+static dbus_int32_t common_state_battery_level    (void);
+static void     common_state_eval                 (common_state_t id, dbus_any_t *val);
+static bool     common_state_equal                (common_state_t id, const dbus_any_t *a, const dbus_any_t *b);
+static bool     common_state_append               (DBusMessageIter *array, const char *key, int type, const dbus_any_t *val);
+static gboolean common_state_snapshot_get_cb      (DBusMessage *const req);
+static gboolean common_state_changed_cb           (gpointer aptr);
+static void     common_state_schedule             (void);
+static void     common_state_cancel               (void);
+static gboolean common_state_subscriber_lost_cb   (DBusMessage *const sig);
+static gboolean common_state_subscribe_cb         (DBusMessage *const req);
+static gboolean common_state_unsubscribe_cb       (DBusMessage *const req);
+static void     common_state_quit                 (void);
+
 // DBUS_FUNCTIONS
 static void     common_dbus_send_usb_cable_state  (DBusMessage *const req);
 static gboolean common_dbus_get_usb_cable_state_cb(DBusMessage *const req);
@@ -46,6 +82,7 @@ static void     common_dbus_init                  (void);
 static void     common_dbus_quit                  (void);
 
 // DATAPIPE_FUNCTIONS
+static void     common_datapipe_state_changed_cb  (gconstpointer data);
 static void     common_datapipe_usb_cable_state_cb(gconstpointer data);
 static void     common_datapipe_charger_state_cb  (gconstpointer data);
 static void     common_datapipe_battery_status_cb (gconstpointer data);
@@ -73,6 +110,463 @@ static battery_status_t battery_status = BATTERY_STATUS_UNDEF;
 /** Battery charge level: assume 100% */
 static gint battery_level = BATTERY_LEVEL_INITIAL;
 
+/* ========================================================================= *
+ * STATE_SNAPSHOT
+ * ========================================================================= */
+
+/** Maximum number of state change signal subscribers */
+#define COMMON_STATE_MAX_SUBSCRIBERS 32
+
+/** Information about state snapshot item */
+typedef struct
+{
+    /** Key used in a{sv} dictionaries */
+    const char *key;
+
+    /** D-Bus type of the value */
+    int         type;
+} common_state_info_t;
+
+/** State snapshot item lookup table */
+static const common_state_info_t common_state_info[COMMON_STATE_COUNT] =
+{
+    [COMMON_STATE_DISPLAY_STATUS]  = { "display_status",  DBUS_TYPE_STRING  },
+    [COMMON_STATE_TKLOCK_MODE]     = { "tklock_mode",     DBUS_TYPE_STRING  },
+    [COMMON_STATE_CALL_STATE]      = { "call_state",      DBUS_TYPE_STRING  },
+    [COMMON_STATE_CALL_TYPE]       = { "call_type",       DBUS_TYPE_STRING  },
+    [COMMON_STATE_USB_CABLE_STATE] = { "usb_cable_state", DBUS_TYPE_STRING  },
+    [COMMON_STATE_CHARGER_STATE]   = { "charger_state",   DBUS_TYPE_STRING  },
+    [COMMON_STATE_BATTERY_STATUS]  = { "battery_status",  DBUS_TYPE_STRING  },
+    [COMMON_STATE_BATTERY_LEVEL]   = { "battery_level",   DBUS_TYPE_INT32   },
+    [COMMON_STATE_PSM_STATE]       = { "psm_state",       DBUS_TYPE_BOOLEAN },
+    [COMMON_STATE_RADIO_MASTER]    = { "radio_master",    DBUS_TYPE_BOOLEAN },
+    [COMMON_STATE_INACTIVITY]      = { "inactivity",      DBUS_TYPE_BOOLEAN },
+};
+
+/** Values included in the latest state change signal */
+static dbus_any_t common_state_sent[COMMON_STATE_COUNT];
+
+/** Idle callback id for broadcasting state changes */
+static guint common_state_changed_id = 0;
+
+/** Private D-Bus names of state change signal subscribers */
+static GSList *common_state_subscribers = 0;
+
+/** Get battery level normalized to values allowed by D-Bus api
+ *
+ * @return battery level 0...100, or MCE_BATTERY_LEVEL_UNKNOWN
+ */
+static dbus_int32_t
+common_state_battery_level(void)
+{
+    dbus_int32_t value = battery_level;
+
+    if( value < 0 )
+        value = MCE_BATTERY_LEVEL_UNKNOWN;
+    else if( value > 100 )
+        value = 100;
+
+    return value;
+}
+
+/** Evaluate current value of state snapshot item
+ *
+ * @param id   state snapshot item
+ * @param val  where to store the value
+ */
+static void
+common_state_eval(common_state_t id, dbus_any_t *val)
+{
+    switch( id ) {
+    case COMMON_STATE_DISPLAY_STATUS:
+        switch( datapipe_get_gint(display_state_next_pipe) ) {
+        case MCE_DISPLAY_ON:  val->s = MCE_DISPLAY_ON_STRING;  break;
+        case MCE_DISPLAY_DIM: val->s = MCE_DISPLAY_DIM_STRING; break;
+        default:              val->s = MCE_DISPLAY_OFF_STRING; break;
+        }
+        break;
+
+    case COMMON_STATE_TKLOCK_MODE:
+        val->s = ((datapipe_get_gint(submode_pipe) & MCE_SUBMODE_TKLOCK) ?
+                  MCE_TK_LOCKED : MCE_TK_UNLOCKED);
+        break;
+
+    case COMMON_STATE_CALL_STATE:
+        val->s = call_state_to_dbus(datapipe_get_gint(call_state_pipe));
+        break;
+
+    case COMMON_STATE_CALL_TYPE:
+        val->s = call_type_repr(datapipe_get_gint(call_type_pipe));
+        break;
+
+    case COMMON_STATE_USB_CABLE_STATE:
+        val->s = usb_cable_state_to_dbus(usb_cable_state);
+        break;
+
+    case COMMON_STATE_CHARGER_STATE:
+        val->s = charger_state_to_dbus(charger_state);
+        break;
+
+    case COMMON_STATE_BATTERY_STATUS:
+        val->s = battery_status_to_dbus(battery_status);
+        break;
+
+    case COMMON_STATE_BATTERY_LEVEL:
+        val->i32 = common_state_battery_level();
+        break;
+
+    case COMMON_STATE_PSM_STATE:
+        val->b = datapipe_get_gint(power_saving_mode_active_pipe) != 0;
+        break;
+
+    case COMMON_STATE_RADIO_MASTER:
+        val->b = datapipe_get_gint(master_radio_enabled_pipe) != 0;
+        break;
+
+    case COMMON_STATE_INACTIVITY:
+        val->b = datapipe_get_gint(device_inactive_pipe) != 0;
+        break;
+
+    default:
+        val->i64 = 0;
+        break;
+    }
+}
+
+/** Compare values of state snapshot item
+ *
+ * @param id  state snapshot item
+ * @param a   value
+ * @param b   value
+ *
+ * @return true if values are equal, false otherwise
+ */
+static bool
+common_state_equal(common_state_t id, const dbus_any_t *a, const dbus_any_t *b)
+{
+    switch( common_state_info[id].type ) {
+    case DBUS_TYPE_STRING:
+        if( !a->s || !b->s )
+            return a->s == b->s;
+        return !strcmp(a->s, b->s);
+
+    case DBUS_TYPE_INT32:
+        return a->i32 == b->i32;
+
+    case DBUS_TYPE_BOOLEAN:
+        return !a->b == !b->b;
+
+    default:
+        break;
+    }
+    return false;
+}
+
+/** Append key - variant pair to a{sv} array
+ *
+ * @param array  iterator for open a{sv} container
+ * @param key    key name
+ * @param type   D-Bus type of the value
+ * @param val    value
+ *
+ * @return true on success, false on failure
+ */
+static bool
+common_state_append(DBusMessageIter *array, const char *key, int type,
+                    const dbus_any_t *val)
+{
+    bool            ack = false;
+    char            sig[2] = { (char)type, 0 };
+    DBusMessageIter dict, variant;
+
+    if( !dbus_message_iter_open_container(array, DBUS_TYPE_DICT_ENTRY,
+                                          0, &dict) )
+        goto EXIT;
+
+    if( !dbus_message_iter_append_basic(&dict, DBUS_TYPE_STRING, &key) )
+        goto ABANDON_DICT;
+
+    if( !dbus_message_iter_open_container(&dict, DBUS_TYPE_VARIANT,
+                                          sig, &variant) )
+        goto ABANDON_DICT;
+
+    if( !dbus_message_iter_append_basic(&variant, type, val) )
+        goto ABANDON_VARIANT;
+
+    if( !dbus_message_iter_close_container(&dict, &variant) )
+        goto ABANDON_DICT;
+
+    ack = dbus_message_iter_close_container(array, &dict);
+    goto EXIT;
+
+ABANDON_VARIANT:
+    dbus_message_iter_abandon_container(&dict, &variant);
+
+ABANDON_DICT:
+    dbus_message_iter_abandon_container(array, &dict);
+
+EXIT:
+    return ack;
+}
+
+/** Callback for handling state snapshot D-Bus queries
+ *
+ * @param req  method call message to reply
+ */
+static gboolean
+common_state_snapshot_get_cb(DBusMessage *const req)
+{
+    DBusMessage     *rsp = 0;
+    DBusMessageIter  body, array;
+    dbus_any_t       val = { .i32 = MCE_STATE_SNAPSHOT_VERSION };
+
+    mce_log(LL_DEBUG, "state snapshot query from: %s",
+            mce_dbus_get_message_sender_ident(req));
+
+    if( dbus_message_get_no_reply(req) )
+        goto EXIT;
+
+    if( !(rsp = dbus_new_method_reply(req)) )
+        goto EXIT;
+
+    dbus_message_iter_init_append(rsp, &body);
+
+    if( !dbus_message_iter_open_container(&body, DBUS_TYPE_ARRAY,
+                                          DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+                                          DBUS_TYPE_STRING_AS_STRING
+                                          DBUS_TYPE_VARIANT_AS_STRING
+                                          DBUS_DICT_ENTRY_END_CHAR_AS_STRING,
+                                          &array) )
+        goto EXIT;
+
+    if( !common_state_append(&array, "version", DBUS_TYPE_INT32, &val) )
+        goto ABANDON_ARRAY;
+
+    for( common_state_t id = 0; id < COMMON_STATE_COUNT; ++id ) {
+        common_state_eval(id, &val);
+        if( !common_state_append(&array, common_state_info[id].key,
+                                 common_state_info[id].type, &val) )
+            goto ABANDON_ARRAY;
+    }
+
+    if( !dbus_message_iter_close_container(&body, &array) )
+        goto EXIT;
+
+    dbus_send_message(rsp), rsp = 0;
+
+    goto EXIT;
+
+ABANDON_ARRAY:
+    dbus_message_iter_abandon_container(&body, &array);
+
+EXIT:
+    if( rsp )
+        dbus_message_unref(rsp);
+
+    return TRUE;
+}
+
+/** Idle callback for broadcasting changed state items
+ *
+ * @param aptr (not used)
+ *
+ * @return FALSE to stop idle callback from repeating
+ */
+static gboolean
+common_state_changed_cb(gpointer aptr)
+{
+    (void)aptr;
+
+    DBusMessage     *sig = 0;
+    DBusMessageIter  body, array;
+    int              cnt = 0;
+    gboolean         sent = FALSE;
+    dbus_any_t       val[COMMON_STATE_COUNT];
+
+    common_state_changed_id = 0;
+
+    if( !common_state_subscribers )
+        goto EXIT;
+
+    sig = dbus_new_signal(MCE_SIGNAL_PATH, MCE_SIGNAL_IF,
+                          MCE_STATE_CHANGED_SIG);
+
+    dbus_message_iter_init_append(sig, &body);
+
+    if( !dbus_message_iter_open_container(&body, DBUS_TYPE_ARRAY,
+                                          DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+                                          DBUS_TYPE_STRING_AS_STRING
+                                          DBUS_TYPE_VARIANT_AS_STRING
+                                          DBUS_DICT_ENTRY_END_CHAR_AS_STRING,
+                                          &array) )
+        goto EXIT;
+
+    for( common_state_t id = 0; id < COMMON_STATE_COUNT; ++id ) {
+        common_state_eval(id, &val[id]);
+
+        if( common_state_equal(id, &val[id], &common_state_sent[id]) )
+            continue;
+
+        if( !common_state_append(&array, common_state_info[id].key,
+                                 common_state_info[id].type, &val[id]) )
+            goto ABANDON_ARRAY;
+
+        ++cnt;
+    }
+
+    if( !dbus_message_iter_close_container(&body, &array) )
+        goto EXIT;
+
+    if( cnt == 0 )
+        goto EXIT;
+
+    mce_log(LL_DEBUG, "broadcast: %d changed state items", cnt);
+
+    /* Items that fail to go out are included in the next broadcast */
+    sent = dbus_send_message(sig), sig = 0;
+    if( !sent )
+        goto EXIT;
+
+    for( common_state_t id = 0; id < COMMON_STATE_COUNT; ++id )
+        common_state_sent[id] = val[id];
+
+    goto EXIT;
+
+ABANDON_ARRAY:
+    dbus_message_iter_abandon_container(&body, &array);
+
+EXIT:
+    if( sig )
+        dbus_message_unref(sig);
+
+    return FALSE;
+}
+
+/** Schedule broadcasting of changed state items
+ *
+ * Changes are coalesced so that everything that changes while
+ * handling one event ends up in a single signal.
+ */
+static void
+common_state_schedule(void)
+{
+    if( common_state_subscribers && !common_state_changed_id )
+        common_state_changed_id = g_idle_add(common_state_changed_cb, 0);
+}
+
+/** Cancel pending broadcasting of changed state items
+ */
+static void
+common_state_cancel(void)
+{
+    if( common_state_changed_id ) {
+        g_source_remove(common_state_changed_id),
+            common_state_changed_id = 0;
+    }
+}
+
+/** Callback for handling state change subscriber name owner changes
+ *
+ * @param sig  NameOwnerChanged signal
+ *
+ * @return TRUE
+ */
+static gboolean
+common_state_subscriber_lost_cb(DBusMessage *const sig)
+{
+    const char *name  = 0;
+    const char *prev  = 0;
+    const char *curr  = 0;
+    DBusError   error = DBUS_ERROR_INIT;
+
+    if( !dbus_message_get_args(sig, &error,
+                               DBUS_TYPE_STRING, &name,
+                               DBUS_TYPE_STRING, &prev,
+                               DBUS_TYPE_STRING, &curr,
+                               DBUS_TYPE_INVALID) ) {
+        mce_log(LL_ERR, "Failed to parse arguments: %s: %s",
+                error.name, error.message);
+        goto EXIT;
+    }
+
+    if( mce_dbus_owner_monitor_remove(name, &common_state_subscribers) == 0 ) {
+        mce_log(LL_DEBUG, "no state change subscribers left");
+        common_state_cancel();
+    }
+
+EXIT:
+    dbus_error_free(&error);
+    return TRUE;
+}
+
+/** Callback for handling state change subscribe requests
+ *
+ * @param req  method call message
+ */
+static gboolean
+common_state_subscribe_cb(DBusMessage *const req)
+{
+    const char *sender = dbus_message_get_sender(req);
+    bool        first  = !common_state_subscribers;
+
+    mce_log(LL_DEBUG, "state change subscribe from: %s",
+            mce_dbus_get_message_sender_ident(req));
+
+    if( !sender )
+        goto EXIT;
+
+    if( mce_dbus_owner_monitor_add(sender, common_state_subscriber_lost_cb,
+                                   &common_state_subscribers,
+                                   COMMON_STATE_MAX_SUBSCRIBERS) == -1 ) {
+        mce_log(LL_WARN, "too many state change subscribers");
+        goto EXIT;
+    }
+
+    /* Signals report changes relative to state at the time of
+     * the first subscription */
+    if( first ) {
+        for( common_state_t id = 0; id < COMMON_STATE_COUNT; ++id )
+            common_state_eval(id, &common_state_sent[id]);
+    }
+
+EXIT:
+    if( !dbus_message_get_no_reply(req) )
+        dbus_send_message(dbus_new_method_reply(req));
+
+    return TRUE;
+}
+
+/** Callback for handling state change unsubscribe requests
+ *
+ * @param req  method call message
+ */
+static gboolean
+common_state_unsubscribe_cb(DBusMessage *const req)
+{
+    const char *sender = dbus_message_get_sender(req);
+
+    mce_log(LL_DEBUG, "state change unsubscribe from: %s",
+            mce_dbus_get_message_sender_ident(req));
+
+    if( sender &&
+        mce_dbus_owner_monitor_remove(sender, &common_state_subscribers) == 0 )
+        common_state_cancel();
+
+    if( !dbus_message_get_no_reply(req) )
+        dbus_send_message(dbus_new_method_reply(req));
+
+    return TRUE;
+}
+
+/** Release state change signal tracking resources
+ */
+static void
+common_state_quit(void)
+{
+    common_state_cancel();
+    mce_dbus_owner_monitor_remove_all(&common_state_subscribers);
+}
+
 /* ========================================================================= *
  * DBUS_FUNCTIONS
  * ========================================================================= */
@@ -281,13 +775,8 @@ common_dbus_send_battery_level(DBusMessage *const req)
 
     DBusMessage *msg = NULL;
 
-    dbus_int32_t value = battery_level;
-
     /* Normalize to values allowed by MCE D-Bus api documentation */
-    if( value < 0 )
-        value = MCE_BATTERY_LEVEL_UNKNOWN;
-    else if( value > 100 )
-        value = 100;
+    dbus_int32_t value = common_state_battery_level();
 
     if( req ) {
         msg = dbus_new_method_reply(req);
@@ -371,6 +860,13 @@ static mce_dbus_handler_t common_dbus_handlers[] =
         .args      =
             "    <arg name=\"battery_level\" type=\"i\"/>\n"
     },
+    {
+        .interface = MCE_SIGNAL_IF,
+        .name      = MCE_STATE_CHANGED_SIG,
+        .type      = DBUS_MESSAGE_TYPE_SIGNAL,
+        .args      =
+            "    <arg name=\"changed_state\" type=\"a{sv}\"/>\n"
+    },
     /* method calls */
     {
         .interface = MCE_REQUEST_IF,
@@ -404,6 +900,30 @@ static mce_dbus_handler_t common_dbus_handlers[] =
         .args      =
             "    <arg direction=\"out\" name=\"battery_level\" type=\"i\"/>\n"
     },
+    {
+        .interface = MCE_REQUEST_IF,
+        .name      = MCE_STATE_SNAPSHOT_GET,
+        .type      = DBUS_MESSAGE_TYPE_METHOD_CALL,
+        .callback  = common_state_snapshot_get_cb,
+        .args      =
+            "    <arg direction=\"out\" name=\"state_snapshot\" type=\"a{sv}\"/>\n"
+    },
+    {
+        .interface = MCE_REQUEST_IF,
+        .name      = MCE_STATE_CHANGED_SUBSCRIBE_REQ,
+        .type      = DBUS_MESSAGE_TYPE_METHOD_CALL,
+        .callback  = common_state_subscribe_cb,
+        .args      =
+            ""
+    },
+    {
+        .interface = MCE_REQUEST_IF,
+        .name      = MCE_STATE_CHANGED_UNSUBSCRIBE_REQ,
+        .type      = DBUS_MESSAGE_TYPE_METHOD_CALL,
+        .callback  = common_state_unsubscribe_cb,
+        .args      =
+            ""
+    },
     /* sentinel */
     {
         .interface = 0
@@ -460,6 +980,8 @@ static void common_dbus_quit(void)
             common_dbus_initial_id = 0;
     }
 
+    common_state_quit();
+
     mce_dbus_handler_unregister_array(common_dbus_handlers);
 }
 
@@ -467,6 +989,21 @@ static void common_dbus_quit(void)
  * DATAPIPE_FUNCTIONS
  * ========================================================================= */
 
+/* ------------------------------------------------------------------------- *
+ * state snapshot
+ * ------------------------------------------------------------------------- */
+
+/** Callback for handling changes in datapipes included in state snapshot
+ *
+ * @param data (not used)
+ */
+static void common_datapipe_state_changed_cb(gconstpointer data)
+{
+    (void)data;
+
+    common_state_schedule();
+}
+
 /* ------------------------------------------------------------------------- *
  * usb_cable_state
  * ------------------------------------------------------------------------- */
@@ -496,6 +1033,7 @@ static void common_datapipe_usb_cable_state_cb(gconstpointer data)
             value_old, value_new);
 
     common_dbus_send_usb_cable_state(0);
+    common_state_schedule();
 
 EXIT:
     return;
@@ -522,6 +1060,7 @@ static void common_datapipe_charger_state_cb(gconstpointer data)
             charger_state_repr(charger_state));
 
     common_dbus_send_charger_state(0);
+    common_state_schedule();
 
 EXIT:
     return;
@@ -548,6 +1087,7 @@ static void common_datapipe_battery_status_cb(gconstpointer data)
             battery_status_repr(battery_status));
 
     common_dbus_send_battery_status(0);
+    common_state_schedule();
 
 EXIT:
     return;
@@ -573,6 +1113,7 @@ static void common_datapipe_battery_level_cb(gconstpointer data)
             prev, battery_level);
 
     common_dbus_send_battery_level(0);
+    common_state_schedule();
 
 EXIT:
     return;
@@ -602,6 +1143,34 @@ static datapipe_handler_t common_datapipe_handlers[] =
         .datapipe  = &battery_level_pipe,
         .output_cb = common_datapipe_battery_level_cb,
     },
+    {
+        .datapipe  = &display_state_next_pipe,
+        .output_cb = common_datapipe_state_changed_cb,
+    },
+    {
+        .datapipe  = &submode_pipe,
+        .output_cb = common_datapipe_state_changed_cb,
+    },
+    {
+        .datapipe  = &call_state_pipe,
+        .output_cb = common_datapipe_state_changed_cb,
+    },
+    {
+        .datapipe  = &call_type_pipe,
+        .output_cb = common_datapipe_state_changed_cb,
+    },
+    {
+        .datapipe  = &power_saving_mode_active_pipe,
+        .output_cb = common_datapipe_state_changed_cb,
+    },
+    {
+        .datapipe  = &master_radio_enabled_pipe,
+        .output_cb = common_datapipe_state_changed_cb,
+    },
+    {
+        .datapipe  = &device_inactive_pipe,
+        .output_cb = common_datapipe_state_changed_cb,
+    },
     // sentinel
     {
         .datapipe = 0,
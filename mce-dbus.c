@@ -27,6 +27,9 @@
 #include "mce-log.h"
 #include "mce-lib.h"
 #include "mce-wakelock.h"
+#include "mce-hbtimer.h"
+#include "mce-wltimer.h"
+#include "mce-startup.h"
 
 #include "systemui/dbus-names.h"
 
@@ -51,6 +54,9 @@
 /** How long to block late suspend when mce is sending dbus messages */
 #define MCE_DBUS_SEND_SUSPEND_BLOCK_MS 1000
 
+/** Number of queued signals that forces immediate flush */
+#define MDB_SIGQ_MAX_QUEUED 64
+
 /** Placeholder value for invalid/unknown process id */
 #define PEERINFO_NO_PID ((pid_t)-1)
 
@@ -66,6 +72,12 @@
 /** Root group id */
 #define PEERINFO_ROOT_GID ((gid_t)0)
 
+/** Maximum number of unique bus names with cached credentials */
+#define PEERCRED_CACHE_MAX 64
+
+/** Maximum number of credential queries allowed to be in flight */
+#define PEERCRED_QUERY_MAX_PENDING 16
+
 /** D-Bus handler callback function */
 typedef gboolean (*handler_callback_t)(DBusMessage *const msg);
 
@@ -95,6 +107,28 @@ typedef enum
     PRIVILEGED_YES,
 } privileged_t;
 
+/** Cached credentials of a unique D-Bus name */
+typedef struct
+{
+    /** Unique bus name */
+    gchar           *pc_name;
+
+    /** Process id of the name owner */
+    pid_t            pc_pid;
+
+    /** Effective user id of the name owner at query time */
+    uid_t            pc_uid;
+
+    /** Effective group id of the name owner at query time */
+    gid_t            pc_gid;
+
+    /** Privileged status of the name owner at query time */
+    bool             pc_privileged;
+
+    /** Link in the least recently used queue */
+    GList           *pc_link;
+} peercred_t;
+
 /** Notification details for client exit tracking */
 typedef struct peerquit_t peerquit_t;
 
@@ -163,6 +197,12 @@ struct peerinfo_t
     /** Pending org.freedesktop.DBus.GetConnectionUnixProcessID method call */
     DBusPendingCall *pi_name_pid_pc;
 
+    /** Flag for: waiting in the credential query queue */
+    bool             pi_pid_queued;
+
+    /** When the credential query was queued [ms] */
+    int64_t          pi_pid_queued_tick;
+
     /** Timer for delayed PEERSTATE_STALE -> PEERSTATE_STOPPED transition */
     guint            pi_expunge_id;
 
@@ -273,6 +313,7 @@ static void              peerinfo_query_owner_req              (peerinfo_t *self
 
 static void              peerinfo_query_pid_ign                (peerinfo_t *self);
 static void              peerinfo_query_pid_rsp                (DBusPendingCall *pc, void *aptr);
+static void              peerinfo_query_pid_send               (peerinfo_t *self);
 static void              peerinfo_query_pid_req                (peerinfo_t *self);
 
 static void              peerinfo_query_expunge_ign            (peerinfo_t *self);
@@ -298,6 +339,32 @@ static void              peerinfo_queue_method                 (peerinfo_t *self
 static void              peerinfo_flush_methods                (peerinfo_t *self);
 static void              peerinfo_handle_methods               (peerinfo_t *self);
 
+/* ------------------------------------------------------------------------- *
+ * PEERCRED_T
+ * ------------------------------------------------------------------------- */
+
+static bool              peercred_is_privileged                (uid_t uid, gid_t gid);
+static peercred_t       *peercred_create                       (const char *name, pid_t pid, uid_t uid, gid_t gid);
+static void              peercred_delete                       (peercred_t *self);
+static void              peercred_delete_cb                    (void *self);
+
+/* ------------------------------------------------------------------------- *
+ * PEERCRED_CACHE
+ * ------------------------------------------------------------------------- */
+
+static void              mce_dbus_peercred_init                (void);
+static void              mce_dbus_peercred_quit                (void);
+static const peercred_t *mce_dbus_peercred_lookup              (const char *name);
+static void              mce_dbus_peercred_store               (const char *name, pid_t pid, uid_t uid, gid_t gid);
+static void              mce_dbus_peercred_forget              (const char *name);
+
+static gboolean          mce_dbus_peercred_dispatch_cb         (gpointer aptr);
+static void              mce_dbus_peercred_schedule_dispatch   (void);
+static void              mce_dbus_peercred_queue_query         (peerinfo_t *info);
+static void              mce_dbus_peercred_unqueue_query       (peerinfo_t *info);
+static void              mce_dbus_peercred_query_sent          (void);
+static void              mce_dbus_peercred_query_done          (void);
+
 /* ------------------------------------------------------------------------- *
  * PEER_TRACKING
  * ------------------------------------------------------------------------- */
@@ -311,6 +378,16 @@ void                     mce_dbus_update_peerinfo              (const char *name
 void                     mce_dbus_del_peerinfo                 (const char *name);
 const char              *mce_dbus_get_peerdesc                 (const char *name);
 
+/* ------------------------------------------------------------------------- *
+ * SIGNAL_COALESCING
+ * ------------------------------------------------------------------------- */
+
+static bool              mdb_sigq_same_signal                  (DBusMessage *a, DBusMessage *b);
+static bool              mdb_sigq_same_content                 (DBusMessage *a, DBusMessage *b);
+static void              mdb_sigq_flush                        (void);
+static gboolean          mdb_sigq_flush_cb                     (gpointer aptr);
+static gboolean          mdb_sigq_add                          (DBusMessage *msg);
+
 /* ------------------------------------------------------------------------- *
  * MESSAGE_SENDING
  * ------------------------------------------------------------------------- */
@@ -333,6 +410,13 @@ gboolean                 dbus_send                             (const gchar *con
 
 static gboolean          version_get_dbus_cb                   (DBusMessage *const msg);
 static gboolean          suspend_stats_get_dbus_cb             (DBusMessage *const req);
+static bool              timer_stats_append_entry              (DBusMessageIter *array, const char *name, const mce_timerstats_t *stats);
+static gboolean          timer_stats_get_dbus_cb               (DBusMessage *const req);
+static void              wakelock_stats_append_entry_cb        (const char *name, const mce_wakelock_stats_t *stats, void *aptr);
+static gboolean          wakelock_stats_get_dbus_cb            (DBusMessage *const req);
+static gboolean          startup_report_get_dbus_cb            (DBusMessage *const req);
+static gboolean          signal_stats_get_dbus_cb              (DBusMessage *const req);
+static gboolean          peercred_stats_get_dbus_cb            (DBusMessage *const req);
 static gboolean          verbosity_get_dbus_cb                 (DBusMessage *const req);
 static gboolean          config_get_dbus_cb                    (DBusMessage *const msg);
 static gboolean          verbosity_set_dbus_cb                 (DBusMessage *const req);
@@ -414,6 +498,9 @@ bool                     mce_dbus_iter_get_array               (DBusMessageIter
 bool                     mce_dbus_iter_get_struct              (DBusMessageIter *iter, DBusMessageIter *sub);
 bool                     mce_dbus_iter_get_entry               (DBusMessageIter *iter, DBusMessageIter *sub);
 bool                     mce_dbus_iter_get_variant             (DBusMessageIter *iter, DBusMessageIter *sub);
+static bool              mce_dbus_iter_set_prop                (DBusMessageIter *var, const mce_dbus_prop_t *prop);
+bool                     mce_dbus_iter_get_prop                (DBusMessageIter *iter, const mce_dbus_prop_t *props, unsigned *seen);
+bool                     mce_dbus_iter_get_props               (DBusMessageIter *iter, const mce_dbus_prop_t *props, unsigned *seen);
 
 /* ------------------------------------------------------------------------- *
  * PEER_IDENTITY
@@ -1041,6 +1128,8 @@ peerinfo_ctor(peerinfo_t *self, const char *name)
     self->pi_datapipe      = 0;
     self->pi_name_owner_pc = 0;
     self->pi_name_pid_pc   = 0;
+    self->pi_pid_queued    = false;
+    self->pi_pid_queued_tick = 0;
     self->pi_expunge_id    = 0;
     self->pi_delete_id     = 0;
 
@@ -1294,8 +1383,14 @@ peerinfo_set_owner_name(peerinfo_t *self, const char *name)
 	self->pi_owner_name = name ? g_strdup(name) : 0;
 
     if( self->pi_owner_name ) {
-	if( *self->pi_owner_name)
+	if( *self->pi_owner_name) {
+	    if( peerinfo_get_state(self) == PEERSTATE_QUERY_PID ) {
+		/* Owner changed while pid query was in progress */
+		peerinfo_query_pid_ign(self);
+		peerinfo_query_pid_req(self);
+	    }
 	    peerinfo_set_state(self, PEERSTATE_QUERY_PID);
+	}
 	else
 	    peerinfo_set_state(self, PEERSTATE_STALE);
     }
@@ -1454,11 +1549,8 @@ peerinfo_get_privileged(const peerinfo_t *self, bool no_caching)
 	gid = peerinfo_get_owner_gid(self);
     }
 
-    if( uid == PEERINFO_ROOT_UID ||
-	uid == mce_dbus_privileged_uid ||
-	gid == mce_dbus_privileged_gid ) {
+    if( peercred_is_privileged(uid, gid) )
 	privileged = PRIVILEGED_YES;
-    }
 
 EXIT:
     return privileged;
@@ -1576,6 +1668,8 @@ EXIT:
 static void
 peerinfo_query_pid_ign(peerinfo_t *self)
 {
+    mce_dbus_peercred_unqueue_query(self);
+
     if( !self->pi_name_pid_pc )
 	goto EXIT;
 
@@ -1585,6 +1679,8 @@ peerinfo_query_pid_ign(peerinfo_t *self)
     dbus_pending_call_unref(self->pi_name_pid_pc),
 	self->pi_name_pid_pc = 0;
 
+    mce_dbus_peercred_query_done();
+
 EXIT:
     return;
 }
@@ -1605,6 +1701,8 @@ peerinfo_query_pid_rsp(DBusPendingCall *pc, void *aptr)
     dbus_pending_call_unref(self->pi_name_pid_pc),
 	self->pi_name_pid_pc = 0;
 
+    mce_dbus_peercred_query_done();
+
     if( !(rsp = dbus_pending_call_steal_reply(pc)) )
 	goto EXIT;
 
@@ -1618,6 +1716,9 @@ peerinfo_query_pid_rsp(DBusPendingCall *pc, void *aptr)
 
     if( pid ) {
 	peerinfo_set_owner_pid(self, pid);
+	mce_dbus_peercred_store(peerinfo_get_owner_name(self), pid,
+				peerinfo_get_owner_uid(self),
+				peerinfo_get_owner_gid(self));
 	peerinfo_set_state(self, PEERSTATE_RUNNING);
 
 	/* Make sure any previously logged ipc without process
@@ -1635,7 +1736,7 @@ EXIT:
 }
 
 static void
-peerinfo_query_pid_req(peerinfo_t *self)
+peerinfo_query_pid_send(peerinfo_t *self)
 {
     if( peerinfo_get_state(self) != PEERSTATE_QUERY_PID )
 	goto EXIT;
@@ -1645,7 +1746,8 @@ peerinfo_query_pid_req(peerinfo_t *self)
 
     mce_log(LL_DEBUG, "[%s] pid query send", peerinfo_name(self));
 
-    const char *name = peerinfo_name(self);
+    /* Query the unique name, so that the reply can be cached */
+    const char *name = peerinfo_get_owner_name(self);
 
     dbus_send_ex(DBUS_SERVICE_DBUS,
 		 DBUS_PATH_DBUS,
@@ -1657,6 +1759,38 @@ peerinfo_query_pid_req(peerinfo_t *self)
 		 DBUS_TYPE_STRING, &name,
 		 DBUS_TYPE_INVALID);
 
+    if( self->pi_name_pid_pc )
+	mce_dbus_peercred_query_sent();
+
+EXIT:
+    return;
+}
+
+static void
+peerinfo_query_pid_req(peerinfo_t *self)
+{
+    if( peerinfo_get_state(self) != PEERSTATE_QUERY_PID )
+	goto EXIT;
+
+    if( self->pi_name_pid_pc || self->pi_pid_queued )
+	goto EXIT;
+
+    const peercred_t *cred =
+	mce_dbus_peercred_lookup(peerinfo_get_owner_name(self));
+
+    if( cred ) {
+	mce_log(LL_DEBUG, "[%s] pid from cache: %d",
+		peerinfo_name(self), (int)cred->pc_pid);
+
+	peerinfo_set_owner_pid(self, cred->pc_pid);
+	peerinfo_set_state(self, PEERSTATE_RUNNING);
+	mce_log(LL_DEVEL, "%s", peerinfo_repr(self));
+    }
+    else {
+	mce_log(LL_DEBUG, "[%s] pid query queued", peerinfo_name(self));
+	mce_dbus_peercred_queue_query(self);
+    }
+
 EXIT:
     return;
 }
@@ -2008,6 +2142,362 @@ peerinfo_handle_methods(peerinfo_t *self)
     }
 }
 
+/* ========================================================================= *
+ * PEERCRED_T
+ * ========================================================================= */
+
+/** Evaluate whether given credentials grant access to privileged methods
+ *
+ * @param uid  effective user id
+ * @param gid  effective group id
+ *
+ * @return true if privileged, false otherwise
+ */
+static bool
+peercred_is_privileged(uid_t uid, gid_t gid)
+{
+    return (uid == PEERINFO_ROOT_UID ||
+	    uid == mce_dbus_privileged_uid ||
+	    gid == mce_dbus_privileged_gid);
+}
+
+static peercred_t *
+peercred_create(const char *name, pid_t pid, uid_t uid, gid_t gid)
+{
+    peercred_t *self = g_malloc0(sizeof *self);
+
+    self->pc_name       = g_strdup(name);
+    self->pc_pid        = pid;
+    self->pc_uid        = uid;
+    self->pc_gid        = gid;
+    self->pc_privileged = peercred_is_privileged(uid, gid);
+    self->pc_link       = 0;
+
+    return self;
+}
+
+static void
+peercred_delete(peercred_t *self)
+{
+    if( self != 0 )
+    {
+	g_free(self->pc_name);
+	g_free(self);
+    }
+}
+
+static void
+peercred_delete_cb(void *self)
+{
+    peercred_delete(self);
+}
+
+/* ========================================================================= *
+ * PEERCRED_CACHE
+ *
+ * Credentials of unique bus names are retained in a bounded least
+ * recently used cache, so that resolving a well known name owner or a
+ * peer whose details have been seen before does not need D-Bus round
+ * trips. Entries are dropped when NameOwnerChanged signals tell that
+ * the unique name is gone.
+ *
+ * Credential queries for new peers are not sent immediately, but
+ * collected and dispatched from an idle callback. This way a burst of
+ * new clients gets all of their queries sent in one go while the number
+ * of simultaneously pending queries stays bounded.
+ * ========================================================================= */
+
+/** Unique bus name to peercred_t lookup table */
+static GHashTable *peercred_lut = 0;
+
+/** Cached credentials, the most recently used first */
+static GQueue peercred_lru = G_QUEUE_INIT; // -> peercred_t *
+
+/** Peers waiting for credential query to be sent */
+static GQueue peercred_query_queue = G_QUEUE_INIT; // -> peerinfo_t *
+
+/** Idle callback id for dispatching queued credential queries */
+static guint peercred_dispatch_id = 0;
+
+/** Number of credential queries waiting for reply */
+static guint peercred_query_pending = 0;
+
+/** Number of credential cache hits */
+static dbus_int64_t peercred_cache_hits = 0;
+
+/** Number of credential cache misses */
+static dbus_int64_t peercred_cache_misses = 0;
+
+/** Number of entries evicted due to cache size limit */
+static dbus_int64_t peercred_cache_evictions = 0;
+
+/** Number of credential queries sent */
+static dbus_int64_t peercred_query_count = 0;
+
+/** Sum of time credential queries have spent in queue [ms] */
+static dbus_int64_t peercred_query_wait_total = 0;
+
+/** Longest time a credential query has spent in queue [ms] */
+static dbus_int64_t peercred_query_wait_max = 0;
+
+/** Largest number of credential queries sent from one dispatch */
+static dbus_int64_t peercred_query_batch_max = 0;
+
+/** Initialize credential cache
+ */
+static void
+mce_dbus_peercred_init(void)
+{
+    if( !peercred_lut ) {
+	peercred_lut = g_hash_table_new_full(g_str_hash, g_str_equal,
+					     0, peercred_delete_cb);
+    }
+}
+
+/** Cleanup credential cache and query queue
+ */
+static void
+mce_dbus_peercred_quit(void)
+{
+    if( peercred_dispatch_id ) {
+	g_source_remove(peercred_dispatch_id),
+	    peercred_dispatch_id = 0;
+    }
+
+    g_queue_clear(&peercred_query_queue);
+    g_queue_clear(&peercred_lru);
+
+    if( peercred_lut ) {
+	g_hash_table_unref(peercred_lut),
+	    peercred_lut = 0;
+    }
+
+    mce_log(LL_DEBUG, "peer credentials: hits=%lld misses=%lld"
+	    " evictions=%lld queries=%lld wait_total=%lld ms"
+	    " wait_max=%lld ms batch_max=%lld",
+	    (long long)peercred_cache_hits,
+	    (long long)peercred_cache_misses,
+	    (long long)peercred_cache_evictions,
+	    (long long)peercred_query_count,
+	    (long long)peercred_query_wait_total,
+	    (long long)peercred_query_wait_max,
+	    (long long)peercred_query_batch_max);
+}
+
+/** Lookup cached credentials of a unique bus name
+ *
+ * @param name  unique bus name
+ *
+ * @return cached credentials, or NULL if not cached
+ */
+static const peercred_t *
+mce_dbus_peercred_lookup(const char *name)
+{
+    peercred_t *cred = 0;
+
+    if( !peercred_lut || !name || *name != ':' )
+	goto EXIT;
+
+    if( (cred = g_hash_table_lookup(peercred_lut, name)) ) {
+	++peercred_cache_hits;
+	g_queue_unlink(&peercred_lru, cred->pc_link);
+	g_queue_push_head_link(&peercred_lru, cred->pc_link);
+    }
+    else {
+	++peercred_cache_misses;
+    }
+
+EXIT:
+    return cred;
+}
+
+/** Add / update cached credentials of a unique bus name
+ *
+ * If the cache is full, the least recently used entry is evicted.
+ *
+ * @param name  unique bus name
+ * @param pid   process id of the name owner
+ * @param uid   effective user id of the name owner
+ * @param gid   effective group id of the name owner
+ */
+static void
+mce_dbus_peercred_store(const char *name, pid_t pid, uid_t uid, gid_t gid)
+{
+    if( !peercred_lut || !name || *name != ':' )
+	goto EXIT;
+
+    mce_dbus_peercred_forget(name);
+
+    while( g_queue_get_length(&peercred_lru) >= PEERCRED_CACHE_MAX ) {
+	peercred_t *oldest = g_queue_peek_tail(&peercred_lru);
+	mce_log(LL_DEBUG, "[%s] credentials evicted", oldest->pc_name);
+	++peercred_cache_evictions;
+	mce_dbus_peercred_forget(oldest->pc_name);
+    }
+
+    peercred_t *cred = peercred_create(name, pid, uid, gid);
+
+    g_queue_push_head(&peercred_lru, cred);
+    cred->pc_link = g_queue_peek_head_link(&peercred_lru);
+    g_hash_table_replace(peercred_lut, cred->pc_name, cred);
+
+    mce_log(LL_DEBUG, "[%s] credentials cached: pid=%d uid=%d gid=%d%s",
+	    name, (int)pid, (int)uid, (int)gid,
+	    cred->pc_privileged ? " (privileged)" : "");
+
+EXIT:
+    return;
+}
+
+/** Drop cached credentials of a unique bus name
+ *
+ * @param name  unique bus name
+ */
+static void
+mce_dbus_peercred_forget(const char *name)
+{
+    peercred_t *cred = 0;
+
+    if( !peercred_lut || !name )
+	goto EXIT;
+
+    if( !(cred = g_hash_table_lookup(peercred_lut, name)) )
+	goto EXIT;
+
+    g_queue_delete_link(&peercred_lru, cred->pc_link),
+	cred->pc_link = 0;
+
+    /* Note: key is owned by the value -> remove deletes both */
+    g_hash_table_remove(peercred_lut, name);
+
+EXIT:
+    return;
+}
+
+/** Idle callback for sending queued credential queries
+ *
+ * @param aptr (not used)
+ *
+ * @return FALSE to stop idle callback from repeating
+ */
+static gboolean
+mce_dbus_peercred_dispatch_cb(gpointer aptr)
+{
+    (void)aptr;
+
+    if( !peercred_dispatch_id )
+	goto EXIT;
+
+    peercred_dispatch_id = 0;
+
+    int64_t now = mce_lib_get_boot_tick();
+    int     cnt = 0;
+
+    while( peercred_query_pending < PEERCRED_QUERY_MAX_PENDING ) {
+	peerinfo_t *info = g_queue_pop_head(&peercred_query_queue);
+
+	if( !info )
+	    break;
+
+	info->pi_pid_queued = false;
+
+	int64_t wait = now - info->pi_pid_queued_tick;
+	peercred_query_wait_total += wait;
+	if( peercred_query_wait_max < wait )
+	    peercred_query_wait_max = wait;
+
+	peerinfo_query_pid_send(info);
+	++cnt;
+    }
+
+    if( peercred_query_batch_max < cnt )
+	peercred_query_batch_max = cnt;
+
+    mce_log(LL_DEBUG, "sent %d credential queries; pending=%u queued=%u",
+	    cnt, peercred_query_pending,
+	    g_queue_get_length(&peercred_query_queue));
+
+EXIT:
+    return FALSE;
+}
+
+/** Schedule dispatching of queued credential queries
+ */
+static void
+mce_dbus_peercred_schedule_dispatch(void)
+{
+    if( peercred_dispatch_id )
+	goto EXIT;
+
+    if( g_queue_is_empty(&peercred_query_queue) )
+	goto EXIT;
+
+    if( peercred_query_pending >= PEERCRED_QUERY_MAX_PENDING )
+	goto EXIT;
+
+    peercred_dispatch_id = g_idle_add(mce_dbus_peercred_dispatch_cb, 0);
+
+EXIT:
+    return;
+}
+
+/** Add peer to credential query queue
+ *
+ * @param info  peer that needs credentials
+ */
+static void
+mce_dbus_peercred_queue_query(peerinfo_t *info)
+{
+    if( info->pi_pid_queued )
+	goto EXIT;
+
+    info->pi_pid_queued      = true;
+    info->pi_pid_queued_tick = mce_lib_get_boot_tick();
+    g_queue_push_tail(&peercred_query_queue, info);
+
+    mce_dbus_peercred_schedule_dispatch();
+
+EXIT:
+    return;
+}
+
+/** Remove peer from credential query queue
+ *
+ * @param info  peer that no longer needs credentials
+ */
+static void
+mce_dbus_peercred_unqueue_query(peerinfo_t *info)
+{
+    if( !info->pi_pid_queued )
+	goto EXIT;
+
+    info->pi_pid_queued = false;
+    g_queue_remove(&peercred_query_queue, info);
+
+EXIT:
+    return;
+}
+
+/** Book keeping for: credential query was sent
+ */
+static void
+mce_dbus_peercred_query_sent(void)
+{
+    ++peercred_query_count;
+    ++peercred_query_pending;
+}
+
+/** Book keeping for: credential query was replied or canceled
+ */
+static void
+mce_dbus_peercred_query_done(void)
+{
+    if( peercred_query_pending > 0 )
+	--peercred_query_pending;
+
+    mce_dbus_peercred_schedule_dispatch();
+}
+
 /* ========================================================================= *
  * PEER_TRACKING
  * ========================================================================= */
@@ -2095,6 +2585,10 @@ mce_dbus_peerinfo_filter_cb(DBusConnection *con, DBusMessage *msg, void *user_da
 	goto EXIT;
     }
 
+    /* Credentials of the previous owner are no longer needed */
+    if( *prev && strcmp(prev, curr) )
+	mce_dbus_peercred_forget(prev);
+
     mce_dbus_update_peerinfo(name, curr);
 
 EXIT:
@@ -2111,6 +2605,8 @@ static void
 mce_dbus_init_peerinfo(void)
 {
     if( !mce_dbus_peerinfo_lut ) {
+	mce_dbus_peercred_init();
+
 	mce_dbus_peerinfo_lut = g_hash_table_new_full(g_str_hash, g_str_equal,
 						      g_free, peerinfo_delete_cb);
 
@@ -2135,6 +2631,8 @@ mce_dbus_quit_peerinfo(void)
 
 	g_hash_table_unref(mce_dbus_peerinfo_lut),
 	    mce_dbus_peerinfo_lut = 0;
+
+	mce_dbus_peercred_quit();
     }
 }
 
@@ -2213,32 +2711,199 @@ mce_dbus_get_peerdesc(const char *name)
 }
 
 /* ========================================================================= *
- * MESSAGE_SENDING
+ * SIGNAL_COALESCING
+ *
+ * Signals are not sent immediately, but queued and flushed from an
+ * idle callback once per main loop iteration. Signals that are identical
+ * to the latest queued signal with the same name are dropped.
+ *
+ * Before sending anything else than a signal, the queue is flushed
+ * so that replies and method calls never overtake signals.
  * ========================================================================= */
 
-/** Return reference to dbus connection cached at mce-dbus module
- *
- * For use in situations where the abstraction provided by mce-dbus
- * makes things too complicated.
+/** Signals waiting to be sent */
+static GQueue mdb_sigq_queue = G_QUEUE_INIT;
+
+/** Idle callback id for flushing queued signals */
+static guint mdb_sigq_flush_id = 0;
+
+/** Number of signals sent */
+static dbus_int64_t mdb_sigq_sent_count = 0;
+
+/** Number of signals dropped as duplicates */
+static dbus_int64_t mdb_sigq_suppressed_count = 0;
+
+/** Predicate for: signals have the same name and object path
  *
- * Caller must release non-null return values with dbus_connection_unref().
+ * @param a  signal message
+ * @param b  signal message
  *
- * @return DBusConnection, or NULL if mce has no dbus connection
+ * @return true if signals are of the same kind, false otherwise
  */
-DBusConnection *dbus_connection_get(void)
+static bool mdb_sigq_same_signal(DBusMessage *a, DBusMessage *b)
 {
-	if( !dbus_connection ) {
-		mce_log(LL_WARN, "no dbus connection");
-		return NULL;
-	}
-	return dbus_connection_ref(dbus_connection);
+	return (!g_strcmp0(dbus_message_get_member(a),
+			   dbus_message_get_member(b)) &&
+		!g_strcmp0(dbus_message_get_interface(a),
+			   dbus_message_get_interface(b)) &&
+		!g_strcmp0(dbus_message_get_path(a),
+			   dbus_message_get_path(b)) &&
+		!g_strcmp0(dbus_message_get_destination(a),
+			   dbus_message_get_destination(b)));
 }
 
-/**
- * Create a new D-Bus signal, with proper error checking
- * will exit the mainloop if an error occurs
+/** Predicate for: signals carry the same data
  *
- * @param path The signal path
+ * @param a  signal message
+ * @param b  signal message
+ *
+ * @return true if signals have identical content, false otherwise
+ */
+static bool mdb_sigq_same_content(DBusMessage *a, DBusMessage *b)
+{
+	bool         same  = false;
+	DBusMessage *a_tmp = 0;
+	DBusMessage *b_tmp = 0;
+	char        *a_dta = 0;
+	char        *b_dta = 0;
+	int          a_len = 0;
+	int          b_len = 0;
+
+	if( g_strcmp0(dbus_message_get_signature(a),
+		      dbus_message_get_signature(b)) )
+		goto EXIT;
+
+	/* Marshaling locks messages, which would make it impossible
+	 * to assign serial numbers on send -> compare copies */
+	if( !(a_tmp = dbus_message_copy(a)) ||
+	    !(b_tmp = dbus_message_copy(b)) )
+		goto EXIT;
+
+	if( !dbus_message_marshal(a_tmp, &a_dta, &a_len) ||
+	    !dbus_message_marshal(b_tmp, &b_dta, &b_len) )
+		goto EXIT;
+
+	same = (a_len == b_len && !memcmp(a_dta, b_dta, a_len));
+
+EXIT:
+	dbus_free(a_dta);
+	dbus_free(b_dta);
+
+	if( a_tmp )
+		dbus_message_unref(a_tmp);
+	if( b_tmp )
+		dbus_message_unref(b_tmp);
+
+	return same;
+}
+
+/** Send all queued signals
+ */
+static void mdb_sigq_flush(void)
+{
+	DBusMessage *msg;
+
+	if( mdb_sigq_flush_id ) {
+		g_source_remove(mdb_sigq_flush_id),
+			mdb_sigq_flush_id = 0;
+	}
+
+	while( (msg = g_queue_pop_head(&mdb_sigq_queue)) ) {
+		if( !dbus_connection ) {
+			/* Disconnected; just discard */
+		}
+		else if( !dbus_connection_send(dbus_connection, msg, NULL) ) {
+			mce_log(LL_CRIT,
+				"Out of memory when sending D-Bus message");
+		}
+		else {
+			++mdb_sigq_sent_count;
+		}
+		dbus_message_unref(msg);
+	}
+}
+
+/** Idle callback for sending queued signals
+ *
+ * @param aptr (not used)
+ *
+ * @return FALSE to stop idle callback from repeating
+ */
+static gboolean mdb_sigq_flush_cb(gpointer aptr)
+{
+	(void)aptr;
+
+	mdb_sigq_flush_id = 0;
+	mdb_sigq_flush();
+
+	return FALSE;
+}
+
+/** Queue signal to be sent from idle callback
+ *
+ * @param msg  signal message; caller retains ownership
+ *
+ * @return TRUE on success, FALSE on failure
+ */
+static gboolean mdb_sigq_add(DBusMessage *msg)
+{
+	/* Only the latest queued signal of the same kind matters;
+	 * if it is identical to this one, subscribers would not
+	 * see any difference -> skip this one */
+	for( GList *iter = mdb_sigq_queue.tail; iter; iter = iter->prev ) {
+		DBusMessage *queued = iter->data;
+
+		if( !mdb_sigq_same_signal(queued, msg) )
+			continue;
+
+		if( mdb_sigq_same_content(queued, msg) ) {
+			++mdb_sigq_suppressed_count;
+			mce_log(LL_DEBUG, "suppressed duplicate %s signal",
+				dbus_message_get_member(msg));
+			goto EXIT;
+		}
+		break;
+	}
+
+	g_queue_push_tail(&mdb_sigq_queue, dbus_message_ref(msg));
+
+	if( g_queue_get_length(&mdb_sigq_queue) >= MDB_SIGQ_MAX_QUEUED )
+		mdb_sigq_flush();
+	else if( !mdb_sigq_flush_id )
+		mdb_sigq_flush_id = g_idle_add_full(G_PRIORITY_DEFAULT,
+						    mdb_sigq_flush_cb, 0, 0);
+
+EXIT:
+	return TRUE;
+}
+
+/* ========================================================================= *
+ * MESSAGE_SENDING
+ * ========================================================================= */
+
+/** Return reference to dbus connection cached at mce-dbus module
+ *
+ * For use in situations where the abstraction provided by mce-dbus
+ * makes things too complicated.
+ *
+ * Caller must release non-null return values with dbus_connection_unref().
+ *
+ * @return DBusConnection, or NULL if mce has no dbus connection
+ */
+DBusConnection *dbus_connection_get(void)
+{
+	if( !dbus_connection ) {
+		mce_log(LL_WARN, "no dbus connection");
+		return NULL;
+	}
+	return dbus_connection_ref(dbus_connection);
+}
+
+/**
+ * Create a new D-Bus signal, with proper error checking
+ * will exit the mainloop if an error occurs
+ *
+ * @param path The signal path
  * @param interface The signal interface
  * @param name The name of the signal to send
  * @return A new DBusMessage
@@ -2352,6 +3017,15 @@ gboolean dbus_send_message(DBusMessage *const msg)
 
 	mce_wakelock_obtain("dbus_send", MCE_DBUS_SEND_SUSPEND_BLOCK_MS);
 
+	/* Signals are coalesced and sent from idle callback */
+	if( dbus_message_get_type(msg) == DBUS_MESSAGE_TYPE_SIGNAL ) {
+		status = mdb_sigq_add(msg);
+		goto EXIT;
+	}
+
+	/* Replies and method calls must not overtake queued signals */
+	mdb_sigq_flush();
+
 	if (dbus_connection_send(dbus_connection, msg, NULL) == FALSE) {
 		mce_log(LL_CRIT,
 			"Out of memory when sending D-Bus message");
@@ -2390,6 +3064,9 @@ dbus_send_message_with_reply_handler(DBusMessage *const msg,
 	if( !msg )
 		goto EXIT;
 
+	/* Method calls must not overtake queued signals */
+	mdb_sigq_flush();
+
 	if( !dbus_connection_send_with_reply(dbus_connection, msg, &pc,
 					     timeout) ) {
 		mce_log(LL_CRIT, "Out of memory when sending D-Bus message");
@@ -2542,147 +3219,551 @@ gboolean dbus_send_ex(const char *service,
 	return res;
 }
 
-/** Generic function to send D-Bus messages and signals
- * to send a signal, call dbus_send with service == NULL
+/** Generic function to send D-Bus messages and signals
+ * to send a signal, call dbus_send with service == NULL
+ *
+ * @todo Make it possible to send D-Bus replies as well
+ *
+ * @param service        D-Bus service; for signals, set to NULL
+ * @param path           D-Bus path
+ * @param interface      D-Bus interface
+ * @param name The       D-Bus method or signal name to send to
+ * @param callback       A reply callback, or NULL to set no reply;
+ *                       for signals, this is unused, but please use NULL
+ *                       for consistency
+ * @param timeout        Milliseconds to wait for reply, or -1 for default
+ * @param user_data      Data to pass to callback
+ * @param user_free      Data release callback for user_data
+ * @param ppc            Where to store pending call handle, or NULL
+ * @param first_arg_type The DBUS_TYPE of the first argument in the list
+ * @param ...            The arguments to append to the D-Bus message;
+ *                       terminate with DBUS_TYPE_INVALID
+ *                       Note: the arguments MUST be passed by reference
+ *
+ * @return TRUE on success, FALSE on failure
+ */
+gboolean dbus_send_ex2(const char *service,
+		       const char *path,
+		       const char *interface,
+		       const char *name,
+		       DBusPendingCallNotifyFunction callback,
+		       int timeout,
+		       void *user_data, DBusFreeFunction user_free,
+		       DBusPendingCall **ppc,
+		       int first_arg_type, ...)
+{
+	va_list va;
+	va_start(va, first_arg_type);
+	gboolean res = dbus_send_va(service, path, interface, name,
+				    callback, timeout, user_data, user_free,
+				    ppc, first_arg_type, va);
+	va_end(va);
+	return res;
+}
+
+/**
+ * Generic function to send D-Bus messages and signals
+ * to send a signal, call dbus_send with service == NULL
+ *
+ * @todo Make it possible to send D-Bus replies as well
+ *
+ * @param service D-Bus service; for signals, set to NULL
+ * @param path D-Bus path
+ * @param interface D-Bus interface
+ * @param name The D-Bus method or signal name to send to
+ * @param callback A reply callback, or NULL to set no reply;
+ *                 for signals, this is unused, but please use NULL
+ *                 for consistency
+ * @param first_arg_type The DBUS_TYPE of the first argument in the list
+ * @param ... The arguments to append to the D-Bus message;
+ *            terminate with DBUS_TYPE_INVALID
+ *            Note: the arguments MUST be passed by reference
+ * @return TRUE on success, FALSE on failure
+ */
+gboolean dbus_send(const gchar *const service, const gchar *const path,
+		   const gchar *const interface, const gchar *const name,
+		   DBusPendingCallNotifyFunction callback,
+		   int first_arg_type, ...)
+{
+	va_list va;
+	va_start(va, first_arg_type);
+	gboolean res = dbus_send_va(service, path, interface, name,
+				    callback, -1, 0, 0, 0, first_arg_type, va);
+	va_end(va);
+	return res;
+}
+
+/* ========================================================================= *
+ * METHOD_CALL_HANDLERS
+ * ========================================================================= */
+
+/**
+ * D-Bus callback for the version get method call
+ *
+ * @param msg The D-Bus message to reply to
+ * @return TRUE on success, FALSE on failure
+ */
+static gboolean version_get_dbus_cb(DBusMessage *const msg)
+{
+	static const gchar *const versionstring = G_STRINGIFY(PRG_VERSION);
+	DBusMessage *reply = NULL;
+	gboolean status = FALSE;
+
+	mce_log(LL_DEBUG, "Received version information request");
+
+	/* Create a reply */
+	reply = dbus_new_method_reply(msg);
+
+	/* Append the version information */
+	if (dbus_message_append_args(reply,
+				     DBUS_TYPE_STRING, &versionstring,
+				     DBUS_TYPE_INVALID) == FALSE) {
+		mce_log(LL_CRIT,
+			"Failed to append reply argument to D-Bus message "
+			"for %s.%s",
+			MCE_REQUEST_IF, MCE_VERSION_GET);
+		dbus_message_unref(reply);
+		goto EXIT;
+	}
+
+	/* Send the message */
+	status = dbus_send_message(reply);
+
+EXIT:
+	return status;
+}
+
+/** D-Bus callback for the get suspend time statistics method call
+ *
+ * @param req The D-Bus message to reply to
+ *
+ * @return TRUE
+ */
+static gboolean suspend_stats_get_dbus_cb(DBusMessage *const req)
+{
+	DBusMessage *rsp = 0;
+
+	mce_log(LL_DEVEL, "suspend info request from %s",
+		mce_dbus_get_message_sender_ident(req));
+
+	/* get stats */
+	dbus_int64_t uptime_ms  = mce_lib_get_boot_tick();
+	dbus_int64_t suspend_ms = uptime_ms - mce_lib_get_mono_tick();
+
+	/* create and send reply message */
+	rsp = dbus_new_method_reply(req);
+
+	if( !dbus_message_append_args(rsp,
+				      DBUS_TYPE_INT64, &uptime_ms,
+				      DBUS_TYPE_INT64, &suspend_ms,
+				      DBUS_TYPE_INVALID) ) {
+		mce_log(LL_ERR, "Failed to append arguments");
+		goto EXIT;
+	}
+
+	dbus_send_message(rsp), rsp = 0;
+
+EXIT:
+	if( rsp )
+		dbus_message_unref(rsp);
+
+	return TRUE;
+}
+
+/** Helper for appending timer statistics dict entry to a reply message
+ *
+ * @param array  dbus message iterator, within a{s(xxxxx)} container
+ * @param name   timer family name
+ * @param stats  timer statistics
+ *
+ * @return true on success, or false on failure
+ */
+static bool timer_stats_append_entry(DBusMessageIter *array, const char *name,
+				     const mce_timerstats_t *stats)
+{
+	bool            ack = false;
+	DBusMessageIter dict, entry;
+
+	const dbus_int64_t val[] = {
+		stats->tms_wakeups,
+		stats->tms_notifications,
+		stats->tms_off_wakeups,
+		stats->tms_off_notifications,
+		stats->tms_off_time,
+	};
+
+	if( !dbus_message_iter_open_container(array, DBUS_TYPE_DICT_ENTRY,
+					      0, &dict) )
+		goto EXIT;
+
+	if( !dbus_message_iter_append_basic(&dict, DBUS_TYPE_STRING, &name) )
+		goto ABANDON_DICT;
+
+	if( !dbus_message_iter_open_container(&dict, DBUS_TYPE_STRUCT,
+					      0, &entry) )
+		goto ABANDON_DICT;
+
+	for( size_t i = 0; i < G_N_ELEMENTS(val); ++i ) {
+		if( !dbus_message_iter_append_basic(&entry, DBUS_TYPE_INT64,
+						    &val[i]) )
+			goto ABANDON_ENTRY;
+	}
+
+	if( !dbus_message_iter_close_container(&dict, &entry) )
+		goto ABANDON_DICT;
+
+	if( !dbus_message_iter_close_container(array, &dict) )
+		goto EXIT;
+
+	ack = true;
+	goto EXIT;
+
+ABANDON_ENTRY:
+	dbus_message_iter_abandon_container(&dict, &entry);
+
+ABANDON_DICT:
+	dbus_message_iter_abandon_container(array, &dict);
+
+EXIT:
+	return ack;
+}
+
+/** D-Bus callback for the get timer wakeup statistics method call
+ *
+ * Reply contains a{s(xxxxx)} dictionary, where timer family name maps
+ * to: number of wakeups, number of timer notifications, number of
+ * wakeups while display was off, number of timer notifications while
+ * display was off and total display off time in milliseconds.
+ *
+ * @param req The D-Bus message to reply to
+ *
+ * @return TRUE
+ */
+static gboolean timer_stats_get_dbus_cb(DBusMessage *const req)
+{
+	DBusMessage     *rsp = 0;
+	DBusMessageIter  body, array;
+
+	mce_log(LL_DEVEL, "timer stats request from %s",
+		mce_dbus_get_message_sender_ident(req));
+
+	if( dbus_message_get_no_reply(req) )
+		goto EXIT;
+
+	mce_timerstats_t hbtimer_stats;
+	mce_timerstats_t wltimer_stats;
+
+	mce_hbtimer_get_stats(&hbtimer_stats);
+	mce_wltimer_get_stats(&wltimer_stats);
+
+	rsp = dbus_new_method_reply(req);
+
+	dbus_message_iter_init_append(rsp, &body);
+
+	if( !dbus_message_iter_open_container(&body, DBUS_TYPE_ARRAY,
+					      DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+					      DBUS_TYPE_STRING_AS_STRING
+					      DBUS_STRUCT_BEGIN_CHAR_AS_STRING
+					      DBUS_TYPE_INT64_AS_STRING
+					      DBUS_TYPE_INT64_AS_STRING
+					      DBUS_TYPE_INT64_AS_STRING
+					      DBUS_TYPE_INT64_AS_STRING
+					      DBUS_TYPE_INT64_AS_STRING
+					      DBUS_STRUCT_END_CHAR_AS_STRING
+					      DBUS_DICT_ENTRY_END_CHAR_AS_STRING,
+					      &array) )
+		goto EXIT;
+
+	if( !timer_stats_append_entry(&array, "hbtimer", &hbtimer_stats) ||
+	    !timer_stats_append_entry(&array, "wltimer", &wltimer_stats) ) {
+		dbus_message_iter_abandon_container(&body, &array);
+		goto EXIT;
+	}
+
+	if( !dbus_message_iter_close_container(&body, &array) )
+		goto EXIT;
+
+	dbus_send_message(rsp), rsp = 0;
+
+EXIT:
+	if( rsp )
+		dbus_message_unref(rsp);
+
+	return TRUE;
+}
+
+/** Helper for appending wakelock statistics dict entry to a reply message
+ *
+ * Used as mce_wakelock_foreach_stats() callback. Once appending
+ * fails, the remaining entries are skipped.
+ *
+ * @param name   wakelock name
+ * @param stats  wakelock statistics
+ * @param aptr   dbus message iterator, within a{s(xxxxxb)} container;
+ *               set to NULL on failure
+ */
+static void wakelock_stats_append_entry_cb(const char *name,
+					   const mce_wakelock_stats_t *stats,
+					   void *aptr)
+{
+	DBusMessageIter **array = aptr;
+	DBusMessageIter   dict, entry;
+
+	const dbus_int64_t val[] = {
+		stats->acquired,
+		stats->timeouts,
+		stats->total_ms,
+		stats->max_ms,
+		stats->sole_ms,
+	};
+	dbus_bool_t active = stats->active;
+
+	if( !*array )
+		goto EXIT;
+
+	if( !dbus_message_iter_open_container(*array, DBUS_TYPE_DICT_ENTRY,
+					      0, &dict) )
+		goto FAILED;
+
+	if( !dbus_message_iter_append_basic(&dict, DBUS_TYPE_STRING, &name) )
+		goto ABANDON_DICT;
+
+	if( !dbus_message_iter_open_container(&dict, DBUS_TYPE_STRUCT,
+					      0, &entry) )
+		goto ABANDON_DICT;
+
+	for( size_t i = 0; i < G_N_ELEMENTS(val); ++i ) {
+		if( !dbus_message_iter_append_basic(&entry, DBUS_TYPE_INT64,
+						    &val[i]) )
+			goto ABANDON_ENTRY;
+	}
+
+	if( !dbus_message_iter_append_basic(&entry, DBUS_TYPE_BOOLEAN,
+					    &active) )
+		goto ABANDON_ENTRY;
+
+	if( !dbus_message_iter_close_container(&dict, &entry) )
+		goto ABANDON_DICT;
+
+	if( !dbus_message_iter_close_container(*array, &dict) )
+		goto FAILED;
+
+	goto EXIT;
+
+ABANDON_ENTRY:
+	dbus_message_iter_abandon_container(&dict, &entry);
+
+ABANDON_DICT:
+	dbus_message_iter_abandon_container(*array, &dict);
+
+FAILED:
+	*array = 0;
+
+EXIT:
+	return;
+}
+
+/** D-Bus callback for the get wakelock statistics method call
  *
- * @todo Make it possible to send D-Bus replies as well
+ * Reply contains a{s(xxxxxb)} dictionary, where wakelock name maps
+ * to: number of times acquired, number of timeouts, total hold time,
+ * maximum hold time, time held as the only wakelock (all times in
+ * milliseconds) and whether the wakelock is currently held.
  *
- * @param service        D-Bus service; for signals, set to NULL
- * @param path           D-Bus path
- * @param interface      D-Bus interface
- * @param name The       D-Bus method or signal name to send to
- * @param callback       A reply callback, or NULL to set no reply;
- *                       for signals, this is unused, but please use NULL
- *                       for consistency
- * @param timeout        Milliseconds to wait for reply, or -1 for default
- * @param user_data      Data to pass to callback
- * @param user_free      Data release callback for user_data
- * @param ppc            Where to store pending call handle, or NULL
- * @param first_arg_type The DBUS_TYPE of the first argument in the list
- * @param ...            The arguments to append to the D-Bus message;
- *                       terminate with DBUS_TYPE_INVALID
- *                       Note: the arguments MUST be passed by reference
+ * @param req The D-Bus message to reply to
  *
- * @return TRUE on success, FALSE on failure
+ * @return TRUE
  */
-gboolean dbus_send_ex2(const char *service,
-		       const char *path,
-		       const char *interface,
-		       const char *name,
-		       DBusPendingCallNotifyFunction callback,
-		       int timeout,
-		       void *user_data, DBusFreeFunction user_free,
-		       DBusPendingCall **ppc,
-		       int first_arg_type, ...)
+static gboolean wakelock_stats_get_dbus_cb(DBusMessage *const req)
 {
-	va_list va;
-	va_start(va, first_arg_type);
-	gboolean res = dbus_send_va(service, path, interface, name,
-				    callback, timeout, user_data, user_free,
-				    ppc, first_arg_type, va);
-	va_end(va);
-	return res;
+	DBusMessage     *rsp = 0;
+	DBusMessageIter  body, array;
+	DBusMessageIter *iter = &array;
+
+	mce_log(LL_DEVEL, "wakelock stats request from %s",
+		mce_dbus_get_message_sender_ident(req));
+
+	if( dbus_message_get_no_reply(req) )
+		goto EXIT;
+
+	rsp = dbus_new_method_reply(req);
+
+	dbus_message_iter_init_append(rsp, &body);
+
+	if( !dbus_message_iter_open_container(&body, DBUS_TYPE_ARRAY,
+					      DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+					      DBUS_TYPE_STRING_AS_STRING
+					      DBUS_STRUCT_BEGIN_CHAR_AS_STRING
+					      DBUS_TYPE_INT64_AS_STRING
+					      DBUS_TYPE_INT64_AS_STRING
+					      DBUS_TYPE_INT64_AS_STRING
+					      DBUS_TYPE_INT64_AS_STRING
+					      DBUS_TYPE_INT64_AS_STRING
+					      DBUS_TYPE_BOOLEAN_AS_STRING
+					      DBUS_STRUCT_END_CHAR_AS_STRING
+					      DBUS_DICT_ENTRY_END_CHAR_AS_STRING,
+					      &array) )
+		goto EXIT;
+
+	mce_wakelock_foreach_stats(wakelock_stats_append_entry_cb, &iter);
+
+	if( !iter ) {
+		dbus_message_iter_abandon_container(&body, &array);
+		goto EXIT;
+	}
+
+	if( !dbus_message_iter_close_container(&body, &array) )
+		goto EXIT;
+
+	dbus_send_message(rsp), rsp = 0;
+
+EXIT:
+	if( rsp )
+		dbus_message_unref(rsp);
+
+	return TRUE;
 }
 
-/**
- * Generic function to send D-Bus messages and signals
- * to send a signal, call dbus_send with service == NULL
+/** D-Bus callback for the get startup report method call
  *
- * @todo Make it possible to send D-Bus replies as well
+ * Reply contains a(sxx) array of startup phases: phase name,
+ * start time relative to the first phase and duration, both
+ * in milliseconds. Duration is negative if the phase is still
+ * ongoing.
  *
- * @param service D-Bus service; for signals, set to NULL
- * @param path D-Bus path
- * @param interface D-Bus interface
- * @param name The D-Bus method or signal name to send to
- * @param callback A reply callback, or NULL to set no reply;
- *                 for signals, this is unused, but please use NULL
- *                 for consistency
- * @param first_arg_type The DBUS_TYPE of the first argument in the list
- * @param ... The arguments to append to the D-Bus message;
- *            terminate with DBUS_TYPE_INVALID
- *            Note: the arguments MUST be passed by reference
- * @return TRUE on success, FALSE on failure
+ * @param req The D-Bus message to reply to
+ *
+ * @return TRUE
  */
-gboolean dbus_send(const gchar *const service, const gchar *const path,
-		   const gchar *const interface, const gchar *const name,
-		   DBusPendingCallNotifyFunction callback,
-		   int first_arg_type, ...)
+static gboolean startup_report_get_dbus_cb(DBusMessage *const req)
 {
-	va_list va;
-	va_start(va, first_arg_type);
-	gboolean res = dbus_send_va(service, path, interface, name,
-				    callback, -1, 0, 0, 0, first_arg_type, va);
-	va_end(va);
-	return res;
-}
+	DBusMessage     *rsp = 0;
+	DBusMessageIter  body, array, entry;
 
-/* ========================================================================= *
- * METHOD_CALL_HANDLERS
- * ========================================================================= */
+	const mce_startup_phase_t *phases = 0;
+	size_t count = mce_startup_get_phases(&phases);
 
-/**
- * D-Bus callback for the version get method call
+	mce_log(LL_DEVEL, "startup report request from %s",
+		mce_dbus_get_message_sender_ident(req));
+
+	if( dbus_message_get_no_reply(req) )
+		goto EXIT;
+
+	rsp = dbus_new_method_reply(req);
+
+	dbus_message_iter_init_append(rsp, &body);
+
+	if( !dbus_message_iter_open_container(&body, DBUS_TYPE_ARRAY,
+					      DBUS_STRUCT_BEGIN_CHAR_AS_STRING
+					      DBUS_TYPE_STRING_AS_STRING
+					      DBUS_TYPE_INT64_AS_STRING
+					      DBUS_TYPE_INT64_AS_STRING
+					      DBUS_STRUCT_END_CHAR_AS_STRING,
+					      &array) )
+		goto EXIT;
+
+	for( size_t i = 0; i < count; ++i ) {
+		const char  *name     = phases[i].name;
+		dbus_int64_t start    = phases[i].start_ms;
+		dbus_int64_t duration = phases[i].duration_ms;
+
+		if( !dbus_message_iter_open_container(&array, DBUS_TYPE_STRUCT,
+						      0, &entry) )
+			goto ABANDON_ARRAY;
+
+		if( !dbus_message_iter_append_basic(&entry, DBUS_TYPE_STRING,
+						    &name) ||
+		    !dbus_message_iter_append_basic(&entry, DBUS_TYPE_INT64,
+						    &start) ||
+		    !dbus_message_iter_append_basic(&entry, DBUS_TYPE_INT64,
+						    &duration) )
+			goto ABANDON_ENTRY;
+
+		if( !dbus_message_iter_close_container(&array, &entry) )
+			goto ABANDON_ARRAY;
+	}
+
+	if( !dbus_message_iter_close_container(&body, &array) )
+		goto EXIT;
+
+	dbus_send_message(rsp), rsp = 0;
+
+	goto EXIT;
+
+ABANDON_ENTRY:
+	dbus_message_iter_abandon_container(&array, &entry);
+
+ABANDON_ARRAY:
+	dbus_message_iter_abandon_container(&body, &array);
+
+EXIT:
+	if( rsp )
+		dbus_message_unref(rsp);
+
+	return TRUE;
+}
+
+/** D-Bus callback for the get signal statistics method call
  *
- * @param msg The D-Bus message to reply to
- * @return TRUE on success, FALSE on failure
+ * @param req The D-Bus message
+ *
+ * @return TRUE
  */
-static gboolean version_get_dbus_cb(DBusMessage *const msg)
+static gboolean signal_stats_get_dbus_cb(DBusMessage *const req)
 {
-	static const gchar *const versionstring = G_STRINGIFY(PRG_VERSION);
-	DBusMessage *reply = NULL;
-	gboolean status = FALSE;
+	DBusMessage *rsp = 0;
 
-	mce_log(LL_DEBUG, "Received version information request");
+	mce_log(LL_DEVEL, "signal stats request from %s",
+		mce_dbus_get_message_sender_ident(req));
 
-	/* Create a reply */
-	reply = dbus_new_method_reply(msg);
+	if( dbus_message_get_no_reply(req) )
+		goto EXIT;
 
-	/* Append the version information */
-	if (dbus_message_append_args(reply,
-				     DBUS_TYPE_STRING, &versionstring,
-				     DBUS_TYPE_INVALID) == FALSE) {
-		mce_log(LL_CRIT,
-			"Failed to append reply argument to D-Bus message "
-			"for %s.%s",
-			MCE_REQUEST_IF, MCE_VERSION_GET);
-		dbus_message_unref(reply);
+	rsp = dbus_new_method_reply(req);
+
+	if( !dbus_message_append_args(rsp,
+				      DBUS_TYPE_INT64, &mdb_sigq_sent_count,
+				      DBUS_TYPE_INT64, &mdb_sigq_suppressed_count,
+				      DBUS_TYPE_INVALID) )
 		goto EXIT;
-	}
 
-	/* Send the message */
-	status = dbus_send_message(reply);
+	dbus_send_message(rsp), rsp = 0;
 
 EXIT:
-	return status;
+	if( rsp )
+		dbus_message_unref(rsp);
+
+	return TRUE;
 }
 
-/** D-Bus callback for the get suspend time statistics method call
+/** D-Bus callback for the get peer credential statistics method call
  *
- * @param req The D-Bus message to reply to
+ * @param req The D-Bus message
  *
  * @return TRUE
  */
-static gboolean suspend_stats_get_dbus_cb(DBusMessage *const req)
+static gboolean peercred_stats_get_dbus_cb(DBusMessage *const req)
 {
 	DBusMessage *rsp = 0;
 
-	mce_log(LL_DEVEL, "suspend info request from %s",
+	mce_log(LL_DEVEL, "peer credential stats request from %s",
 		mce_dbus_get_message_sender_ident(req));
 
-	/* get stats */
-	dbus_int64_t uptime_ms  = mce_lib_get_boot_tick();
-	dbus_int64_t suspend_ms = uptime_ms - mce_lib_get_mono_tick();
+	if( dbus_message_get_no_reply(req) )
+		goto EXIT;
 
-	/* create and send reply message */
 	rsp = dbus_new_method_reply(req);
 
 	if( !dbus_message_append_args(rsp,
-				      DBUS_TYPE_INT64, &uptime_ms,
-				      DBUS_TYPE_INT64, &suspend_ms,
-				      DBUS_TYPE_INVALID) ) {
-		mce_log(LL_ERR, "Failed to append arguments");
+				      DBUS_TYPE_INT64, &peercred_cache_hits,
+				      DBUS_TYPE_INT64, &peercred_cache_misses,
+				      DBUS_TYPE_INT64, &peercred_cache_evictions,
+				      DBUS_TYPE_INT64, &peercred_query_count,
+				      DBUS_TYPE_INT64, &peercred_query_wait_total,
+				      DBUS_TYPE_INT64, &peercred_query_wait_max,
+				      DBUS_TYPE_INT64, &peercred_query_batch_max,
+				      DBUS_TYPE_INVALID) )
 		goto EXIT;
-	}
 
 	dbus_send_message(rsp), rsp = 0;
 
@@ -4665,6 +5746,113 @@ mce_dbus_iter_get_variant(DBusMessageIter *iter, DBusMessageIter *sub)
 	return mce_dbus_iter_get_container(iter, sub, DBUS_TYPE_VARIANT);
 }
 
+/** Store variant value according to property decoding instructions
+ *
+ * @param var  dbus message iterator pointing to variant content
+ * @param prop decoding instructions
+ *
+ * @return true if the value was stored, false otherwise
+ */
+static bool
+mce_dbus_iter_set_prop(DBusMessageIter *var, const mce_dbus_prop_t *prop)
+{
+	int have = dbus_message_iter_get_arg_type(var);
+
+	/* Any type goes, the caller deals with the content */
+	if( prop->type == DBUS_TYPE_VARIANT ) {
+		*(DBusMessageIter *)prop->dest = *var;
+		return true;
+	}
+
+	if( have != prop->type ) {
+		mce_log(LL_WARN, "%s: expected: %s, got: %s", prop->key,
+			mce_dbus_type_repr(prop->type),
+			mce_dbus_type_repr(have));
+		return false;
+	}
+
+	/* Booleans need conversion, everything else is stored as is;
+	 * for strings this means borrowing the message data */
+	if( have == DBUS_TYPE_BOOLEAN ) {
+		dbus_bool_t val = 0;
+		dbus_message_iter_get_basic(var, &val);
+		*(bool *)prop->dest = (val != 0);
+	}
+	else {
+		dbus_message_iter_get_basic(var, prop->dest);
+	}
+
+	return true;
+}
+
+/** Decode key string + variant value pair from dbus message iterator
+ *
+ * Can be used both for dictionary entry content and for
+ * PropertyChanged style signal arguments. Values for keys that are
+ * not listed in the decoding table are skipped without touching them.
+ *
+ * @param iter  dbus message iterator pointing to key string
+ * @param props decoding table, terminated with NULL key
+ * @param seen  bitmask of decoded table entries to update, or NULL
+ *
+ * @return true if the key and variant could be parsed, false otherwise
+ */
+bool
+mce_dbus_iter_get_prop(DBusMessageIter *iter, const mce_dbus_prop_t *props,
+		       unsigned *seen)
+{
+	const char      *key = 0;
+	DBusMessageIter  var;
+
+	if( !mce_dbus_iter_get_string(iter, &key) )
+		return false;
+
+	if( !mce_dbus_iter_get_variant(iter, &var) )
+		return false;
+
+	for( unsigned i = 0; props[i].key; ++i ) {
+		if( strcmp(props[i].key, key) )
+			continue;
+
+		if( mce_dbus_iter_set_prop(&var, props + i) && seen )
+			*seen |= 1u << i;
+		break;
+	}
+
+	return true;
+}
+
+/** Decode a{sv} dictionary from dbus message iterator
+ *
+ * All entries are processed in one pass over the array and the
+ * values are stored without making copies.
+ *
+ * @param iter  dbus message iterator pointing to a{sv} array
+ * @param props decoding table, terminated with NULL key
+ * @param seen  bitmask of decoded table entries to update, or NULL
+ *
+ * @return true if the whole dictionary could be parsed, false otherwise
+ */
+bool
+mce_dbus_iter_get_props(DBusMessageIter *iter, const mce_dbus_prop_t *props,
+			unsigned *seen)
+{
+	DBusMessageIter arr, ent;
+
+	if( !mce_dbus_iter_get_array(iter, &arr) )
+		return false;
+
+	while( !mce_dbus_iter_at_end(&arr) ) {
+		if( !mce_dbus_iter_get_entry(&arr, &ent) )
+			return false;
+
+		if( !mce_dbus_iter_get_prop(&ent, props, seen) )
+			return false;
+	}
+
+	return true;
+}
+
 /** Register D-Bus message handler
  *
  * @param self handler data
@@ -5120,6 +6308,53 @@ static mce_dbus_handler_t mce_dbus_handlers[] =
 			"    <arg direction=\"out\" name=\"uptime_ms\" type=\"x\"/>\n"
 			"    <arg direction=\"out\" name=\"suspend_ms\" type=\"x\"/>\n"
 	},
+	{
+		.interface = MCE_REQUEST_IF,
+		.name      = MCE_TIMER_STATS_GET,
+		.type      = DBUS_MESSAGE_TYPE_METHOD_CALL,
+		.callback  = timer_stats_get_dbus_cb,
+		.args      =
+			"    <arg direction=\"out\" name=\"stats\" type=\"a{s(xxxxx)}\"/>\n"
+	},
+	{
+		.interface = MCE_REQUEST_IF,
+		.name      = MCE_WAKELOCK_STATS_GET,
+		.type      = DBUS_MESSAGE_TYPE_METHOD_CALL,
+		.callback  = wakelock_stats_get_dbus_cb,
+		.args      =
+			"    <arg direction=\"out\" name=\"stats\" type=\"a{s(xxxxxb)}\"/>\n"
+	},
+	{
+		.interface = MCE_REQUEST_IF,
+		.name      = MCE_STARTUP_REPORT_GET,
+		.type      = DBUS_MESSAGE_TYPE_METHOD_CALL,
+		.callback  = startup_report_get_dbus_cb,
+		.args      =
+			"    <arg direction=\"out\" name=\"phases\" type=\"a(sxx)\"/>\n"
+	},
+	{
+		.interface = MCE_REQUEST_IF,
+		.name      = MCE_SIGNAL_STATS_GET,
+		.type      = DBUS_MESSAGE_TYPE_METHOD_CALL,
+		.callback  = signal_stats_get_dbus_cb,
+		.args      =
+			"    <arg direction=\"out\" name=\"sent\" type=\"x\"/>\n"
+			"    <arg direction=\"out\" name=\"suppressed\" type=\"x\"/>\n"
+	},
+	{
+		.interface = MCE_REQUEST_IF,
+		.name      = MCE_PEER_CREDENTIAL_STATS_GET,
+		.type      = DBUS_MESSAGE_TYPE_METHOD_CALL,
+		.callback  = peercred_stats_get_dbus_cb,
+		.args      =
+			"    <arg direction=\"out\" name=\"cache_hits\" type=\"x\"/>\n"
+			"    <arg direction=\"out\" name=\"cache_misses\" type=\"x\"/>\n"
+			"    <arg direction=\"out\" name=\"cache_evictions\" type=\"x\"/>\n"
+			"    <arg direction=\"out\" name=\"queries\" type=\"x\"/>\n"
+			"    <arg direction=\"out\" name=\"queue_wait_total_ms\" type=\"x\"/>\n"
+			"    <arg direction=\"out\" name=\"queue_wait_max_ms\" type=\"x\"/>\n"
+			"    <arg direction=\"out\" name=\"batch_max\" type=\"x\"/>\n"
+	},
 	{
 		.interface = MCE_REQUEST_IF,
 		.name      = MCE_VERBOSITY_GET,
@@ -5347,6 +6582,13 @@ void mce_dbus_exit(void)
 		dbus_handlers = 0;
 	}
 
+	/* Send out whatever signals are still queued */
+	mdb_sigq_flush();
+
+	mce_log(LL_DEBUG, "signals sent: %lld, suppressed: %lld",
+		(long long)mdb_sigq_sent_count,
+		(long long)mdb_sigq_suppressed_count);
+
 	/* Disconnect from D-Bus */
 	if (dbus_connection != NULL) {
 		mce_log(LL_DEBUG, "closing dbus connection");
@@ -113,6 +113,70 @@
 # define FINGERPRINT1_DBUS_SIG_ACQUISITION_INFO  "AcquisitionInfo"
 # define FINGERPRINT1_DBUS_SIG_ENROLL_PROGRESS   "EnrollProgressChanged"
 
+/* ========================================================================= *
+ * MCE DBUS EXTENSIONS
+ *
+ * Method call and signal names that are not (yet) provided by mce-dev
+ * ========================================================================= */
+
+/** Query wakeup statistics of heartbeat and wakelock timers */
+# ifndef MCE_TIMER_STATS_GET
+#  define MCE_TIMER_STATS_GET                     "get_timer_stats"
+# endif
+
+/** Query usage statistics of virtual wakelocks */
+# ifndef MCE_WAKELOCK_STATS_GET
+#  define MCE_WAKELOCK_STATS_GET                  "get_wakelock_stats"
+# endif
+
+/** Query extended display statistics */
+# ifndef MCE_DISPLAY_STATS_EXTENDED_GET
+#  define MCE_DISPLAY_STATS_EXTENDED_GET          "get_display_stats_extended"
+# endif
+
+/** Query timing of mce startup phases */
+# ifndef MCE_STARTUP_REPORT_GET
+#  define MCE_STARTUP_REPORT_GET                  "get_startup_report"
+# endif
+
+/** Query number of sent and suppressed duplicate signals */
+# ifndef MCE_SIGNAL_STATS_GET
+#  define MCE_SIGNAL_STATS_GET                    "get_signal_stats"
+# endif
+
+/** Query peer credential cache and query queue statistics */
+# ifndef MCE_PEER_CREDENTIAL_STATS_GET
+#  define MCE_PEER_CREDENTIAL_STATS_GET           "get_peer_credential_stats"
+# endif
+
+/** Query snapshot of public mce state as a{sv} dictionary */
+# ifndef MCE_STATE_SNAPSHOT_GET
+#  define MCE_STATE_SNAPSHOT_GET                  "get_state_snapshot"
+# endif
+
+/** Subscribe to aggregated state change signals */
+# ifndef MCE_STATE_CHANGED_SUBSCRIBE_REQ
+#  define MCE_STATE_CHANGED_SUBSCRIBE_REQ         "req_state_changed_subscribe"
+# endif
+
+/** Unsubscribe from aggregated state change signals */
+# ifndef MCE_STATE_CHANGED_UNSUBSCRIBE_REQ
+#  define MCE_STATE_CHANGED_UNSUBSCRIBE_REQ       "req_state_changed_unsubscribe"
+# endif
+
+/** Aggregated state change signal, carries a{sv} of changed keys only */
+# ifndef MCE_STATE_CHANGED_SIG
+#  define MCE_STATE_CHANGED_SIG                   "state_changed"
+# endif
+
+/** Query cpu keepalive session statistics */
+# ifndef MCE_CPU_KEEPALIVE_STATS_GET
+#  define MCE_CPU_KEEPALIVE_STATS_GET             "get_cpu_keepalive_stats"
+# endif
+
+/** Layout version of state snapshot, included as "version" key */
+# define MCE_STATE_SNAPSHOT_VERSION               1
+
 /* ========================================================================= *
  * D-Bus connection and message handling
  * ========================================================================= */
@@ -153,6 +217,31 @@ typedef struct
     gconstpointer cookie;
 } mce_dbus_handler_t;
 
+/** Decoding instructions for one a{sv} dictionary entry
+ *
+ * For use with mce_dbus_iter_get_props() etc. Tables are terminated
+ * with an entry that has NULL key and can have at most 32 entries.
+ *
+ * The type of dest depends on the expected value type:
+ * - DBUS_TYPE_BOOLEAN -> bool *
+ * - DBUS_TYPE_STRING, DBUS_TYPE_OBJECT_PATH -> const char **, the
+ *   string is borrowed from and valid as long as the message is
+ * - DBUS_TYPE_VARIANT -> DBusMessageIter *, accepts values of any
+ *   type and yields iterator pointing to the value
+ * - other basic types -> pointer to matching dbus_xxx_t type
+ */
+typedef struct
+{
+    /** Property name */
+    const char *key;
+
+    /** Expected value type */
+    int         type;
+
+    /** Where to store the value */
+    void       *dest;
+} mce_dbus_prop_t;
+
 DBusConnection *dbus_connection_get(void);
 
 DBusMessage *dbus_new_signal(const gchar *const path,
@@ -210,6 +299,8 @@ bool mce_dbus_iter_get_array(DBusMessageIter *iter, DBusMessageIter *sub);
 bool mce_dbus_iter_get_struct(DBusMessageIter *iter, DBusMessageIter *sub);
 bool mce_dbus_iter_get_entry(DBusMessageIter *iter, DBusMessageIter *sub);
 bool mce_dbus_iter_get_variant(DBusMessageIter *iter, DBusMessageIter *sub);
+bool mce_dbus_iter_get_prop(DBusMessageIter *iter, const mce_dbus_prop_t *props, unsigned *seen);
+bool mce_dbus_iter_get_props(DBusMessageIter *iter, const mce_dbus_prop_t *props, unsigned *seen);
 
 void mce_dbus_handler_register(mce_dbus_handler_t *self);
 void mce_dbus_handler_unregister(mce_dbus_handler_t *self);
@@ -29,10 +29,8 @@
 #include "mce.h"
 #include "mce-log.h"
 #include "mce-lib.h"
-
-#ifdef ENABLE_WAKELOCKS
-# include "libwakelock.h"
-#endif
+#include "mce-timerheap.h"
+#include "mce-wakelock.h"
 
 #include <sys/socket.h>
 
@@ -58,8 +56,17 @@ struct mce_hbtimer_t
     /** Timer name, used for debug logging purposes */
     char       *hbt_name;
 
-    /** Trigger time, milliseconds in CLOCK_BOOTTIME base */
-    int64_t     hbt_trigger;
+    /** Trigger time, milliseconds in CLOCK_BOOTTIME base
+     *
+     * The trigger time is held in the heap node that is used for
+     * keeping active timers in mht_queue_timer_heap. */
+    mce_timernode_t hbt_node;
+
+    /** Latest acceptable trigger time, held in mht_queue_deadline_heap */
+    mce_timernode_t hbt_deadline;
+
+    /** How much triggering can be delayed for coalescing purposes [ms] */
+    int         hbt_slack;
 
     /** Timer callback function */
     GSourceFunc hbt_notify;
@@ -70,6 +77,9 @@ struct mce_hbtimer_t
     /** Flag for: control within hbt_notify() */
     bool        hbt_in_notify;
 
+    /** Flag for: triggered, waiting for mht_queue_dispatch_timers() */
+    bool        hbt_dispatch_pending;
+
     /** User data to pass to hbt_notify() */
     void       *hbt_user_data;
 };
@@ -80,6 +90,7 @@ void            mce_hbtimer_delete         (mce_hbtimer_t *self);
 bool            mce_hbtimer_is_active      (const mce_hbtimer_t *self);
 const char     *mce_hbtimer_get_name       (const mce_hbtimer_t *self);
 void            mce_hbtimer_set_period     (mce_hbtimer_t *self, int period);
+void            mce_hbtimer_set_slack      (mce_hbtimer_t *self, int slack);
 void            mce_hbtimer_start          (mce_hbtimer_t *self);
 void            mce_hbtimer_stop           (mce_hbtimer_t *self);
 
@@ -91,7 +102,7 @@ static void     mce_hbtimer_set_trigger    (mce_hbtimer_t *self, int64_t trigger
  * ------------------------------------------------------------------------- */
 
 /** Monotonic tick value used to signify "not-set" */
-#define NO_TICK INT64_MAX
+#define NO_TICK MCE_TIMERHEAP_NO_TICK
 
 static guint    mht_add_iowatch            (int fd, bool close_on_unref, GIOCondition cnd, GIOFunc io_cb, gpointer aptr);
 
@@ -99,15 +110,24 @@ static guint    mht_add_iowatch            (int fd, bool close_on_unref, GIOCond
  * QUEUE_MANAGEMENT
  * ------------------------------------------------------------------------- */
 
-/** List of registered timers */
-static GSList *mht_queue_timer_list = 0;
+/** Lookup table of registered timers */
+static GHashTable *mht_queue_timer_lut = 0; // [mce_hbtimer_t *] -> mce_hbtimer_t *
+
+/** Active timers, ordered by trigger time */
+static mce_timerheap_t mht_queue_timer_heap = MCE_TIMERHEAP_INIT;
+
+/** Active timers, ordered by trigger time + slack */
+static mce_timerheap_t mht_queue_deadline_heap = MCE_TIMERHEAP_INIT;
+
+/** Wakeup statistics */
+static mce_timerstats_t mht_queue_stats = MCE_TIMERSTATS_INIT;
 
 void            mht_queue_dispatch_timers  (void);
 static void     mht_queue_schedule_wakeups (void);
-static void     mht_queue_garbage_collect  (void);
 static void     mht_queue_add_timer        (mce_hbtimer_t *self);
 static void     mht_queue_remove_timer     (mce_hbtimer_t *self);
 static bool     mht_queue_has_timer        (const mce_hbtimer_t *self);
+void            mce_hbtimer_get_stats      (mce_timerstats_t *stats);
 
 /* ------------------------------------------------------------------------- *
  * GLIB_WAKEUPS
@@ -132,11 +152,14 @@ static void     mht_glib_set_wakeup        (int64_t trigger, int64_t now);
 /** Cached timestamp of last requested iphb wakeup */
 static int64_t  mht_iphb_wakeup_tick = NO_TICK;
 
+/** Cached upper bound timestamp of last requested iphb wakeup */
+static int64_t  mht_iphb_wakeup_last = NO_TICK;
+
 /** Source id for iphb wakeup input watch */
 static guint   mht_iphb_wakeup_watch_id = 0;
 
 static gboolean mht_iphb_wakeup_cb         (GIOChannel *chn, GIOCondition cnd, gpointer data);
-static void     mht_iphb_set_wakeup        (int64_t trigger, int64_t now);
+static void     mht_iphb_set_wakeup        (int64_t trigger, int64_t deadline, int64_t now);
 
 /* ------------------------------------------------------------------------- *
  * IPHB_CONNECTION
@@ -180,6 +203,7 @@ static bool shutting_down = false;
 static void mht_datapipe_dsme_service_state_cb (gconstpointer data);
 static void mht_datapipe_resume_detected_event_cb (gconstpointer data);
 static void mht_datapipe_shutting_down_cb  (gconstpointer data);
+static void mht_datapipe_display_state_curr_cb(gconstpointer data);
 
 static void mht_datapipe_init(void);
 static void mht_datapipe_quit(void);
@@ -249,8 +273,11 @@ mce_hbtimer_create(const char  *name,
     self->hbt_notify    = notify;
     self->hbt_period    = period;
     self->hbt_user_data = user_data;
-    self->hbt_trigger   = NO_TICK;
     self->hbt_in_notify = false;
+    self->hbt_dispatch_pending = false;
+
+    mce_timernode_init(&self->hbt_node, self);
+    mce_timernode_init(&self->hbt_deadline, self);
 
     mht_queue_add_timer(self);
 
@@ -290,7 +317,7 @@ mce_hbtimer_is_active(const mce_hbtimer_t *self)
 {
     bool active = false;
     if( self )
-        active = (self->hbt_trigger < NO_TICK);
+        active = (self->hbt_node.tmn_trigger < NO_TICK);
     return active;
 }
 
@@ -324,6 +351,24 @@ mce_hbtimer_set_period(mce_hbtimer_t *self, int period)
         self->hbt_period = period;
 }
 
+/** Set heatbeat timer slack
+ *
+ * Allowing the timer to trigger late makes it possible to serve it
+ * from the same wakeup as some other timer. When the device is
+ * suspended, the wakeups are further aligned with iphb heartbeats.
+ *
+ * Takes effect when the timer is started the next time.
+ *
+ * @param self   heartbeat timer object, or NULL
+ * @param slack  allowed triggering delay [ms]
+ */
+void
+mce_hbtimer_set_slack(mce_hbtimer_t *self, int slack)
+{
+    if( self )
+        self->hbt_slack = (slack > 0) ? slack : 0;
+}
+
 /** Call heatbeat timer notification functiom
  *
  * @param self   heartbeat timer object, or NULL
@@ -341,7 +386,8 @@ mce_hbtimer_notify(mce_hbtimer_t *self)
         goto EXIT;
 
     self->hbt_in_notify = true;
-    self->hbt_trigger   = NO_TICK;
+    mce_timerheap_remove(&mht_queue_timer_heap, &self->hbt_node);
+    mce_timerheap_remove(&mht_queue_deadline_heap, &self->hbt_deadline);
 
     bool again = self->hbt_notify(self->hbt_user_data);
 
@@ -370,10 +416,21 @@ mce_hbtimer_set_trigger(mce_hbtimer_t *self, int64_t trigger)
     if( !self )
         goto EXIT;
 
-    if( self->hbt_trigger == trigger )
+    /* Explicit start/stop overrides already triggered state */
+    self->hbt_dispatch_pending = false;
+
+    if( self->hbt_node.tmn_trigger == trigger &&
+        (trigger == NO_TICK || mce_timernode_is_queued(&self->hbt_node)) )
         goto EXIT;
 
-    self->hbt_trigger = trigger;
+    int64_t deadline = NO_TICK;
+
+    if( trigger != NO_TICK )
+        deadline = trigger + self->hbt_slack;
+
+    mce_timerheap_schedule(&mht_queue_timer_heap, &self->hbt_node, trigger);
+    mce_timerheap_schedule(&mht_queue_deadline_heap, &self->hbt_deadline,
+                           deadline);
     mht_queue_schedule_wakeups();
 
 EXIT:
@@ -422,33 +479,6 @@ EXIT:
  * QUEUE_MANAGEMENT
  * ========================================================================= */
 
-/** Clean up unused timer list slots
- *
- * When timers are deleted, the associated node in mht_queue_timer_list
- * is left in place with data pointer set to zero.
- *
- * This function can be used to remove such stale entries in suitable
- * point outside the dispatch iteration loop.
- */
-static void
-mht_queue_garbage_collect(void)
-{
-    GSList **tail = &mht_queue_timer_list;
-
-    GSList *item;
-
-    while( (item = *tail) ) {
-        if( item->data ) {
-            tail = &item->next;
-        }
-        else {
-            *tail = item->next;
-            item->next = 0;
-            g_slist_free(item);
-        }
-    }
-}
-
 /** Predicate for: heartbeat timer is registered
  *
  * @param self   heartbeat timer object, or NULL
@@ -460,10 +490,10 @@ mht_queue_has_timer(const mce_hbtimer_t *self)
 {
     bool has_timer = false;
 
-    if( !self )
+    if( !self || !mht_queue_timer_lut )
         goto EXIT;
 
-    has_timer = g_slist_find(mht_queue_timer_list, self) != 0;
+    has_timer = g_hash_table_lookup(mht_queue_timer_lut, self) != 0;
 
 EXIT:
     return has_timer;
@@ -479,13 +509,12 @@ mht_queue_add_timer(mce_hbtimer_t *self)
     if( !self )
         goto EXIT;
 
-    /* Try to find recyclable vacated timer slot */
-    GSList *item = g_slist_find(mht_queue_timer_list, 0);
+    /* Timers can be created before mce_hbtimer_init() is called */
+    if( !mht_queue_timer_lut )
+        mht_queue_timer_lut = g_hash_table_new(g_direct_hash,
+                                               g_direct_equal);
 
-    if( item )
-        item->data = self;
-    else
-        mht_queue_timer_list = g_slist_prepend(mht_queue_timer_list, self);
+    g_hash_table_replace(mht_queue_timer_lut, self, self);
 
 EXIT:
     return;
@@ -501,17 +530,24 @@ mht_queue_remove_timer(mce_hbtimer_t *self)
     if( !self )
         goto EXIT;
 
-    GSList *item = g_slist_find(mht_queue_timer_list, self);
+    mce_timerheap_remove(&mht_queue_timer_heap, &self->hbt_node);
+    mce_timerheap_remove(&mht_queue_deadline_heap, &self->hbt_deadline);
 
-    /* Vacate the slot by clearing the data link */
-    if( item )
-        item->data = 0;
+    if( mht_queue_timer_lut )
+        g_hash_table_remove(mht_queue_timer_lut, self);
 
 EXIT:
     return;
 }
 
-/** Scan registered heartbeat timers and schdule nearest wakeup
+/** Schedule wakeup for the nearest heartbeat timer trigger
+ *
+ * While the device is awake, the glib wakeup is delayed until the
+ * earliest deadline (trigger + slack) so that all timers triggered
+ * by then get dispatched in one go.
+ *
+ * When suspended, the iphb wakeup range spans from the earliest
+ * trigger to the earliest deadline (or at least heartbeat period).
  */
 static void
 mht_queue_schedule_wakeups(void)
@@ -519,34 +555,24 @@ mht_queue_schedule_wakeups(void)
     if( !mce_hbtimer_initialized )
         goto EXIT;
 
-    int64_t trigger = NO_TICK;
-    bool    compact = false;
-
-    for( GSList *item = mht_queue_timer_list; item; item = item->next ) {
-        mce_hbtimer_t *timer = item->data;
-
-        if( !timer )
-            compact = true;
-        else if( trigger > timer->hbt_trigger )
-            trigger = timer->hbt_trigger;
-    }
-
-    if( compact )
-        mht_queue_garbage_collect();
-
-    int64_t now = mce_lib_get_boot_tick();
+    int64_t trigger  = mce_timerheap_next_trigger(&mht_queue_timer_heap);
+    int64_t deadline = mce_timerheap_next_trigger(&mht_queue_deadline_heap);
+    int64_t now      = mce_lib_get_boot_tick();
 
     if( trigger < now )
         trigger = now;
 
-    mht_glib_set_wakeup(trigger, now);
-    mht_iphb_set_wakeup(trigger, now);
+    if( deadline < trigger )
+        deadline = trigger;
+
+    mht_glib_set_wakeup(deadline, now);
+    mht_iphb_set_wakeup(trigger, deadline, now);
 
 EXIT:
     return;
 }
 
-/** Scan registered heartbeat timers and notify triggered ones
+/** Notify triggered heartbeat timers
  */
 void
 mht_queue_dispatch_timers(void)
@@ -565,35 +591,58 @@ mht_queue_dispatch_timers(void)
 
     /* Block suspend during dispatching */
 #ifdef ENABLE_WAKELOCKS
-    wakelock_lock("mce_hbtimer_dispatch", -1);
+    mce_wakelock_ref("mce_hbtimer_dispatch");
 #endif
 
     int64_t now = mce_lib_get_boot_tick();
 
-    for( GSList *item = mht_queue_timer_list; item; item = item->next ) {
-        mce_hbtimer_t *timer = item->data;
-
-        if( !timer )
-            continue;
+    /* Detach all triggered timers from the heap before notifying
+     * any of them, so that timers restarted from within notify
+     * callbacks do not get dispatched again during this round. */
+    GSList          *triggered = 0;
+    mce_timernode_t *node;
 
-        if( timer->hbt_trigger == NO_TICK )
-            continue;
+    while( (node = mce_timerheap_pop_expired(&mht_queue_timer_heap, now)) ) {
+        mce_hbtimer_t *timer = node->tmn_owner;
 
         mce_log(LL_DEBUG, "%s T%+"PRId64" ms",
                 mce_hbtimer_get_name(timer),
-                now - timer->hbt_trigger);
+                now - node->tmn_trigger);
+
+        mce_timerheap_remove(&mht_queue_deadline_heap, &timer->hbt_deadline);
+        timer->hbt_dispatch_pending = true;
+        triggered = g_slist_prepend(triggered, timer);
+    }
 
-        if( now < timer->hbt_trigger )
+    triggered = g_slist_reverse(triggered);
+
+    int notified = 0;
+
+    for( GSList *item = triggered; item; item = item->next ) {
+        mce_hbtimer_t *timer = item->data;
+
+        /* Skip timers that were deleted, stopped or restarted
+         * by notify callbacks of previously handled timers */
+        if( !mht_queue_has_timer(timer) )
+            continue;
+
+        if( !timer->hbt_dispatch_pending )
             continue;
 
+        timer->hbt_dispatch_pending = false;
         mce_hbtimer_notify(timer);
+        ++notified;
     }
 
+    g_slist_free(triggered);
+
+    mce_timerstats_add_wakeup(&mht_queue_stats, notified);
+
     /* Check the next timer to trigger */
     mht_queue_schedule_wakeups();
 
 #ifdef ENABLE_WAKELOCKS
-    wakelock_unlock("mce_hbtimer_dispatch");
+    mce_wakelock_unref("mce_hbtimer_dispatch");
 #endif
 
     pthread_mutex_unlock(&mutex);
@@ -602,6 +651,16 @@ EXIT:
     return;
 }
 
+/** Get heartbeat timer wakeup statistics
+ *
+ * @param stats  where to store the statistics snapshot
+ */
+void
+mce_hbtimer_get_stats(mce_timerstats_t *stats)
+{
+    mce_timerstats_get(&mht_queue_stats, stats, mce_lib_get_boot_tick());
+}
+
 /* ========================================================================= *
  * GLIB_WAKEUPS
  * ========================================================================= */
@@ -720,6 +779,7 @@ mht_iphb_wakeup_cb(GIOChannel *chn, GIOCondition cnd, gpointer data)
 
     /* clear programmed state */
     mht_iphb_wakeup_tick = NO_TICK;
+    mht_iphb_wakeup_last = NO_TICK;
 
     /* notify */
     mce_log(LL_DEBUG, "iphb wakeup; dispatch hbtimers");
@@ -740,24 +800,23 @@ cleanup_nak:
 
 /** Reprogram iphb timeout for dispatching heartbeat timers
  *
- * @param trigger when to trigger
- * @param now     current time
+ * @param trigger  when to trigger at the earliest
+ * @param deadline when to trigger at the latest
+ * @param now      current time
  */
 static void
-mht_iphb_set_wakeup(int64_t trigger, int64_t now)
+mht_iphb_set_wakeup(int64_t trigger, int64_t deadline, int64_t now)
 {
     /* Assume: iphb timer should be stopped */
     int lo = 0;
     int hi = 0;
     int64_t tick = NO_TICK;
+    int64_t last = NO_TICK;
 
     if( mht_connection_handle && trigger != NO_TICK) {
         /* Calculate the iphb wakeup range to be used. */
         int64_t delay = (trigger - now + 999) / 1000;
 
-        lo = (int)delay;
-        hi = lo + MHT_IPHB_WAKEUP_MAX_DELAY_S;
-
         /* Calculate the next full BOOTTIME second after low bound
          * of iphb wakeup. This is used for avoiding constant iphb
          * ipc when wakeups get re-evaluated.
@@ -774,10 +833,21 @@ mht_iphb_set_wakeup(int64_t trigger, int64_t now)
         tick = now + delay * 1000;
         tick += 999;
         tick -= tick % 1000;
+
+        /* Upper bound is also cached as full BOOTTIME second, and
+         * extended up to the deadline, if timer slack allows */
+        last = tick + MHT_IPHB_WAKEUP_MAX_DELAY_S * 1000;
+
+        if( deadline != NO_TICK && last < deadline - deadline % 1000 )
+            last = deadline - deadline % 1000;
+
+        lo = (int)delay;
+        hi = (int)((last - now) / 1000);
     }
 
-    if( mht_iphb_wakeup_tick != tick ) {
+    if( mht_iphb_wakeup_tick != tick || mht_iphb_wakeup_last != last ) {
         mht_iphb_wakeup_tick = tick;
+        mht_iphb_wakeup_last = last;
 
         if( mht_connection_handle )
             iphb_wait2(mht_connection_handle, lo, hi, 0, 1);
@@ -943,7 +1013,7 @@ mht_connection_close(void)
         mce_log(LL_DEBUG, "iphb disconnected");
 
         /* reset last programmed wakeup */
-        mht_iphb_set_wakeup(NO_TICK, NO_TICK);
+        mht_iphb_set_wakeup(NO_TICK, NO_TICK, NO_TICK);
     }
 }
 
@@ -1003,6 +1073,20 @@ EXIT:
     return;
 }
 
+/** Change notifications for display_state_curr
+ */
+static void mht_datapipe_display_state_curr_cb(gconstpointer data)
+{
+    display_state_t state = GPOINTER_TO_INT(data);
+
+    bool display_off = (state == MCE_DISPLAY_OFF ||
+                        state == MCE_DISPLAY_LPM_OFF);
+
+    /* Used for evaluating wakeups per display off time */
+    mce_timerstats_set_display_off(&mht_queue_stats, display_off,
+                                   mce_lib_get_boot_tick());
+}
+
 /** Array of datapipe handlers */
 static datapipe_handler_t mht_datapipe_handlers[] =
 {
@@ -1019,6 +1103,10 @@ static datapipe_handler_t mht_datapipe_handlers[] =
         .datapipe  = &shutting_down_pipe,
         .output_cb = mht_datapipe_shutting_down_cb,
     },
+    {
+        .datapipe  = &display_state_curr_pipe,
+        .output_cb = mht_datapipe_display_state_curr_cb,
+    },
 
     // sentinel
     {
@@ -1075,7 +1163,7 @@ mce_hbtimer_quit(void)
 
     /* Remove wakeups */
     mht_glib_set_wakeup(NO_TICK, NO_TICK);
-    mht_iphb_set_wakeup(NO_TICK, NO_TICK);
+    mht_iphb_set_wakeup(NO_TICK, NO_TICK, NO_TICK);
 
     /* close iphb connection */
     mht_connection_close();
@@ -27,6 +27,8 @@
 #ifndef MCE_HBTIMER_H_
 # define MCE_HBTIMER_H_
 
+# include "mce-timerheap.h"
+
 # include <stdbool.h>
 # include <glib.h>
 
@@ -42,11 +44,13 @@ void            mce_hbtimer_delete      (mce_hbtimer_t *self);
 bool            mce_hbtimer_is_active   (const mce_hbtimer_t *self);
 const char     *mce_hbtimer_get_name    (const mce_hbtimer_t *self);
 void            mce_hbtimer_set_period  (mce_hbtimer_t *self, int period);
+void            mce_hbtimer_set_slack   (mce_hbtimer_t *self, int slack);
 
 void            mce_hbtimer_start       (mce_hbtimer_t *self);
 void            mce_hbtimer_stop        (mce_hbtimer_t *self);
 
 void            mce_hbtimer_dispatch    (void);
+void            mce_hbtimer_get_stats   (mce_timerstats_t *stats);
 
 void            mce_hbtimer_init        (void);
 void            mce_hbtimer_quit        (void);
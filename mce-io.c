@@ -25,16 +25,15 @@
 #include "mce.h"
 #include "mce-log.h"
 #include "mce-lib.h"
-
-#ifdef ENABLE_WAKELOCKS
-# include "libwakelock.h"
-#endif
+#include "mce-wakelock.h"
+#include "mce-worker.h"
 
 #include <unistd.h>
 #include <inttypes.h>
 #include <string.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
 
 #include <glib/gstdio.h>
 
@@ -45,6 +44,9 @@
 /** Suffix used for temporary files */
 #define TMP_SUFFIX				".tmp"
 
+/** Async writes taking longer than this are logged [ms] */
+#define ASYNC_WRITE_SLOW_MS			100
+
 /* ========================================================================= *
  * TYPES
  * ========================================================================= */
@@ -78,6 +80,37 @@ struct mce_io_mon_t {
 	mce_io_mon_free_cb user_free_cb;/**< Callback for freeing user_data */
 };
 
+/** Asynchronous write tracking data for one file */
+typedef struct mce_io_async_t mce_io_async_t;
+
+/** One queued asynchronous write */
+typedef struct {
+	mce_io_async_t *ae_file;	/**< Tracking data for the file */
+	gchar          *ae_value;	/**< Value to write */
+} mce_io_async_entry_t;
+
+struct mce_io_async_t {
+	gchar          *aw_path;	/**< File to write to */
+	int             aw_fd;		/**< Open file descriptor, or -1 */
+	gboolean        aw_regular;	/**< Flag for: aw_fd is a regular file */
+
+	/** Queued write that can still be replaced, or NULL */
+	mce_io_async_entry_t *aw_pending;
+
+	/** Ordered write count at the time aw_pending was queued */
+	guint           aw_barrier;
+
+	/** Flag for: the latest write that has been made failed */
+	gboolean        aw_failed;
+
+	guint           aw_writes;	/**< Number of writes made */
+	guint           aw_failures;	/**< Number of failed writes */
+	guint           aw_collapsed;	/**< Number of overwritten values */
+
+	int64_t         aw_latency_sum;	/**< Total time spent writing [ms] */
+	int64_t         aw_latency_max;	/**< Slowest write [ms] */
+};
+
 /* ========================================================================= *
  * STATE_DATA
  * ========================================================================= */
@@ -85,6 +118,30 @@ struct mce_io_mon_t {
 /** List of all file monitors */
 static GSList *file_monitors = NULL;
 
+/** Lookup table for async write tracking: path -> mce_io_async_t */
+static GHashTable *async_write_lut = NULL;
+
+/** Pending async writes, in submission order */
+static GQueue async_write_queue = G_QUEUE_INIT;
+
+/** Number of ordered async writes queued so far */
+static guint async_write_barrier = 0;
+
+/** Flag for: pending writes are being executed */
+static gboolean async_write_busy = FALSE;
+
+/** Flag for: worker job for executing pending writes is scheduled */
+static gboolean async_write_scheduled = FALSE;
+
+/** Flag for: writes are passed to the worker thread */
+static gboolean async_write_enabled = FALSE;
+
+/** Mutex for protecting async write state */
+static pthread_mutex_t async_write_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/** Condition for waiting async write execution to finish */
+static pthread_cond_t async_write_cond = PTHREAD_COND_INITIALIZER;
+
 /* ========================================================================= *
  * PROTOTYPES
  * ========================================================================= */
@@ -144,6 +201,22 @@ gboolean        mce_io_save_to_existing_file            (const char *path, const
 gboolean        mce_io_save_file_atomic                 (const char *path, const void *data, size_t size, mode_t mode, gboolean keep_backup);
 gboolean        mce_io_update_file_atomic               (const char *path, const void *data, size_t size, mode_t mode, gboolean keep_backup);
 
+// ASYNC_WRITE
+
+static mce_io_async_t *mce_io_async_create              (const char *path);
+static void            mce_io_async_delete              (mce_io_async_t *self);
+static void            mce_io_async_delete_cb           (gpointer self);
+static gboolean        mce_io_async_write               (mce_io_async_t *self, const char *value);
+static void            mce_io_async_execute             (void);
+static void           *mce_io_async_job_cb              (void *aptr);
+
+void                   mce_io_write_async_full          (const char *path, const char *value, gboolean collapse);
+void                   mce_io_write_async               (const char *path, const char *value);
+void                   mce_io_write_async_number        (const char *path, gulong number);
+gboolean               mce_io_write_async_failed        (const char *path);
+void                   mce_io_write_async_init          (void);
+void                   mce_io_write_async_quit          (void);
+
 /* ========================================================================= *
  * SUSPEND_DETECTION
  * ========================================================================= */
@@ -454,7 +527,7 @@ static gboolean mce_io_mon_read_chunks(GIOChannel *source,
 	/* Since the locks on kernel side are released once all
 	 * events are read, we must obtain the userspace lock
 	 * before reading the available data */
-	wakelock_lock("mce_input_handler", -1);
+	mce_wakelock_ref("mce_input_handler");
 #endif
 
 	/* We get input from evdev nodes at resume, handle that 1st */
@@ -553,7 +626,7 @@ EXIT:
 
 #ifdef ENABLE_WAKELOCKS
 	/* Release the lock after we're done with processing it */
-	wakelock_unlock("mce_input_handler");
+	mce_wakelock_unref("mce_input_handler");
 #endif
 
 	return status;
@@ -2044,3 +2117,364 @@ EXIT:
 
 	return res;
 }
+
+/* ========================================================================= *
+ * ASYNC_WRITE
+ * ========================================================================= */
+
+/** Create async write tracking object
+ *
+ * @param path file to write to
+ *
+ * @return tracking object
+ */
+static mce_io_async_t *mce_io_async_create(const char *path)
+{
+	mce_io_async_t *self = g_slice_new0(mce_io_async_t);
+
+	self->aw_path    = g_strdup(path);
+	self->aw_fd      = -1;
+	self->aw_regular = FALSE;
+	self->aw_pending = 0;
+	self->aw_failed  = FALSE;
+
+	return self;
+}
+
+/** Delete async write tracking object
+ *
+ * @param self tracking object, or NULL
+ */
+static void mce_io_async_delete(mce_io_async_t *self)
+{
+	if( !self )
+		goto EXIT;
+
+	if( self->aw_writes ) {
+		mce_log(LL_DEBUG, "%s: writes=%u failures=%u collapsed=%u"
+			" latency: avg=%"PRId64" max=%"PRId64" ms",
+			self->aw_path, self->aw_writes, self->aw_failures,
+			self->aw_collapsed,
+			self->aw_latency_sum / self->aw_writes,
+			self->aw_latency_max);
+	}
+
+	if( self->aw_fd != -1 )
+		TEMP_FAILURE_RETRY(close(self->aw_fd));
+
+	g_free(self->aw_path);
+	g_slice_free(mce_io_async_t, self);
+
+EXIT:
+	return;
+}
+
+/** Type agnostic callback for deleting async write tracking objects
+ *
+ * @param self tracking object, or NULL
+ */
+static void mce_io_async_delete_cb(gpointer self)
+{
+	mce_io_async_delete(self);
+}
+
+/** Write a value to a file tracked by async write object
+ *
+ * The file is opened on the first write and then kept open, so that
+ * repeated writes to the same sysfs control file do not need to
+ * reopen it. The file is closed after failed writes, and reopened
+ * on the next write attempt.
+ *
+ * @param self  tracking object
+ * @param value string to write
+ *
+ * @return TRUE on success, FALSE on errors
+ */
+static gboolean mce_io_async_write(mce_io_async_t *self, const char *value)
+{
+	gboolean    res  = FALSE;
+	size_t      size = strlen(value);
+	struct stat st;
+
+	if( self->aw_fd == -1 ) {
+		self->aw_fd = TEMP_FAILURE_RETRY(open(self->aw_path,
+						      O_WRONLY|O_CLOEXEC));
+		if( self->aw_fd == -1 ) {
+			mce_log(LL_WARN, "open(%s): %m", self->aw_path);
+			goto EXIT;
+		}
+		self->aw_regular = (fstat(self->aw_fd, &st) == 0 &&
+				    S_ISREG(st.st_mode));
+	}
+
+	/* Sysfs attributes expect the value to be written at offset
+	 * zero; seeking fails harmlessly for non-seekable files */
+	lseek(self->aw_fd, 0, SEEK_SET);
+
+	if( !mce_io_write_all(self->aw_fd, value, size, 0) ) {
+		mce_log(LL_WARN, "write(%s): %m", self->aw_path);
+		goto EXIT;
+	}
+
+	if( self->aw_regular && ftruncate(self->aw_fd, size) == -1 ) {
+		mce_log(LL_WARN, "truncate(%s): %m", self->aw_path);
+		goto EXIT;
+	}
+
+	res = TRUE;
+
+EXIT:
+	if( !res && self->aw_fd != -1 ) {
+		TEMP_FAILURE_RETRY(close(self->aw_fd));
+		self->aw_fd = -1;
+	}
+
+	return res;
+}
+
+/** Execute pending async writes
+ *
+ * Can be called from both the worker thread and the main thread.
+ * Only one thread at a time executes writes, so that writes to
+ * the same file are made in the order they were submitted.
+ */
+static void mce_io_async_execute(void)
+{
+	pthread_mutex_lock(&async_write_mutex);
+
+	while( async_write_busy )
+		pthread_cond_wait(&async_write_cond, &async_write_mutex);
+
+	async_write_busy = TRUE;
+
+	for( ;; ) {
+		mce_io_async_entry_t *entry = g_queue_pop_head(&async_write_queue);
+
+		if( !entry ) {
+			async_write_scheduled = FALSE;
+			break;
+		}
+
+		mce_io_async_t *self  = entry->ae_file;
+		gchar          *value = entry->ae_value;
+
+		if( self->aw_pending == entry )
+			self->aw_pending = 0;
+		g_slice_free(mce_io_async_entry_t, entry);
+
+		/* Tracking objects are not released while busy, so the
+		 * path can be accessed without holding the mutex */
+		pthread_mutex_unlock(&async_write_mutex);
+
+		int64_t  t0 = mce_lib_get_boot_tick();
+		gboolean ok = mce_io_async_write(self, value);
+		int64_t  t1 = mce_lib_get_boot_tick();
+
+		if( t1 - t0 >= ASYNC_WRITE_SLOW_MS )
+			mce_log(LL_WARN, "%s: writing took %"PRId64" ms",
+				self->aw_path, t1 - t0);
+		else
+			mce_log(LL_DEBUG, "%s << %s", self->aw_path, value);
+
+		g_free(value);
+
+		pthread_mutex_lock(&async_write_mutex);
+
+		self->aw_writes += 1;
+		if( !ok )
+			self->aw_failures += 1;
+		self->aw_failed = !ok;
+		self->aw_latency_sum += t1 - t0;
+		if( self->aw_latency_max < t1 - t0 )
+			self->aw_latency_max = t1 - t0;
+	}
+
+	async_write_busy = FALSE;
+	pthread_cond_broadcast(&async_write_cond);
+
+	pthread_mutex_unlock(&async_write_mutex);
+}
+
+/** Worker thread callback for executing pending async writes
+ *
+ * @param aptr Unused
+ *
+ * @return NULL
+ */
+static void *mce_io_async_job_cb(void *aptr)
+{
+	(void)aptr;
+
+	mce_io_async_execute();
+
+	return NULL;
+}
+
+/** Write a string to a file asynchronously
+ *
+ * The write is made in the worker thread. All writes are made in
+ * submission order.
+ *
+ * If collapse is TRUE and the previous value queued for the same file
+ * has not been written yet, it is replaced by the new one - unless
+ * there are ordered writes queued in between. This is meant for
+ * state-like files where only the latest value matters.
+ *
+ * If collapse is FALSE, the write is always made, and it also acts as
+ * an ordering barrier: writes queued before it are not replaced by
+ * writes queued after it. This is meant for command-like files, such
+ * as led controller engine controls.
+ *
+ * The file must already exist, i.e. this is meant for sysfs and
+ * similar control files.
+ *
+ * Until mce_io_write_async_init() has been called, and after
+ * mce_io_write_async_quit() has been called, writes are made
+ * synchronously.
+ *
+ * @param path     file to write to
+ * @param value    string to write
+ * @param collapse TRUE to allow replacing the pending value
+ */
+void mce_io_write_async_full(const char *path, const char *value,
+			     gboolean collapse)
+{
+	gboolean schedule = FALSE;
+
+	if( !path || !value )
+		goto EXIT;
+
+	pthread_mutex_lock(&async_write_mutex);
+
+	if( !async_write_lut )
+		async_write_lut = g_hash_table_new_full(g_str_hash, g_str_equal,
+							0, mce_io_async_delete_cb);
+
+	mce_io_async_t *self = g_hash_table_lookup(async_write_lut, path);
+
+	if( !self ) {
+		self = mce_io_async_create(path);
+		g_hash_table_insert(async_write_lut, self->aw_path, self);
+	}
+
+	if( collapse && self->aw_pending &&
+	    self->aw_barrier == async_write_barrier ) {
+		/* Latest value wins */
+		g_free(self->aw_pending->ae_value);
+		self->aw_pending->ae_value = g_strdup(value);
+		self->aw_collapsed += 1;
+	}
+	else {
+		mce_io_async_entry_t *entry = g_slice_new(mce_io_async_entry_t);
+
+		entry->ae_file  = self;
+		entry->ae_value = g_strdup(value);
+		g_queue_push_tail(&async_write_queue, entry);
+
+		if( collapse ) {
+			self->aw_pending = entry;
+			self->aw_barrier = async_write_barrier;
+		}
+		else {
+			self->aw_pending = 0;
+			async_write_barrier += 1;
+		}
+	}
+
+	if( async_write_enabled && !async_write_scheduled )
+		async_write_scheduled = schedule = TRUE;
+
+	pthread_mutex_unlock(&async_write_mutex);
+
+	if( schedule )
+		mce_worker_add_job(0, "async-write", mce_io_async_job_cb, 0, 0);
+	else if( !async_write_enabled )
+		mce_io_async_execute();
+
+EXIT:
+	return;
+}
+
+/** Write a string to a state-like file asynchronously
+ *
+ * See mce_io_write_async_full() for details.
+ *
+ * @param path  file to write to
+ * @param value string to write
+ */
+void mce_io_write_async(const char *path, const char *value)
+{
+	mce_io_write_async_full(path, value, TRUE);
+}
+
+/** Write a string representation of a number to a file asynchronously
+ *
+ * See mce_io_write_async() for details.
+ *
+ * @param path   file to write to
+ * @param number number to write
+ */
+void mce_io_write_async_number(const char *path, gulong number)
+{
+	char value[32];
+
+	snprintf(value, sizeof value, "%lu", number);
+	mce_io_write_async(path, value);
+}
+
+/** Check whether the latest async write made to a file failed
+ *
+ * @param path file to check
+ *
+ * @return TRUE if the latest completed write failed, FALSE otherwise
+ */
+gboolean mce_io_write_async_failed(const char *path)
+{
+	gboolean failed = FALSE;
+
+	if( !path )
+		goto EXIT;
+
+	pthread_mutex_lock(&async_write_mutex);
+
+	mce_io_async_t *self = 0;
+
+	if( async_write_lut )
+		self = g_hash_table_lookup(async_write_lut, path);
+	if( self )
+		failed = self->aw_failed;
+
+	pthread_mutex_unlock(&async_write_mutex);
+
+EXIT:
+	return failed;
+}
+
+/** Start passing async writes to the worker thread
+ *
+ * Must be called after mce_worker_init().
+ */
+void mce_io_write_async_init(void)
+{
+	pthread_mutex_lock(&async_write_mutex);
+	async_write_enabled = TRUE;
+	pthread_mutex_unlock(&async_write_mutex);
+}
+
+/** Make pending async writes and release tracking data
+ *
+ * Must be called before mce_worker_quit().
+ */
+void mce_io_write_async_quit(void)
+{
+	pthread_mutex_lock(&async_write_mutex);
+	async_write_enabled = FALSE;
+	pthread_mutex_unlock(&async_write_mutex);
+
+	mce_io_async_execute();
+
+	pthread_mutex_lock(&async_write_mutex);
+	if( async_write_lut )
+		g_hash_table_unref(async_write_lut), async_write_lut = 0;
+	pthread_mutex_unlock(&async_write_mutex);
+}
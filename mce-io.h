@@ -168,4 +168,19 @@ gboolean mce_io_update_file_atomic(const char *path,
 				   const void *data, size_t size,
 				   mode_t mode, gboolean keep_backup);
 
+/* async write functions */
+
+void mce_io_write_async_full(const char *path, const char *value,
+			     gboolean collapse);
+
+void mce_io_write_async(const char *path, const char *value);
+
+void mce_io_write_async_number(const char *path, gulong number);
+
+gboolean mce_io_write_async_failed(const char *path);
+
+void mce_io_write_async_init(void);
+
+void mce_io_write_async_quit(void);
+
 #endif /* _MCE_IO_H_ */
@@ -0,0 +1,822 @@
+/**
+ * @file mce-journal.c
+ *
+ * Mode Control Entity - Datapipe traffic recording and replay
+ *
+ * <p>
+ *
+ * Copyright (C) 2017 Jolla Ltd.
+ *
+ * mce is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * mce is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mce.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mce-journal.h"
+
+#include "mce.h"
+#include "mce-log.h"
+#include "mce-lib.h"
+
+#include <linux/input.h>
+
+#include <sys/mman.h>
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+
+#include <glib.h>
+
+/* ========================================================================= *
+ * TYPES & CONSTANTS
+ * ========================================================================= */
+
+/** How datapipe values are serialized into journal records */
+typedef enum
+{
+    /** Value is an integer passed as pointer */
+    MCE_JOURNAL_CODEC_INT,
+
+    /** Value points to a nul terminated string */
+    MCE_JOURNAL_CODEC_STRING,
+
+    /** Value points to a fixed size binary object */
+    MCE_JOURNAL_CODEC_BLOB,
+} mce_journal_codec_t;
+
+/** Datapipe id table entry */
+typedef struct
+{
+    /** Datapipe to journal */
+    datapipe_struct     *jp_datapipe;
+
+    /** Datapipe name, for diagnostic logging */
+    const char          *jp_name;
+
+    /** How values are serialized */
+    mce_journal_codec_t  jp_codec;
+
+    /** Object size for MCE_JOURNAL_CODEC_BLOB */
+    size_t               jp_size;
+} mce_journal_pipe_t;
+
+/** State data for ongoing journal replay */
+typedef struct
+{
+    /** Records to replay, in sequence number order */
+    mce_journal_record_t *jr_records;
+
+    /** Number of records to replay */
+    size_t                jr_count;
+
+    /** Index of the next record to replay */
+    size_t                jr_index;
+
+    /** Replay speed factor, or 0 for no delays */
+    int                   jr_speed;
+
+    /** Timer / idle callback id for the next replay step */
+    guint                 jr_timer_id;
+
+    /** Replay start time [ms] */
+    int64_t               jr_started_tick;
+
+    /** Process cpu time at replay start [ms] */
+    int64_t               jr_started_cpu;
+
+    /** Decoded values that must stay valid until quit */
+    GSList               *jr_retained;
+} mce_journal_replay_t;
+
+G_STATIC_ASSERT(sizeof (mce_journal_header_t) == 64);
+G_STATIC_ASSERT(sizeof (mce_journal_record_t) == 64);
+
+/* ========================================================================= *
+ * PROTOTYPES
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * JOURNAL_PIPES
+ * ------------------------------------------------------------------------- */
+
+static const mce_journal_pipe_t *mce_journal_pipe_from_id(unsigned id);
+
+/* ------------------------------------------------------------------------- *
+ * JOURNAL_CODEC
+ * ------------------------------------------------------------------------- */
+
+static void     mce_journal_encode(const mce_journal_pipe_t *pipe, gconstpointer data, mce_journal_record_t *rec);
+static gpointer mce_journal_decode(const mce_journal_pipe_t *pipe, const mce_journal_record_t *rec);
+
+/* ------------------------------------------------------------------------- *
+ * JOURNAL_RECORD
+ * ------------------------------------------------------------------------- */
+
+bool mce_journal_init  (const char *path);
+void mce_journal_quit  (void);
+void mce_journal_record(const datapipe_struct *datapipe, gconstpointer data, unsigned flags, unsigned depth);
+
+/* ------------------------------------------------------------------------- *
+ * JOURNAL_REPLAY
+ * ------------------------------------------------------------------------- */
+
+static int64_t  mce_journal_replay_cpu_tick    (void);
+static bool     mce_journal_replay_is_toplevel (const mce_journal_record_t *rec);
+static gint     mce_journal_replay_compare_cb  (gconstpointer a, gconstpointer b);
+static bool     mce_journal_replay_load        (const char *path);
+static void     mce_journal_replay_execute     (const mce_journal_record_t *rec);
+static void     mce_journal_replay_schedule    (void);
+static gboolean mce_journal_replay_step_cb     (gpointer aptr);
+static void     mce_journal_replay_finish      (void);
+static void     mce_journal_replay_cancel      (void);
+bool            mce_journal_replay             (const char *path, int speed);
+
+/* ========================================================================= *
+ * JOURNAL_PIPES
+ * ========================================================================= */
+
+/** Datapipes that are journaled
+ *
+ * Datapipe id stored in journal records is index to this table
+ * plus one. Entries must not be reordered or removed without
+ * bumping MCE_JOURNAL_VERSION; new entries can be appended.
+ */
+static const mce_journal_pipe_t mce_journal_pipe_tab[] =
+{
+    { &led_brightness_pipe, "led_brightness", MCE_JOURNAL_CODEC_INT, 0 },
+    { &lpm_brightness_pipe, "lpm_brightness", MCE_JOURNAL_CODEC_INT, 0 },
+    { &device_inactive_pipe, "device_inactive", MCE_JOURNAL_CODEC_INT, 0 },
+    { &inactivity_event_pipe, "inactivity_event", MCE_JOURNAL_CODEC_INT, 0 },
+    { &led_pattern_activate_pipe, "led_pattern_activate", MCE_JOURNAL_CODEC_STRING, 0 },
+    { &led_pattern_deactivate_pipe, "led_pattern_deactivate", MCE_JOURNAL_CODEC_STRING, 0 },
+    { &resume_detected_event_pipe, "resume_detected_event", MCE_JOURNAL_CODEC_BLOB, sizeof (int64_t) },
+    { &user_activity_event_pipe, "user_activity_event", MCE_JOURNAL_CODEC_BLOB, sizeof (struct input_event) },
+    { &cpu_boost_event_pipe, "cpu_boost_event", MCE_JOURNAL_CODEC_BLOB, sizeof (struct input_event) },
+    { &display_state_curr_pipe, "display_state_curr", MCE_JOURNAL_CODEC_INT, 0 },
+    { &display_state_request_pipe, "display_state_request", MCE_JOURNAL_CODEC_INT, 0 },
+    { &display_state_next_pipe, "display_state_next", MCE_JOURNAL_CODEC_INT, 0 },
+    { &uiexception_type_pipe, "uiexception_type", MCE_JOURNAL_CODEC_INT, 0 },
+    { &display_brightness_pipe, "display_brightness", MCE_JOURNAL_CODEC_INT, 0 },
+    { &key_backlight_brightness_pipe, "key_backlight_brightness", MCE_JOURNAL_CODEC_INT, 0 },
+    { &keypress_event_pipe, "keypress_event", MCE_JOURNAL_CODEC_BLOB, sizeof (struct input_event) },
+    { &touchscreen_event_pipe, "touchscreen_event", MCE_JOURNAL_CODEC_BLOB, sizeof (struct input_event) },
+    { &lockkey_state_pipe, "lockkey_state", MCE_JOURNAL_CODEC_INT, 0 },
+    { &init_done_pipe, "init_done", MCE_JOURNAL_CODEC_INT, 0 },
+    { &keyboard_slide_state_pipe, "keyboard_slide_state", MCE_JOURNAL_CODEC_INT, 0 },
+    { &keyboard_available_state_pipe, "keyboard_available_state", MCE_JOURNAL_CODEC_INT, 0 },
+    { &lid_sensor_is_working_pipe, "lid_sensor_is_working", MCE_JOURNAL_CODEC_INT, 0 },
+    { &lid_sensor_actual_pipe, "lid_sensor_actual", MCE_JOURNAL_CODEC_INT, 0 },
+    { &lid_sensor_filtered_pipe, "lid_sensor_filtered", MCE_JOURNAL_CODEC_INT, 0 },
+    { &lens_cover_state_pipe, "lens_cover_state", MCE_JOURNAL_CODEC_INT, 0 },
+    { &proximity_sensor_actual_pipe, "proximity_sensor_actual", MCE_JOURNAL_CODEC_INT, 0 },
+    { &light_sensor_actual_pipe, "light_sensor_actual", MCE_JOURNAL_CODEC_INT, 0 },
+    { &light_sensor_filtered_pipe, "light_sensor_filtered", MCE_JOURNAL_CODEC_INT, 0 },
+    { &light_sensor_poll_request_pipe, "light_sensor_poll_request", MCE_JOURNAL_CODEC_INT, 0 },
+    { &orientation_sensor_actual_pipe, "orientation_sensor_actual", MCE_JOURNAL_CODEC_INT, 0 },
+    { &alarm_ui_state_pipe, "alarm_ui_state", MCE_JOURNAL_CODEC_INT, 0 },
+    { &system_state_pipe, "system_state", MCE_JOURNAL_CODEC_INT, 0 },
+    { &master_radio_enabled_pipe, "master_radio_enabled", MCE_JOURNAL_CODEC_INT, 0 },
+    { &submode_pipe, "submode", MCE_JOURNAL_CODEC_INT, 0 },
+    { &call_state_pipe, "call_state", MCE_JOURNAL_CODEC_INT, 0 },
+    { &ignore_incoming_call_event_pipe, "ignore_incoming_call_event", MCE_JOURNAL_CODEC_INT, 0 },
+    { &call_type_pipe, "call_type", MCE_JOURNAL_CODEC_INT, 0 },
+    { &tklock_request_pipe, "tklock_request", MCE_JOURNAL_CODEC_INT, 0 },
+    { &interaction_expected_pipe, "interaction_expected", MCE_JOURNAL_CODEC_INT, 0 },
+    { &charger_state_pipe, "charger_state", MCE_JOURNAL_CODEC_INT, 0 },
+    { &battery_status_pipe, "battery_status", MCE_JOURNAL_CODEC_INT, 0 },
+    { &battery_level_pipe, "battery_level", MCE_JOURNAL_CODEC_INT, 0 },
+    { &topmost_window_pid_pipe, "topmost_window_pid", MCE_JOURNAL_CODEC_INT, 0 },
+    { &camera_button_state_pipe, "camera_button_state", MCE_JOURNAL_CODEC_INT, 0 },
+    { &inactivity_delay_pipe, "inactivity_delay", MCE_JOURNAL_CODEC_INT, 0 },
+    { &audio_route_pipe, "audio_route", MCE_JOURNAL_CODEC_INT, 0 },
+    { &usb_cable_state_pipe, "usb_cable_state", MCE_JOURNAL_CODEC_INT, 0 },
+    { &jack_sense_state_pipe, "jack_sense_state", MCE_JOURNAL_CODEC_INT, 0 },
+    { &power_saving_mode_active_pipe, "power_saving_mode_active", MCE_JOURNAL_CODEC_INT, 0 },
+    { &thermal_state_pipe, "thermal_state", MCE_JOURNAL_CODEC_INT, 0 },
+    { &heartbeat_event_pipe, "heartbeat_event", MCE_JOURNAL_CODEC_INT, 0 },
+    { &compositor_service_state_pipe, "compositor_service_state", MCE_JOURNAL_CODEC_INT, 0 },
+    { &lipstick_service_state_pipe, "lipstick_service_state", MCE_JOURNAL_CODEC_INT, 0 },
+    { &devicelock_service_state_pipe, "devicelock_service_state", MCE_JOURNAL_CODEC_INT, 0 },
+    { &usbmoded_service_state_pipe, "usbmoded_service_state", MCE_JOURNAL_CODEC_INT, 0 },
+    { &ngfd_service_state_pipe, "ngfd_service_state", MCE_JOURNAL_CODEC_INT, 0 },
+    { &ngfd_event_request_pipe, "ngfd_event_request", MCE_JOURNAL_CODEC_STRING, 0 },
+    { &dsme_service_state_pipe, "dsme_service_state", MCE_JOURNAL_CODEC_INT, 0 },
+    { &bluez_service_state_pipe, "bluez_service_state", MCE_JOURNAL_CODEC_INT, 0 },
+    { &packagekit_locked_pipe, "packagekit_locked", MCE_JOURNAL_CODEC_INT, 0 },
+    { &osupdate_running_pipe, "osupdate_running", MCE_JOURNAL_CODEC_INT, 0 },
+    { &shutting_down_pipe, "shutting_down", MCE_JOURNAL_CODEC_INT, 0 },
+    { &devicelock_state_pipe, "devicelock_state", MCE_JOURNAL_CODEC_INT, 0 },
+    { &touch_detected_pipe, "touch_detected", MCE_JOURNAL_CODEC_INT, 0 },
+    { &touch_grab_wanted_pipe, "touch_grab_wanted", MCE_JOURNAL_CODEC_INT, 0 },
+    { &touch_grab_active_pipe, "touch_grab_active", MCE_JOURNAL_CODEC_INT, 0 },
+    { &keypad_grab_wanted_pipe, "keypad_grab_wanted", MCE_JOURNAL_CODEC_INT, 0 },
+    { &keypad_grab_active_pipe, "keypad_grab_active", MCE_JOURNAL_CODEC_INT, 0 },
+    { &music_playback_ongoing_pipe, "music_playback_ongoing", MCE_JOURNAL_CODEC_INT, 0 },
+    { &proximity_blanked_pipe, "proximity_blanked", MCE_JOURNAL_CODEC_INT, 0 },
+    { &wristgesture_sensor_pipe, "wristgesture_sensor", MCE_JOURNAL_CODEC_INT, 0 },
+    { &fpd_service_state_pipe, "fpd_service_state", MCE_JOURNAL_CODEC_INT, 0 },
+    { &fpstate_pipe, "fpstate", MCE_JOURNAL_CODEC_INT, 0 },
+    { &enroll_in_progress_pipe, "enroll_in_progress", MCE_JOURNAL_CODEC_INT, 0 },
+};
+
+/** Number of entries in mce_journal_pipe_tab */
+#define MCE_JOURNAL_PIPE_COUNT G_N_ELEMENTS(mce_journal_pipe_tab)
+
+/** Lookup datapipe id table entry
+ *
+ * @param id  datapipe id from journal record
+ *
+ * @return table entry, or NULL if id is not valid
+ */
+static const mce_journal_pipe_t *
+mce_journal_pipe_from_id(unsigned id)
+{
+    if( id < 1 || id > MCE_JOURNAL_PIPE_COUNT )
+        return 0;
+
+    return &mce_journal_pipe_tab[id - 1];
+}
+
+/* ========================================================================= *
+ * JOURNAL_CODEC
+ * ========================================================================= */
+
+/** Serialize datapipe value into journal record
+ *
+ * Values that do not fit in the record are truncated and
+ * flagged as such.
+ *
+ * @param pipe  datapipe id table entry
+ * @param data  datapipe value
+ * @param rec   record to fill in
+ */
+static void
+mce_journal_encode(const mce_journal_pipe_t *pipe, gconstpointer data,
+                   mce_journal_record_t *rec)
+{
+    size_t size = 0;
+
+    switch( pipe->jp_codec ) {
+    case MCE_JOURNAL_CODEC_INT:
+        {
+            int64_t val = (int64_t)GPOINTER_TO_INT(data);
+            size = sizeof val;
+            memcpy(rec->jr_data, &val, size);
+        }
+        break;
+
+    case MCE_JOURNAL_CODEC_STRING:
+        if( !data ) {
+            rec->jr_flags |= MCE_JOURNAL_FLAG_NULL;
+            break;
+        }
+        size = strlen(data);
+        if( size > MCE_JOURNAL_DATA_MAX ) {
+            rec->jr_flags |= MCE_JOURNAL_FLAG_TRUNCATED;
+            size = MCE_JOURNAL_DATA_MAX;
+        }
+        memcpy(rec->jr_data, data, size);
+        break;
+
+    case MCE_JOURNAL_CODEC_BLOB:
+        if( !data ) {
+            rec->jr_flags |= MCE_JOURNAL_FLAG_NULL;
+            break;
+        }
+        size = pipe->jp_size;
+        if( size > MCE_JOURNAL_DATA_MAX ) {
+            rec->jr_flags |= MCE_JOURNAL_FLAG_TRUNCATED;
+            size = MCE_JOURNAL_DATA_MAX;
+        }
+        memcpy(rec->jr_data, data, size);
+        break;
+
+    default:
+        break;
+    }
+
+    rec->jr_size = (uint8_t)size;
+}
+
+/** Deserialize datapipe value from journal record
+ *
+ * Pointer values are returned as dynamically allocated copies
+ * that the caller must release with g_free().
+ *
+ * @param pipe  datapipe id table entry
+ * @param rec   record to decode
+ *
+ * @return datapipe value
+ */
+static gpointer
+mce_journal_decode(const mce_journal_pipe_t *pipe,
+                   const mce_journal_record_t *rec)
+{
+    gpointer data = 0;
+    size_t   size = MIN(rec->jr_size, MCE_JOURNAL_DATA_MAX);
+
+    if( rec->jr_flags & MCE_JOURNAL_FLAG_NULL )
+        goto EXIT;
+
+    switch( pipe->jp_codec ) {
+    case MCE_JOURNAL_CODEC_INT:
+        {
+            int64_t val = 0;
+            memcpy(&val, rec->jr_data, MIN(size, sizeof val));
+            data = GINT_TO_POINTER((gint)val);
+        }
+        break;
+
+    case MCE_JOURNAL_CODEC_STRING:
+        data = g_strndup((const char *)rec->jr_data, size);
+        break;
+
+    case MCE_JOURNAL_CODEC_BLOB:
+        /* Truncated tail is left zero filled */
+        data = g_malloc0(pipe->jp_size);
+        memcpy(data, rec->jr_data, MIN(size, pipe->jp_size));
+        break;
+
+    default:
+        break;
+    }
+
+EXIT:
+    return data;
+}
+
+/* ========================================================================= *
+ * JOURNAL_RECORD
+ * ========================================================================= */
+
+/** Journal file mapped to memory, or NULL if not recording */
+static mce_journal_header_t *mce_journal_header = 0;
+
+/** Record slots following the header */
+static mce_journal_record_t *mce_journal_slots = 0;
+
+/** Size of the memory mapping [bytes] */
+static size_t mce_journal_mapped_size = 0;
+
+/** Start recording datapipe traffic to a memory mapped ring file
+ *
+ * Any previous journal content is discarded. Must be called
+ * after the datapipes have been initialized.
+ *
+ * @param path  journal file path, or NULL to use MCE_JOURNAL_FILE
+ *
+ * @return true on success, false otherwise
+ */
+bool
+mce_journal_init(const char *path)
+{
+    bool    ack  = false;
+    int     fd   = -1;
+    void   *mem  = MAP_FAILED;
+    size_t  size = (sizeof *mce_journal_header +
+                    MCE_JOURNAL_RECORD_COUNT * sizeof *mce_journal_slots);
+
+    if( mce_journal_header )
+        goto EXIT;
+
+    if( !path )
+        path = MCE_JOURNAL_FILE;
+
+    if( (fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644)) == -1 ) {
+        mce_log(LL_WARN, "%s: open: %m", path);
+        goto EXIT;
+    }
+
+    /* Truncate to zero first so that stale records are cleared */
+    if( ftruncate(fd, 0) == -1 || ftruncate(fd, size) == -1 ) {
+        mce_log(LL_WARN, "%s: truncate: %m", path);
+        goto EXIT;
+    }
+
+    mem = mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if( mem == MAP_FAILED ) {
+        mce_log(LL_WARN, "%s: mmap: %m", path);
+        goto EXIT;
+    }
+
+    mce_journal_header      = mem;
+    mce_journal_slots       = (mce_journal_record_t *)(mce_journal_header + 1);
+    mce_journal_mapped_size = size;
+
+    memcpy(mce_journal_header->jh_magic, MCE_JOURNAL_MAGIC,
+           sizeof mce_journal_header->jh_magic);
+    mce_journal_header->jh_version      = MCE_JOURNAL_VERSION;
+    mce_journal_header->jh_record_size  = sizeof *mce_journal_slots;
+    mce_journal_header->jh_record_count = MCE_JOURNAL_RECORD_COUNT;
+    mce_journal_header->jh_pipe_count   = MCE_JOURNAL_PIPE_COUNT;
+    mce_journal_header->jh_write_seq    = 1;
+
+    for( size_t i = 0; i < MCE_JOURNAL_PIPE_COUNT; ++i )
+        mce_journal_pipe_tab[i].jp_datapipe->journal_id = i + 1;
+
+    mce_log(LL_NOTICE, "recording datapipe journal to %s", path);
+    ack = true;
+
+EXIT:
+    if( fd != -1 )
+        close(fd);
+
+    return ack;
+}
+
+/** Stop recording datapipe traffic and cancel ongoing replay
+ *
+ * The journal file is left in place for post mortem inspection.
+ */
+void
+mce_journal_quit(void)
+{
+    mce_journal_replay_cancel();
+
+    if( !mce_journal_header )
+        goto EXIT;
+
+    for( size_t i = 0; i < MCE_JOURNAL_PIPE_COUNT; ++i )
+        mce_journal_pipe_tab[i].jp_datapipe->journal_id = 0;
+
+    munmap(mce_journal_header, mce_journal_mapped_size);
+    mce_journal_header      = 0;
+    mce_journal_slots       = 0;
+    mce_journal_mapped_size = 0;
+
+EXIT:
+    return;
+}
+
+/** Append datapipe execution to the journal
+ *
+ * Called from datapipe execution functions. Does nothing if
+ * recording is not enabled or the datapipe is not journaled.
+ *
+ * @param datapipe  datapipe that is being executed
+ * @param data      value fed to the datapipe
+ * @param flags     bitmask of mce_journal_flag_t
+ * @param depth     datapipe execution nesting level
+ */
+void
+mce_journal_record(const datapipe_struct *datapipe, gconstpointer data,
+                   unsigned flags, unsigned depth)
+{
+    const mce_journal_pipe_t *pipe = 0;
+
+    if( !mce_journal_header || !datapipe || !datapipe->journal_id )
+        goto EXIT;
+
+    if( !(pipe = mce_journal_pipe_from_id(datapipe->journal_id)) )
+        goto EXIT;
+
+    uint64_t seq = mce_journal_header->jh_write_seq;
+    mce_journal_record_t *rec = &mce_journal_slots[seq % MCE_JOURNAL_RECORD_COUNT];
+
+    memset(rec, 0, sizeof *rec);
+    rec->jr_seq   = seq;
+    rec->jr_pipe  = (uint16_t)datapipe->journal_id;
+    rec->jr_flags = (uint8_t)flags;
+    rec->jr_depth = (uint8_t)MIN(depth, UINT8_MAX);
+    rec->jr_tick  = mce_lib_get_boot_tick();
+
+    if( !(flags & MCE_JOURNAL_FLAG_USE_CACHE) )
+        mce_journal_encode(pipe, data, rec);
+
+    /* Publish after the record is complete */
+    mce_journal_header->jh_write_seq = seq + 1;
+
+EXIT:
+    return;
+}
+
+/* ========================================================================= *
+ * JOURNAL_REPLAY
+ * ========================================================================= */
+
+/** Ongoing journal replay, or NULL */
+static mce_journal_replay_t *mce_journal_replay_state = 0;
+
+/** Get process cpu time
+ *
+ * @return cpu time used by mce process [ms]
+ */
+static int64_t
+mce_journal_replay_cpu_tick(void)
+{
+    struct timespec ts = { 0, 0 };
+
+    if( clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) == -1 )
+        return 0;
+
+    return ts.tv_sec * INT64_C(1000) + ts.tv_nsec / 1000000;
+}
+
+/** Predicate for: record describes externally originated input
+ *
+ * Executions made from within datapipe callbacks are not replayed
+ * as they are expected to happen again as side effects of the
+ * top level executions.
+ *
+ * @param rec  journal record
+ *
+ * @return true if record should be replayed, false otherwise
+ */
+static bool
+mce_journal_replay_is_toplevel(const mce_journal_record_t *rec)
+{
+    if( rec->jr_flags & MCE_JOURNAL_FLAG_OUTPUT_ONLY )
+        return rec->jr_depth == 0;
+
+    if( rec->jr_flags & MCE_JOURNAL_FLAG_QUEUED )
+        return false;
+
+    return rec->jr_depth == 1;
+}
+
+/** Compare journal records by sequence number
+ *
+ * @param a  journal record
+ * @param b  journal record
+ *
+ * @return negative / zero / positive value
+ */
+static gint
+mce_journal_replay_compare_cb(gconstpointer a, gconstpointer b)
+{
+    const mce_journal_record_t *rec_a = a;
+    const mce_journal_record_t *rec_b = b;
+
+    return (rec_a->jr_seq > rec_b->jr_seq) - (rec_a->jr_seq < rec_b->jr_seq);
+}
+
+/** Load top level records from journal file
+ *
+ * @param path  journal file path
+ *
+ * @return true on success, false otherwise
+ */
+static bool
+mce_journal_replay_load(const char *path)
+{
+    bool    ack  = false;
+    gchar  *data = 0;
+    gsize   size = 0;
+    GError *err  = 0;
+    GArray *recs = 0;
+
+    if( !g_file_get_contents(path, &data, &size, &err) ) {
+        mce_log(LL_ERR, "%s: %s", path, err->message);
+        goto EXIT;
+    }
+
+    const mce_journal_header_t *hdr = (const mce_journal_header_t *)data;
+
+    if( size < sizeof *hdr ||
+        memcmp(hdr->jh_magic, MCE_JOURNAL_MAGIC, sizeof hdr->jh_magic) ) {
+        mce_log(LL_ERR, "%s: not a datapipe journal", path);
+        goto EXIT;
+    }
+
+    if( hdr->jh_version != MCE_JOURNAL_VERSION ||
+        hdr->jh_record_size != sizeof (mce_journal_record_t) ||
+        hdr->jh_pipe_count > MCE_JOURNAL_PIPE_COUNT ) {
+        mce_log(LL_ERR, "%s: unsupported journal version", path);
+        goto EXIT;
+    }
+
+    if( size < sizeof *hdr + (size_t)hdr->jh_record_count * hdr->jh_record_size ) {
+        mce_log(LL_ERR, "%s: journal file is truncated", path);
+        goto EXIT;
+    }
+
+    const mce_journal_record_t *slots = (const mce_journal_record_t *)(hdr + 1);
+
+    recs = g_array_new(false, false, sizeof (mce_journal_record_t));
+
+    for( uint32_t i = 0; i < hdr->jh_record_count; ++i ) {
+        const mce_journal_record_t *rec = &slots[i];
+
+        if( rec->jr_seq == 0 || !mce_journal_pipe_from_id(rec->jr_pipe) )
+            continue;
+
+        if( mce_journal_replay_is_toplevel(rec) )
+            g_array_append_vals(recs, rec, 1);
+    }
+
+    g_array_sort(recs, mce_journal_replay_compare_cb);
+
+    mce_journal_replay_state->jr_count   = recs->len;
+    mce_journal_replay_state->jr_records =
+        (mce_journal_record_t *)g_array_free(recs, false);
+    recs = 0;
+
+    mce_log(LL_NOTICE, "%s: %zu records to replay", path,
+            mce_journal_replay_state->jr_count);
+    ack = true;
+
+EXIT:
+    if( recs )
+        g_array_free(recs, true);
+    g_clear_error(&err);
+    g_free(data);
+
+    return ack;
+}
+
+/** Feed one journal record to the datapipe it was recorded from
+ *
+ * @param rec  journal record
+ */
+static void
+mce_journal_replay_execute(const mce_journal_record_t *rec)
+{
+    const mce_journal_pipe_t *pipe     = mce_journal_pipe_from_id(rec->jr_pipe);
+    datapipe_struct          *datapipe = pipe->jp_datapipe;
+
+    if( rec->jr_flags & MCE_JOURNAL_FLAG_USE_CACHE ) {
+        datapipe_exec_full(datapipe, 0, USE_CACHE, DONT_CACHE_INDATA);
+        goto EXIT;
+    }
+
+    caching_policy_t cache = DONT_CACHE_INDATA;
+
+    if( rec->jr_flags & MCE_JOURNAL_FLAG_CACHE_INDATA )
+        cache |= CACHE_INDATA;
+    if( rec->jr_flags & MCE_JOURNAL_FLAG_CACHE_OUTDATA )
+        cache |= CACHE_OUTDATA;
+
+    gpointer data = mce_journal_decode(pipe, rec);
+
+    if( rec->jr_flags & MCE_JOURNAL_FLAG_OUTPUT_ONLY )
+        datapipe_exec_output_triggers(datapipe, data, USE_INDATA);
+    else
+        datapipe_exec_full(datapipe, data, USE_INDATA, cache);
+
+    /* Cached dynamic data is owned by the datapipe from now on,
+     * other pointer values might still be referred to */
+    if( pipe->jp_codec == MCE_JOURNAL_CODEC_INT )
+        goto EXIT;
+
+    if( datapipe->free_cache == FREE_CACHE && cache != DONT_CACHE_INDATA &&
+        !(rec->jr_flags & MCE_JOURNAL_FLAG_OUTPUT_ONLY) )
+        goto EXIT;
+
+    if( data )
+        mce_journal_replay_state->jr_retained =
+            g_slist_prepend(mce_journal_replay_state->jr_retained, data);
+
+EXIT:
+    return;
+}
+
+/** Schedule replaying of the next journal record
+ *
+ * Delays between records are scaled down by replay speed
+ * factor. With zero speed records are replayed back to back.
+ */
+static void
+mce_journal_replay_schedule(void)
+{
+    mce_journal_replay_t *state = mce_journal_replay_state;
+    int64_t               delay = 0;
+
+    if( state->jr_index > 0 && state->jr_speed > 0 &&
+        state->jr_index < state->jr_count ) {
+        delay = (state->jr_records[state->jr_index].jr_tick -
+                 state->jr_records[state->jr_index - 1].jr_tick);
+        delay = MAX(delay, 0) / state->jr_speed;
+    }
+
+    if( delay > 0 )
+        state->jr_timer_id = g_timeout_add((guint)delay,
+                                           mce_journal_replay_step_cb, 0);
+    else
+        state->jr_timer_id = g_idle_add(mce_journal_replay_step_cb, 0);
+}
+
+/** Timer / idle callback for replaying the next journal record
+ *
+ * @param aptr  unused
+ *
+ * @return FALSE to stop the timer from repeating
+ */
+static gboolean
+mce_journal_replay_step_cb(gpointer aptr)
+{
+    (void)aptr;
+
+    mce_journal_replay_t *state = mce_journal_replay_state;
+
+    if( !state || !state->jr_timer_id )
+        goto EXIT;
+
+    state->jr_timer_id = 0;
+
+    if( state->jr_index == 0 ) {
+        state->jr_started_tick = mce_lib_get_boot_tick();
+        state->jr_started_cpu  = mce_journal_replay_cpu_tick();
+    }
+
+    if( state->jr_index >= state->jr_count ) {
+        mce_journal_replay_finish();
+        goto EXIT;
+    }
+
+    mce_journal_replay_execute(&state->jr_records[state->jr_index++]);
+    mce_journal_replay_schedule();
+
+EXIT:
+    return FALSE;
+}
+
+/** Report replay statistics and exit mce mainloop
+ */
+static void
+mce_journal_replay_finish(void)
+{
+    mce_journal_replay_t *state = mce_journal_replay_state;
+    int64_t               span  = 0;
+
+    if( state->jr_count > 1 )
+        span = (state->jr_records[state->jr_count - 1].jr_tick -
+                state->jr_records[0].jr_tick);
+
+    mce_log(LL_NOTICE, "replayed %zu records; journal span %" PRId64
+            " ms, took %" PRId64 " ms, cpu %" PRId64 " ms",
+            state->jr_count, span,
+            mce_lib_get_boot_tick() - state->jr_started_tick,
+            mce_journal_replay_cpu_tick() - state->jr_started_cpu);
+
+    mce_quit_mainloop();
+}
+
+/** Cancel ongoing replay and release replay data
+ */
+static void
+mce_journal_replay_cancel(void)
+{
+    mce_journal_replay_t *state = mce_journal_replay_state;
+
+    if( !state )
+        goto EXIT;
+
+    mce_journal_replay_state = 0;
+
+    if( state->jr_timer_id )
+        g_source_remove(state->jr_timer_id);
+
+    g_slist_free_full(state->jr_retained, g_free);
+    g_free(state->jr_records);
+    g_free(state);
+
+EXIT:
+    return;
+}
+
+/** Replay recorded datapipe traffic
+ *
+ * The journal is loaded immediately so that it can be replayed
+ * even if the same file is then used for recording. Replaying
+ * starts when the mainloop is entered, and mce exits after the
+ * last record has been replayed.
+ *
+ * @param path   journal file path
+ * @param speed  replay speed factor, or 0 for no delays
+ *
+ * @return true if replay was scheduled, false otherwise
+ */
+bool
+mce_journal_replay(const char *path, int speed)
+{
+    bool ack = false;
+
+    mce_journal_replay_cancel();
+
+    mce_journal_replay_state = g_malloc0(sizeof *mce_journal_replay_state);
+    mce_journal_replay_state->jr_speed = MAX(speed, 0);
+
+    if( !mce_journal_replay_load(path) ) {
+        mce_journal_replay_cancel();
+        goto EXIT;
+    }
+
+    mce_journal_replay_state->jr_timer_id =
+        g_idle_add(mce_journal_replay_step_cb, 0);
+    ack = true;
+
+EXIT:
+    return ack;
+}
@@ -0,0 +1,146 @@
+/**
+ * @file mce-journal.h
+ *
+ * Mode Control Entity - Datapipe traffic recording and replay
+ *
+ * <p>
+ *
+ * Copyright (C) 2017 Jolla Ltd.
+ *
+ * mce is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * mce is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mce.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MCE_JOURNAL_H_
+# define MCE_JOURNAL_H_
+
+# include "datapipe.h"
+
+# include <stdbool.h>
+# include <stdint.h>
+
+# ifdef __cplusplus
+extern "C" {
+# endif
+
+/** Default location of the journal file */
+# define MCE_JOURNAL_FILE            G_STRINGIFY(MCE_RUN_DIR) "/datapipe.journal"
+
+/** Journal file identification */
+# define MCE_JOURNAL_MAGIC           "MCEJRNL"
+
+/** Journal file layout version
+ *
+ * Must be bumped whenever the record layout or the pipe id
+ * table in mce-journal.c changes.
+ */
+# define MCE_JOURNAL_VERSION         2
+
+/** Number of record slots in the journal ring */
+# define MCE_JOURNAL_RECORD_COUNT    4096
+
+/** Maximum size of serialized datapipe value */
+# define MCE_JOURNAL_DATA_MAX        40
+
+/** Datapipe execution details stored in journal records */
+typedef enum
+{
+    /** Execution used cached value, no data recorded */
+    MCE_JOURNAL_FLAG_USE_CACHE     = 1<<0,
+
+    /** Execution used CACHE_INDATA caching policy */
+    MCE_JOURNAL_FLAG_CACHE_INDATA  = 1<<1,
+
+    /** Execution used CACHE_OUTDATA caching policy */
+    MCE_JOURNAL_FLAG_CACHE_OUTDATA = 1<<2,
+
+    /** Only output triggers were executed */
+    MCE_JOURNAL_FLAG_OUTPUT_ONLY   = 1<<3,
+
+    /** Execution was deferred via datapipe run queue */
+    MCE_JOURNAL_FLAG_QUEUED        = 1<<4,
+
+    /** Serialized value did not fit in the record */
+    MCE_JOURNAL_FLAG_TRUNCATED     = 1<<5,
+
+    /** Pointer value was NULL */
+    MCE_JOURNAL_FLAG_NULL          = 1<<6,
+} mce_journal_flag_t;
+
+/** Journal file header */
+typedef struct mce_journal_header_t
+{
+    /** MCE_JOURNAL_MAGIC */
+    char     jh_magic[8];
+
+    /** MCE_JOURNAL_VERSION */
+    uint32_t jh_version;
+
+    /** Size of one record [bytes] */
+    uint32_t jh_record_size;
+
+    /** Number of record slots following the header */
+    uint32_t jh_record_count;
+
+    /** Number of entries in the pipe id table */
+    uint32_t jh_pipe_count;
+
+    /** Sequence number of the next record to write */
+    uint64_t jh_write_seq;
+
+    /** Padding to make the header as large as one record */
+    uint8_t  jh_reserved[32];
+} mce_journal_header_t;
+
+/** Journal record describing one datapipe execution
+ *
+ * Record with sequence number N is stored at slot
+ * N % jh_record_count. Slots with zero sequence number
+ * have not been written yet.
+ */
+typedef struct mce_journal_record_t
+{
+    /** Record sequence number, starting from 1 */
+    uint64_t jr_seq;
+
+    /** When the datapipe was executed [ms] */
+    int64_t  jr_tick;
+
+    /** Datapipe id, see mce-journal.c */
+    uint16_t jr_pipe;
+
+    /** Bitmask of mce_journal_flag_t */
+    uint8_t  jr_flags;
+
+    /** Datapipe execution nesting level */
+    uint8_t  jr_depth;
+
+    /** Number of valid bytes in jr_data */
+    uint8_t  jr_size;
+
+    /** Padding */
+    uint8_t  jr_reserved[3];
+
+    /** Serialized datapipe value */
+    uint8_t  jr_data[MCE_JOURNAL_DATA_MAX];
+} mce_journal_record_t;
+
+bool mce_journal_init   (const char *path);
+void mce_journal_quit   (void);
+void mce_journal_record (const datapipe_struct *datapipe, gconstpointer data, unsigned flags, unsigned depth);
+bool mce_journal_replay (const char *path, int speed);
+
+# ifdef __cplusplus
+};
+# endif
+
+#endif /* MCE_JOURNAL_H_ */
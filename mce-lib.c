@@ -515,3 +515,86 @@ mce_wakelocked_idle_add(GSourceFunc function, gpointer data)
 	return mce_wakelocked_timeout_add_full(G_PRIORITY_DEFAULT, 0,
 					       function, data, NULL);
 }
+
+/** Glib timeout source that can be dispatched late */
+typedef struct slack_timeout_t
+{
+	GSource st_source;
+	guint   st_interval;
+	guint   st_slack;
+} slack_timeout_t;
+
+/** Schedule next dispatch of slack timeout source
+ *
+ * The wakeup time is aligned to the largest power of two milliseconds
+ * that fits in the allowed slack. Timers that allow similar amount of
+ * slack thus end up getting dispatched during the same wakeup.
+ */
+static void
+slack_timeout_rearm(slack_timeout_t *self)
+{
+	int64_t step = 1;
+	int64_t when = g_get_monotonic_time() + self->st_interval * 1000LL;
+
+	while( step * 2 <= self->st_slack )
+		step *= 2;
+	step *= 1000;
+
+	when += step - 1;
+	when -= when % step;
+
+	g_source_set_ready_time(&self->st_source, when);
+}
+
+/** Handle slack timeout source dispatch
+ */
+static gboolean
+slack_timeout_dispatch_cb(GSource *source, GSourceFunc callback,
+			  gpointer user_data)
+{
+	if( !callback || !callback(user_data) )
+		return FALSE;
+
+	slack_timeout_rearm((slack_timeout_t *)source);
+	return TRUE;
+}
+
+/** Glib source callbacks for slack timeouts */
+static GSourceFuncs slack_timeout_funcs =
+{
+	.dispatch = slack_timeout_dispatch_cb,
+};
+
+/** Timer slack aware alternative for g_timeout_add()
+ *
+ * The function is called at the earliest after interval, and at the
+ * latest after interval + slack milliseconds. Use for timers that do
+ * not need to be exact, so that wakeups from several timers can be
+ * served at once.
+ *
+ * @param interval  the time between calls to the function, in milliseconds
+ * @param slack     how much calls may be delayed, in milliseconds
+ * @param function  function to call
+ * @param data      data to pass to function
+ *
+ * @return glib source identifier
+ */
+guint
+mce_slack_timeout_add(guint interval, guint slack, GSourceFunc function,
+		      gpointer data)
+{
+	GSource *source = g_source_new(&slack_timeout_funcs,
+				       sizeof(slack_timeout_t));
+	slack_timeout_t *self = (slack_timeout_t *)source;
+	guint id;
+
+	self->st_interval = interval;
+	self->st_slack    = slack;
+	slack_timeout_rearm(self);
+
+	g_source_set_callback(source, function, data, NULL);
+	id = g_source_attach(source, NULL);
+	g_source_unref(source);
+
+	return id;
+}
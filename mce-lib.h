@@ -67,5 +67,7 @@ guint mce_wakelocked_timeout_add_full(gint priority, guint interval,
 guint mce_wakelocked_timeout_add(guint interval, GSourceFunc function,
 				 gpointer data);
 guint mce_wakelocked_idle_add(GSourceFunc function, gpointer data);
+guint mce_slack_timeout_add(guint interval, guint slack,
+			    GSourceFunc function, gpointer data);
 
 #endif /* _MCE_LIB_H_ */
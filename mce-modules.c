@@ -26,12 +26,59 @@
 #include "mce-conf.h"
 
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
 
 #include <gmodule.h>
 
+/** How long to wait for init-done before loading deferred modules [s] */
+#define MCE_MODULES_DEFER_TIMEOUT_S 120
+
+/** Module load states */
+typedef enum {
+	/** Module has not been evaluated yet */
+	MODULE_STATE_UNKNOWN,
+	/** Module dependencies are being evaluated */
+	MODULE_STATE_RESOLVING,
+	/** Module is to be loaded during mce startup */
+	MODULE_STATE_STARTUP,
+	/** Module is to be loaded after init-done */
+	MODULE_STATE_DEFERRED,
+	/** Module is not going to be loaded */
+	MODULE_STATE_SKIPPED,
+	/** Module has been loaded */
+	MODULE_STATE_LOADED,
+	/** Loading the module failed */
+	MODULE_STATE_FAILED,
+} module_state_t;
+
+/** Bookkeeping data for modules listed in the configuration */
+typedef struct {
+	/** Name of the module, without path and suffix */
+	gchar *name;
+
+	/** Load state of the module */
+	module_state_t state;
+} module_entry_t;
+
 /** List of all loaded modules */
 static GSList *modules = NULL;
 
+/** Modules listed in the configuration, in load order */
+static GSList *module_entries = NULL;
+
+/** Directory where modules are loaded from */
+static gchar *module_path = NULL;
+
+/** Names of modules to load after init-done */
+static gchar **module_deferred = NULL;
+
+/** Idle callback id for loading deferred modules */
+static guint module_deferred_idle_id = 0;
+
+/** Timer id for loading deferred modules without init-done */
+static guint module_deferred_timer_id = 0;
+
 /**
  * Dump information about mce modules to stdout
  */
@@ -150,6 +197,322 @@ static gchar * mce_modules_build_path(const gchar *directory,
 	return g_strdup_printf("%s/%s.so", directory, module_name);
 }
 
+/** Find bookkeeping data for a module listed in the configuration
+ *
+ * @param name Name of the module
+ *
+ * @return module entry, or NULL if the module is not listed
+ */
+static module_entry_t *mce_modules_lookup_entry(const gchar *name)
+{
+	for (GSList *item = module_entries; item; item = item->next) {
+		module_entry_t *entry = item->data;
+
+		if (!strcmp(entry->name, name))
+			return entry;
+	}
+
+	return NULL;
+}
+
+/** Check if the hardware a module needs is present
+ *
+ * Modules can be tied to hardware via [ModuleRequires] configuration
+ * group, where the key is module name and the value is a list of
+ * paths of which at least one must exist.
+ *
+ * @param name Name of the module
+ *
+ * @return TRUE if the module should be loaded, FALSE otherwise
+ */
+static gboolean mce_modules_hardware_present(const gchar *name)
+{
+	gboolean present = TRUE;
+	gchar **paths = NULL;
+	gsize count = 0;
+
+	if (!mce_conf_has_key(MCE_CONF_MODULE_REQUIRES_GROUP, name))
+		goto EXIT;
+
+	paths = mce_conf_get_string_list(MCE_CONF_MODULE_REQUIRES_GROUP,
+					 name, &count);
+
+	if (!paths || count == 0)
+		goto EXIT;
+
+	present = FALSE;
+
+	for (gsize i = 0; i < count; ++i) {
+		if (access(paths[i], F_OK) == 0) {
+			present = TRUE;
+			break;
+		}
+	}
+
+	if (!present)
+		mce_log(LL_NOTICE, "module %s: required hardware not present",
+			name);
+
+EXIT:
+	g_strfreev(paths);
+
+	return present;
+}
+
+/** Check if a module is configured to be loaded after init-done
+ *
+ * @param name Name of the module
+ *
+ * @return TRUE if loading should be deferred, FALSE otherwise
+ */
+static gboolean mce_modules_is_deferred(const gchar *name)
+{
+	for (gsize i = 0; module_deferred && module_deferred[i]; ++i) {
+		if (!strcmp(module_deferred[i], name))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/** Evaluate when, if at all, a module should be loaded
+ *
+ * Dependencies declared in [ModuleDepends] configuration group
+ * must be loaded before the module itself. If a dependency is
+ * skipped, so is the module; if a dependency is deferred, so is
+ * the module.
+ *
+ * @param entry Module entry
+ *
+ * @return MODULE_STATE_STARTUP, MODULE_STATE_DEFERRED or
+ *         MODULE_STATE_SKIPPED
+ */
+static module_state_t mce_modules_resolve(module_entry_t *entry)
+{
+	module_state_t state = MODULE_STATE_SKIPPED;
+	gchar **depends = NULL;
+	gsize count = 0;
+
+	switch (entry->state) {
+	case MODULE_STATE_UNKNOWN:
+		break;
+
+	case MODULE_STATE_RESOLVING:
+		mce_log(LL_ERR, "module %s: circular dependency",
+			entry->name);
+		goto EXIT;
+
+	default:
+		state = entry->state;
+		goto EXIT;
+	}
+
+	entry->state = MODULE_STATE_RESOLVING;
+
+	if (!mce_modules_hardware_present(entry->name))
+		goto DONE;
+
+	state = (mce_modules_is_deferred(entry->name) ?
+		 MODULE_STATE_DEFERRED : MODULE_STATE_STARTUP);
+
+	if (!mce_conf_has_key(MCE_CONF_MODULE_DEPENDS_GROUP, entry->name))
+		goto DONE;
+
+	depends = mce_conf_get_string_list(MCE_CONF_MODULE_DEPENDS_GROUP,
+					   entry->name, &count);
+
+	for (gsize i = 0; depends && i < count; ++i) {
+		module_entry_t *dep = mce_modules_lookup_entry(depends[i]);
+
+		if (!dep) {
+			mce_log(LL_WARN, "module %s: depends on unlisted "
+				"module %s", entry->name, depends[i]);
+			state = MODULE_STATE_SKIPPED;
+			break;
+		}
+
+		switch (mce_modules_resolve(dep)) {
+		case MODULE_STATE_STARTUP:
+			break;
+
+		case MODULE_STATE_DEFERRED:
+			state = MODULE_STATE_DEFERRED;
+			break;
+
+		default:
+			mce_log(LL_NOTICE, "module %s: dependency %s "
+				"is not going to be loaded",
+				entry->name, dep->name);
+			state = MODULE_STATE_SKIPPED;
+			break;
+		}
+
+		if (state == MODULE_STATE_SKIPPED)
+			break;
+	}
+
+DONE:
+	entry->state = state;
+
+EXIT:
+	g_strfreev(depends);
+
+	return state;
+}
+
+/** Load a module and the modules it depends on
+ *
+ * @param entry Module entry
+ * @param state Load phase; modules in other states are left alone
+ */
+static void mce_modules_load(module_entry_t *entry, module_state_t state)
+{
+	GModule *module = NULL;
+	gchar **depends = NULL;
+	gchar *tmp = NULL;
+	gsize count = 0;
+
+	if (entry->state != state)
+		goto EXIT;
+
+	/* Mark as failed until loaded to stop dependency recursion */
+	entry->state = MODULE_STATE_FAILED;
+
+	if (mce_conf_has_key(MCE_CONF_MODULE_DEPENDS_GROUP, entry->name))
+		depends = mce_conf_get_string_list(MCE_CONF_MODULE_DEPENDS_GROUP,
+						   entry->name, &count);
+
+	for (gsize i = 0; depends && i < count; ++i) {
+		module_entry_t *dep = mce_modules_lookup_entry(depends[i]);
+
+		if (dep && (dep->state == MODULE_STATE_STARTUP ||
+			    dep->state == MODULE_STATE_DEFERRED))
+			mce_modules_load(dep, dep->state);
+
+		if (!dep || dep->state != MODULE_STATE_LOADED) {
+			mce_log(LL_ERR, "module %s: dependency %s not loaded; "
+				"skipping", entry->name, depends[i]);
+			goto EXIT;
+		}
+	}
+
+	tmp = mce_modules_build_path(module_path, entry->name);
+
+	mce_log(LL_INFO,
+		"Loading module: %s from %s",
+		entry->name, module_path);
+
+	if ((module = g_module_open(tmp, 0)) != NULL) {
+		modules = g_slist_prepend(modules, module);
+		entry->state = MODULE_STATE_LOADED;
+	} else {
+		const char *err = g_module_error();
+		mce_log(LL_ERR, "%s", err ?: "unknown error");
+		mce_log(LL_ERR,
+			"Failed to load module: %s; skipping",
+			entry->name);
+	}
+
+EXIT:
+	g_free(tmp);
+	g_strfreev(depends);
+}
+
+/** Load all modules in the given load phase
+ *
+ * @param state MODULE_STATE_STARTUP or MODULE_STATE_DEFERRED
+ */
+static void mce_modules_load_all(module_state_t state)
+{
+	for (GSList *item = module_entries; item; item = item->next)
+		mce_modules_load(item->data, state);
+}
+
+/** Cancel pending deferred module loading
+ */
+static void mce_modules_cancel_deferred(void)
+{
+	if (module_deferred_idle_id) {
+		g_source_remove(module_deferred_idle_id),
+			module_deferred_idle_id = 0;
+	}
+
+	if (module_deferred_timer_id) {
+		g_source_remove(module_deferred_timer_id),
+			module_deferred_timer_id = 0;
+	}
+}
+
+/** Idle callback for loading deferred modules
+ *
+ * @param aptr (unused)
+ *
+ * @return FALSE to stop the idle callback from being repeated
+ */
+static gboolean mce_modules_deferred_idle_cb(gpointer aptr)
+{
+	(void)aptr;
+
+	if (!module_deferred_idle_id)
+		goto EXIT;
+
+	module_deferred_idle_id = 0;
+
+	mce_modules_cancel_deferred();
+
+	mce_log(LL_NOTICE, "loading deferred modules");
+	mce_modules_load_all(MODULE_STATE_DEFERRED);
+
+EXIT:
+	return FALSE;
+}
+
+/** Schedule loading of deferred modules
+ */
+static void mce_modules_schedule_deferred(void)
+{
+	if (!module_deferred_idle_id)
+		module_deferred_idle_id =
+			g_idle_add(mce_modules_deferred_idle_cb, NULL);
+}
+
+/** Timer callback for loading deferred modules without init-done
+ *
+ * @param aptr (unused)
+ *
+ * @return FALSE to stop the timer from being repeated
+ */
+static gboolean mce_modules_deferred_timer_cb(gpointer aptr)
+{
+	(void)aptr;
+
+	if (!module_deferred_timer_id)
+		goto EXIT;
+
+	module_deferred_timer_id = 0;
+
+	mce_log(LL_WARN, "init-done not reached; loading deferred modules");
+	mce_modules_schedule_deferred();
+
+EXIT:
+	return FALSE;
+}
+
+/** Change notifications for init_done_pipe
+ *
+ * Loading is done from idle callback so that modules do not get
+ * to register datapipe triggers while a datapipe is executing.
+ *
+ * @param data init-done state as tristate_t cast to pointer
+ */
+static void mce_modules_init_done_cb(gconstpointer data)
+{
+	tristate_t init_done = GPOINTER_TO_INT(data);
+
+	if (init_done == TRISTATE_TRUE && module_deferred_timer_id)
+		mce_modules_schedule_deferred();
+}
+
 /**
  * Init function for the mce-modules component
  *
@@ -159,47 +522,56 @@ gboolean mce_modules_init(void)
 {
 	gchar **modlist = NULL;
 	gsize length;
-	gchar *path = NULL;
+	gboolean deferred = FALSE;
 
 	/* Get the module path */
-	path = mce_conf_get_string(MCE_CONF_MODULES_GROUP,
-				   MCE_CONF_MODULES_PATH,
-				   DEFAULT_MCE_MODULE_PATH);
+	module_path = mce_conf_get_string(MCE_CONF_MODULES_GROUP,
+					  MCE_CONF_MODULES_PATH,
+					  DEFAULT_MCE_MODULE_PATH);
+
+	/* Get the list of modules to load after init-done */
+	module_deferred = mce_conf_get_string_list(MCE_CONF_MODULES_GROUP,
+						   MCE_CONF_MODULES_DEFERRED,
+						   &length);
 
 	/* Get the list modules to load */
 	modlist = mce_conf_get_string_list(MCE_CONF_MODULES_GROUP,
 					   MCE_CONF_MODULES_MODULES,
 					   &length);
 
-	if (modlist != NULL) {
-		gint i;
-
-		for (i = 0; modlist[i]; i++) {
-			GModule *module;
-			gchar *tmp = mce_modules_build_path(path, modlist[i]);
-
-			mce_log(LL_INFO,
-				"Loading module: %s from %s",
-				modlist[i], path);
-
-			if ((module = g_module_open(tmp, 0)) != NULL) {
-				/* XXX: check dependencies, conflicts, et al */
-				modules = g_slist_prepend(modules, module);
-			} else {
-				const char *err = g_module_error();
-				mce_log(LL_ERR, "%s", err ?: "unknown error");
-				mce_log(LL_ERR,
-					"Failed to load module: %s; skipping",
-					modlist[i]);
-			}
+	for (gint i = 0; modlist && modlist[i]; i++) {
+		if (mce_modules_lookup_entry(modlist[i]))
+			continue;
 
-			g_free(tmp);
-		}
+		module_entry_t *entry = g_malloc0(sizeof *entry);
+		entry->name  = g_strdup(modlist[i]);
+		entry->state = MODULE_STATE_UNKNOWN;
+		module_entries = g_slist_append(module_entries, entry);
+	}
+
+	g_strfreev(modlist);
 
-		g_strfreev(modlist);
+	/* Decide when each module gets loaded */
+	for (GSList *item = module_entries; item; item = item->next) {
+		if (mce_modules_resolve(item->data) == MODULE_STATE_DEFERRED)
+			deferred = TRUE;
 	}
 
-	g_free(path);
+	/* Load modules needed during startup */
+	mce_modules_load_all(MODULE_STATE_STARTUP);
+
+	/* Load the rest when init-done is reached */
+	if (deferred) {
+		module_deferred_timer_id =
+			g_timeout_add_seconds(MCE_MODULES_DEFER_TIMEOUT_S,
+					      mce_modules_deferred_timer_cb,
+					      NULL);
+
+		datapipe_add_output_trigger(&init_done_pipe,
+					    mce_modules_init_done_cb);
+
+		mce_modules_init_done_cb(datapipe_get_gpointer(init_done_pipe));
+	}
 
 	return TRUE;
 }
@@ -212,6 +584,11 @@ void mce_modules_exit(void)
 	GModule *module;
 	gint i;
 
+	datapipe_remove_output_trigger(&init_done_pipe,
+				       mce_modules_init_done_cb);
+
+	mce_modules_cancel_deferred();
+
 	if (modules != NULL) {
 		for (i = 0; (module = g_slist_nth_data(modules, i)) != NULL; i++) {
 			if( mce_in_valgrind_mode() ) {
@@ -239,5 +616,16 @@ void mce_modules_exit(void)
 		modules = NULL;
 	}
 
+	for (GSList *item = module_entries; item; item = item->next) {
+		module_entry_t *entry = item->data;
+		g_free(entry->name);
+		g_free(entry);
+	}
+	g_slist_free(module_entries), module_entries = NULL;
+
+	g_strfreev(module_deferred), module_deferred = NULL;
+
+	g_free(module_path), module_path = NULL;
+
 	return;
 }
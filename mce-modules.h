@@ -32,6 +32,15 @@
 /** Name of configuration key for modules to load */
 #define MCE_CONF_MODULES_MODULES        "Modules"
 
+/** Name of configuration key for modules to load after init-done */
+#define MCE_CONF_MODULES_DEFERRED       "DeferredModules"
+
+/** Name of configuration group for module hardware requirements */
+#define MCE_CONF_MODULE_REQUIRES_GROUP  "ModuleRequires"
+
+/** Name of configuration group for module dependencies */
+#define MCE_CONF_MODULE_DEPENDS_GROUP   "ModuleDepends"
+
 /** Default value for module path */
 #define DEFAULT_MCE_MODULE_PATH         "/usr/lib/mce/modules"
 
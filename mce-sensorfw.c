@@ -29,7 +29,7 @@
 #include "mce.h"
 #include "mce-log.h"
 #include "mce-dbus.h"
-#include "libwakelock.h"
+#include "mce-wakelock.h"
 #include "evdev.h"
 #include "mce-setting.h"
 
@@ -5421,7 +5421,7 @@ mce_sensorfw_evdev_cb(GIOChannel *chn, GIOCondition cnd, gpointer aptr)
     struct input_event eve[256];
 
     /* wakelock must be taken before reading the data */
-    wakelock_lock("mce_input_handler", -1);
+    mce_wakelock_ref("mce_input_handler");
 
     if( cnd & (G_IO_ERR | G_IO_HUP | G_IO_NVAL) ) {
         goto EXIT;
@@ -5489,7 +5489,7 @@ EXIT:
     }
 
     /* wakelock must be released when we are done with the data */
-    wakelock_unlock("mce_input_handler");
+    mce_wakelock_unref("mce_input_handler");
 
     return keep;
 }
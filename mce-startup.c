@@ -0,0 +1,172 @@
+/**
+ * @file mce-startup.c
+ *
+ * Mode Control Entity - Startup phase profiling
+ *
+ * <p>
+ *
+ * Copyright (C) 2017 Jolla Ltd.
+ *
+ * mce is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * mce is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mce.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mce-startup.h"
+
+#include "mce-log.h"
+#include "mce-lib.h"
+
+#include <glib.h>
+
+/* ========================================================================= *
+ * FUNCTIONS & DATA
+ * ========================================================================= */
+
+/** Maximum number of startup phases that are recorded */
+#define MCE_STARTUP_MAX_PHASES 32
+
+/** Recorded startup phases */
+static mce_startup_phase_t mce_startup_phase_tab[MCE_STARTUP_MAX_PHASES];
+
+/** Number of recorded startup phases */
+static size_t  mce_startup_phase_cnt = 0;
+
+/** When the first startup phase was started [ms] */
+static int64_t mce_startup_base_tick = 0;
+
+/** When the current startup phase was started [ms] */
+static int64_t mce_startup_phase_tick = 0;
+
+/** Flag for: startup has been finished */
+static bool    mce_startup_done = false;
+
+static void    mce_startup_end_phase (int64_t now);
+
+void           mce_startup_phase     (const char *name);
+void           mce_startup_finish    (void);
+bool           mce_startup_finished  (void);
+size_t         mce_startup_get_phases(const mce_startup_phase_t **phases);
+
+/* ========================================================================= *
+ * STARTUP_PHASES
+ * ========================================================================= */
+
+/** Close the currently ongoing startup phase, if any
+ *
+ * @param now  current time [ms]
+ */
+static void
+mce_startup_end_phase(int64_t now)
+{
+    if( mce_startup_phase_cnt < 1 )
+        goto EXIT;
+
+    mce_startup_phase_t *phase = &mce_startup_phase_tab[mce_startup_phase_cnt - 1];
+
+    if( phase->duration_ms >= 0 )
+        goto EXIT;
+
+    phase->duration_ms = now - mce_startup_phase_tick;
+
+EXIT:
+    return;
+}
+
+/** Start a new startup phase
+ *
+ * The previously started phase, if any, is ended.
+ *
+ * @param name  name of the phase, must be a static string
+ */
+void
+mce_startup_phase(const char *name)
+{
+    int64_t now = mce_lib_get_boot_tick();
+
+    if( mce_startup_done )
+        goto EXIT;
+
+    mce_startup_end_phase(now);
+
+    if( mce_startup_phase_cnt == 0 )
+        mce_startup_base_tick = now;
+
+    if( mce_startup_phase_cnt >= MCE_STARTUP_MAX_PHASES ) {
+        mce_log(LL_WARN, "%s: too many startup phases", name);
+        goto EXIT;
+    }
+
+    mce_startup_phase_t *phase = &mce_startup_phase_tab[mce_startup_phase_cnt++];
+
+    phase->name        = name;
+    phase->start_ms    = now - mce_startup_base_tick;
+    phase->duration_ms = -1;
+
+    mce_startup_phase_tick = now;
+
+EXIT:
+    return;
+}
+
+/** End the last startup phase and log the startup report
+ */
+void
+mce_startup_finish(void)
+{
+    int64_t now = mce_lib_get_boot_tick();
+
+    if( mce_startup_done )
+        goto EXIT;
+
+    mce_startup_done = true;
+
+    mce_startup_end_phase(now);
+
+    for( size_t i = 0; i < mce_startup_phase_cnt; ++i ) {
+        const mce_startup_phase_t *phase = &mce_startup_phase_tab[i];
+
+        mce_log(LL_DEBUG, "startup: %-16s @ %5" G_GINT64_FORMAT
+                " ms, took %5" G_GINT64_FORMAT " ms",
+                phase->name, phase->start_ms, phase->duration_ms);
+    }
+
+    mce_log(LL_NOTICE, "startup took %" G_GINT64_FORMAT " ms",
+            now - mce_startup_base_tick);
+
+EXIT:
+    return;
+}
+
+/** Predicate for: startup has been finished
+ *
+ * @return true after mce_startup_finish() has been called, false otherwise
+ */
+bool
+mce_startup_finished(void)
+{
+    return mce_startup_done;
+}
+
+/** Get recorded startup phases
+ *
+ * The phase that is still ongoing has negative duration.
+ *
+ * @param phases  where to store pointer to array of phases
+ *
+ * @return number of phases in the array
+ */
+size_t
+mce_startup_get_phases(const mce_startup_phase_t **phases)
+{
+    *phases = mce_startup_phase_tab;
+    return mce_startup_phase_cnt;
+}
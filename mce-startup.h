@@ -0,0 +1,56 @@
+/**
+ * @file mce-startup.h
+ *
+ * Mode Control Entity - Startup phase profiling
+ *
+ * <p>
+ *
+ * Copyright (C) 2017 Jolla Ltd.
+ *
+ * mce is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * mce is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mce.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MCE_STARTUP_H_
+# define MCE_STARTUP_H_
+
+# include <stdbool.h>
+# include <stdint.h>
+# include <stddef.h>
+
+# ifdef __cplusplus
+extern "C" {
+# endif
+
+/** Timing information for one startup phase */
+typedef struct mce_startup_phase_t
+{
+    /** Name of the phase */
+    const char *name;
+
+    /** When the phase started, relative to the first phase [ms] */
+    int64_t     start_ms;
+
+    /** How long the phase took [ms] */
+    int64_t     duration_ms;
+} mce_startup_phase_t;
+
+void    mce_startup_phase   (const char *name);
+void    mce_startup_finish  (void);
+bool    mce_startup_finished(void);
+size_t  mce_startup_get_phases(const mce_startup_phase_t **phases);
+
+# ifdef __cplusplus
+};
+# endif
+
+#endif /* MCE_STARTUP_H_ */
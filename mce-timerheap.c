@@ -0,0 +1,413 @@
+/**
+ * @file mce-timerheap.c
+ *
+ * Mode Control Entity - Binary heap for ordering timer deadlines
+ *
+ * <p>
+ *
+ * Copyright (C) 2017 Jolla Ltd.
+ *
+ * mce is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * mce is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mce.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mce-timerheap.h"
+
+#include <stdlib.h>
+
+/* ========================================================================= *
+ * Types and functions
+ * ========================================================================= */
+
+/* ------------------------------------------------------------------------- *
+ * TIMERNODE_METHODS
+ * ------------------------------------------------------------------------- */
+
+void             mce_timernode_init        (mce_timernode_t *node, void *owner);
+bool             mce_timernode_is_queued   (const mce_timernode_t *node);
+
+/* ------------------------------------------------------------------------- *
+ * TIMERHEAP_INTERNALS
+ * ------------------------------------------------------------------------- */
+
+static void      mth_heap_place            (mce_timerheap_t *heap, size_t slot, mce_timernode_t *node);
+static bool      mth_heap_less             (const mce_timerheap_t *heap, size_t a, size_t b);
+static void      mth_heap_swap             (mce_timerheap_t *heap, size_t a, size_t b);
+static void      mth_heap_sift_up          (mce_timerheap_t *heap, size_t slot);
+static void      mth_heap_sift_down        (mce_timerheap_t *heap, size_t slot);
+static void      mth_heap_reserve          (mce_timerheap_t *heap, size_t count);
+
+/* ------------------------------------------------------------------------- *
+ * TIMERHEAP_METHODS
+ * ------------------------------------------------------------------------- */
+
+void             mce_timerheap_clear       (mce_timerheap_t *heap);
+size_t           mce_timerheap_count       (const mce_timerheap_t *heap);
+void             mce_timerheap_schedule    (mce_timerheap_t *heap, mce_timernode_t *node, int64_t trigger);
+void             mce_timerheap_remove      (mce_timerheap_t *heap, mce_timernode_t *node);
+mce_timernode_t *mce_timerheap_peek        (const mce_timerheap_t *heap);
+int64_t          mce_timerheap_next_trigger(const mce_timerheap_t *heap);
+mce_timernode_t *mce_timerheap_pop_expired (mce_timerheap_t *heap, int64_t now);
+
+/* ------------------------------------------------------------------------- *
+ * TIMERSTATS_METHODS
+ * ------------------------------------------------------------------------- */
+
+void             mce_timerstats_add_wakeup (mce_timerstats_t *stats, int notifications);
+void             mce_timerstats_set_display_off(mce_timerstats_t *stats, bool display_off, int64_t now);
+void             mce_timerstats_get        (const mce_timerstats_t *stats, mce_timerstats_t *res, int64_t now);
+
+/* ========================================================================= *
+ * TIMERNODE_METHODS
+ * ========================================================================= */
+
+/** Initialize timer heap node
+ *
+ * @param node  heap node embedded in timer object
+ * @param owner the timer object
+ */
+void
+mce_timernode_init(mce_timernode_t *node, void *owner)
+{
+    node->tmn_trigger = MCE_TIMERHEAP_NO_TICK;
+    node->tmn_index   = -1;
+    node->tmn_owner   = owner;
+}
+
+/** Predicate for: timer node is in some heap
+ *
+ * @param node  heap node, or NULL
+ *
+ * @return true if node is queued, false otherwise
+ */
+bool
+mce_timernode_is_queued(const mce_timernode_t *node)
+{
+    return node && node->tmn_index >= 0;
+}
+
+/* ========================================================================= *
+ * TIMERHEAP_INTERNALS
+ * ========================================================================= */
+
+/** Store node to heap slot and update node position
+ */
+static void
+mth_heap_place(mce_timerheap_t *heap, size_t slot, mce_timernode_t *node)
+{
+    heap->tmh_node[slot] = node;
+    node->tmn_index = (ptrdiff_t)slot;
+}
+
+/** Compare triggers of nodes in two heap slots
+ */
+static bool
+mth_heap_less(const mce_timerheap_t *heap, size_t a, size_t b)
+{
+    return heap->tmh_node[a]->tmn_trigger < heap->tmh_node[b]->tmn_trigger;
+}
+
+/** Exchange nodes in two heap slots
+ */
+static void
+mth_heap_swap(mce_timerheap_t *heap, size_t a, size_t b)
+{
+    mce_timernode_t *node = heap->tmh_node[a];
+    mth_heap_place(heap, a, heap->tmh_node[b]);
+    mth_heap_place(heap, b, node);
+}
+
+/** Move node towards the heap root until heap order is restored
+ */
+static void
+mth_heap_sift_up(mce_timerheap_t *heap, size_t slot)
+{
+    while( slot > 0 ) {
+        size_t parent = (slot - 1) / 2;
+
+        if( !mth_heap_less(heap, slot, parent) )
+            break;
+
+        mth_heap_swap(heap, slot, parent);
+        slot = parent;
+    }
+}
+
+/** Move node towards heap leaves until heap order is restored
+ */
+static void
+mth_heap_sift_down(mce_timerheap_t *heap, size_t slot)
+{
+    for( ;; ) {
+        size_t least = slot;
+        size_t lhs   = slot * 2 + 1;
+        size_t rhs   = lhs + 1;
+
+        if( lhs < heap->tmh_count && mth_heap_less(heap, lhs, least) )
+            least = lhs;
+
+        if( rhs < heap->tmh_count && mth_heap_less(heap, rhs, least) )
+            least = rhs;
+
+        if( least == slot )
+            break;
+
+        mth_heap_swap(heap, slot, least);
+        slot = least;
+    }
+}
+
+/** Make sure heap array can hold given number of nodes
+ */
+static void
+mth_heap_reserve(mce_timerheap_t *heap, size_t count)
+{
+    if( count <= heap->tmh_alloc )
+        goto EXIT;
+
+    size_t alloc = heap->tmh_alloc ?: 16;
+
+    while( alloc < count )
+        alloc *= 2;
+
+    mce_timernode_t **node = realloc(heap->tmh_node, alloc * sizeof *node);
+
+    /* Like g_renew(): out of memory is not a recoverable situation */
+    if( !node )
+        abort();
+
+    heap->tmh_node  = node;
+    heap->tmh_alloc = alloc;
+
+EXIT:
+    return;
+}
+
+/* ========================================================================= *
+ * TIMERHEAP_METHODS
+ * ========================================================================= */
+
+/** Detach all nodes and release dynamic resources held by heap
+ *
+ * @param heap  timer heap
+ */
+void
+mce_timerheap_clear(mce_timerheap_t *heap)
+{
+    for( size_t i = 0; i < heap->tmh_count; ++i )
+        heap->tmh_node[i]->tmn_index = -1;
+
+    free(heap->tmh_node),
+        heap->tmh_node = 0;
+
+    heap->tmh_count = 0;
+    heap->tmh_alloc = 0;
+}
+
+/** Get number of queued nodes
+ *
+ * @param heap  timer heap
+ *
+ * @return number of nodes in the heap
+ */
+size_t
+mce_timerheap_count(const mce_timerheap_t *heap)
+{
+    return heap->tmh_count;
+}
+
+/** Insert node to heap, or reposition already queued node
+ *
+ * Scheduling with MCE_TIMERHEAP_NO_TICK trigger removes the node.
+ *
+ * @param heap     timer heap
+ * @param node     timer node
+ * @param trigger  trigger time
+ */
+void
+mce_timerheap_schedule(mce_timerheap_t *heap, mce_timernode_t *node,
+                       int64_t trigger)
+{
+    if( trigger == MCE_TIMERHEAP_NO_TICK ) {
+        mce_timerheap_remove(heap, node);
+        goto EXIT;
+    }
+
+    int64_t prev = node->tmn_trigger;
+    node->tmn_trigger = trigger;
+
+    if( !mce_timernode_is_queued(node) ) {
+        mth_heap_reserve(heap, heap->tmh_count + 1);
+        mth_heap_place(heap, heap->tmh_count++, node);
+        mth_heap_sift_up(heap, (size_t)node->tmn_index);
+    }
+    else if( trigger < prev ) {
+        mth_heap_sift_up(heap, (size_t)node->tmn_index);
+    }
+    else if( trigger > prev ) {
+        mth_heap_sift_down(heap, (size_t)node->tmn_index);
+    }
+
+EXIT:
+    return;
+}
+
+/** Remove node from heap
+ *
+ * @param heap     timer heap
+ * @param node     timer node
+ */
+void
+mce_timerheap_remove(mce_timerheap_t *heap, mce_timernode_t *node)
+{
+    node->tmn_trigger = MCE_TIMERHEAP_NO_TICK;
+
+    if( !mce_timernode_is_queued(node) )
+        goto EXIT;
+
+    size_t slot = (size_t)node->tmn_index;
+    size_t last = --heap->tmh_count;
+
+    node->tmn_index = -1;
+
+    if( slot == last )
+        goto EXIT;
+
+    /* Fill the hole with the last node and restore heap order */
+    mth_heap_place(heap, slot, heap->tmh_node[last]);
+    mth_heap_sift_down(heap, slot);
+    mth_heap_sift_up(heap, slot);
+
+EXIT:
+    return;
+}
+
+/** Get node with the earliest trigger time
+ *
+ * @param heap     timer heap
+ *
+ * @return timer node, or NULL if heap is empty
+ */
+mce_timernode_t *
+mce_timerheap_peek(const mce_timerheap_t *heap)
+{
+    return heap->tmh_count ? heap->tmh_node[0] : 0;
+}
+
+/** Get the earliest trigger time
+ *
+ * @param heap     timer heap
+ *
+ * @return trigger time, or MCE_TIMERHEAP_NO_TICK if heap is empty
+ */
+int64_t
+mce_timerheap_next_trigger(const mce_timerheap_t *heap)
+{
+    mce_timernode_t *node = mce_timerheap_peek(heap);
+    return node ? node->tmn_trigger : MCE_TIMERHEAP_NO_TICK;
+}
+
+/** Detach the earliest node if it has been triggered
+ *
+ * The trigger time of the returned node is left intact so that
+ * the caller can still use it for bookkeeping purposes.
+ *
+ * @param heap     timer heap
+ * @param now      current time
+ *
+ * @return timer node, or NULL if no nodes have been triggered
+ */
+mce_timernode_t *
+mce_timerheap_pop_expired(mce_timerheap_t *heap, int64_t now)
+{
+    mce_timernode_t *node = mce_timerheap_peek(heap);
+
+    if( !node || node->tmn_trigger > now ) {
+        node = 0;
+        goto EXIT;
+    }
+
+    int64_t trigger = node->tmn_trigger;
+    mce_timerheap_remove(heap, node);
+    node->tmn_trigger = trigger;
+
+EXIT:
+    return node;
+}
+
+/* ========================================================================= *
+ * TIMERSTATS_METHODS
+ * ========================================================================= */
+
+/** Account a timer dispatching round
+ *
+ * Rounds that did not notify any timers are ignored.
+ *
+ * @param stats          statistics object
+ * @param notifications  number of timers notified
+ */
+void
+mce_timerstats_add_wakeup(mce_timerstats_t *stats, int notifications)
+{
+    if( notifications <= 0 )
+        goto EXIT;
+
+    stats->tms_wakeups       += 1;
+    stats->tms_notifications += notifications;
+
+    if( stats->tms_off_since == MCE_TIMERHEAP_NO_TICK )
+        goto EXIT;
+
+    stats->tms_off_wakeups       += 1;
+    stats->tms_off_notifications += notifications;
+
+EXIT:
+    return;
+}
+
+/** Track display off time
+ *
+ * @param stats        statistics object
+ * @param display_off  true if display is off, false otherwise
+ * @param now          current time [ms]
+ */
+void
+mce_timerstats_set_display_off(mce_timerstats_t *stats, bool display_off,
+                               int64_t now)
+{
+    if( display_off ) {
+        if( stats->tms_off_since == MCE_TIMERHEAP_NO_TICK )
+            stats->tms_off_since = now;
+    }
+    else if( stats->tms_off_since != MCE_TIMERHEAP_NO_TICK ) {
+        stats->tms_off_time += now - stats->tms_off_since;
+        stats->tms_off_since = MCE_TIMERHEAP_NO_TICK;
+    }
+}
+
+/** Get snapshot of statistics
+ *
+ * Display off time includes the currently ongoing display off period.
+ *
+ * @param stats  statistics object
+ * @param res    where to store the snapshot
+ * @param now    current time [ms]
+ */
+void
+mce_timerstats_get(const mce_timerstats_t *stats, mce_timerstats_t *res,
+                   int64_t now)
+{
+    *res = *stats;
+
+    if( res->tms_off_since != MCE_TIMERHEAP_NO_TICK )
+        res->tms_off_time += now - res->tms_off_since;
+}
@@ -0,0 +1,110 @@
+/**
+ * @file mce-timerheap.h
+ *
+ * Mode Control Entity - Binary heap for ordering timer deadlines
+ *
+ * <p>
+ *
+ * Copyright (C) 2017 Jolla Ltd.
+ *
+ * mce is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License
+ * version 2.1 as published by the Free Software Foundation.
+ *
+ * mce is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with mce.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef MCE_TIMERHEAP_H_
+# define MCE_TIMERHEAP_H_
+
+# include <stdbool.h>
+# include <stdint.h>
+# include <stddef.h>
+
+# ifdef __cplusplus
+extern "C" {
+# endif
+
+/** Trigger time value used to signify "not-set" */
+# define MCE_TIMERHEAP_NO_TICK INT64_MAX
+
+/** Heap entry to be embedded in timer objects */
+typedef struct mce_timernode_t
+{
+    /** Trigger time, in whatever time base the heap owner uses */
+    int64_t     tmn_trigger;
+
+    /** Position in heap array, or -1 when not queued */
+    ptrdiff_t   tmn_index;
+
+    /** Timer object that contains this node */
+    void       *tmn_owner;
+} mce_timernode_t;
+
+/** Min-heap of timer nodes ordered by trigger time */
+typedef struct mce_timerheap_t
+{
+    /** Heap array, the node with earliest trigger is at index 0 */
+    mce_timernode_t **tmh_node;
+
+    /** Number of queued nodes */
+    size_t            tmh_count;
+
+    /** Number of allocated heap array slots */
+    size_t            tmh_alloc;
+} mce_timerheap_t;
+
+/** Static initializer for mce_timerheap_t objects */
+# define MCE_TIMERHEAP_INIT { 0, 0, 0 }
+
+/** Wakeup statistics for timer families using mce_timerheap_t */
+typedef struct mce_timerstats_t
+{
+    /** Number of wakeups that notified at least one timer */
+    int64_t     tms_wakeups;
+
+    /** Number of timer notifications */
+    int64_t     tms_notifications;
+
+    /** Number of wakeups while display was off */
+    int64_t     tms_off_wakeups;
+
+    /** Number of timer notifications while display was off */
+    int64_t     tms_off_notifications;
+
+    /** Accumulated display off time [ms] */
+    int64_t     tms_off_time;
+
+    /** When display was turned off, or MCE_TIMERHEAP_NO_TICK */
+    int64_t     tms_off_since;
+} mce_timerstats_t;
+
+/** Static initializer for mce_timerstats_t objects */
+# define MCE_TIMERSTATS_INIT { 0, 0, 0, 0, 0, MCE_TIMERHEAP_NO_TICK }
+
+void             mce_timernode_init        (mce_timernode_t *node, void *owner);
+bool             mce_timernode_is_queued   (const mce_timernode_t *node);
+
+void             mce_timerheap_clear       (mce_timerheap_t *heap);
+size_t           mce_timerheap_count       (const mce_timerheap_t *heap);
+void             mce_timerheap_schedule    (mce_timerheap_t *heap, mce_timernode_t *node, int64_t trigger);
+void             mce_timerheap_remove      (mce_timerheap_t *heap, mce_timernode_t *node);
+mce_timernode_t *mce_timerheap_peek        (const mce_timerheap_t *heap);
+int64_t          mce_timerheap_next_trigger(const mce_timerheap_t *heap);
+mce_timernode_t *mce_timerheap_pop_expired (mce_timerheap_t *heap, int64_t now);
+
+void             mce_timerstats_add_wakeup (mce_timerstats_t *stats, int notifications);
+void             mce_timerstats_set_display_off(mce_timerstats_t *stats, bool display_off, int64_t now);
+void             mce_timerstats_get        (const mce_timerstats_t *stats, mce_timerstats_t *res, int64_t now);
+
+# ifdef __cplusplus
+};
+# endif
+
+#endif /* MCE_TIMERHEAP_H_ */
@@ -21,8 +21,10 @@
 
 #include "mce-wakelock.h"
 #include "mce-log.h"
+#include "mce-lib.h"
 
 #include <stdbool.h>
+#include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
@@ -43,7 +45,16 @@ static const char mwl_sysfs_lock_path[] = "/sys/power/wake_lock";
 /** Path to kernel wakelock release sysfs file */
 static const char mwl_sysfs_unlock_path[] = "/sys/power/wake_unlock";
 
-static bool mwl_sysfs_write(const char *path, const char *data, int size);
+/** Persistently open kernel wakelock obtain sysfs file, or -1 */
+static int mwl_sysfs_lock_fd = -1;
+
+/** Persistently open kernel wakelock release sysfs file, or -1 */
+static int mwl_sysfs_unlock_fd = -1;
+
+static bool mwl_sysfs_write   (const char *path, const char *data, int size);
+static bool mwl_sysfs_write_fd(int fd, const char *path, const char *data, int size);
+static void mwl_sysfs_open    (void);
+static void mwl_sysfs_close   (void);
 
 /* ------------------------------------------------------------------------- *
  * RAWLOCK_API
@@ -55,11 +66,49 @@ static const char mwl_rawlock_name[] = "mce_mux";
 /** Flag for: "real" wakelock is held */
 static bool mce_rawlock_locked = false;
 
+/** Number of writes made to wakelock sysfs files */
+static guint mwl_rawlock_writes = 0;
+
 static bool mwl_rawlock_supported (void);
 static bool mwl_rawlock_lock      (void);
 static bool mwl_rawlock_unlock    (void);
 static void mwl_rawlock_set       (bool lock);
 
+/* ------------------------------------------------------------------------- *
+ * mwl_stats_t
+ * ------------------------------------------------------------------------- */
+
+/** Usage accounting for virtual wakelocks sharing a name */
+typedef struct mwl_stats_t
+{
+    /** Accumulated statistics */
+    mce_wakelock_stats_t st_data;
+
+    /** Number of currently active virtual wakelocks using this entry */
+    int                  st_active;
+
+    /** When the entry became active [ms] */
+    int64_t              st_since;
+} mwl_stats_t;
+
+/** Lookup table for wakelock statistics */
+static GHashTable  *mwl_stats_lut = 0; // [key] -> mwl_stats_t *
+
+/** Statistics entry for the only active virtual wakelock, or NULL */
+static mwl_stats_t *mwl_stats_sole = 0;
+
+/** When mwl_stats_sole became the only active entry [ms] */
+static int64_t      mwl_stats_sole_since = 0;
+
+static gchar       *mwl_stats_key         (const char *name);
+static mwl_stats_t *mwl_stats_lookup      (const char *name);
+static void         mwl_stats_begin       (mwl_stats_t *self, int64_t now);
+static void         mwl_stats_end         (mwl_stats_t *self, int64_t now);
+static void         mwl_stats_get         (const mwl_stats_t *self, mce_wakelock_stats_t *res, int64_t now);
+static void         mwl_stats_rethink_sole(void);
+static void         mwl_stats_init        (void);
+static void         mwl_stats_quit        (void);
+
 /* ------------------------------------------------------------------------- *
  * mwl_wakelock_t
  * ------------------------------------------------------------------------- */
@@ -70,8 +119,17 @@ typedef struct mwl_wakelock_t
     /** Name of the virtual wakelock */
     gchar *wl_name;
 
+    /** Usage accounting entry */
+    mwl_stats_t *wl_stats;
+
     /** Release timer id */
     guint  wl_timer_id;
+
+    /** Flag for: held via mce_wakelock_obtain() */
+    bool   wl_obtained;
+
+    /** Number of mce_wakelock_ref() calls without matching unref */
+    int    wl_refcount;
 } mwl_wakelock_t;
 
 static gboolean        mwl_wakelock_timer_cb    (gpointer aptr);
@@ -92,12 +150,19 @@ static bool mce_wakelock_ready  = false;
 /** Lookup table for tracked wakelock objects */
 static GHashTable *mce_wakelock_lut = 0; // [name] -> mwl_wakelock_t *
 
+/** Number of virtual wakelock obtain / ref requests */
+static guint mce_wakelock_requests = 0;
+
 static mwl_wakelock_t *mce_wakelock_add_entry    (const char *name);
 static void            mce_wakelock_rem_entry    (const char *name);
+static void            mce_wakelock_gc_entry     (mwl_wakelock_t *self);
 static bool            mce_wakelock_have_entries (void);
 
 void                   mce_wakelock_obtain       (const char *name, int duration_ms);
 void                   mce_wakelock_release      (const char *name);
+void                   mce_wakelock_ref          (const char *name);
+void                   mce_wakelock_unref        (const char *name);
+void                   mce_wakelock_foreach_stats(mce_wakelock_stats_fn cb, void *aptr);
 
 void                   mce_wakelock_init         (void);
 void                   mce_wakelock_quit         (void);
@@ -132,6 +197,71 @@ cleanup:
     return res;
 }
 
+/** Helper for writing to persistently open sysfs files
+ *
+ * Falls back to opening the file by path if the file
+ * descriptor is not available.
+ *
+ * Async signal safe.
+ */
+static bool
+mwl_sysfs_write_fd(int fd, const char *path, const char *data, int size)
+{
+    bool res = false;
+
+    ++mwl_rawlock_writes;
+
+    if( fd == -1 ) {
+        res = mwl_sysfs_write(path, data, size);
+        goto cleanup;
+    }
+
+    if( !data || size <= 0 )
+        goto cleanup;
+
+    /* Kernel handles each write as a separate request
+     * regardless of the file position */
+    if( write(fd, data, size) == -1 )
+        goto cleanup;
+
+    res = true;
+
+cleanup:
+    return res;
+}
+
+/** Open wakelock sysfs files for the lifetime of the process
+ *
+ * Avoids open() + close() syscalls on every wakelock state change.
+ */
+static void
+mwl_sysfs_open(void)
+{
+    if( mwl_sysfs_lock_fd == -1 )
+        mwl_sysfs_lock_fd = open(mwl_sysfs_lock_path, O_WRONLY | O_CLOEXEC);
+
+    if( mwl_sysfs_lock_fd == -1 )
+        mce_log(LL_WARN, "%s: open: %m", mwl_sysfs_lock_path);
+
+    if( mwl_sysfs_unlock_fd == -1 )
+        mwl_sysfs_unlock_fd = open(mwl_sysfs_unlock_path, O_WRONLY | O_CLOEXEC);
+
+    if( mwl_sysfs_unlock_fd == -1 )
+        mce_log(LL_WARN, "%s: open: %m", mwl_sysfs_unlock_path);
+}
+
+/** Close persistently open wakelock sysfs files
+ */
+static void
+mwl_sysfs_close(void)
+{
+    if( mwl_sysfs_lock_fd != -1 )
+        close(mwl_sysfs_lock_fd), mwl_sysfs_lock_fd = -1;
+
+    if( mwl_sysfs_unlock_fd != -1 )
+        close(mwl_sysfs_unlock_fd), mwl_sysfs_unlock_fd = -1;
+}
+
 /* ========================================================================= *
  * RAWLOCK_API
  * ========================================================================= */
@@ -150,8 +280,8 @@ mwl_rawlock_supported(void)
 static bool
 mwl_rawlock_lock(void)
 {
-    return mwl_sysfs_write(mwl_sysfs_lock_path, mwl_rawlock_name,
-                           sizeof mwl_rawlock_name - 1);
+    return mwl_sysfs_write_fd(mwl_sysfs_lock_fd, mwl_sysfs_lock_path,
+                              mwl_rawlock_name, sizeof mwl_rawlock_name - 1);
 }
 
 /** Async signal safe wakelock release
@@ -159,8 +289,8 @@ mwl_rawlock_lock(void)
 static bool
 mwl_rawlock_unlock(void)
 {
-    return mwl_sysfs_write(mwl_sysfs_unlock_path, mwl_rawlock_name,
-                           sizeof mwl_rawlock_name - 1);
+    return mwl_sysfs_write_fd(mwl_sysfs_unlock_fd, mwl_sysfs_unlock_path,
+                              mwl_rawlock_name, sizeof mwl_rawlock_name - 1);
 }
 
 /** Set wakelock state
@@ -190,6 +320,187 @@ EXIT:
     return;
 }
 
+/* ========================================================================= *
+ * mwl_stats_t
+ * ========================================================================= */
+
+/** Map virtual wakelock name to statistics key
+ *
+ * Some virtual wakelocks are named uniquely by appending a serial
+ * number, e.g. "dbus_call_123". To keep the statistics bounded,
+ * such wakelocks are accounted under the common prefix.
+ *
+ * @param name  Name of the virtual wakelock
+ *
+ * @return statistics key, to be released with g_free()
+ */
+static gchar *
+mwl_stats_key(const char *name)
+{
+    size_t len = strlen(name);
+    size_t end = len;
+
+    while( end > 0 && g_ascii_isdigit(name[end-1]) )
+        --end;
+
+    if( end < len && end > 1 && name[end-1] == '_' )
+        len = end - 1;
+
+    return g_strndup(name, len);
+}
+
+/** Lookup or create statistics entry for a virtual wakelock
+ *
+ * @param name  Name of the virtual wakelock
+ *
+ * @return statistics entry, or NULL if statistics are not available
+ */
+static mwl_stats_t *
+mwl_stats_lookup(const char *name)
+{
+    mwl_stats_t *self = 0;
+    gchar       *key  = 0;
+
+    if( !mwl_stats_lut )
+        goto EXIT;
+
+    key = mwl_stats_key(name);
+
+    if( !(self = g_hash_table_lookup(mwl_stats_lut, key)) ) {
+        self = g_malloc0(sizeof *self);
+        g_hash_table_replace(mwl_stats_lut, key, self), key = 0;
+    }
+
+EXIT:
+    g_free(key);
+
+    return self;
+}
+
+/** Account virtual wakelock activation
+ *
+ * @param self  statistics entry, or NULL
+ * @param now   current time [ms]
+ */
+static void
+mwl_stats_begin(mwl_stats_t *self, int64_t now)
+{
+    if( !self )
+        goto EXIT;
+
+    self->st_data.acquired += 1;
+
+    if( self->st_active++ == 0 )
+        self->st_since = now;
+
+EXIT:
+    return;
+}
+
+/** Account virtual wakelock deactivation
+ *
+ * @param self  statistics entry, or NULL
+ * @param now   current time [ms]
+ */
+static void
+mwl_stats_end(mwl_stats_t *self, int64_t now)
+{
+    if( !self || self->st_active <= 0 )
+        goto EXIT;
+
+    if( --self->st_active > 0 )
+        goto EXIT;
+
+    int64_t held = now - self->st_since;
+
+    self->st_data.total_ms += held;
+
+    if( self->st_data.max_ms < held )
+        self->st_data.max_ms = held;
+
+EXIT:
+    return;
+}
+
+/** Get snapshot of statistics, including ongoing activity
+ *
+ * @param self  statistics entry
+ * @param res   where to store the snapshot
+ * @param now   current time [ms]
+ */
+static void
+mwl_stats_get(const mwl_stats_t *self, mce_wakelock_stats_t *res, int64_t now)
+{
+    *res = self->st_data;
+
+    res->active = (self->st_active > 0);
+
+    if( res->active ) {
+        int64_t held = now - self->st_since;
+
+        res->total_ms += held;
+
+        if( res->max_ms < held )
+            res->max_ms = held;
+    }
+
+    if( self == mwl_stats_sole )
+        res->sole_ms += now - mwl_stats_sole_since;
+}
+
+/** Re-evaluate which wakelock, if any, is the only one blocking suspend
+ *
+ * Should be called whenever virtual wakelocks are added or removed.
+ */
+static void
+mwl_stats_rethink_sole(void)
+{
+    int64_t      now  = mce_lib_get_boot_tick();
+    mwl_stats_t *sole = 0;
+
+    if( mce_wakelock_lut && g_hash_table_size(mce_wakelock_lut) == 1 ) {
+        GHashTableIter iter;
+        gpointer       val = 0;
+
+        g_hash_table_iter_init(&iter, mce_wakelock_lut);
+        if( g_hash_table_iter_next(&iter, 0, &val) )
+            sole = ((mwl_wakelock_t *)val)->wl_stats;
+    }
+
+    if( mwl_stats_sole == sole )
+        goto EXIT;
+
+    if( mwl_stats_sole )
+        mwl_stats_sole->st_data.sole_ms += now - mwl_stats_sole_since;
+
+    mwl_stats_sole       = sole;
+    mwl_stats_sole_since = now;
+
+EXIT:
+    return;
+}
+
+/** Initialize wakelock statistics
+ */
+static void
+mwl_stats_init(void)
+{
+    if( !mwl_stats_lut )
+        mwl_stats_lut = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                              g_free, g_free);
+}
+
+/** Release wakelock statistics
+ */
+static void
+mwl_stats_quit(void)
+{
+    mwl_stats_sole = 0;
+
+    if( mwl_stats_lut )
+        g_hash_table_unref(mwl_stats_lut), mwl_stats_lut = 0;
+}
+
 /* ========================================================================= *
  * mwl_wakelock_t
  * ========================================================================= */
@@ -211,6 +522,9 @@ mwl_wakelock_timer_cb(gpointer aptr)
 
     self->wl_timer_id = 0;
 
+    if( self->wl_stats )
+        self->wl_stats->st_data.timeouts += 1;
+
     mce_wakelock_release(self->wl_name);
 
 EXIT:
@@ -281,6 +595,11 @@ mwl_wakelock_create(const char *name)
 
     self->wl_name     = g_strdup(name);
     self->wl_timer_id = 0;
+    self->wl_obtained = false;
+    self->wl_refcount = 0;
+    self->wl_stats    = mwl_stats_lookup(name);
+
+    mwl_stats_begin(self->wl_stats, mce_lib_get_boot_tick());
 
     mce_log(LL_DEBUG, "wakelock %s obtain (mux)", self->wl_name);
 
@@ -301,6 +620,8 @@ mwl_wakelock_delete(mwl_wakelock_t *self)
 
     mce_log(LL_DEBUG, "wakelock %s release (mux)", self->wl_name);
 
+    mwl_stats_end(self->wl_stats, mce_lib_get_boot_tick());
+
     g_free(self->wl_name);
     g_free(self);
 
@@ -339,6 +660,7 @@ mce_wakelock_add_entry(const char *name)
     if( !(self = g_hash_table_lookup(mce_wakelock_lut, name)) ) {
         self = mwl_wakelock_create(name);
         g_hash_table_replace(mce_wakelock_lut, g_strdup(name), self);
+        mwl_stats_rethink_sole();
     }
 
 EXIT:
@@ -355,7 +677,27 @@ mce_wakelock_rem_entry(const char *name)
     if( !mce_wakelock_lut )
         goto EXIT;
 
-    g_hash_table_remove(mce_wakelock_lut, name);
+    if( g_hash_table_remove(mce_wakelock_lut, name) )
+        mwl_stats_rethink_sole();
+
+EXIT:
+    return;
+}
+
+/** Remove a wakelock object that is no longer held
+ *
+ * @param self  wakelock object pointer, or NULL
+ */
+static void
+mce_wakelock_gc_entry(mwl_wakelock_t *self)
+{
+    if( !self )
+        goto EXIT;
+
+    if( self->wl_obtained || self->wl_refcount > 0 )
+        goto EXIT;
+
+    mce_wakelock_rem_entry(self->wl_name);
 
 EXIT:
     return;
@@ -390,9 +732,15 @@ mce_wakelock_obtain(const char *name, int duration_ms)
     if( !mce_wakelock_ready )
         goto EXIT;
 
+    ++mce_wakelock_requests;
+
     /* Add entry & start release timer */
-    mwl_wakelock_start_timer(mce_wakelock_add_entry(name),
-                             duration_ms);
+    mwl_wakelock_t *self = mce_wakelock_add_entry(name);
+
+    if( self )
+        self->wl_obtained = true;
+
+    mwl_wakelock_start_timer(self, duration_ms);
 
     /* Re-evaluate need for real wakelock */
     mwl_rawlock_set(mce_wakelock_have_entries());
@@ -411,8 +759,15 @@ mce_wakelock_release(const char *name)
     if( !mce_wakelock_ready )
         goto EXIT;
 
-    /* Remove entry */
-    mce_wakelock_rem_entry(name);
+    mwl_wakelock_t *self = g_hash_table_lookup(mce_wakelock_lut, name);
+
+    if( !self )
+        goto EXIT;
+
+    /* Remove entry unless held via references too */
+    mwl_wakelock_stop_timer(self);
+    self->wl_obtained = false;
+    mce_wakelock_gc_entry(self);
 
     /* Re-evaluate need for real wakelock */
     mwl_rawlock_set(mce_wakelock_have_entries());
@@ -421,6 +776,103 @@ EXIT:
     return;
 }
 
+/** Add reference to virtual wakelock
+ *
+ * Unlike mce_wakelock_obtain(), nested calls are counted and the
+ * wakelock is held until matching number of mce_wakelock_unref()
+ * calls have been made. The kernel is accessed only when the first
+ * virtual wakelock gets activated.
+ *
+ * @param name  Name of the virtual wakelock
+ */
+void
+mce_wakelock_ref(const char *name)
+{
+    if( !mce_wakelock_ready )
+        goto EXIT;
+
+    ++mce_wakelock_requests;
+
+    mwl_wakelock_t *self = mce_wakelock_add_entry(name);
+
+    if( !self )
+        goto EXIT;
+
+    if( self->wl_refcount++ > 0 )
+        goto EXIT;
+
+    /* Re-evaluate need for real wakelock */
+    mwl_rawlock_set(mce_wakelock_have_entries());
+
+EXIT:
+    return;
+}
+
+/** Remove reference from virtual wakelock
+ *
+ * The kernel is accessed only when the last virtual
+ * wakelock gets deactivated.
+ *
+ * @param name  Name of the virtual wakelock
+ */
+void
+mce_wakelock_unref(const char *name)
+{
+    if( !mce_wakelock_ready )
+        goto EXIT;
+
+    mwl_wakelock_t *self = g_hash_table_lookup(mce_wakelock_lut, name);
+
+    if( !self || self->wl_refcount <= 0 ) {
+        mce_log(LL_WARN, "wakelock %s: unbalanced unref", name);
+        goto EXIT;
+    }
+
+    if( --self->wl_refcount > 0 )
+        goto EXIT;
+
+    mce_wakelock_gc_entry(self);
+
+    /* Re-evaluate need for real wakelock */
+    mwl_rawlock_set(mce_wakelock_have_entries());
+
+EXIT:
+    return;
+}
+
+/** Iterate over accumulated wakelock usage statistics
+ *
+ * Virtual wakelocks that have unique serial number suffix
+ * are reported under the common prefix.
+ *
+ * @param cb    callback to call for each entry, in name order
+ * @param aptr  user data to pass to the callback
+ */
+void
+mce_wakelock_foreach_stats(mce_wakelock_stats_fn cb, void *aptr)
+{
+    GList  *keys = 0;
+    int64_t now  = mce_lib_get_boot_tick();
+
+    if( !mwl_stats_lut )
+        goto EXIT;
+
+    keys = g_list_sort(g_hash_table_get_keys(mwl_stats_lut),
+                       (GCompareFunc)strcmp);
+
+    for( GList *iter = keys; iter; iter = iter->next ) {
+        const char           *key  = iter->data;
+        const mwl_stats_t    *self = g_hash_table_lookup(mwl_stats_lut, key);
+        mce_wakelock_stats_t  stats;
+
+        mwl_stats_get(self, &stats, now);
+        cb(key, &stats, aptr);
+    }
+
+EXIT:
+    g_list_free(keys);
+}
+
 /** Initialize mce wakelock subsystem
  */
 void
@@ -430,11 +882,16 @@ mce_wakelock_init(void)
     if( !mwl_rawlock_supported() )
         goto EXIT;
 
-    /* Setup entry look up table */
+    /* Setup statistics & entry look up tables */
+    mwl_stats_init();
+
     if( !mce_wakelock_lut )
         mce_wakelock_lut = g_hash_table_new_full(g_str_hash, g_str_equal,
                                                  g_free, mwl_wakelock_delete_cb);
 
+    /* Keep the control files open to minimize syscalls */
+    mwl_sysfs_open();
+
     /* In case previous mce instance managed to exit without
      * clearing wakelocks: unlock without error checking */
     mwl_rawlock_unlock();
@@ -461,9 +918,16 @@ mce_wakelock_quit(void)
     if( mce_wakelock_lut )
         g_hash_table_unref(mce_wakelock_lut), mce_wakelock_lut = 0;
 
+    mwl_stats_quit();
+
     /* If there were active internal wakelocks,
      * remove the real kernel wakelock too */
     mwl_rawlock_set(false);
+
+    mce_log(LL_DEBUG, "wakelock requests: %u, sysfs writes: %u",
+            mce_wakelock_requests, mwl_rawlock_writes);
+
+    mwl_sysfs_close();
 }
 
 /** Async signal safe wakelock cleanup
@@ -21,14 +21,47 @@
 #ifndef MCE_WAKELOCK_H_
 # define MCE_WAKELOCK_H_
 
+# include <stdbool.h>
+# include <stdint.h>
+
 # ifdef __cplusplus
 extern "C" {
 # elif 0
 } /* fool JED indentation ... */
 # endif
 
+/** Accumulated usage statistics for a virtual wakelock */
+typedef struct mce_wakelock_stats_t
+{
+    /** Number of times the wakelock has been activated */
+    int64_t acquired;
+
+    /** Number of times the wakelock has been released by timeout */
+    int64_t timeouts;
+
+    /** Total time the wakelock has been held [ms] */
+    int64_t total_ms;
+
+    /** Longest continuous time the wakelock has been held [ms] */
+    int64_t max_ms;
+
+    /** Time held while no other virtual wakelocks were active [ms] */
+    int64_t sole_ms;
+
+    /** Flag for: wakelock is currently held */
+    bool    active;
+} mce_wakelock_stats_t;
+
+/** Callback function type for mce_wakelock_foreach_stats() */
+typedef void (*mce_wakelock_stats_fn)(const char *name,
+                                      const mce_wakelock_stats_t *stats,
+                                      void *aptr);
+
 void                   mce_wakelock_obtain      (const char *name, int duration_ms);
 void                   mce_wakelock_release     (const char *name);
+void                   mce_wakelock_ref         (const char *name);
+void                   mce_wakelock_unref       (const char *name);
+void                   mce_wakelock_foreach_stats(mce_wakelock_stats_fn cb, void *aptr);
 
 void                   mce_wakelock_init        (void);
 void                   mce_wakelock_quit        (void);
@@ -26,8 +26,11 @@
 
 #include "mce-wltimer.h"
 
+#include "mce.h"
 #include "mce-log.h"
+#include "mce-lib.h"
 #include "mce-wakelock.h"
+#include "mce-timerheap.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -49,8 +52,20 @@ struct mce_wltimer_t
     /** Timer delay in milliseconds */
     int         wlt_period;
 
-    /** Underlying glib timeout id */
-    guint       wlt_timer_id;
+    /** Trigger time, milliseconds in CLOCK_MONOTONIC base
+     *
+     * The trigger time is held in the heap node that is used for
+     * keeping active timers in mwt_queue_timer_heap. */
+    mce_timernode_t wlt_node;
+
+    /** Latest acceptable trigger time, held in mwt_queue_deadline_heap */
+    mce_timernode_t wlt_deadline;
+
+    /** How much triggering can be delayed for coalescing purposes [ms] */
+    int         wlt_slack;
+
+    /** Flag for: triggered, waiting for mwt_queue_dispatch_timers() */
+    bool        wlt_dispatch_pending;
 
     /** Timer callback function */
     GSourceFunc wlt_notify;
@@ -67,29 +82,55 @@ static void     mce_wltimer_eval_wakelock  (const mce_wltimer_t *self);
 bool            mce_wltimer_is_active      (const mce_wltimer_t *self);
 const char     *mce_wltimer_get_name       (const mce_wltimer_t *self);
 void            mce_wltimer_set_period     (mce_wltimer_t *self, int period);
+void            mce_wltimer_set_slack      (mce_wltimer_t *self, int slack);
+static void     mce_wltimer_set_trigger    (mce_wltimer_t *self, int64_t trigger);
 void            mce_wltimer_start          (mce_wltimer_t *self);
 void            mce_wltimer_stop           (mce_wltimer_t *self);
 
-static gboolean mce_wltimer_gate_cb        (gpointer aptr);
+static void     mce_wltimer_notify         (mce_wltimer_t *self);
 
 /* ------------------------------------------------------------------------- *
  * QUEUE_MANAGEMENT
  * ------------------------------------------------------------------------- */
 
-/** Idle callback id for delayed garbage collect */
-static guint mwt_queue_compact_id = 0;
+/** Monotonic tick value used to signify "not-set" */
+#define NO_TICK MCE_TIMERHEAP_NO_TICK
+
+/** Lookup table of registered timers */
+static GHashTable *mwt_queue_timer_lut = 0; // [mce_wltimer_t *] -> mce_wltimer_t *
+
+/** Active timers, ordered by trigger time */
+static mce_timerheap_t mwt_queue_timer_heap = MCE_TIMERHEAP_INIT;
 
-/** List of registered timers */
-static GSList *mwt_queue_timer_list = 0;
+/** Active timers, ordered by trigger time + slack */
+static mce_timerheap_t mwt_queue_deadline_heap = MCE_TIMERHEAP_INIT;
 
-static void     mwt_queue_compact          (void);
-static gboolean mwt_queue_compact_cb       (gpointer aptr);
-static void     mwt_queue_schedule_compact (void);
-static void     mwt_queue_cancel_compact   (void);
+/** Wakeup statistics */
+static mce_timerstats_t mwt_queue_stats = MCE_TIMERSTATS_INIT;
+
+/** Glib timeout id for the nearest timer trigger */
+static guint    mwt_queue_wakeup_id = 0;
+
+/** Trigger time the glib timeout has been programmed for */
+static int64_t  mwt_queue_wakeup_tick = NO_TICK;
+
+static void     mwt_queue_dispatch_timers  (void);
+static gboolean mwt_queue_wakeup_cb        (gpointer aptr);
+static void     mwt_queue_schedule_wakeup  (void);
 
 static void     mwt_queue_add_timer        (mce_wltimer_t *self);
 static void     mwt_queue_remove_timer     (mce_wltimer_t *self);
 static bool     mwt_queue_has_timer        (const mce_wltimer_t *self);
+void            mce_wltimer_get_stats      (mce_timerstats_t *stats);
+
+/* ------------------------------------------------------------------------- *
+ * DATAPIPE_HANDLERS
+ * ------------------------------------------------------------------------- */
+
+static void     mwt_datapipe_display_state_curr_cb(gconstpointer data);
+
+static void     mwt_datapipe_init          (void);
+static void     mwt_datapipe_quit          (void);
 
 /* ------------------------------------------------------------------------- *
  * MODULE_INIT
@@ -124,9 +165,12 @@ mce_wltimer_create(const char  *name,
 
     self->wlt_name      = name ? strdup(name) : 0;
     self->wlt_period    = period;
-    self->wlt_timer_id  = 0;
     self->wlt_notify    = notify;
     self->wlt_user_data = user_data;
+    self->wlt_dispatch_pending = false;
+
+    mce_timernode_init(&self->wlt_node, self);
+    mce_timernode_init(&self->wlt_deadline, self);
 
     mwt_queue_add_timer(self);
 
@@ -168,7 +212,7 @@ mce_wltimer_eval_wakelock(const mce_wltimer_t *self)
     if( !self->wlt_name)
         goto EXIT;
 
-    if( self->wlt_timer_id )
+    if( mce_wltimer_is_active(self) )
         mce_wakelock_obtain(self->wlt_name, -1);
     else
         mce_wakelock_release(self->wlt_name);
@@ -188,7 +232,7 @@ mce_wltimer_is_active(const mce_wltimer_t *self)
 {
     bool active = false;
     if( self )
-        active = (self->wlt_timer_id != 0);
+        active = (self->wlt_node.tmn_trigger < NO_TICK);
     return active;
 }
 
@@ -222,43 +266,89 @@ mce_wltimer_set_period(mce_wltimer_t *self, int period)
         self->wlt_period = period;
 }
 
-/** Call wakelock timer notification functiom
+/** Set wakelock timer slack
+ *
+ * Allowing the timer to trigger late makes it possible to serve it
+ * from the same wakeup as some other timer.
+ *
+ * Takes effect when the timer is started the next time.
  *
- * @param aptr   wakelock timer object (as void pointer)
+ * @param self   wakelock timer object, or NULL
+ * @param slack  allowed triggering delay [ms]
  */
-static gboolean
-mce_wltimer_gate_cb(gpointer aptr)
+void
+mce_wltimer_set_slack(mce_wltimer_t *self, int slack)
+{
+    if( self )
+        self->wlt_slack = (slack > 0) ? slack : 0;
+}
+
+/** Set wakelock timer trigger time stamp
+ *
+ * @param self    wakelock timer object, or NULL
+ * @param trigger trigger time
+ */
+static void
+mce_wltimer_set_trigger(mce_wltimer_t *self, int64_t trigger)
 {
-    gboolean repeat = FALSE;
+    if( !self )
+        goto EXIT;
+
+    /* Explicit start/stop overrides already triggered state */
+    self->wlt_dispatch_pending = false;
+
+    int64_t deadline = NO_TICK;
+
+    if( trigger != NO_TICK )
+        deadline = trigger + self->wlt_slack;
+
+    mce_timerheap_schedule(&mwt_queue_timer_heap, &self->wlt_node, trigger);
+    mce_timerheap_schedule(&mwt_queue_deadline_heap, &self->wlt_deadline,
+                           deadline);
+    mwt_queue_schedule_wakeup();
 
-    mce_wltimer_t *self = aptr;
+EXIT:
+    return;
+}
 
-    if( !self->wlt_timer_id )
+/** Call wakelock timer notification functiom
+ *
+ * @param self   wakelock timer object, or NULL
+ */
+static void
+mce_wltimer_notify(mce_wltimer_t *self)
+{
+    bool repeat = false;
+
+    if( !self )
         goto EXIT;
 
     if( self->wlt_notify ) {
-        bool res = self->wlt_notify(self->wlt_user_data);
+        repeat = self->wlt_notify(self->wlt_user_data);
 
         if( !mwt_queue_has_timer(self) ) {
             /* The notify callback managed to delete the timer
              * object, invalidate the pointer */
             self = 0;
-        }
-        else {
-            /* Repeat/stop according to the callback return value */
-            repeat = res;
+            goto EXIT;
         }
     }
 
-EXIT:
+    /* Leave alone timers that were explicitly started or
+     * stopped from within the notify callback */
+    if( !self->wlt_dispatch_pending )
+        goto EXIT;
 
-    if( self ) {
-        if( !repeat &&  self->wlt_timer_id )
-            self->wlt_timer_id = 0;
-        mce_wltimer_eval_wakelock(self);
-    }
+    /* Repeat/stop according to the callback return value */
+    if( repeat && mce_wltimer_ready )
+        mce_wltimer_start(self);
+    else
+        mce_wltimer_set_trigger(self, NO_TICK);
 
-    return repeat;
+EXIT:
+    mce_wltimer_eval_wakelock(self);
+
+    return;
 }
 
 /** Start wakelock timer
@@ -271,30 +361,16 @@ mce_wltimer_start(mce_wltimer_t *self)
     if( !self )
         goto EXIT;
 
-    if( self->wlt_timer_id ) {
-        g_source_remove(self->wlt_timer_id),
-            self->wlt_timer_id = 0;
-    }
-
-    if( !mce_wltimer_ready )
-        goto EXIT;
-
-    if( self->wlt_period < 0 )
-        goto EXIT;
-
-    mce_log(LL_DEBUG, "start %s %d", mce_wltimer_get_name(self),
-            self->wlt_period);
+    int64_t trigger = NO_TICK;
 
-    if( self->wlt_period > 0 ) {
-        self->wlt_timer_id = g_timeout_add(self->wlt_period,
-                                           mce_wltimer_gate_cb,
-                                           self);
-    }
-    else {
-        self->wlt_timer_id = g_idle_add(mce_wltimer_gate_cb,
-                                        self);
+    if( mce_wltimer_ready && self->wlt_period >= 0 ) {
+        mce_log(LL_DEBUG, "start %s %d", mce_wltimer_get_name(self),
+                self->wlt_period);
+        trigger = mce_lib_get_mono_tick() + self->wlt_period;
     }
 
+    mce_wltimer_set_trigger(self, trigger);
+
 EXIT:
     mce_wltimer_eval_wakelock(self);
     return;
@@ -310,13 +386,12 @@ mce_wltimer_stop(mce_wltimer_t *self)
     if( !self )
         goto EXIT;
 
-    if( !self->wlt_timer_id )
+    if( !mce_wltimer_is_active(self) )
         goto EXIT;
 
     mce_log(LL_DEBUG, "stop %s", mce_wltimer_get_name(self));
 
-    g_source_remove(self->wlt_timer_id),
-        self->wlt_timer_id = 0;
+    mce_wltimer_set_trigger(self, NO_TICK);
 
 EXIT:
     mce_wltimer_eval_wakelock(self);
@@ -328,79 +403,115 @@ EXIT:
  * QUEUE_MANAGEMENT
  * ========================================================================= */
 
-/** Clean up unused timer list slots
- *
- * When timers are deleted, the associated node in mwt_queue_timer_list
- * is left in place with data pointer set to zero.
- *
- * This function can be used to remove such stale entries in suitable
- * point outside the dispatch iteration loop.
+/** Notify triggered wakelock timers
  */
 static void
-mwt_queue_compact(void)
+mwt_queue_dispatch_timers(void)
 {
-    mwt_queue_cancel_compact();
+    int64_t now = mce_lib_get_mono_tick();
 
-    GSList **tail = &mwt_queue_timer_list;
+    /* Detach all triggered timers from the heap before notifying
+     * any of them, so that timers restarted from within notify
+     * callbacks do not get dispatched again during this round. */
+    GSList          *triggered = 0;
+    mce_timernode_t *node;
 
-    GSList *item;
+    while( (node = mce_timerheap_pop_expired(&mwt_queue_timer_heap, now)) ) {
+        mce_wltimer_t *timer = node->tmn_owner;
 
-    while( (item = *tail) ) {
-        if( item->data ) {
-            tail = &item->next;
-        }
-        else {
-            *tail = item->next;
-            item->next = 0;
-            g_slist_free(item);
-        }
+        mce_timerheap_remove(&mwt_queue_deadline_heap, &timer->wlt_deadline);
+        timer->wlt_dispatch_pending = true;
+        triggered = g_slist_prepend(triggered, timer);
     }
+
+    triggered = g_slist_reverse(triggered);
+
+    int notified = 0;
+
+    for( GSList *item = triggered; item; item = item->next ) {
+        mce_wltimer_t *timer = item->data;
+
+        /* Skip timers that were deleted, stopped or restarted
+         * by notify callbacks of previously handled timers */
+        if( !mwt_queue_has_timer(timer) )
+            continue;
+
+        if( !timer->wlt_dispatch_pending )
+            continue;
+
+        mce_wltimer_notify(timer);
+        ++notified;
+    }
+
+    g_slist_free(triggered);
+
+    mce_timerstats_add_wakeup(&mwt_queue_stats, notified);
+}
+
+/** Get wakelock timer wakeup statistics
+ *
+ * @param stats  where to store the statistics snapshot
+ */
+void
+mce_wltimer_get_stats(mce_timerstats_t *stats)
+{
+    mce_timerstats_get(&mwt_queue_stats, stats, mce_lib_get_mono_tick());
 }
 
-/** Idle callback function for delayed garbage collect
+/** Glib timeout callback for dispatching wakelock timers
  *
- * @param aptr user data pointer (unused)
+ * @param aptr (not used)
  *
- * @return FALSE, to stop repeats
+ * @return FALSE to stop timeout from repeating
  */
 static gboolean
-mwt_queue_compact_cb(gpointer aptr)
+mwt_queue_wakeup_cb(gpointer aptr)
 {
     (void)aptr;
 
-    if( !mwt_queue_compact_id )
+    if( !mwt_queue_wakeup_id )
         goto EXIT;
 
-    mwt_queue_compact_id = 0;
+    mwt_queue_wakeup_id = 0;
+    mwt_queue_wakeup_tick = NO_TICK;
 
-    mwt_queue_compact();
+    mwt_queue_dispatch_timers();
+
+    /* Check the next timer to trigger */
+    mwt_queue_schedule_wakeup();
 
 EXIT:
     return FALSE;
 }
 
-/** Schedule delayed garbage collection
+/** Reprogram glib timeout for the nearest wakelock timer deadline
+ *
+ * Waking up at the earliest deadline (trigger + slack) allows
+ * dispatching all timers triggered by then in one go.
  */
-static void mwt_queue_schedule_compact(void)
+static void
+mwt_queue_schedule_wakeup(void)
 {
-    if( mwt_queue_compact_id )
+    int64_t trigger = mce_timerheap_next_trigger(&mwt_queue_deadline_heap);
+
+    if( mwt_queue_wakeup_id && mwt_queue_wakeup_tick == trigger )
         goto EXIT;
 
-    mwt_queue_compact_id = g_idle_add(mwt_queue_compact_cb, 0);
+    if( mwt_queue_wakeup_id ) {
+        g_source_remove(mwt_queue_wakeup_id),
+            mwt_queue_wakeup_id = 0;
+    }
 
-EXIT:
-    return;
-}
+    mwt_queue_wakeup_tick = trigger;
 
-/** Cancel delayed garbage collection
- */
-static void mwt_queue_cancel_compact(void)
-{
-    if( !mwt_queue_compact_id )
+    if( trigger == NO_TICK )
         goto EXIT;
 
-    g_source_remove(mwt_queue_compact_id),
-        mwt_queue_compact_id = 0;
+    int64_t now   = mce_lib_get_mono_tick();
+    int64_t delay = (trigger > now) ? (trigger - now) : 0;
+
+    mwt_queue_wakeup_id = g_timeout_add((guint)delay,
+                                        mwt_queue_wakeup_cb, 0);
 
 EXIT:
     return;
@@ -417,10 +528,10 @@ mwt_queue_has_timer(const mce_wltimer_t *self)
 {
     bool has_timer = false;
 
-    if( !self )
+    if( !self || !mwt_queue_timer_lut )
         goto EXIT;
 
-    has_timer = g_slist_find(mwt_queue_timer_list, self) != 0;
+    has_timer = g_hash_table_lookup(mwt_queue_timer_lut, self) != 0;
 
 EXIT:
     return has_timer;
@@ -436,13 +547,11 @@ mwt_queue_add_timer(mce_wltimer_t *self)
     if( !self )
         goto EXIT;
 
-    /* Try to find recyclable vacated timer slot */
-    GSList *item = g_slist_find(mwt_queue_timer_list, 0);
+    if( !mwt_queue_timer_lut )
+        mwt_queue_timer_lut = g_hash_table_new(g_direct_hash,
+                                               g_direct_equal);
 
-    if( item )
-        item->data = self;
-    else
-        mwt_queue_timer_list = g_slist_prepend(mwt_queue_timer_list, self);
+    g_hash_table_replace(mwt_queue_timer_lut, self, self);
 
 EXIT:
     return;
@@ -458,19 +567,73 @@ mwt_queue_remove_timer(mce_wltimer_t *self)
     if( !self )
         goto EXIT;
 
-    GSList *item = g_slist_find(mwt_queue_timer_list, self);
-
-    /* Vacate the slot by clearing the data link */
-    if( item )
-        item->data = 0;
+    mce_timerheap_remove(&mwt_queue_timer_heap, &self->wlt_node);
+    mce_timerheap_remove(&mwt_queue_deadline_heap, &self->wlt_deadline);
+    mwt_queue_schedule_wakeup();
 
-    /* Schedule removal of the link it self */
-    mwt_queue_schedule_compact();
+    if( mwt_queue_timer_lut )
+        g_hash_table_remove(mwt_queue_timer_lut, self);
 
 EXIT:
     return;
 }
 
+/* ========================================================================= *
+ * DATAPIPE_HANDLERS
+ * ========================================================================= */
+
+/** Change notifications for display_state_curr
+ */
+static void
+mwt_datapipe_display_state_curr_cb(gconstpointer data)
+{
+    display_state_t state = GPOINTER_TO_INT(data);
+
+    bool display_off = (state == MCE_DISPLAY_OFF ||
+                        state == MCE_DISPLAY_LPM_OFF);
+
+    /* Used for evaluating wakeups per display off time */
+    mce_timerstats_set_display_off(&mwt_queue_stats, display_off,
+                                   mce_lib_get_mono_tick());
+}
+
+/** Array of datapipe handlers */
+static datapipe_handler_t mwt_datapipe_handlers[] =
+{
+    // output triggers
+    {
+        .datapipe  = &display_state_curr_pipe,
+        .output_cb = mwt_datapipe_display_state_curr_cb,
+    },
+
+    // sentinel
+    {
+        .datapipe = 0,
+    }
+};
+
+static datapipe_bindings_t mwt_datapipe_bindings =
+{
+    .module   = "mce_wltimer",
+    .handlers = mwt_datapipe_handlers,
+};
+
+/** Append triggers/filters to datapipes
+ */
+static void
+mwt_datapipe_init(void)
+{
+    datapipe_bindings_init(&mwt_datapipe_bindings);
+}
+
+/** Remove triggers/filters from datapipes
+ */
+static void
+mwt_datapipe_quit(void)
+{
+    datapipe_bindings_quit(&mwt_datapipe_bindings);
+}
+
 /* ========================================================================= *
  * MODULE_INIT
  * ========================================================================= */
@@ -478,7 +641,7 @@ EXIT:
 void
 mce_wltimer_init(void)
 {
-    /* nop */
+    mwt_datapipe_init();
 }
 
 void
@@ -486,29 +649,38 @@ mce_wltimer_quit(void)
 {
     mce_log(LL_DEBUG, "deny suspend block timers");
 
+    mwt_datapipe_quit();
+
     /* Deny starting of timers */
     mce_wltimer_ready = false;
 
     /* Disable left-behind timer objects */
-    for( GSList *item = mwt_queue_timer_list; item; item = item->next ) {
-        mce_wltimer_t *timer = item->data;
-        if( !timer )
-            continue;
+    if( mwt_queue_timer_lut ) {
+        GHashTableIter iter;
+        gpointer       key;
 
-        /* Note: What we have here is effectively a resource leak
-         *       somewhere else. But all that can be done is to make
-         *       sure we do not leave behind active timeouts that
-         *       might then trigger callbacks in unexpected manner.
-         */
+        g_hash_table_iter_init(&iter, mwt_queue_timer_lut);
+        while( g_hash_table_iter_next(&iter, &key, 0) ) {
+            mce_wltimer_t *timer = key;
 
-        mce_log(LL_WARN, "timer '%s' exists at deinit",
-               mce_wltimer_get_name(timer));
+            /* Note: What we have here is effectively a resource leak
+             *       somewhere else. But all that can be done is to make
+             *       sure we do not leave behind active timeouts that
+             *       might then trigger callbacks in unexpected manner.
+             */
 
-        mce_wltimer_stop(timer);
-        item->data = 0;
-    }
+            mce_log(LL_WARN, "timer '%s' exists at deinit",
+                    mce_wltimer_get_name(timer));
+
+            mce_wltimer_stop(timer);
+        }
 
-    /* Flush timer list */
-    mwt_queue_compact();
+        g_hash_table_unref(mwt_queue_timer_lut),
+            mwt_queue_timer_lut = 0;
+    }
 
+    /* Release heap and cancel pending wakeup */
+    mce_timerheap_clear(&mwt_queue_timer_heap);
+    mce_timerheap_clear(&mwt_queue_deadline_heap);
+    mwt_queue_schedule_wakeup();
 }
@@ -27,6 +27,8 @@
 #ifndef MCE_WLTIMER_H_
 # define MCE_WLTIMER_H_
 
+# include "mce-timerheap.h"
+
 # include <stdbool.h>
 # include <glib.h>
 
@@ -42,11 +44,13 @@ void            mce_wltimer_delete      (mce_wltimer_t *self);
 bool            mce_wltimer_is_active   (const mce_wltimer_t *self);
 const char     *mce_wltimer_get_name    (const mce_wltimer_t *self);
 void            mce_wltimer_set_period  (mce_wltimer_t *self, int period);
+void            mce_wltimer_set_slack   (mce_wltimer_t *self, int slack);
 
 void            mce_wltimer_start       (mce_wltimer_t *self);
 void            mce_wltimer_stop        (mce_wltimer_t *self);
 
 void            mce_wltimer_dispatch    (void);
+void            mce_wltimer_get_stats   (mce_timerstats_t *stats);
 
 void            mce_wltimer_init        (void);
 void            mce_wltimer_quit        (void);
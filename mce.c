@@ -36,8 +36,11 @@
 #include "mce-modules.h"
 #include "mce-command-line.h"
 #include "mce-sensorfw.h"
+#include "mce-startup.h"
+#include "mce-journal.h"
 #include "mce-wakelock.h"
 #include "mce-worker.h"
+#include "mce-io.h"
 #include "tklock.h"
 #include "powerkey.h"
 #include "event-input.h"
@@ -54,6 +57,7 @@
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
+#include <limits.h>
 #include <fcntl.h>
 
 #include <systemd/sd-daemon.h>
@@ -113,17 +117,12 @@ static void mce_cleanup_wakelocks(void)
 	/* We are on exit path -> block suspend for good */
 	wakelock_block_suspend_until_exit();
 
-	wakelock_unlock("mce_display_on");
-	wakelock_unlock("mce_input_handler");
 	wakelock_unlock("mce_cpu_keepalive");
-	wakelock_unlock("mce_display_stm");
 	wakelock_unlock("mce_powerkey_stm");
 	wakelock_unlock("mce_proximity_stm");
 	wakelock_unlock("mce_bluez_wait");
 	wakelock_unlock("mce_led_breathing");
-	wakelock_unlock("mce_lpm_off");
 	wakelock_unlock("mce_tklock_notify");
-	wakelock_unlock("mce_hbtimer_dispatch");
 	wakelock_unlock("mce_inactivity_notify");
 }
 #endif // ENABLE_WAKELOCKS
@@ -660,6 +659,9 @@ static struct
 	bool valgrind_mode;
 	bool sensortest_mode;
 	int  auto_exit;
+	char *journal_path;
+	char *replay_path;
+	int  replay_speed;
 } mce_args =
 {
 	.daemonflag       = false,
@@ -671,6 +673,9 @@ static struct
 	.valgrind_mode    = false,
 	.sensortest_mode  = false,
 	.auto_exit        = -1,
+	.journal_path     = 0,
+	.replay_path      = 0,
+	.replay_speed     = 0,
 };
 
 bool mce_in_valgrind_mode(void)
@@ -772,6 +777,37 @@ static bool mce_do_trace(const char *arg)
 	return mce_enable_trace(arg);
 }
 
+static bool mce_do_journal(const char *arg)
+{
+	g_free(mce_args.journal_path);
+	mce_args.journal_path = g_strdup(arg ?: MCE_JOURNAL_FILE);
+	return true;
+}
+
+static bool mce_do_replay_journal(const char *arg)
+{
+	g_free(mce_args.replay_path);
+	mce_args.replay_path = g_strdup(arg);
+	return true;
+}
+
+static bool mce_do_replay_speed(const char *arg)
+{
+	char *end = 0;
+	long  val;
+
+	errno = 0;
+	val = strtol(arg, &end, 0);
+
+	if( errno || end == arg || *end || val <= 0 || val > INT_MAX ) {
+		fprintf(stderr, "invalid replay speed '%s'\n", arg);
+		return false;
+	}
+
+	mce_args.replay_speed = (int)val;
+	return true;
+}
+
 static const mce_opt_t options[] =
 {
 
@@ -885,6 +921,40 @@ static const mce_opt_t options[] =
 			"\n"
 			"This is usefult for mce startup debugging only.\n"
 	},
+	{
+		.name        = "journal",
+		.values      = "path",
+		.with_arg    = mce_do_journal,
+		.without_arg = mce_do_journal,
+		.usage       =
+			"Record datapipe traffic to a journal file\n"
+			"\n"
+			"The journal is a memory mapped ring of the most recent\n"
+			"datapipe executions. Default path is:\n"
+			"  " MCE_JOURNAL_FILE "\n"
+	},
+	{
+		.name        = "replay-journal",
+		.values      = "path",
+		.with_arg    = mce_do_replay_journal,
+		.usage       =
+			"Replay datapipe traffic from a journal file\n"
+			"\n"
+			"Recorded inputs are fed to datapipes after startup is\n"
+			"finished, and mce exits once all of them have been\n"
+			"replayed. Timing statistics are logged on exit.\n"
+	},
+	{
+		.name        = "replay-speed",
+		.values      = "factor",
+		.with_arg    = mce_do_replay_speed,
+		.usage       =
+			"Set journal replay speed factor\n"
+			"\n"
+			"Delays between recorded inputs are divided by the given\n"
+			"positive factor. If not given, inputs are replayed without\n"
+			"delays.\n"
+	},
 	{
 		.name        = "valgrind-mode",
 		.without_arg = mce_do_valgrind_mode,
@@ -1031,9 +1101,13 @@ int main(int argc, char **argv)
 	}
 	mce_signal_handlers_install();
 
+	/* Start opening input devices in the background */
+	mce_input_prefetch();
+
 	/* Initialise subsystems */
 
 	/* Get configuration options */
+	mce_startup_phase("conf");
 	if( !mce_conf_init() ) {
 		mce_log(LL_CRIT,
 			"Failed to initialise configuration options");
@@ -1041,13 +1115,17 @@ int main(int argc, char **argv)
 	}
 
 	/* Open fbdev as early as possible */
+	mce_startup_phase("fbdev");
 	mce_fbdev_init();
 
 	/* Start worker thread */
+	mce_startup_phase("worker");
 	if( !mce_worker_init() )
 		goto EXIT;
+	mce_io_write_async_init();
 
 	/* Initialise D-Bus */
+	mce_startup_phase("dbus");
 	if( !mce_dbus_init(mce_args.systembus) ) {
 		mce_log(LL_CRIT,
 			"Failed to initialise D-Bus");
@@ -1057,6 +1135,7 @@ int main(int argc, char **argv)
 	/* Initialise GConf
 	 * pre-requisite: g_type_init()
 	 */
+	mce_startup_phase("setting");
 	if (mce_setting_init() == FALSE) {
 		mce_log(LL_CRIT,
 			"Cannot connect to default GConf engine");
@@ -1064,9 +1143,19 @@ int main(int argc, char **argv)
 	}
 
 	/* Setup all datapipes */
+	mce_startup_phase("datapipe");
 	mce_datapipe_init();
 
+	/* Load journal before possibly overwriting it by recording */
+	if( mce_args.replay_path &&
+	    !mce_journal_replay(mce_args.replay_path, mce_args.replay_speed) )
+		goto EXIT;
+
+	if( mce_args.journal_path )
+		mce_journal_init(mce_args.journal_path);
+
 	/* Allow registering of suspend proof timers */
+	mce_startup_phase("timers");
 	mce_hbtimer_init();
 
 	/* Allow registering of suspend blocking timers */
@@ -1076,6 +1165,7 @@ int main(int argc, char **argv)
 	 * pre-requisite: mce_setting_init()
 	 * pre-requisite: mce_dbus_init()
 	 */
+	mce_startup_phase("mode");
 	if (mce_mode_init() == FALSE) {
 		goto EXIT;
 	}
@@ -1085,10 +1175,12 @@ int main(int argc, char **argv)
 	 * pre-requisite: mce_dbus_init()
 	 * pre-requisite: mce_mce_init()
 	 */
+	mce_startup_phase("dsme");
 	if( !mce_dsme_init() )
 		goto EXIT;
 
 	/* Initialise powerkey driver */
+	mce_startup_phase("powerkey");
 	if (mce_powerkey_init() == FALSE) {
 		goto EXIT;
 	}
@@ -1096,28 +1188,34 @@ int main(int argc, char **argv)
 	/* Initialise /dev/input driver
 	 * pre-requisite: g_type_init()
 	 */
+	mce_startup_phase("input");
 	if (mce_input_init() == FALSE) {
 		goto EXIT;
 	}
 
 	/* Initialise switch driver */
+	mce_startup_phase("switches");
 	if (mce_switches_init() == FALSE) {
 		goto EXIT;
 	}
 
 	/* Initialise tklock driver */
+	mce_startup_phase("tklock");
 	if (mce_tklock_init() == FALSE) {
 		goto EXIT;
 	}
 
+	mce_startup_phase("sensorfw");
 	if( !mce_sensorfw_init() ) {
 		goto EXIT;
 	}
 
+	mce_startup_phase("common");
 	if( !mce_common_init() )
 		goto EXIT;
 
 	/* Load all modules */
+	mce_startup_phase("modules");
 	if (mce_modules_init() == FALSE) {
 		goto EXIT;
 	}
@@ -1129,6 +1227,7 @@ int main(int argc, char **argv)
 
 	/* MCE startup succeeded */
 	status = EXIT_SUCCESS;
+	mce_startup_finish();
 
 	/* Tell systemd that we have started up */
 	if( mce_args.systemd_notify ) {
@@ -1167,10 +1266,16 @@ EXIT:
 	/* Free all datapipes */
 	mce_datapipe_quit();
 
+	/* Stop datapipe journaling */
+	mce_journal_quit();
+	g_free(mce_args.journal_path), mce_args.journal_path = 0;
+	g_free(mce_args.replay_path), mce_args.replay_path = 0;
+
 	/* Call the exit function for all subsystems */
 	mce_setting_exit();
 	mce_dbus_exit();
 	mce_conf_exit();
+	mce_io_write_async_quit();
 	mce_worker_quit();
 	mce_fbdev_quit();
 
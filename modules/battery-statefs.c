@@ -76,6 +76,16 @@
  */
 #define REREAD_DELAY 250
 
+/** Upper limit for epoll wakeups handled without forced re-read
+ *
+ * When forced re-reads do not find changes that were not already
+ * reported via epoll, the following epoll wakeups are handled
+ * without scheduling a re-read. The number of skipped wakeups is
+ * doubled (plus one) after each fruitless re-read up to this limit,
+ * and dropped back to zero when a re-read finds something new.
+ */
+#define REREAD_SKIP_MAX 15
+
 /** Delay from 1st property change to state machine update; [ms] */
 #define UPDATE_DELAY (REREAD_DELAY + 50)
 
@@ -225,6 +235,7 @@ static void     sfsctl_start            (void);
 static bool     sfsctl_start_try                (void);
 static gboolean sfsctl_start_cb         (gpointer aptr);
 
+static bool     sfsctl_update_all       (void);
 static bool     sfsctl_watch_cb         (struct epoll_event *eve, int cnt);
 
 static void     sfsctl_schedule_reread  (void);
@@ -468,6 +479,10 @@ inputset_watch_cb(GIOChannel *srce, GIOCondition cond, gpointer data)
 
     gboolean keep_going = TRUE;
 
+    /* Room for all tracked files, so that one epoll_wait() call
+     * drains everything that is ready. Note that the fds are level
+     * triggered, so calling epoll_wait() again before the files have
+     * been read would just report the same files again. */
     struct epoll_event eve[16];
 
     if( cond & ~G_IO_IN ) {
@@ -490,6 +505,7 @@ inputset_watch_cb(GIOChannel *srce, GIOCondition cond, gpointer data)
         goto cleanup;
     }
 
+    /* Events for all ready files are handled in one batch */
     bool (*input_cb)(struct epoll_event *, int) = data;
 
     if( !input_cb(eve, rc) )
@@ -838,6 +854,10 @@ tracker_propdir(void)
 }
 
 /** Read string from statefs input file
+ *
+ * The file is kept open and read from offset zero with a single
+ * pread() call. Rewinding via lseek() is needed only for files
+ * that are not seekable, i.e. pipes used while debugging.
  *
  * @param self statefs input file tracking object
  * @param data buffer where to read to
@@ -855,14 +875,13 @@ tracker_read_data(tracker_t *self, char *data, size_t size)
         goto cleanup;
 
     /* Read the state data */
-    if( (rc = read(self->fd, data, size-1)) == -1 ) {
-        mce_log(LL_WARN, "%s: read: %m", self->path);
-        goto cleanup;
-    }
+    if( self->seekable )
+        rc = pread(self->fd, data, size-1, 0);
+    else
+        rc = read(self->fd, data, size-1);
 
-    /* Rewind to the start of the file */
-    if( self->seekable && lseek(self->fd, 0, SEEK_SET) == -1 ) {
-        mce_log(LL_WARN, "%s: rewind: %m", self->path);
+    if( rc == -1 ) {
+        mce_log(LL_WARN, "%s: read: %m", self->path);
         goto cleanup;
     }
 
@@ -968,17 +987,19 @@ cleanup:
     return ack;
 }
 
-/** Update value from statefs content and schedule state machine update
+/** Update value from statefs content
+ *
+ * Scheduling state machine update is left to the caller, so
+ * that changes in several files can be processed in one go.
  *
  * @param self statefs input file tracking object
  *
- * @return true if io was successfull, but the value did not change;
- *         false otherwise
+ * @return true if the value changed, false otherwise
  */
 static bool
 tracker_update(tracker_t *self)
 {
-    bool dummy = false; // assume: io failed or value changed
+    bool changed = false;
 
     char data[64];
 
@@ -987,14 +1008,11 @@ tracker_update(tracker_t *self)
         goto cleanup;
     }
 
-    if( self->update_cb(self, data) )
-        mcebat_update_schedule();
-    else
-        dummy = true; // io succeesfull, but value did not change
+    changed = self->update_cb(self, data);
 
 cleanup:
 
-    return dummy;
+    return changed;
 }
 
 /** Open statefs file
@@ -1101,7 +1119,8 @@ tracker_start(tracker_t *self, bool *warned)
     if( !tracker_open(self, warned) )
         goto cleanup_failure;
 
-    tracker_update(self);
+    if( tracker_update(self) )
+        mcebat_update_schedule();
 
     if( !inputset_insert(self->fd, self) ) {
         tracker_close(self);
@@ -1165,6 +1184,12 @@ static guint sfsctl_start_id = 0;
 /** timeout for handling missed epoll io notifications */
 static guint sfsctl_reread_id = 0;
 
+/** Number of epoll wakeups to skip after a forced re-read */
+static guint sfsctl_reread_skip = 0;
+
+/** Number of epoll wakeups still to skip before next forced re-read */
+static guint sfsctl_reread_countdown = 0;
+
 /** Initialize dynamic data for statefs tracking objects
  */
 static void
@@ -1253,6 +1278,23 @@ cleanup:
     return;
 }
 
+/** Update values of all open statefs files
+ *
+ * @return true if any of the values changed, false otherwise
+ */
+static bool
+sfsctl_update_all(void)
+{
+    bool changed = false;
+
+    for( tracker_t *prop = sfsctl_props; prop->name; ++prop ) {
+        if( prop->fd != -1 && tracker_update(prop) )
+            changed = true;
+    }
+
+    return changed;
+}
+
 /** Handle statefs change notifications received via epoll set
  *
  * @param eve array of epoll events
@@ -1265,6 +1307,7 @@ sfsctl_watch_cb(struct epoll_event *eve, int cnt)
 {
     bool keep_going   = true;
     bool statefs_lost = false;
+    bool changed      = false;
 
     mce_log(LL_DEBUG, "process %d statefs changes", cnt);
 
@@ -1273,12 +1316,21 @@ sfsctl_watch_cb(struct epoll_event *eve, int cnt)
 
         if( eve[i].events & ~EPOLLIN )
             tracker_close(prop), statefs_lost = true;
-        else
-            tracker_update(prop);
+        else if( tracker_update(prop) )
+            changed = true;
     }
 
-    /* HACK: Force all props to be reread before datapipe updates */
-    sfsctl_schedule_reread();
+    if( changed )
+        mcebat_update_schedule();
+
+    /* HACK: Force all props to be reread before datapipe updates,
+     *       unless recent re-reads have not found anything new */
+    if( !sfsctl_reread_id ) {
+        if( sfsctl_reread_countdown > 0 )
+            --sfsctl_reread_countdown;
+        else
+            sfsctl_schedule_reread();
+    }
 
     if( statefs_lost ) {
         /* ASSUME: Loss of inputs == statefs restart */
@@ -1311,8 +1363,21 @@ sfsctl_reread_cb(gpointer aptr)
 
     mce_log(LL_DEBUG, "forced update of all states files");
 
-    for( tracker_t *prop = sfsctl_props; prop->name; ++prop )
-        tracker_update(prop);
+    if( sfsctl_update_all() ) {
+        /* Epoll missed something -> re-read after every wakeup */
+        sfsctl_reread_skip = 0;
+        mcebat_update_schedule();
+    }
+    else {
+        /* Nothing new -> skip more wakeups before next re-read */
+        sfsctl_reread_skip = MIN(sfsctl_reread_skip * 2 + 1,
+                                 REREAD_SKIP_MAX);
+    }
+
+    sfsctl_reread_countdown = sfsctl_reread_skip;
+
+    mce_log(LL_DEBUG, "skip re-read on next %u wakeups",
+            sfsctl_reread_skip);
 
 cleanup:
     return FALSE;
@@ -1325,6 +1390,9 @@ sfsctl_cancel_reread(void)
 {
     if( sfsctl_reread_id )
         g_source_remove(sfsctl_reread_id), sfsctl_reread_id = 0;
+
+    sfsctl_reread_skip      = 0;
+    sfsctl_reread_countdown = 0;
 }
 
 /** Schedule forced re-read of statefs properties
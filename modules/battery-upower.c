@@ -802,7 +802,24 @@ static void xup_properties_get_all_cb(DBusPendingCall *pc, void *aptr)
 
     mce_log(LL_INFO, "path = %s", path);
 
-    DBusMessageIter body, arr, dic, var;
+    DBusMessageIter body;
+
+    /* Only properties that are actually used are decoded and stored */
+    static const char * const keys[] = {
+        "NativePath",
+        "Percentage",
+        "State",
+    };
+
+    DBusMessageIter var[G_N_ELEMENTS(keys)];
+    unsigned        seen = 0;
+
+    const mce_dbus_prop_t props[] = {
+        { .key = keys[0], .type = DBUS_TYPE_VARIANT, .dest = &var[0] },
+        { .key = keys[1], .type = DBUS_TYPE_VARIANT, .dest = &var[1] },
+        { .key = keys[2], .type = DBUS_TYPE_VARIANT, .dest = &var[2] },
+        { .key = 0, }
+    };
 
     updev_set_invalid_all(dev);
 
@@ -818,30 +835,12 @@ static void xup_properties_get_all_cb(DBusPendingCall *pc, void *aptr)
     if( !dbus_message_iter_init(rsp, &body) )
         goto EXIT;
 
-    if( dbus_message_iter_get_arg_type(&body) != DBUS_TYPE_ARRAY )
+    if( !mce_dbus_iter_get_props(&body, props, &seen) )
         goto EXIT;
-    dbus_message_iter_recurse(&body, &arr);
-    dbus_message_iter_next(&body);
-
-    while( dbus_message_iter_get_arg_type(&arr) == DBUS_TYPE_DICT_ENTRY ) {
-        dbus_message_iter_recurse(&arr, &dic);
-        dbus_message_iter_next(&arr);
-
-        const char *key = 0;
-        if( dbus_message_iter_get_arg_type(&dic) != DBUS_TYPE_STRING )
-            goto EXIT;
-        dbus_message_iter_get_basic(&dic, &key);
-        dbus_message_iter_next(&dic);
-        if( !key )
-            goto EXIT;
-
-        if( dbus_message_iter_get_arg_type(&dic) != DBUS_TYPE_VARIANT )
-            goto EXIT;
-        dbus_message_iter_recurse(&dic, &var);
-        dbus_message_iter_next(&dic);
-
-        uprop_t *prop = updev_add_prop(dev, key);
-        uprop_set_from_iter(prop, &var);
+
+    for( size_t i = 0; i < G_N_ELEMENTS(keys); ++i ) {
+        if( seen & (1u << i) )
+            uprop_set_from_iter(updev_add_prop(dev, keys[i]), &var[i]);
     }
 
     mce_log(LL_DEBUG, "%s is %sBATTERY", path,
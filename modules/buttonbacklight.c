@@ -24,6 +24,7 @@
 #include "../mce-log.h"
 #include "../mce-dbus.h"
 #include "../mce-conf.h"
+#include "../mce-io.h"
 
 #include <unistd.h>
 #include <string.h>
@@ -135,30 +136,14 @@ static gchar *bbl_control_value_disable = 0;
  * ========================================================================= */
 
 /** Helper for writing to sysfs files
+ *
+ * The write is made in the worker thread, so that slow sysfs
+ * nodes do not block the mainloop.
  */
 static void
 bbl_write_sysfs(const char *path, const char *data)
 {
-    int fd = -1;
-
-    if( !path || !data )
-        goto EXIT;
-
-    if( (fd = TEMP_FAILURE_RETRY(open(path, O_WRONLY))) == -1 ) {
-        mce_log(LOG_ERR, "%s: %s: %m", path, "open");
-        goto EXIT;
-    }
-
-    if( TEMP_FAILURE_RETRY(write(fd, data, strlen(data))) == -1 ) {
-        mce_log(LOG_ERR, "%s: %s: %m", path, "write");
-        goto EXIT;
-    }
-
-    mce_log(LL_DEBUG, "%s << %s", path, data);
-
-EXIT:
-    if( fd != -1 )
-        TEMP_FAILURE_RETRY(close(fd));
+    mce_io_write_async(path, data);
 }
 
 /* ========================================================================= *
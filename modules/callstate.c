@@ -321,48 +321,54 @@ ofono_vcall_delete_cb(gpointer self)
     ofono_vcall_delete(self);
 }
 
-/** Update oFono voice call object from key string and variant
+/** Update oFono voice call object via property decoder
  *
- * @param self oFono voice call object
+ * Values that could be decoded are applied even if parsing
+ * fails halfway through.
+ *
+ * @param self   oFono voice call object
+ * @param iter   dbus message iterator
+ * @param decode mce_dbus_iter_get_prop() or mce_dbus_iter_get_props()
  */
 static void
-ofono_vcall_update_1(ofono_vcall_t *self, DBusMessageIter *iter)
-{
-    const char *key = 0;
-    DBusMessageIter var;
-
-    if( !mce_dbus_iter_get_string(iter, &key) )
-        goto EXIT;
+ofono_vcall_decode(ofono_vcall_t *self, DBusMessageIter *iter,
+                   bool (*decode)(DBusMessageIter *,
+                                  const mce_dbus_prop_t *, unsigned *))
+{
+    bool        emergency = false;
+    const char *state     = 0;
+    unsigned    seen      = 0;
+
+    const mce_dbus_prop_t props[] = {
+        { .key = "Emergency", .type = DBUS_TYPE_BOOLEAN, .dest = &emergency },
+        { .key = "State",     .type = DBUS_TYPE_STRING,  .dest = &state     },
+        { .key = 0, }
+    };
 
-    if( !mce_dbus_iter_get_variant(iter, &var) )
-        goto EXIT;
+    decode(iter, props, &seen);
 
-    if( !strcmp(key, "Emergency") ) {
-        bool emergency = false;
-        if( !mce_dbus_iter_get_bool(&var, &emergency) )
-            goto EXIT;
+    if( seen & (1u << 0) ) {
         self->type = ofono_calltype_to_mce(emergency);
-
-        mce_log(LL_DEBUG, "* %s = ofono:%s -> mce:%s", key,
+        mce_log(LL_DEBUG, "* %s = ofono:%s -> mce:%s", "Emergency",
                 emergency ? "true" : "false",
                 call_type_repr(self->type));
     }
-    else if( !strcmp(key, "State") ) {
-        const char *str = 0;
-        if( !mce_dbus_iter_get_string(&var, &str) )
-            goto EXIT;
-        self->state = ofono_callstate_to_mce(str);
-        mce_log(LL_DEBUG, "* %s = ofono:%s -> mce:%s", key,str,
+
+    if( seen & (1u << 1) ) {
+        self->state = ofono_callstate_to_mce(state);
+        mce_log(LL_DEBUG, "* %s = ofono:%s -> mce:%s", "State", state,
                 call_state_repr(self->state));
     }
-#if 0
-    else {
-        mce_log(LL_DEBUG, "* %s = %s", key, "...");
-    }
-#endif
+}
 
-EXIT:
-    return;
+/** Update oFono voice call object from key string and variant
+ *
+ * @param self oFono voice call object
+ */
+static void
+ofono_vcall_update_1(ofono_vcall_t *self, DBusMessageIter *iter)
+{
+    ofono_vcall_decode(self, iter, mce_dbus_iter_get_prop);
 }
 
 /** Update oFono voice call object from array of dict entries
@@ -372,23 +378,11 @@ EXIT:
 static void
 ofono_vcall_update_N(ofono_vcall_t *self, DBusMessageIter *iter)
 {
-    DBusMessageIter arr2, dict;
-
     // <arg name="properties" type="a{sv}"/>
 
     self->probed = true;
 
-    if( !mce_dbus_iter_get_array(iter, &arr2) )
-        goto EXIT;
-
-    while( !mce_dbus_iter_at_end(&arr2) ) {
-        if( !mce_dbus_iter_get_entry(&arr2, &dict) )
-            goto EXIT;
-
-        ofono_vcall_update_1(self, &dict);
-    }
-EXIT:
-    return;
+    ofono_vcall_decode(self, iter, mce_dbus_iter_get_props);
 }
 
 /* ========================================================================= *
@@ -556,33 +550,42 @@ ofono_modem_delete_cb(gpointer self)
     ofono_modem_delete(self);
 }
 
-/** Update oFono modem tracking object from key + variant data
+/** Update oFono modem tracking object via property decoder
  *
- * @param self object pointer
- * @param iter dbus message iterator pointing to key string + variant data
+ * Values that could be decoded are applied even if parsing
+ * fails halfway through.
+ *
+ * @param self   object pointer
+ * @param iter   dbus message iterator
+ * @param decode mce_dbus_iter_get_prop() or mce_dbus_iter_get_props()
  */
 static void
-ofono_modem_update_1(ofono_modem_t *self, DBusMessageIter *iter)
-{
-    const char *key = 0;
-    DBusMessageIter var;
+ofono_modem_decode(ofono_modem_t *self, DBusMessageIter *iter,
+                   bool (*decode)(DBusMessageIter *,
+                                  const mce_dbus_prop_t *, unsigned *))
+{
+    bool            emergency = false;
+    DBusMessageIter ifaces;
+    unsigned        seen      = 0;
+
+    const mce_dbus_prop_t props[] = {
+        { .key = "Emergency",  .type = DBUS_TYPE_BOOLEAN, .dest = &emergency },
+        { .key = "Interfaces", .type = DBUS_TYPE_VARIANT, .dest = &ifaces    },
+        { .key = 0, }
+    };
 
-    if( !mce_dbus_iter_get_string(iter, &key) )
-        goto EXIT;
+    decode(iter, props, &seen);
 
-    if( !mce_dbus_iter_get_variant(iter, &var) )
-        goto EXIT;
-
-    if( !strcmp(key, "Emergency") ) {
-        if( !mce_dbus_iter_get_bool(&var, &self->emergency) )
-            goto EXIT;
-        mce_log(LL_DEBUG, "* %s = %s", key,
+    if( seen & (1u << 0) ) {
+        self->emergency = emergency;
+        mce_log(LL_DEBUG, "* %s = %s", "Emergency",
                 self->emergency ? "true" : "false");
     }
-    else if( !strcmp(key, "Interfaces") ) {
+
+    if( seen & (1u << 1) ) {
         DBusMessageIter arr;
 
-        if( !mce_dbus_iter_get_array(&var, &arr) )
+        if( !mce_dbus_iter_get_array(&ifaces, &arr) )
             goto EXIT;
 
         bool vcalls_iface = false;
@@ -610,15 +613,22 @@ ofono_modem_update_1(ofono_modem_t *self, DBusMessageIter *iter)
 
         }
     }
-#if 0
-    else {
-        mce_log(LL_DEBUG, "* %s = %s", key, "...");
-    }
-#endif
+
 EXIT:
     return;
 }
 
+/** Update oFono modem tracking object from key + variant data
+ *
+ * @param self object pointer
+ * @param iter dbus message iterator pointing to key string + variant data
+ */
+static void
+ofono_modem_update_1(ofono_modem_t *self, DBusMessageIter *iter)
+{
+    ofono_modem_decode(self, iter, mce_dbus_iter_get_prop);
+}
+
 /** Update oFono modem tracking object from array of dict entries
  *
  * @param self object pointer
@@ -627,22 +637,11 @@ EXIT:
 static void
 ofono_modem_update_N(ofono_modem_t *self, DBusMessageIter *iter)
 {
-    DBusMessageIter arr2, dict;
-
     self->probed = true;
 
     // <arg name="properties" type="a{sv}"/>
 
-    if( !mce_dbus_iter_get_array(iter, &arr2) )
-        goto EXIT;
-
-    while( !mce_dbus_iter_at_end(&arr2) ) {
-        if( !mce_dbus_iter_get_entry(&arr2, &dict) )
-            goto EXIT;
-        ofono_modem_update_1(self, &dict);
-    }
-EXIT:
-    return;
+    ofono_modem_decode(self, iter, mce_dbus_iter_get_props);
 }
 
 /** Get voice calls for a modem
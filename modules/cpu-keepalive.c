@@ -28,6 +28,7 @@
 #include "../mce-log.h"
 #include "../mce-lib.h"
 #include "../mce-dbus.h"
+#include "../mce-timerheap.h"
 
 #ifdef ENABLE_WAKELOCKS
 # include "../libwakelock.h"
@@ -156,8 +157,14 @@ struct cka_session_t
 
   /** Has the session been finished */
   bool          ses_finished;
+
+  /** Position in session expiry heap, ordered by ses_timeout */
+  mce_timernode_t ses_expiry;
 };
 
+/** Unfinished sessions of all clients, ordered by timeout */
+static mce_timerheap_t cka_session_heap = MCE_TIMERHEAP_INIT;
+
 static cka_session_t *cka_session_create   (cka_client_t *client, const char *session);
 static void           cka_session_renew    (cka_session_t *self, tick_t timeout);
 static void           cka_session_finish   (cka_session_t *self, tick_t now);
@@ -177,11 +184,23 @@ struct cka_client_t
   /** NameOwnerChanged signal match used for tracking death of client */
   char       *cli_match_rule;
 
-  /** Upper bound for reneval of cpu keepalive for this client */
-  tick_t      cli_timeout;
-
   /** One client can have several keepalive objects */
   GHashTable *cli_sessions; // [string] -> cka_session_t *
+
+  /** Number of unfinished sessions */
+  unsigned    cli_active;
+
+  /** When the 1st of currently unfinished sessions was started */
+  tick_t      cli_held_since;
+
+  /** Accumulated time with at least one unfinished session [ms] */
+  tick_t      cli_held_ms;
+
+  /** Number of sessions started */
+  unsigned    cli_session_count;
+
+  /** Number of session renewals */
+  unsigned    cli_renew_count;
 };
 
 /** Format string for constructing name owner lost match rules */
@@ -197,7 +216,8 @@ static const char cka_client_match_fmt[] =
 
 static cka_session_t *cka_client_get_session   (cka_client_t *self, const char *session_id);
 static cka_session_t *cka_client_add_session   (cka_client_t *self, const char *session_id);
-static void           cka_client_scan_timeout  (cka_client_t *self);
+static void           cka_client_hold          (cka_client_t *self, tick_t now);
+static void           cka_client_release       (cka_client_t *self, tick_t now);
 static void           cka_client_remove_timeout(cka_client_t *self, const char *session_id);
 static void           cka_client_update_timeout(cka_client_t *self, const char *session_id, tick_t when);
 static cka_client_t  *cka_client_create        (const char *dbus_name);
@@ -210,12 +230,38 @@ static void           cka_client_delete_cb     (void *self);
  * KEEPALIVE_STATE
  * ------------------------------------------------------------------------- */
 
-/** Timer for releasing cpu-keepalive wakelock */
+/** Timer for expiring sessions / releasing cpu-keepalive wakelock */
 static guint    cka_state_timer_id = 0;
 
+/** When cka_state_timer_id is due to trigger */
+static tick_t   cka_state_timer_tick = MCE_TIMERHEAP_NO_TICK;
+
+/** Keepalive statistics */
+static struct
+{
+  /** Number of sessions started */
+  dbus_int64_t  sessions;
+
+  /** Number of session renewals */
+  dbus_int64_t  renewals;
+
+  /** Number of sessions ended due to timeout */
+  dbus_int64_t  expired;
+
+  /** Number of times the keepalive wakelock was acquired */
+  dbus_int64_t  activations;
+
+  /** Accumulated time the keepalive wakelock was held [ms] */
+  dbus_int64_t  held_ms;
+
+  /** Number of session expiry timer wakeups */
+  dbus_int64_t  wakeups;
+} cka_state_stats;
+
 static void     cka_state_set       (bool active);
 static gboolean cka_state_timer_cb  (gpointer data);
 static void     cka_state_reset     (void);
+static void     cka_state_expire    (tick_t now);
 static void     cka_state_rethink   (void);
 
 /* ------------------------------------------------------------------------- *
@@ -258,6 +304,7 @@ static gboolean           cka_dbus_handle_period_cb  (DBusMessage *const msg);
 static gboolean           cka_dbus_handle_start_cb   (DBusMessage *const msg);
 static gboolean           cka_dbus_handle_stop_cb    (DBusMessage *const msg);
 static gboolean           cka_dbus_handle_wakeup_cb  (DBusMessage *const msg);
+static gboolean           cka_dbus_handle_stats_cb   (DBusMessage *const msg);
 
 static DBusHandlerResult  cka_dbus_filter_message_cb (DBusConnection *con, DBusMessage *msg, void *user_data);
 
@@ -468,6 +515,11 @@ cka_session_create(cka_client_t *client, const char *session_id)
   self->ses_flagged  = false;
   self->ses_finished = false;
 
+  mce_timernode_init(&self->ses_expiry, self);
+
+  cka_client_hold(client, self->ses_started);
+  cka_state_stats.sessions += 1;
+
   mce_log(LL_DEVEL, "session created; id=%u/%s %s",
           self->ses_unique, self->ses_session,
           cka_client_identify(self->ses_client));
@@ -487,6 +539,11 @@ cka_session_renew(cka_session_t *self, tick_t timeout)
   self->ses_timeout  = timeout;
   self->ses_renewed += 1;
 
+  mce_timerheap_schedule(&cka_session_heap, &self->ses_expiry, timeout);
+
+  self->ses_client->cli_renew_count += 1;
+  cka_state_stats.renewals += 1;
+
   tick_t now = cka_tick_get_current();
   tick_t dur = now - self->ses_started;
 
@@ -516,6 +573,11 @@ static
 void
 cka_session_finish(cka_session_t *self, tick_t now)
 {
+  if( self->ses_finished )
+  {
+    goto EXIT;
+  }
+
   tick_t dur = now - self->ses_started;
 
   if( dur > KEEPALIVE_SESSION_WARN_LIMIT_MS )
@@ -532,6 +594,12 @@ cka_session_finish(cka_session_t *self, tick_t now)
   }
 
   self->ses_finished = true;
+
+  mce_timerheap_remove(&cka_session_heap, &self->ses_expiry);
+  cka_client_release(self->ses_client, now);
+
+EXIT:
+  return;
 }
 
 /** Delete bookkeeping information for a keepalive session
@@ -551,6 +619,8 @@ cka_session_delete(cka_session_t *self)
           self->ses_unique, self->ses_session,
           cka_client_identify(self->ses_client));
 
+  cka_session_finish(self, cka_tick_get_current());
+
   g_free(self->ses_session);
   g_free(self);
 
@@ -613,45 +683,35 @@ cka_client_add_session(cka_client_t *self, const char *session_id)
   return session;
 }
 
-/** Update client timeout to be maximum of context timeouts
+/** Account start of a client session
  *
- * @param self pointer to cka_client_t structure
+ * @param self  pointer to cka_client_t structure
+ * @param now   current time
  */
 static
 void
-cka_client_scan_timeout(cka_client_t *self)
+cka_client_hold(cka_client_t *self, tick_t now)
 {
-  tick_t now  = cka_tick_get_current();
-
-  self->cli_timeout = 0;
-
-  /* Expire sessions / update client timeout */
-  GHashTableIter iter;
-  gpointer       val;
-
-  g_hash_table_iter_init(&iter, self->cli_sessions);
-  while( g_hash_table_iter_next(&iter, 0, &val) )
+  if( self->cli_active++ == 0 )
   {
-    cka_session_t *session = val;
-
-    if( session->ses_timeout <= now )
-    {
-      /* Expire session */
-      cka_session_finish(session, now);
-      g_hash_table_iter_remove(&iter);
-    }
-    else if( self->cli_timeout < session->ses_timeout )
-    {
-      /* Update client timeout */
-      self->cli_timeout = session->ses_timeout;
-    }
+    self->cli_held_since = now;
   }
 
-  if( self->cli_timeout > now )
+  self->cli_session_count += 1;
+}
+
+/** Account end of a client session
+ *
+ * @param self  pointer to cka_client_t structure
+ * @param now   current time
+ */
+static
+void
+cka_client_release(cka_client_t *self, tick_t now)
+{
+  if( self->cli_active > 0 && --self->cli_active == 0 )
   {
-    mce_log(LL_DEBUG, "client T%+"PRId64"; %s",
-            now - self->cli_timeout,
-            cka_client_identify(self));
+    self->cli_held_ms += now - self->cli_held_since;
   }
 }
 
@@ -724,7 +784,12 @@ cka_client_create(const char *dbus_name)
   self->cli_dbus_name  = g_strdup(dbus_name);
   self->cli_match_rule = g_strdup_printf(cka_client_match_fmt,
                                          self->cli_dbus_name);
-  self->cli_timeout    = 0;
+
+  self->cli_active        = 0;
+  self->cli_held_since    = 0;
+  self->cli_held_ms       = 0;
+  self->cli_session_count = 0;
+  self->cli_renew_count   = 0;
 
   self->cli_sessions   = g_hash_table_new_full(g_str_hash, g_str_equal,
                                                g_free, cka_session_delete_cb);
@@ -767,6 +832,11 @@ cka_client_delete(cka_client_t *self)
       cka_session_finish(session, now);
     }
 
+    mce_log(LL_DEVEL, "client held keepalive %"PRId64" ms; "
+            "sessions=%u renewals=%u; %s",
+            self->cli_held_ms, self->cli_session_count,
+            self->cli_renew_count, cka_client_identify(self));
+
     /* NULL error -> match will be removed asynchronously */
     dbus_bus_remove_match(cka_dbus_systembus, self->cli_match_rule, 0);
 
@@ -815,12 +885,15 @@ static void cka_state_set(bool active)
       wakelock_lock(cpu_wakelock, -1);
 #endif
       started = now;
+      cka_state_stats.activations += 1;
       mce_log(LL_DEVEL, "keepalive started");
     }
     else
     {
       tick_t dur = now - started;
 
+      cka_state_stats.held_ms += dur;
+
       if( dur > KEEPALIVE_STATE_WARN_LIMIT_MS )
       {
         mce_log(LL_CRIT, "long keepalive stopped after %"PRId64" ms", dur);
@@ -867,8 +940,10 @@ cka_state_timer_cb(gpointer data)
   {
     mce_log(LL_DEBUG, "cpu-keepalive timeout triggered");
     cka_state_timer_id = 0;
+    cka_state_timer_tick = MCE_TIMERHEAP_NO_TICK;
+    cka_state_stats.wakeups += 1;
 
-    /* Do full rethink to expire client sessions */
+    /* Expire client sessions and reprogram the timer */
     cka_state_rethink();
   }
 
@@ -886,14 +961,42 @@ cka_state_reset(void)
     mce_log(LL_DEBUG, "cpu-keepalive timeout canceled");
     g_source_remove(cka_state_timer_id), cka_state_timer_id = 0;
   }
+  cka_state_timer_tick = MCE_TIMERHEAP_NO_TICK;
 
   cka_state_set(false);
 }
 
+/** Finish client sessions that have timed out
+ *
+ * Only sessions that actually have expired are visited.
+ *
+ * @param now  current time
+ */
+static
+void
+cka_state_expire(tick_t now)
+{
+  mce_timernode_t *node;
+
+  while( (node = mce_timerheap_pop_expired(&cka_session_heap, now)) )
+  {
+    cka_session_t *session = node->tmn_owner;
+    cka_client_t  *client  = session->ses_client;
+
+    cka_state_stats.expired += 1;
+
+    /* Deletes the session object too */
+    cka_session_finish(session, now);
+    g_hash_table_remove(client->cli_sessions, session->ses_session);
+  }
+}
+
 /** Re-evaluate the end of cpu-keepalive period
  *
- * Calculates maximum of wakeup period and per client renew periods
- * and uses it to reprogram the end of cpu-keepalive period
+ * Expires timed out sessions and programs a single timer for the
+ * earliest of remaining session timeouts and the wakeup period.
+ * Cpu-keepalive is active as long as there are unfinished sessions
+ * or the wakeup period is in progress.
  */
 static
 void
@@ -901,47 +1004,35 @@ cka_state_rethink(void)
 {
   tick_t now = cka_tick_get_current();
 
-  /* Find furthest away client renew timeout */
-  tick_t maxtime = cka_clients_wakeup_timeout;
+  cka_state_expire(now);
 
-  GHashTableIter iter;
-  gpointer       val;
+  /* Earliest pending session timeout */
+  tick_t wakeup = mce_timerheap_next_trigger(&cka_session_heap);
 
-  g_hash_table_iter_init(&iter, cka_clients_lut);
-  while( g_hash_table_iter_next(&iter, 0, &val) )
+  if( now < cka_clients_wakeup_timeout && cka_clients_wakeup_timeout < wakeup )
   {
-    cka_client_t *client = val;
-
-    cka_client_scan_timeout(client);
-
-    if( maxtime < client->cli_timeout )
-    {
-      maxtime = client->cli_timeout;
-    }
+    wakeup = cka_clients_wakeup_timeout;
   }
 
-  /* Remove existing timer */
-  if( cka_state_timer_id != 0 )
+  /* Reprogram timer only if the wakeup time changes */
+  if( cka_state_timer_tick != wakeup )
   {
-    g_source_remove(cka_state_timer_id), cka_state_timer_id = 0;
-  }
+    if( cka_state_timer_id != 0 )
+    {
+      g_source_remove(cka_state_timer_id), cka_state_timer_id = 0;
+    }
 
-  /* If needed, program timer */
-  static tick_t oldtime = 0;
+    cka_state_timer_tick = wakeup;
 
-  if( now < maxtime )
-  {
-    if( maxtime != oldtime )
+    if( wakeup != MCE_TIMERHEAP_NO_TICK )
     {
       mce_log(LL_DEBUG, "cpu-keepalive timeout at T%+"PRId64"",
-              now - maxtime);
+              now - wakeup);
+      cka_state_timer_id = g_timeout_add(wakeup - now,
+                                         cka_state_timer_cb, 0);
     }
-    cka_state_timer_id = g_timeout_add(maxtime - now,
-                             cka_state_timer_cb, 0);
   }
 
-  oldtime = maxtime;
-
   cka_state_set(cka_state_timer_id != 0);
 }
 
@@ -1222,6 +1313,19 @@ static void cka_clients_quit(void)
   {
     g_hash_table_unref(cka_clients_lut), cka_clients_lut = 0;
   }
+
+  /* Sessions remove themselves from the heap when deleted */
+  mce_timerheap_clear(&cka_session_heap);
+
+  mce_log(LL_DEBUG, "keepalive sessions=%"PRId64" renewals=%"PRId64
+          " expired=%"PRId64" activations=%"PRId64" held=%"PRId64" ms"
+          " wakeups=%"PRId64,
+          (int64_t)cka_state_stats.sessions,
+          (int64_t)cka_state_stats.renewals,
+          (int64_t)cka_state_stats.expired,
+          (int64_t)cka_state_stats.activations,
+          (int64_t)cka_state_stats.held_ms,
+          (int64_t)cka_state_stats.wakeups);
 }
 
 /* ========================================================================= *
@@ -1482,6 +1586,53 @@ EXIT:
   return res;
 }
 
+/** D-Bus callback for the MCE_CPU_KEEPALIVE_STATS_GET method call
+ *
+ * @param msg  The D-Bus message
+ *
+ * @return TRUE
+ */
+static
+gboolean
+cka_dbus_handle_stats_cb(DBusMessage *const msg)
+{
+  DBusMessage *rsp = 0;
+
+  mce_log(LL_DEVEL, "keepalive stats request from %s",
+          mce_dbus_get_message_sender_ident(msg));
+
+  if( dbus_message_get_no_reply(msg) )
+  {
+    goto EXIT;
+  }
+
+  dbus_int64_t clients = g_hash_table_size(cka_clients_lut);
+  dbus_int64_t active  = mce_timerheap_count(&cka_session_heap);
+
+  rsp = dbus_new_method_reply(msg);
+
+  if( !dbus_message_append_args(rsp,
+                                DBUS_TYPE_INT64, &cka_state_stats.sessions,
+                                DBUS_TYPE_INT64, &cka_state_stats.renewals,
+                                DBUS_TYPE_INT64, &cka_state_stats.expired,
+                                DBUS_TYPE_INT64, &cka_state_stats.activations,
+                                DBUS_TYPE_INT64, &cka_state_stats.held_ms,
+                                DBUS_TYPE_INT64, &cka_state_stats.wakeups,
+                                DBUS_TYPE_INT64, &clients,
+                                DBUS_TYPE_INT64, &active,
+                                DBUS_TYPE_INVALID) )
+  {
+    goto EXIT;
+  }
+
+  dbus_send_message(rsp), rsp = 0;
+
+EXIT:
+  if( rsp ) dbus_message_unref(rsp);
+
+  return TRUE;
+}
+
 /** Array of dbus message handlers */
 static mce_dbus_handler_t cka_dbus_handlers[] =
 {
@@ -1521,6 +1672,21 @@ static mce_dbus_handler_t cka_dbus_handlers[] =
     .args      =
       "    <arg direction=\"out\" name=\"success\" type=\"b\"/>\n"
   },
+  {
+    .interface = MCE_REQUEST_IF,
+    .name      = MCE_CPU_KEEPALIVE_STATS_GET,
+    .type      = DBUS_MESSAGE_TYPE_METHOD_CALL,
+    .callback  = cka_dbus_handle_stats_cb,
+    .args      =
+      "    <arg direction=\"out\" name=\"sessions\" type=\"x\"/>\n"
+      "    <arg direction=\"out\" name=\"renewals\" type=\"x\"/>\n"
+      "    <arg direction=\"out\" name=\"expired\" type=\"x\"/>\n"
+      "    <arg direction=\"out\" name=\"activations\" type=\"x\"/>\n"
+      "    <arg direction=\"out\" name=\"held_ms\" type=\"x\"/>\n"
+      "    <arg direction=\"out\" name=\"wakeups\" type=\"x\"/>\n"
+      "    <arg direction=\"out\" name=\"clients\" type=\"x\"/>\n"
+      "    <arg direction=\"out\" name=\"active_sessions\" type=\"x\"/>\n"
+  },
   /* sentinel */
   {
     .interface = 0
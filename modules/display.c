@@ -31,6 +31,7 @@
 #include "../mce-setting.h"
 #include "../mce-dbus.h"
 #include "../mce-sensorfw.h"
+#include "../mce-wakelock.h"
 #include "../tklock.h"
 
 #ifdef ENABLE_HYBRIS
@@ -54,8 +55,11 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <glob.h>
+#include <sys/mman.h>
 #include <pthread.h>
 
+#include <linux/input.h>
+
 #include <mce/dbus-names.h>
 #include <mce/mode-names.h>
 
@@ -99,7 +103,21 @@
 #define MCE_FADER_DURATION_UI_MAX 5000
 
 /** How long to delay entering late suspend after powering down display */
-#define MCE_DISPLAY_STM_SUSPEND_DELAY_NS (5LL * 1000LL * 1000LL * 1000LL)
+#define MCE_DISPLAY_STM_SUSPEND_DELAY_MS 5000
+
+/** Maximum duration of cpu boost triggered by input while display is off */
+#define MDY_GOVERNOR_BOOST_TIMEOUT_MS 3000
+
+/** How long cpu boost is kept after display has been powered up */
+#define MDY_GOVERNOR_BOOST_LINGER_MS 500
+
+/** How long speculative frame buffer resume is kept without display
+ *  power up request before rolling it back [ms] */
+#define MDY_SPECRESUME_TIMEOUT_MS 1000
+
+/** How much compositor watchdog and retry timers can be delayed
+ *  in order to share wakeups with other timers [ms] */
+#define MDY_TIMER_SLACK_MS 1000
 
 /** Placeholder value for unknown compositor pid */
 #define COMPOSITOR_STM_INVALID_PID (-1)
@@ -410,6 +428,7 @@ static void                mdy_datapipe_call_state_trigger_cb(gconstpointer data
 static void                mdy_datapipe_device_inactive_cb(gconstpointer data);
 static void                mdy_datapipe_orientation_sensor_actual_cb(gconstpointer data);
 static void                mdy_datapipe_shutting_down_cb(gconstpointer aptr);
+static void                mdy_datapipe_cpu_boost_event_cb(gconstpointer aptr);
 
 static void                mdy_datapipe_init(void);
 static void                mdy_datapipe_quit(void);
@@ -776,6 +795,27 @@ static void                mdy_fbsusp_led_start_timer(mdy_fbsusp_led_state_t req
  * DISPLAY_STATE_MACHINE
  * ------------------------------------------------------------------------- */
 
+/** Unblank steps that are timed separately */
+typedef enum
+{
+    /** Exit from early suspend / autosleep */
+    MDY_UNBLANK_STEP_AUTOSUSPEND,
+
+    /** Frame buffer power up ioctl */
+    MDY_UNBLANK_STEP_FBDEV,
+
+    /** Frame buffer resumed */
+    MDY_UNBLANK_STEP_FB_RESUME,
+
+    /** Compositor has enabled updates */
+    MDY_UNBLANK_STEP_COMPOSITOR,
+
+    /** Brightness fade has finished */
+    MDY_UNBLANK_STEP_FADE,
+
+    MDY_UNBLANK_STEP_COUNT
+} mdy_unblank_step_t;
+
 // human readable state names
 static const char         *mdy_stm_state_name(stm_state_t state);
 
@@ -812,6 +852,15 @@ static bool                mdy_stm_is_fb_resume_finished(void);
 static void                mdy_stm_release_wakelock(void);
 static void                mdy_stm_acquire_wakelock(void);
 
+// unblank step timing
+static void                mdy_stm_unblank_begin(void);
+static void                mdy_stm_unblank_step_done(mdy_unblank_step_t step);
+static void                mdy_stm_unblank_end(bool report);
+
+// blank timing
+static void                mdy_stm_blank_begin(void);
+static void                mdy_stm_blank_end(void);
+
 // display state changing
 static void                mdy_stm_push_target_change(display_state_t next_state);
 static bool                mdy_stm_pull_target_change(void);
@@ -828,11 +877,34 @@ static void                mdy_stm_cancel_rethink(void);
 static void                mdy_stm_schedule_rethink(void);
 static void                mdy_stm_force_rethink(void);
 
+/* ------------------------------------------------------------------------- *
+ * SPECULATIVE_RESUME
+ * ------------------------------------------------------------------------- */
+
+static const char         *mdy_specresume_source_repr(int source);
+static int                 mdy_specresume_source_index(int source);
+static bool                mdy_specresume_is_active(void);
+static gboolean            mdy_specresume_timer_cb(gpointer aptr);
+static void                mdy_specresume_start(int source);
+static void                mdy_specresume_resolve(bool hit);
+static void                mdy_specresume_quit(void);
+
 /* ------------------------------------------------------------------------- *
  * DISPLAY_STATE_STATISTICS
  * ------------------------------------------------------------------------- */
 
+static void                mdy_statistics_begin_write(void);
+static void                mdy_statistics_end_write(void);
 static void                mdy_statistics_update(void);
+static void                mdy_statistics_fade_begin(fader_type_t type);
+static void                mdy_statistics_fade_end(void);
+static bool                mdy_statistics_fading(void);
+static void                mdy_statistics_add_latency(int64_t *histogram, int64_t ms);
+static void                mdy_statistics_unblank_latency(int64_t ms);
+static void                mdy_statistics_blank_latency(int64_t ms);
+static void                mdy_statistics_als_change(void);
+static void                mdy_statistics_init(void);
+static void                mdy_statistics_quit(void);
 
 /* ------------------------------------------------------------------------- *
  * CPU_SCALING_GOVERNOR
@@ -842,8 +914,14 @@ static governor_setting_t *mdy_governor_get_settings(const char *tag);
 static void                mdy_governor_free_settings(governor_setting_t *settings);
 static bool                mdy_governor_write_data(const char *path, const char *data);
 static void                mdy_governor_apply_setting(const governor_setting_t *setting);
+static void                mdy_governor_apply_settings(const governor_setting_t *settings);
+static void               *mdy_governor_set_state_exec_cb(void *aptr);
 static void                mdy_governor_set_state(int state);
 static void                mdy_governor_rethink(void);
+static gboolean            mdy_governor_boost_timer_cb(gpointer aptr);
+static void                mdy_governor_boost_start(int duration_ms);
+static void                mdy_governor_boost_linger(void);
+static void                mdy_governor_boost_stop(void);
 static void                mdy_governor_setting_cb(GConfClient *const client, const guint id, GConfEntry *const entry, gpointer const data);
 
 /* ------------------------------------------------------------------------- *
@@ -881,6 +959,8 @@ static gboolean            mdy_dbus_handle_cabc_mode_set_req(DBusMessage *const
 static gboolean            mdy_dbus_handle_blanking_pause_start_req(DBusMessage *const msg);
 static gboolean            mdy_dbus_handle_blanking_pause_cancel_req(DBusMessage *const msg);
 static gboolean            mdy_dbus_handle_display_stats_get_req(DBusMessage *const req);
+static bool                mdy_dbus_append_stats_entry(DBusMessageIter *array, const char *key, int64_t value);
+static gboolean            mdy_dbus_handle_display_stats_extended_get_req(DBusMessage *const req);
 
 static gboolean            mdy_dbus_handle_desktop_started_sig(DBusMessage *const msg);
 static gboolean            mdy_dbus_timed_wakeup_sig(DBusMessage *const msg);
@@ -1682,6 +1762,12 @@ static void mdy_datapipe_display_state_curr_cb(gconstpointer data)
     mdy_blanking_pause_evaluate_allowed();
     mdy_blanking_inhibit_schedule_broadcast();
 
+#ifdef ENABLE_CPU_GOVERNOR
+    /* Display is up -> end input boost soon */
+    if( display_state_curr == MCE_DISPLAY_ON )
+        mdy_governor_boost_linger();
+#endif
+
 EXIT:
     return;
 }
@@ -1972,6 +2058,10 @@ static void mdy_datapipe_proximity_sensor_actual_cb(gconstpointer data)
     mce_log(LL_DEBUG, "proximity_sensor_actual = %s",
             proximity_state_repr(proximity_sensor_actual));
 
+    /* Uncovering is likely to be followed by display power up */
+    if( prev == COVER_CLOSED && proximity_sensor_actual == COVER_OPEN )
+        mdy_specresume_start(MCE_SPECULATIVE_RESUME_PROXIMITY);
+
     /* handle toggling between LPM_ON and LPM_OFF */
     mdy_blanking_rethink_proximity();
 
@@ -2168,6 +2258,26 @@ EXIT:
     return;
 }
 
+/** Handle cpu_boost_event_pipe notifications
+ *
+ * @param aptr input event that is likely to turn display on
+ */
+static void mdy_datapipe_cpu_boost_event_cb(gconstpointer aptr)
+{
+    const struct input_event *ev = aptr;
+
+    /* Power key down: resume frame buffer while powerkey.c decides
+     * what the press actually means */
+    if( ev && ev->type == EV_KEY && ev->code == KEY_POWER && ev->value == 1 )
+        mdy_specresume_start(MCE_SPECULATIVE_RESUME_POWERKEY);
+
+#ifdef ENABLE_CPU_GOVERNOR
+    /* Boost is meant for speeding up display power up */
+    if( display_state_curr != MCE_DISPLAY_ON )
+        mdy_governor_boost_start(MDY_GOVERNOR_BOOST_TIMEOUT_MS);
+#endif
+}
+
 /** Array of datapipe handlers */
 static datapipe_handler_t mdy_datapipe_handlers[] =
 {
@@ -2283,6 +2393,10 @@ static datapipe_handler_t mdy_datapipe_handlers[] =
         .datapipe  = &shutting_down_pipe,
         .output_cb = mdy_datapipe_shutting_down_cb,
     },
+    {
+        .datapipe  = &cpu_boost_event_pipe,
+        .output_cb = mdy_datapipe_cpu_boost_event_cb,
+    },
     // sentinel
     {
         .datapipe = 0,
@@ -2676,6 +2790,11 @@ static void mdy_brightness_set_level(int number)
     if( mdy_brightness_level_cached != number ) {
         mdy_brightness_level_cached = number;
         mdy_brightness_set_level_hook(number);
+
+        /* Account time spent at the previous level; during fades
+         * this is done only when the fade ends */
+        if( !mdy_statistics_fading() )
+            mdy_statistics_update();
     }
 
     // TODO: we might want to power off fb at zero brightness
@@ -2896,6 +3015,8 @@ static void mdy_brightness_cleanup_fade_timer(void)
         g_source_remove(mdy_brightness_fade_timer_id),
         mdy_brightness_fade_timer_id = 0;
 
+    mdy_statistics_fade_end();
+
     /* Clear ongoing fade type */
     mdy_brightness_fade_type = FADER_IDLE;
 
@@ -2927,11 +3048,17 @@ static void mdy_brightness_start_fade_timer(fader_type_t type,
     if( !mdy_brightness_fade_timer_id ) {
         mce_log(LL_DEBUG, "fader started");
         mdy_brightness_set_priority_boost(true);
+        mdy_statistics_fade_begin(type);
     }
     else {
         mce_log(LL_DEBUG, "fader restarted");
         g_source_remove(mdy_brightness_fade_timer_id),
             mdy_brightness_fade_timer_id = 0;
+
+        if( mdy_brightness_fade_type != type ) {
+            mdy_statistics_fade_end();
+            mdy_statistics_fade_begin(type);
+        }
     }
 
     /* Setup new timeout */
@@ -3177,6 +3304,10 @@ static void mdy_brightness_set_fade_target_als(gint new_brightness)
     mce_log(LL_DEBUG, "resume level: %d -> %d",
             mdy_brightness_level_display_resume,
             new_brightness);
+
+    if( mdy_brightness_level_display_resume != new_brightness )
+        mdy_statistics_als_change();
+
     mdy_brightness_level_display_resume = new_brightness;
 
     /* If currently unblanking, just adjust the target level */
@@ -3954,7 +4085,7 @@ static gboolean mdy_blanking_off_cb(gpointer data)
 
     /* Remove wakelock unless the timer got re-programmed */
     if( !mdy_blanking_off_cb_id  )
-        wakelock_unlock("mce_lpm_off");
+        mce_wakelock_release("mce_lpm_off");
 EXIT:
 
     return FALSE;
@@ -3974,7 +4105,7 @@ static void mdy_blanking_cancel_off(void)
         mdy_blanking_inhibit_schedule_broadcast();
 
         /* unlock on cancellation */
-        wakelock_unlock("mce_lpm_off");
+        mce_wakelock_release("mce_lpm_off");
     }
 }
 
@@ -4032,7 +4163,7 @@ static void mdy_blanking_schedule_off(void)
         mce_log(LL_DEBUG, "BLANK timer rescheduled @ %d secs", timeout);
     }
     else {
-        wakelock_lock("mce_lpm_off", -1);
+        mce_wakelock_obtain("mce_lpm_off", -1);
         mce_log(LL_DEBUG, "BLANK timer scheduled @ %d secs", timeout);
     }
 
@@ -6322,9 +6453,10 @@ compositor_stm_schedule_panic(compositor_stm_t *self)
 
     mce_log(LL_DEBUG, "schedule panic led");
 
-    self->csi_panic_timer_id = g_timeout_add(self->csi_panic_delay,
-                                             compositor_stm_panic_timer_cb,
-                                             self);
+    self->csi_panic_timer_id = mce_slack_timeout_add(self->csi_panic_delay,
+                                                     MDY_TIMER_SLACK_MS,
+                                                     compositor_stm_panic_timer_cb,
+                                                     self);
 
 EXIT:
     return;
@@ -6395,8 +6527,10 @@ compositor_stm_schedule_retry(compositor_stm_t *self)
 
     mce_log(LL_DEBUG, "schedule ipc retry");
 
-    self->csi_retry_timer_id = g_timeout_add(self->csi_retry_delay,
-                                             compositor_stm_retry_timer_cb, self);
+    self->csi_retry_timer_id = mce_slack_timeout_add(self->csi_retry_delay,
+                                                     MDY_TIMER_SLACK_MS,
+                                                     compositor_stm_retry_timer_cb,
+                                                     self);
 }
 
 /** Cancel retrying of failed compositor state request
@@ -6457,9 +6591,10 @@ compositor_stm_schedule_killer(compositor_stm_t *self)
 
     mce_log(LL_DEBUG, "schedule compositor killer");
 
-    self->csi_kill_timer_id = g_timeout_add(mdy_compositor_core_delay * 1000,
-                                            compositor_stm_core_timer_cb,
-                                            self);
+    self->csi_kill_timer_id = mce_slack_timeout_add(mdy_compositor_core_delay * 1000,
+                                                    MDY_TIMER_SLACK_MS,
+                                                    compositor_stm_core_timer_cb,
+                                                    self);
 
 EXIT:
     return;
@@ -6525,9 +6660,10 @@ compositor_stm_core_timer_cb(void *aptr)
     if( kill(self->csi_service_pid, SIGXCPU) == -1 && errno == ESRCH )
         goto EXIT;
 
-    self->csi_kill_timer_id = g_timeout_add(mdy_compositor_kill_delay * 1000,
-                                            compositor_stm_kill_timer_cb,
-                                            self);
+    self->csi_kill_timer_id = mce_slack_timeout_add(mdy_compositor_kill_delay * 1000,
+                                                    MDY_TIMER_SLACK_MS,
+                                                    compositor_stm_kill_timer_cb,
+                                                    self);
 
 EXIT:
     return FALSE;
@@ -6553,9 +6689,10 @@ compositor_stm_kill_timer_cb(void *aptr)
     if( kill(self->csi_service_pid, SIGKILL) == -1 && errno == ESRCH )
         goto EXIT;
 
-    self->csi_kill_timer_id = g_timeout_add(mdy_compositor_bury_delay * 1000,
-                                            compositor_stm_bury_timer_cb,
-                                            self);
+    self->csi_kill_timer_id = mce_slack_timeout_add(mdy_compositor_bury_delay * 1000,
+                                                    MDY_TIMER_SLACK_MS,
+                                                    compositor_stm_bury_timer_cb,
+                                                    self);
 
 EXIT:
     return FALSE;
@@ -7583,6 +7720,9 @@ static stm_state_t mdy_stm_dstate = STM_UNSET;
 /** Display state / suspend policy wakelock held */
 static bool mdy_stm_acquire_wakelockd = false;
 
+/** Flag for: compositor is enabled while frame buffer is resumed */
+static bool mdy_stm_parallel_unblank = DEFAULT_PARALLEL_UNBLANK;
+
 /** Display state machine state to human readable string
  */
 static const char *mdy_stm_state_name(stm_state_t state)
@@ -7780,6 +7920,9 @@ static void mdy_stm_fbdev_power_done_cb(void *aptr, void *reply)
     mce_log(LL_DEBUG, "mdy_waitfb_data.suspended = %s",
             mdy_waitfb_data.suspended ? "true" : "false");
 
+    if( poweron )
+        mdy_stm_unblank_step_done(MDY_UNBLANK_STEP_FBDEV);
+
     mdy_stm_fbdev_pending_set_power = false;
     mdy_stm_schedule_rethink();
 }
@@ -7825,6 +7968,12 @@ static void mdy_stm_fbdev_set_power(bool poweron)
  */
 static bool mdy_stm_is_early_suspend_allowed(void)
 {
+    /* Speculative resume keeps frame buffer powered up */
+    if( mdy_specresume_is_active() ) {
+        mce_log(LL_INFO, "res=false (speculative resume)");
+        return false;
+    }
+
 #ifdef ENABLE_WAKELOCKS
     bool res = (mdy_autosuspend_get_allowed_level() >= SUSPEND_LEVEL_EARLY);
     mce_log(LL_INFO, "res=%s", res ? "true" : "false");
@@ -7873,12 +8022,16 @@ static void mdy_stm_autosuspend_done_cb(void *aptr, void *reply)
 
     mce_log(LL_DEBUG, "autosuspend = %s", allow ? "enabled" : "disabled");
 
+    if( !allow )
+        mdy_stm_unblank_step_done(MDY_UNBLANK_STEP_AUTOSUSPEND);
+
     if( mdy_waitfb_data.thread ) {
         /* Early suspend: Resume implicitly wakes up display too */
     }
-    else {
-        /* Autosleep: Explicit display power control needed */
-        mdy_stm_fbdev_set_power(allow ? false : true);
+    else if( allow ) {
+        /* Autosleep: Explicit display power control needed. Power
+         * up is queued already by mdy_stm_start_fb_resume() */
+        mdy_stm_fbdev_set_power(false);
     }
 
     mdy_stm_schedule_rethink();
@@ -7954,6 +8107,11 @@ static void mdy_stm_start_fb_resume(void)
 #ifdef ENABLE_WAKELOCKS
     mce_log(LL_NOTICE, "resuming");
     mdy_stm_autosuspend_set_state(false);
+
+    /* Autosleep: Queue display power up right after the sysfs write
+     * instead of waiting for a main loop round trip in between */
+    if( !mdy_waitfb_data.thread )
+        mdy_stm_fbdev_set_power(true);
 #else
     mce_log(LL_NOTICE, "power on frame buffer");
     mdy_waitfb_data.suspended = false, mce_fbdev_set_power(true);
@@ -7979,8 +8137,10 @@ static bool mdy_stm_is_fb_resume_finished(void)
 {
     bool res = !mdy_waitfb_data.suspended;
 
-    if( res )
+    if( res ) {
         mdy_fbsusp_led_cancel_timer();
+        mdy_stm_unblank_step_done(MDY_UNBLANK_STEP_FB_RESUME);
+    }
 
     mce_log(LL_INFO, "res=%s", res ? "true" : "false");
     return res;
@@ -7994,7 +8154,7 @@ static void mdy_stm_release_wakelock(void)
         mdy_stm_acquire_wakelockd = false;
 #ifdef ENABLE_WAKELOCKS
         mce_log(LL_INFO, "wakelock released");
-        wakelock_lock("mce_display_on", MCE_DISPLAY_STM_SUSPEND_DELAY_NS);
+        mce_wakelock_obtain("mce_display_on", MCE_DISPLAY_STM_SUSPEND_DELAY_MS);
 #endif
     }
 }
@@ -8006,12 +8166,121 @@ static void mdy_stm_acquire_wakelock(void)
     if( !mdy_stm_acquire_wakelockd ) {
         mdy_stm_acquire_wakelockd = true;
 #ifdef ENABLE_WAKELOCKS
-        wakelock_lock("mce_display_on", -1);
+        mce_wakelock_obtain("mce_display_on", -1);
         mce_log(LL_INFO, "wakelock acquired");
 #endif
     }
 }
 
+/** When the ongoing unblank was started, or zero if not in progress */
+static int64_t mdy_stm_unblank_tick = 0;
+
+/** When each unblank step finished, or zero if not executed */
+static int64_t mdy_stm_unblank_step_tick[MDY_UNBLANK_STEP_COUNT];
+
+/** Start timing of display power up sequence
+ */
+static void mdy_stm_unblank_begin(void)
+{
+    if( mdy_stm_unblank_tick )
+        goto EXIT;
+
+    mdy_stm_unblank_tick = mce_lib_get_boot_tick();
+
+    for( int i = 0; i < MDY_UNBLANK_STEP_COUNT; ++i )
+        mdy_stm_unblank_step_tick[i] = 0;
+
+EXIT:
+    return;
+}
+
+/** Mark a step of display power up sequence finished
+ *
+ * @param step  unblank step
+ */
+static void mdy_stm_unblank_step_done(mdy_unblank_step_t step)
+{
+    if( !mdy_stm_unblank_tick )
+        goto EXIT;
+
+    if( !mdy_stm_unblank_step_tick[step] )
+        mdy_stm_unblank_step_tick[step] = mce_lib_get_boot_tick();
+
+EXIT:
+    return;
+}
+
+/** Stop timing of display power up sequence
+ *
+ * @param report  true to log per step timing breakdown
+ */
+static void mdy_stm_unblank_end(bool report)
+{
+    static const char * const names[MDY_UNBLANK_STEP_COUNT] = {
+        [MDY_UNBLANK_STEP_AUTOSUSPEND] = "autosuspend",
+        [MDY_UNBLANK_STEP_FBDEV]       = "fbdev",
+        [MDY_UNBLANK_STEP_FB_RESUME]   = "resume",
+        [MDY_UNBLANK_STEP_COMPOSITOR]  = "compositor",
+        [MDY_UNBLANK_STEP_FADE]        = "fade",
+    };
+
+    if( !mdy_stm_unblank_tick )
+        goto EXIT;
+
+    if( report ) {
+        int64_t now = mce_lib_get_boot_tick();
+        char    buf[256];
+        size_t  len = 0;
+
+        *buf = 0;
+        for( int i = 0; i < MDY_UNBLANK_STEP_COUNT; ++i ) {
+            if( !mdy_stm_unblank_step_tick[i] || len >= sizeof buf )
+                continue;
+            len += snprintf(buf + len, sizeof buf - len, " %s=%d",
+                            names[i],
+                            (int)(mdy_stm_unblank_step_tick[i] -
+                                  mdy_stm_unblank_tick));
+        }
+
+        mce_log(LL_DEVEL, "unblank took %d ms;%s",
+                (int)(now - mdy_stm_unblank_tick), buf);
+
+        mdy_statistics_unblank_latency(now - mdy_stm_unblank_tick);
+    }
+
+    mdy_stm_unblank_tick = 0;
+
+EXIT:
+    return;
+}
+
+/** When the ongoing blank was started, or zero if not in progress */
+static int64_t mdy_stm_blank_tick = 0;
+
+/** Start timing of display power down sequence
+ */
+static void mdy_stm_blank_begin(void)
+{
+    if( !mdy_stm_blank_tick )
+        mdy_stm_blank_tick = mce_lib_get_boot_tick();
+}
+
+/** Stop timing of display power down sequence
+ */
+static void mdy_stm_blank_end(void)
+{
+    if( !mdy_stm_blank_tick )
+        goto EXIT;
+
+    mdy_statistics_blank_latency(mce_lib_get_boot_tick() -
+                                 mdy_stm_blank_tick);
+
+    mdy_stm_blank_tick = 0;
+
+EXIT:
+    return;
+}
+
 /** Helper for making state transitions
  */
 static void mdy_stm_trans(stm_state_t state)
@@ -8028,6 +8297,10 @@ static void mdy_stm_trans(stm_state_t state)
  */
 static void mdy_stm_push_target_change(display_state_t next_state)
 {
+    /* Display power up after speculative resume counts as a hit */
+    if( mdy_stm_display_state_needs_power(next_state) )
+        mdy_specresume_resolve(true);
+
     if( mdy_stm_want != next_state ) {
         mdy_stm_want = next_state;
         /* Try to initiate state transitions immediately
@@ -8105,6 +8378,7 @@ static void mdy_stm_step(void)
         break;
 
     case STM_RENDERER_INIT_START:
+        mdy_stm_unblank_begin();
         if( !mdy_compositor_is_available() ) {
             mdy_brightness_set_fade_target_unblank(mdy_brightness_level_display_resume);
             mdy_stm_trans(STM_WAIT_FADE_TO_TARGET);
@@ -8120,6 +8394,7 @@ static void mdy_stm_step(void)
         if( mdy_compositor_is_pending() )
             break;
         if( mdy_compositor_is_enabled() ) {
+            mdy_stm_unblank_step_done(MDY_UNBLANK_STEP_COMPOSITOR);
             mdy_brightness_set_fade_target_unblank(mdy_brightness_level_display_resume);
             mdy_stm_trans(STM_WAIT_FADE_TO_TARGET);
             break;
@@ -8148,6 +8423,7 @@ static void mdy_stm_step(void)
          * transition gets really jumpy. */
         if( mdy_brightness_fade_is_active() )
             break;
+        mdy_stm_unblank_step_done(MDY_UNBLANK_STEP_FADE);
         mdy_stm_trans(STM_ENTER_POWER_ON);
         break;
 
@@ -8159,6 +8435,7 @@ static void mdy_stm_step(void)
             break;
 
         mdy_stm_finish_target_change();
+        mdy_stm_unblank_end(true);
         mdy_stm_trans(STM_STAY_POWER_ON);
         break;
 
@@ -8179,8 +8456,10 @@ static void mdy_stm_step(void)
         break;
 
     case STM_LEAVE_POWER_ON:
-        if( !mdy_stm_display_state_needs_power(mdy_stm_next) )
+        if( !mdy_stm_display_state_needs_power(mdy_stm_next) ) {
+            mdy_stm_blank_begin();
             mdy_stm_trans(STM_WAIT_FADE_TO_BLACK);
+        }
         else if( mdy_brightness_level_cached < 0 )
             mdy_stm_trans(STM_INIT_RESUME);
         else
@@ -8256,7 +8535,8 @@ static void mdy_stm_step(void)
         break;
 
     case STM_ENTER_POWER_OFF:
-
+        mdy_stm_unblank_end(false);
+        mdy_stm_blank_end();
         mdy_stm_finish_target_change();
         mdy_stm_trans(STM_STAY_POWER_OFF);
         break;
@@ -8297,7 +8577,26 @@ static void mdy_stm_step(void)
         break;
 
     case STM_INIT_RESUME:
+        if( mdy_stm_display_state_needs_power(mdy_stm_next) )
+            mdy_stm_unblank_begin();
+
         mdy_stm_start_fb_resume();
+
+        /* Compositor handoff does not depend on frame buffer power
+         * state, start it already while the resume is in progress.
+         * The results are joined in STM_RENDERER_WAIT_START. */
+        if( mdy_stm_parallel_unblank &&
+            mdy_stm_display_state_needs_power(mdy_stm_next) &&
+            mdy_compositor_is_available() ) {
+            /* Ui can draw as soon as the handoff is made, so the
+             * non-zero brightness normally set in STM_WAIT_RESUME
+             * must be in place already before that */
+            if( mdy_brightness_level_cached <= 0 )
+                mdy_brightness_force_level(1);
+
+            mdy_compositor_enable();
+        }
+
         mdy_stm_trans(STM_WAIT_RESUME);
         break;
 
@@ -8334,6 +8633,8 @@ static void mdy_stm_step(void)
         if( mdy_stm_autosuspend_pending )
             break;
 
+        mdy_stm_unblank_end(false);
+        mdy_stm_blank_end();
         mdy_stm_finish_target_change();
         if( force_powerup_in_logical_off ) {
             force_powerup_in_logical_off = false;
@@ -8429,7 +8730,7 @@ static gboolean mdy_stm_rethink_cb(gpointer aptr)
         /* remove wakelock if not re-scheduled */
 #ifdef ENABLE_WAKELOCKS
         if( !mdy_stm_rethink_id )
-            wakelock_unlock("mce_display_stm");
+            mce_wakelock_release("mce_display_stm");
 #endif
     }
     return FALSE;
@@ -8444,7 +8745,7 @@ static void mdy_stm_cancel_rethink(void)
         mce_log(LL_INFO, "cancelled");
 
 #ifdef ENABLE_WAKELOCKS
-        wakelock_unlock("mce_display_stm");
+        mce_wakelock_release("mce_display_stm");
 #endif
     }
 }
@@ -8455,7 +8756,7 @@ static void mdy_stm_schedule_rethink(void)
 {
     if( !mdy_stm_rethink_id ) {
 #ifdef ENABLE_WAKELOCKS
-        wakelock_lock("mce_display_stm", -1);
+        mce_wakelock_obtain("mce_display_stm", -1);
 #endif
 
         mce_log(LL_INFO, "scheduled");
@@ -8476,7 +8777,7 @@ static void mdy_stm_force_rethink(void)
 
 #ifdef ENABLE_WAKELOCKS
     if( !mdy_stm_rethink_id )
-        wakelock_lock("mce_display_stm", -1);
+        mce_wakelock_obtain("mce_display_stm", -1);
 #endif
 
     if( mdy_stm_rethink_id )
@@ -8486,7 +8787,7 @@ static void mdy_stm_force_rethink(void)
 
 #ifdef ENABLE_WAKELOCKS
     if( !mdy_stm_rethink_id )
-        wakelock_unlock("mce_display_stm");
+        mce_wakelock_release("mce_display_stm");
 #endif
 
 EXIT:
@@ -8494,27 +8795,224 @@ EXIT:
 }
 
 /* ========================================================================= *
- * DISPLAY_STATE_STATISTICS
+ * SPECULATIVE_RESUME
  * ========================================================================= */
 
-/** Statistics: Time spent in each display state */
-static struct
+/** Speculative resume triggering mask; from settings */
+static gint  mdy_specresume_mode = MCE_DEFAULT_DISPLAY_SPECULATIVE_RESUME;
+static guint mdy_specresume_mode_setting_id = 0;
+
+/** Timer for rolling back unused speculative resume */
+static guint mdy_specresume_timer_id = 0;
+
+/** Source of the ongoing speculative resume */
+static int   mdy_specresume_source = MCE_SPECULATIVE_RESUME_NONE;
+
+/** Number of speculative resumes followed by display power up */
+static guint mdy_specresume_hits[2] = { 0, 0 };
+
+/** Number of speculative resumes that were rolled back */
+static guint mdy_specresume_misses[2] = { 0, 0 };
+
+/** Speculative resume source to human readable string
+ *
+ * @param source MCE_SPECULATIVE_RESUME_POWERKEY etc
+ *
+ * @return name of the source
+ */
+static const char *mdy_specresume_source_repr(int source)
 {
-    int64_t         entries;
-    int64_t         time_ms;
+    const char *repr = "unknown";
+
+    switch( source ) {
+    case MCE_SPECULATIVE_RESUME_NONE:      repr = "none";      break;
+    case MCE_SPECULATIVE_RESUME_POWERKEY:  repr = "powerkey";  break;
+    case MCE_SPECULATIVE_RESUME_PROXIMITY: repr = "proximity"; break;
+    default: break;
+    }
+
+    return repr;
 }
-mdy_statistics_data[MCE_DISPLAY_NUMSTATES] =
+
+/** Map speculative resume source to statistics array index
+ *
+ * @param source MCE_SPECULATIVE_RESUME_POWERKEY or
+ *               MCE_SPECULATIVE_RESUME_PROXIMITY
+ *
+ * @return array index
+ */
+static int mdy_specresume_source_index(int source)
 {
-    [MCE_DISPLAY_UNDEF]      = { 0, 0 },
-    [MCE_DISPLAY_OFF]        = { 0, 0 },
-    [MCE_DISPLAY_LPM_OFF]    = { 0, 0 },
-    [MCE_DISPLAY_LPM_ON]     = { 0, 0 },
-    [MCE_DISPLAY_DIM]        = { 0, 0 },
-    [MCE_DISPLAY_ON]         = { 0, 0 },
-    [MCE_DISPLAY_POWER_UP]   = { 0, 0 },
-    [MCE_DISPLAY_POWER_DOWN] = { 0, 0 },
+    return (source == MCE_SPECULATIVE_RESUME_PROXIMITY) ? 1 : 0;
+}
+
+/** Predicate for: speculative frame buffer resume is in progress
+ */
+static bool mdy_specresume_is_active(void)
+{
+    return mdy_specresume_timer_id != 0;
+}
+
+/** Timer callback for rolling back unused speculative resume
+ *
+ * @param aptr (unused)
+ *
+ * @return FALSE to stop the timer from repeating
+ */
+static gboolean mdy_specresume_timer_cb(gpointer aptr)
+{
+    (void)aptr;
+
+    if( !mdy_specresume_timer_id )
+        goto EXIT;
+
+    mdy_specresume_resolve(false);
+
+EXIT:
+    return FALSE;
+}
+
+/** Start speculative frame buffer resume
+ *
+ * Frame buffer resume and exit from early suspend are started while
+ * the backlight is kept off. If display power up is requested soon
+ * after, the slowest part of unblanking has already been done. If not,
+ * the state machine returns to early suspend once the timer expires.
+ *
+ * @param source MCE_SPECULATIVE_RESUME_POWERKEY or
+ *               MCE_SPECULATIVE_RESUME_PROXIMITY
+ */
+static void mdy_specresume_start(int source)
+{
+    if( !(mdy_specresume_mode & source) )
+        goto EXIT;
+
+    /* Already ongoing: just extend the rollback timeout */
+    if( mdy_specresume_timer_id ) {
+        g_source_remove(mdy_specresume_timer_id);
+        mdy_specresume_timer_id =
+            g_timeout_add(MDY_SPECRESUME_TIMEOUT_MS,
+                          mdy_specresume_timer_cb, 0);
+        goto EXIT;
+    }
+
+    /* Worth doing only when frame buffer is powered off */
+    if( mdy_stm_dstate != STM_STAY_POWER_OFF )
+        goto EXIT;
+
+    mce_log(LL_DEBUG, "speculative resume (%s) started",
+            mdy_specresume_source_repr(source));
+
+    mdy_specresume_source   = source;
+    mdy_specresume_timer_id =
+        g_timeout_add(MDY_SPECRESUME_TIMEOUT_MS,
+                      mdy_specresume_timer_cb, 0);
+
+    mdy_stm_schedule_rethink();
+
+EXIT:
+    return;
+}
+
+/** Finish speculative frame buffer resume
+ *
+ * @param hit true if display power up was requested, false
+ *            if the speculative resume is to be rolled back
+ */
+static void mdy_specresume_resolve(bool hit)
+{
+    if( !mdy_specresume_timer_id )
+        goto EXIT;
+
+    g_source_remove(mdy_specresume_timer_id),
+        mdy_specresume_timer_id = 0;
+
+    int i = mdy_specresume_source_index(mdy_specresume_source);
+
+    if( hit )
+        mdy_specresume_hits[i] += 1;
+    else
+        mdy_specresume_misses[i] += 1;
+
+    mce_log(LL_DEVEL, "speculative resume (%s) %s; hits=%u misses=%u",
+            mdy_specresume_source_repr(mdy_specresume_source),
+            hit ? "hit" : "miss",
+            mdy_specresume_hits[i], mdy_specresume_misses[i]);
+
+    mdy_specresume_source = MCE_SPECULATIVE_RESUME_NONE;
+
+    /* Allow return to early suspend */
+    mdy_stm_schedule_rethink();
+
+EXIT:
+    return;
+}
+
+/** Cancel speculative resume on module unload
+ */
+static void mdy_specresume_quit(void)
+{
+    if( mdy_specresume_timer_id ) {
+        g_source_remove(mdy_specresume_timer_id),
+            mdy_specresume_timer_id = 0;
+    }
+
+    for( int i = 0; i < 2; ++i ) {
+        if( !mdy_specresume_hits[i] && !mdy_specresume_misses[i] )
+            continue;
+
+        mce_log(LL_DEBUG, "speculative resume (%s): hits=%u misses=%u",
+                mdy_specresume_source_repr(1 << i),
+                mdy_specresume_hits[i], mdy_specresume_misses[i]);
+    }
+}
+
+/* ========================================================================= *
+ * DISPLAY_STATE_STATISTICS
+ * ========================================================================= */
+
+G_STATIC_ASSERT(MCE_DISPLAY_STATS_STATES == MCE_DISPLAY_NUMSTATES);
+G_STATIC_ASSERT(MCE_DISPLAY_STATS_FADERS == FADER_NUMOF);
+
+/** Statistics storage used when snapshot file is not available */
+static mce_display_stats_t  mdy_statistics_local =
+{
+    .magic   = MCE_DISPLAY_STATS_MAGIC,
+    .version = MCE_DISPLAY_STATS_VERSION,
+    .size    = sizeof(mce_display_stats_t),
 };
 
+/** Display statistics; points to mmapped snapshot file when available */
+static mce_display_stats_t *mdy_statistics = &mdy_statistics_local;
+
+/** Fade type being accounted, or FADER_IDLE */
+static fader_type_t mdy_statistics_fade_type = FADER_IDLE;
+
+/** When the fade being accounted started */
+static int64_t      mdy_statistics_fade_tick = 0;
+
+/** Brightness level when the fade being accounted started */
+static int          mdy_statistics_fade_level = 0;
+
+/** Brightness level accounted for time since the last update */
+static int          mdy_statistics_level = 0;
+
+/** Mark statistics update started for snapshot file readers
+ */
+static void mdy_statistics_begin_write(void)
+{
+    mdy_statistics->sequence += 1;
+    __sync_synchronize();
+}
+
+/** Mark statistics update finished for snapshot file readers
+ */
+static void mdy_statistics_end_write(void)
+{
+    __sync_synchronize();
+    mdy_statistics->sequence += 1;
+}
+
 /** Update display state statistics
  */
 static void mdy_statistics_update(void)
@@ -8524,15 +9022,188 @@ static void mdy_statistics_update(void)
     static display_state_t prev_state  = MCE_DISPLAY_UNDEF;
     static int64_t         prev_update = 0;
 
-    int64_t now = mce_lib_get_boot_tick();
+    int64_t now     = mce_lib_get_boot_tick();
+    int64_t elapsed = now - prev_update;
 
-    mdy_statistics_data[prev_state].time_ms += (now - prev_update);
+    mdy_statistics_begin_write();
+
+    mdy_statistics->state[prev_state].time_ms       += elapsed;
+    mdy_statistics->state[prev_state].brightness_ms += mdy_statistics_level * elapsed;
 
     if( prev_state != display_state_curr )
-        mdy_statistics_data[display_state_curr].entries += 1;
+        mdy_statistics->state[display_state_curr].entries += 1;
+
+    mdy_statistics->brightness_max = mdy_brightness_level_maximum;
+    mdy_statistics->updated_ms     = now;
+
+    mdy_statistics_end_write();
 
     prev_state  = display_state_curr;
     prev_update = now;
+    mdy_statistics_level = (mdy_brightness_level_cached > 0) ?
+        mdy_brightness_level_cached : 0;
+}
+
+/** Start accounting a brightness fade
+ *
+ * @param type type of fade that was started
+ */
+static void mdy_statistics_fade_begin(fader_type_t type)
+{
+    if( type <= FADER_IDLE || type >= FADER_NUMOF )
+        goto EXIT;
+
+    /* Account time spent before the fade */
+    mdy_statistics_update();
+
+    mdy_statistics_fade_type  = type;
+    mdy_statistics_fade_tick  = mce_lib_get_boot_tick();
+    mdy_statistics_fade_level = mdy_statistics_level;
+
+    mdy_statistics_begin_write();
+    mdy_statistics->fade_count[type] += 1;
+    mdy_statistics_end_write();
+
+EXIT:
+    return;
+}
+
+/** Stop accounting a brightness fade
+ */
+static void mdy_statistics_fade_end(void)
+{
+    fader_type_t type = mdy_statistics_fade_type;
+
+    if( type == FADER_IDLE )
+        goto EXIT;
+
+    mdy_statistics_fade_type = FADER_IDLE;
+
+    mdy_statistics_begin_write();
+    mdy_statistics->fade_ms[type] += (mce_lib_get_boot_tick() -
+                                      mdy_statistics_fade_tick);
+    mdy_statistics_end_write();
+
+    /* Brightness changes during the fade were not accounted
+     * step by step; use average of start and end levels */
+    mdy_statistics_level = (mdy_statistics_fade_level +
+                            MAX(mdy_brightness_level_cached, 0)) / 2;
+    mdy_statistics_update();
+
+EXIT:
+    return;
+}
+
+/** Predicate for: brightness fade is being accounted
+ *
+ * @return true during brightness fades, false otherwise
+ */
+static bool mdy_statistics_fading(void)
+{
+    return mdy_statistics_fade_type != FADER_IDLE;
+}
+
+/** Add a sample to latency histogram
+ *
+ * @param histogram array of MCE_DISPLAY_STATS_LATENCY_BUCKETS counters
+ * @param ms        latency [ms]
+ */
+static void mdy_statistics_add_latency(int64_t *histogram, int64_t ms)
+{
+    int bucket = 0;
+
+    while( bucket < MCE_DISPLAY_STATS_LATENCY_BUCKETS - 1 &&
+           ms >= (50 << bucket) )
+        ++bucket;
+
+    mdy_statistics_begin_write();
+    histogram[bucket] += 1;
+    mdy_statistics_end_write();
+}
+
+/** Record how long display power up took
+ *
+ * @param ms  latency [ms]
+ */
+static void mdy_statistics_unblank_latency(int64_t ms)
+{
+    mdy_statistics_add_latency(mdy_statistics->unblank_latency, ms);
+}
+
+/** Record how long display power down took
+ *
+ * @param ms  latency [ms]
+ */
+static void mdy_statistics_blank_latency(int64_t ms)
+{
+    mdy_statistics_add_latency(mdy_statistics->blank_latency, ms);
+}
+
+/** Count ambient light sensor driven brightness change
+ */
+static void mdy_statistics_als_change(void)
+{
+    mdy_statistics_begin_write();
+    mdy_statistics->als_changes += 1;
+    mdy_statistics_end_write();
+}
+
+/** Start keeping statistics in mmapped snapshot file
+ */
+static void mdy_statistics_init(void)
+{
+    const char *path = MCE_DISPLAY_STATS_FILE;
+    int         fd   = -1;
+    void       *mem  = MAP_FAILED;
+
+    if( mdy_statistics != &mdy_statistics_local )
+        goto EXIT;
+
+    if( (fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644)) == -1 ) {
+        mce_log(LL_WARN, "%s: open: %m", path);
+        goto EXIT;
+    }
+
+    if( ftruncate(fd, sizeof *mdy_statistics) == -1 ) {
+        mce_log(LL_WARN, "%s: truncate: %m", path);
+        goto EXIT;
+    }
+
+    mem = mmap(0, sizeof *mdy_statistics, PROT_READ | PROT_WRITE,
+               MAP_SHARED, fd, 0);
+    if( mem == MAP_FAILED ) {
+        mce_log(LL_WARN, "%s: mmap: %m", path);
+        goto EXIT;
+    }
+
+    /* Carry over whatever has been accumulated so far */
+    memcpy(mem, &mdy_statistics_local, sizeof mdy_statistics_local);
+    mdy_statistics = mem;
+
+EXIT:
+    if( fd != -1 )
+        close(fd);
+}
+
+/** Stop keeping statistics in mmapped snapshot file
+ *
+ * The file itself is left in place for post mortem inspection.
+ */
+static void mdy_statistics_quit(void)
+{
+    if( mdy_statistics == &mdy_statistics_local )
+        goto EXIT;
+
+    mdy_statistics_update();
+
+    memcpy(&mdy_statistics_local, mdy_statistics,
+           sizeof mdy_statistics_local);
+
+    munmap(mdy_statistics, sizeof *mdy_statistics);
+    mdy_statistics = &mdy_statistics_local;
+
+EXIT:
+    return;
 }
 
 /* ========================================================================= *
@@ -8550,6 +9221,21 @@ static governor_setting_t *mdy_governor_default = 0;
 /** GOVERNOR_INTERACTIVE CPU scaling governor settings */
 static governor_setting_t *mdy_governor_interactive = 0;
 
+/** Internal governor state used for boosting display power up
+ *
+ * Not meant to be used via MCE_SETTING_CPU_SCALING_GOVERNOR.
+ */
+#define GOVERNOR_BOOST 3
+
+/** GOVERNOR_BOOST CPU scaling governor settings */
+static governor_setting_t *mdy_governor_boost = 0;
+
+/** Flag for: input boost is active */
+static bool mdy_governor_boost_active = false;
+
+/** Timer for ending input boost */
+static guint mdy_governor_boost_timer_id = 0;
+
 /** Limit number of files that can be modified via settings */
 #define GOVERNOR_MAX_SETTINGS 32
 
@@ -8752,7 +9438,36 @@ cleanup:
     globfree(&gb);
 }
 
+/** Write array of cpu scaling governor parameters to sysfs
+ *
+ * @param settings array of settings
+ */
+static void mdy_governor_apply_settings(const governor_setting_t *settings)
+{
+    for( ; settings->path; ++settings ) {
+        mdy_governor_apply_setting(settings);
+    }
+}
+
+/** Callback for writing cpu scaling governor parameters in worker thread
+ *
+ * @param aptr array of settings (as void pointer)
+ *
+ * @return array of settings (as void pointer)
+ */
+static void *mdy_governor_set_state_exec_cb(void *aptr)
+{
+    /* Note: This is executed in the worker thread context */
+
+    mdy_governor_apply_settings(aptr);
+
+    return aptr;
+}
+
 /** Switch cpu scaling governor state
+ *
+ * The sysfs writes are done in worker thread so that they do not
+ * delay processing of the input event that triggered the change.
  *
  * @param state GOVERNOR_DEFAULT, GOVERNOR_DEFAULT, ...
  */
@@ -8768,6 +9483,9 @@ static void mdy_governor_set_state(int state)
     case GOVERNOR_INTERACTIVE:
         settings = mdy_governor_interactive;
         break;
+    case GOVERNOR_BOOST:
+        settings = mdy_governor_boost;
+        break;
 
     default: break;
     }
@@ -8775,10 +9493,14 @@ static void mdy_governor_set_state(int state)
     if( !settings ) {
         mce_log(LL_WARN, "governor state=%d has no mapping", state);
     }
+    else if( mdy_unloading_module ) {
+        /* Worker jobs are no longer executed -> write directly */
+        mdy_governor_apply_settings(settings);
+    }
     else {
-        for( ; settings->path; ++settings ) {
-            mdy_governor_apply_setting(settings);
-        }
+        mce_worker_add_job(MODULE_NAME, "cpu-governor",
+                           mdy_governor_set_state_exec_cb, 0,
+                           (void *)settings);
     }
 }
 
@@ -8812,6 +9534,12 @@ static void mdy_governor_rethink(void)
         governor_want = GOVERNOR_DEFAULT;
     }
 
+    /* Temporarily boost display power up in user mode */
+    if( mdy_governor_boost_active &&
+        governor_want == GOVERNOR_INTERACTIVE ) {
+        governor_want = GOVERNOR_BOOST;
+    }
+
     /* Config override has been set */
     if( mdy_governor_conf != GOVERNOR_UNSET ) {
         governor_want = mdy_governor_conf;
@@ -8852,6 +9580,74 @@ static void mdy_governor_setting_cb(GConfClient *const client, const guint id,
         mdy_governor_rethink();
     }
 }
+
+/** Timer callback for ending input boost
+ *
+ * @param aptr (not used)
+ *
+ * @return FALSE to stop the timer from repeating
+ */
+static gboolean mdy_governor_boost_timer_cb(gpointer aptr)
+{
+    (void)aptr;
+
+    if( !mdy_governor_boost_timer_id )
+        goto EXIT;
+
+    mdy_governor_boost_timer_id = 0;
+
+    mce_log(LL_DEBUG, "input boost ended");
+    mdy_governor_boost_active = false;
+    mdy_governor_rethink();
+
+EXIT:
+    return FALSE;
+}
+
+/** Start or extend input boost
+ *
+ * @param duration_ms how long to keep the boost active
+ */
+static void mdy_governor_boost_start(int duration_ms)
+{
+    /* Skip if not configured */
+    if( !mdy_governor_boost || !mdy_governor_boost->path )
+        goto EXIT;
+
+    if( mdy_governor_boost_timer_id )
+        g_source_remove(mdy_governor_boost_timer_id);
+
+    mdy_governor_boost_timer_id =
+        g_timeout_add(duration_ms, mdy_governor_boost_timer_cb, 0);
+
+    if( !mdy_governor_boost_active ) {
+        mce_log(LL_DEBUG, "input boost started");
+        mdy_governor_boost_active = true;
+        mdy_governor_rethink();
+    }
+
+EXIT:
+    return;
+}
+
+/** Shorten active input boost after display has been powered up
+ */
+static void mdy_governor_boost_linger(void)
+{
+    if( mdy_governor_boost_active )
+        mdy_governor_boost_start(MDY_GOVERNOR_BOOST_LINGER_MS);
+}
+
+/** Cancel input boost without re-evaluating governor state
+ */
+static void mdy_governor_boost_stop(void)
+{
+    if( mdy_governor_boost_timer_id )
+        g_source_remove(mdy_governor_boost_timer_id),
+            mdy_governor_boost_timer_id = 0;
+
+    mdy_governor_boost_active = false;
+}
 #endif /* ENABLE_CPU_GOVERNOR */
 
 /* ========================================================================= *
@@ -9814,11 +10610,11 @@ static gboolean mdy_dbus_handle_display_stats_get_req(DBusMessage *const req)
                                               0, &entry) )
             goto ABANDON_DICT;
 
-        dta.i64 = mdy_statistics_data[i].time_ms;
+        dta.i64 = mdy_statistics->state[i].time_ms;
         if( !dbus_message_iter_append_basic(&entry, DBUS_TYPE_INT64,  &dta) )
             goto ABANDON_ENTRY;
 
-        dta.i64 = mdy_statistics_data[i].entries;
+        dta.i64 = mdy_statistics->state[i].entries;
         if( !dbus_message_iter_append_basic(&entry, DBUS_TYPE_INT64,  &dta) )
             goto ABANDON_ENTRY;
 
@@ -9852,6 +10648,171 @@ EXIT:
     return TRUE;
 }
 
+/** Append key-value pair to a{sx} array
+ *
+ * @param array  iterator for open a{sx} container
+ * @param key    name of the statistics item
+ * @param value  value of the statistics item
+ *
+ * @return true on success, false on failure
+ */
+static bool mdy_dbus_append_stats_entry(DBusMessageIter *array,
+                                        const char *key, int64_t value)
+{
+    bool             ack = false;
+    DBusMessageIter  dict;
+    dbus_any_t       dta;
+
+    if( !dbus_message_iter_open_container(array, DBUS_TYPE_DICT_ENTRY,
+                                          0, &dict) )
+        goto EXIT;
+
+    dta.s = key;
+    if( !dbus_message_iter_append_basic(&dict, DBUS_TYPE_STRING, &dta) )
+        goto ABANDON_DICT;
+
+    dta.i64 = value;
+    if( !dbus_message_iter_append_basic(&dict, DBUS_TYPE_INT64, &dta) )
+        goto ABANDON_DICT;
+
+    ack = dbus_message_iter_close_container(array, &dict);
+    goto EXIT;
+
+ABANDON_DICT:
+    dbus_message_iter_abandon_container(array, &dict);
+
+EXIT:
+    return ack;
+}
+
+/** D-Bus callback for the get extended display statistics method call
+ *
+ * Reply is a flat a{sx} dictionary so that new items can be added
+ * without breaking existing clients.
+ *
+ * @param req The D-Bus message
+ *
+ * @return TRUE
+ */
+static gboolean mdy_dbus_handle_display_stats_extended_get_req(DBusMessage *const req)
+{
+    static const char * const latency_key[MCE_DISPLAY_STATS_LATENCY_BUCKETS] =
+    {
+        "lt50ms",   "lt100ms",  "lt200ms",  "lt400ms",
+        "lt800ms",  "lt1600ms", "lt3200ms", "ge3200ms",
+    };
+
+    DBusMessage      *rsp = 0;
+    DBusMessageIter  body;
+    DBusMessageIter  array;
+    char             key[64];
+
+    mce_log(LL_DEVEL, "extended display statistics req from %s",
+            mce_dbus_get_message_sender_ident(req));
+
+    if( dbus_message_get_no_reply(req) )
+        goto EXIT;
+
+    rsp = dbus_new_method_reply(req);
+
+    dbus_message_iter_init_append(rsp, &body);
+
+    if( !dbus_message_iter_open_container(&body, DBUS_TYPE_ARRAY,
+                                          DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+                                          DBUS_TYPE_STRING_AS_STRING
+                                          DBUS_TYPE_INT64_AS_STRING
+                                          DBUS_DICT_ENTRY_END_CHAR_AS_STRING,
+                                          &array) )
+        goto EXIT;
+
+    /* Add data accumulated for the current display state
+     * before constructing the reply message */
+    mdy_statistics_update();
+
+    for( size_t i = 0; i < MCE_DISPLAY_NUMSTATES; ++i ) {
+        const char *name = display_state_repr(i);
+        const mce_display_stats_state_t *state = &mdy_statistics->state[i];
+
+        snprintf(key, sizeof key, "%s.entries", name);
+        if( !mdy_dbus_append_stats_entry(&array, key, state->entries) )
+            goto ABANDON_ARRAY;
+
+        snprintf(key, sizeof key, "%s.time_ms", name);
+        if( !mdy_dbus_append_stats_entry(&array, key, state->time_ms) )
+            goto ABANDON_ARRAY;
+
+        snprintf(key, sizeof key, "%s.brightness_ms", name);
+        if( !mdy_dbus_append_stats_entry(&array, key, state->brightness_ms) )
+            goto ABANDON_ARRAY;
+    }
+
+    if( !mdy_dbus_append_stats_entry(&array, "brightness_max",
+                                     mdy_statistics->brightness_max) )
+        goto ABANDON_ARRAY;
+
+    for( fader_type_t type = FADER_IDLE + 1; type < FADER_NUMOF; ++type ) {
+        snprintf(key, sizeof key, "fade.%s.count", fader_type_name(type));
+        if( !mdy_dbus_append_stats_entry(&array, key,
+                                         mdy_statistics->fade_count[type]) )
+            goto ABANDON_ARRAY;
+
+        snprintf(key, sizeof key, "fade.%s.time_ms", fader_type_name(type));
+        if( !mdy_dbus_append_stats_entry(&array, key,
+                                         mdy_statistics->fade_ms[type]) )
+            goto ABANDON_ARRAY;
+    }
+
+    for( int i = 0; i < MCE_DISPLAY_STATS_LATENCY_BUCKETS; ++i ) {
+        snprintf(key, sizeof key, "unblank_latency.%s", latency_key[i]);
+        if( !mdy_dbus_append_stats_entry(&array, key,
+                                         mdy_statistics->unblank_latency[i]) )
+            goto ABANDON_ARRAY;
+    }
+
+    for( int i = 0; i < MCE_DISPLAY_STATS_LATENCY_BUCKETS; ++i ) {
+        snprintf(key, sizeof key, "blank_latency.%s", latency_key[i]);
+        if( !mdy_dbus_append_stats_entry(&array, key,
+                                         mdy_statistics->blank_latency[i]) )
+            goto ABANDON_ARRAY;
+    }
+
+    if( !mdy_dbus_append_stats_entry(&array, "als_changes",
+                                     mdy_statistics->als_changes) )
+        goto ABANDON_ARRAY;
+
+    for( int i = 0; i < 2; ++i ) {
+        const char *name =
+            mdy_specresume_source_repr(i ? MCE_SPECULATIVE_RESUME_PROXIMITY
+                                         : MCE_SPECULATIVE_RESUME_POWERKEY);
+
+        snprintf(key, sizeof key, "specresume.%s.hits", name);
+        if( !mdy_dbus_append_stats_entry(&array, key,
+                                         mdy_specresume_hits[i]) )
+            goto ABANDON_ARRAY;
+
+        snprintf(key, sizeof key, "specresume.%s.misses", name);
+        if( !mdy_dbus_append_stats_entry(&array, key,
+                                         mdy_specresume_misses[i]) )
+            goto ABANDON_ARRAY;
+    }
+
+    if( !dbus_message_iter_close_container(&body, &array) )
+        goto EXIT;
+
+    dbus_send_message(rsp), rsp = 0;
+
+    goto EXIT;
+
+ABANDON_ARRAY:
+    dbus_message_iter_abandon_container(&body, &array);
+
+EXIT:
+    if( rsp )
+        dbus_message_unref(rsp);
+
+    return TRUE;
+}
+
 /**
  * D-Bus callback for the desktop startup notification signal
  *
@@ -10110,6 +11071,14 @@ static mce_dbus_handler_t mdy_dbus_handlers[] =
         .args      =
             "    <arg direction=\"out\" name=\"display_state_statistics\" type=\"a{s(xx)}\"/>\n"
     },
+    {
+        .interface = MCE_REQUEST_IF,
+        .name      = MCE_DISPLAY_STATS_EXTENDED_GET,
+        .type      = DBUS_MESSAGE_TYPE_METHOD_CALL,
+        .callback  = mdy_dbus_handle_display_stats_extended_get_req,
+        .args      =
+            "    <arg direction=\"out\" name=\"display_statistics\" type=\"a{sx}\"/>\n"
+    },
     /* sentinel */
     {
         .interface = 0
@@ -10610,6 +11579,11 @@ static void mdy_setting_cb(GConfClient *const gcc, const guint id,
         mce_log(LL_NOTICE, "display off override = %d",
                 mdy_dbus_display_off_override);
     }
+    else if( id == mdy_specresume_mode_setting_id ) {
+        mdy_specresume_mode = gconf_value_get_int(gcv);
+        mce_log(LL_NOTICE, "speculative resume mode = %d",
+                mdy_specresume_mode);
+    }
 
     else if( id == mdy_blanking_pause_mode_setting_id ) {
         gint old = mdy_blanking_pause_mode;
@@ -10982,6 +11956,13 @@ static void mdy_setting_init(void)
                           mdy_setting_cb,
                           &mdy_dbus_display_off_override_setting_id);
 
+    /* Speculative frame buffer resume triggers */
+    mce_setting_track_int(MCE_SETTING_DISPLAY_SPECULATIVE_RESUME,
+                          &mdy_specresume_mode,
+                          MCE_DEFAULT_DISPLAY_SPECULATIVE_RESUME,
+                          mdy_setting_cb,
+                          &mdy_specresume_mode_setting_id);
+
     /* Use orientation sensor */
     mce_setting_track_bool(MCE_SETTING_ORIENTATION_SENSOR_ENABLED,
                            &mdy_orientation_sensor_enabled,
@@ -11105,6 +12086,9 @@ static void mdy_setting_quit(void)
     mce_setting_notifier_remove(mdy_dbus_display_off_override_setting_id),
         mdy_dbus_display_off_override_setting_id = 0;
 
+    mce_setting_notifier_remove(mdy_specresume_mode_setting_id),
+        mdy_specresume_mode_setting_id = 0;
+
     mce_setting_notifier_remove(mdy_orientation_sensor_enabled_setting_id),
         mdy_orientation_sensor_enabled_setting_id = 0;
 
@@ -11209,6 +12193,14 @@ const gchar *g_module_check_init(GModule *module)
 
     mdy_compositor_init();
 
+    /* Make statistics available via snapshot file */
+    mdy_statistics_init();
+
+    /* Start compositor handoff already during frame buffer resume? */
+    mdy_stm_parallel_unblank = mce_conf_get_bool(MCE_CONF_DISPLAY_GROUP,
+                                                 MCE_CONF_PARALLEL_UNBLANK,
+                                                 DEFAULT_PARALLEL_UNBLANK);
+
     /* Allow execution of worker thread jobs from this plugin */
     mce_worker_add_context(MODULE_NAME);
 
@@ -11219,6 +12211,7 @@ const gchar *g_module_check_init(GModule *module)
     /* Get CPU scaling governor settings from INI-files */
     mdy_governor_default = mdy_governor_get_settings("Default");
     mdy_governor_interactive = mdy_governor_get_settings("Interactive");
+    mdy_governor_boost = mdy_governor_get_settings("Boost");
 
     /* Get cpu scaling governor configuration & track changes */
     mce_setting_track_int(MCE_SETTING_CPU_SCALING_GOVERNOR,
@@ -11339,6 +12332,7 @@ void g_module_unload(GModule *module)
         mdy_governor_conf_setting_id = 0;
 
     /* Switch back to defaults */
+    mdy_governor_boost_stop();
     mdy_governor_rethink();
 
     /* Release CPU scaling governor settings from INI-files */
@@ -11346,6 +12340,8 @@ void g_module_unload(GModule *module)
         mdy_governor_default = 0;
     mdy_governor_free_settings(mdy_governor_interactive),
         mdy_governor_interactive = 0;
+    mdy_governor_free_settings(mdy_governor_boost),
+        mdy_governor_boost = 0;
 #endif
 
     /* Remove triggers/filters from datapipes */
@@ -11381,6 +12377,11 @@ void g_module_unload(GModule *module)
     /* Cancel pending state machine updates */
     mdy_stm_cancel_rethink();
 
+    mdy_specresume_quit();
+
+    /* Detach from statistics snapshot file */
+    mdy_statistics_quit();
+
     mdy_poweron_led_rethink_cancel();
 
     /* Remove callbacks on module unload */
@@ -21,6 +21,8 @@
 #ifndef DISPLAY_H_
 # define DISPLAY_H_
 
+# include <stdint.h>
+
 /* ========================================================================= *
  * Constants
  * ========================================================================= */
@@ -37,6 +39,99 @@
 /** List of max backlight control files to try */
 # define MCE_CONF_MAX_BACKLIGHT_PATH             "MaxBrightnessPath"
 
+/** Path to display statistics snapshot file
+ *
+ * The file contains mce_display_stats_t structure that is kept
+ * up to date by mce and can be mmapped read-only by other processes.
+ */
+# define MCE_DISPLAY_STATS_FILE                  G_STRINGIFY(MCE_RUN_DIR) "/display-stats"
+
+/** Magic number at the start of display statistics snapshot file */
+# define MCE_DISPLAY_STATS_MAGIC                 0x4d434453 /* "MCDS" */
+
+/** Layout version of display statistics snapshot file */
+# define MCE_DISPLAY_STATS_VERSION               1
+
+/** Number of display states in display statistics; = MCE_DISPLAY_NUMSTATES */
+# define MCE_DISPLAY_STATS_STATES                8
+
+/** Number of brightness fader types in display statistics
+ *
+ * In order: idle (unused), default, dimming, als, blank, unblank
+ */
+# define MCE_DISPLAY_STATS_FADERS                6
+
+/** Number of buckets in display statistics latency histograms
+ *
+ * Bucket N counts transitions that took less than 50<<N ms,
+ * the last bucket counts everything that took longer.
+ */
+# define MCE_DISPLAY_STATS_LATENCY_BUCKETS       8
+
+/** Per display state statistics */
+typedef struct
+{
+    /** Number of times the state has been entered */
+    int64_t  entries;
+
+    /** Time spent in the state [ms] */
+    int64_t  time_ms;
+
+    /** Backlight brightness integrated over time spent in the state
+     *  [hw brightness level * ms] */
+    int64_t  brightness_ms;
+} mce_display_stats_state_t;
+
+/** Display statistics snapshot
+ *
+ * Readers should retry if the sequence number is odd, or if it
+ * changes while the data is being copied.
+ */
+typedef struct
+{
+    /** MCE_DISPLAY_STATS_MAGIC */
+    uint32_t magic;
+
+    /** MCE_DISPLAY_STATS_VERSION */
+    uint32_t version;
+
+    /** Size of this structure in bytes */
+    uint32_t size;
+
+    /** Incremented before and after each update */
+    uint32_t sequence;
+
+    /** Boot time of the latest update [ms] */
+    int64_t  updated_ms;
+
+    /** Maximum hw brightness level */
+    int64_t  brightness_max;
+
+    /** Statistics per display state, indexed by display_state_t */
+    mce_display_stats_state_t state[MCE_DISPLAY_STATS_STATES];
+
+    /** Number of brightness fades started, per fader type */
+    int64_t  fade_count[MCE_DISPLAY_STATS_FADERS];
+
+    /** Time spent fading brightness, per fader type [ms] */
+    int64_t  fade_ms[MCE_DISPLAY_STATS_FADERS];
+
+    /** Display power up latency histogram */
+    int64_t  unblank_latency[MCE_DISPLAY_STATS_LATENCY_BUCKETS];
+
+    /** Display power down latency histogram */
+    int64_t  blank_latency[MCE_DISPLAY_STATS_LATENCY_BUCKETS];
+
+    /** Number of ambient light sensor driven brightness changes */
+    int64_t  als_changes;
+} mce_display_stats_t;
+
+/** Whether compositor handoff is started already during fb resume */
+# define MCE_CONF_PARALLEL_UNBLANK               "ParallelUnblank"
+
+/** Default value for MCE_CONF_PARALLEL_UNBLANK */
+# define DEFAULT_PARALLEL_UNBLANK                true
+
 /** Default timeout for the high brightness mode; in seconds */
 # define DEFAULT_HBM_TIMEOUT                     1800    /* 30 min */
 
@@ -473,6 +568,20 @@ typedef enum
 # define MCE_SETTING_DISPLAY_OFF_OVERRIDE                MCE_SETTING_DISPLAY_PATH "/display_off_override"
 # define MCE_DEFAULT_DISPLAY_OFF_OVERRIDE                0 // = DISPLAY_OFF_OVERRIDE_DISABLED
 
+/** Speculative display resume triggering bits */
+# define MCE_SPECULATIVE_RESUME_NONE                     (0)
+# define MCE_SPECULATIVE_RESUME_POWERKEY                 (1<<0)
+# define MCE_SPECULATIVE_RESUME_PROXIMITY                (1<<1)
+
+/** Events that start frame buffer resume early [mask]
+ *
+ * Frame buffer resume is started with backlight off already when
+ * the event arrives, and rolled back if display power up does not
+ * follow soon after.
+ */
+# define MCE_SETTING_DISPLAY_SPECULATIVE_RESUME          MCE_SETTING_DISPLAY_PATH "/speculative_resume"
+# define MCE_DEFAULT_DISPLAY_SPECULATIVE_RESUME          1 // = MCE_SPECULATIVE_RESUME_POWERKEY
+
 /** Display blanking pause modes */
 typedef enum {
     /** Ignore blanking pause requests */
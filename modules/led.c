@@ -79,8 +79,6 @@ G_MODULE_EXPORT module_info_struct module_info = {
 static GQueue *pattern_stack = NULL;
 /** The pattern combination rule queue */
 static GQueue *combination_rule_list = NULL;
-/** The pattern combination rule queue */
-static GQueue *combination_rule_xref_list = NULL;
 /** The D-Bus controlled LED switch */
 static gboolean led_enabled = FALSE;
 
@@ -134,6 +132,20 @@ typedef enum {
  */
 #define CHANNEL_SIZE		32 * 2
 
+/** How much pattern timeouts can be delayed to align with other wakeups */
+#define LED_PATTERN_TIMEOUT_SLACK_MS	1000
+
+/** Number of led controller engines */
+#define LED_ENGINE_COUNT		3
+
+/** One step in software breathing waveform */
+typedef struct {
+	/** Brightness level to use, index to brightness_map */
+	gint level;
+	/** How long the level is held [ms] */
+	gint duration;
+} mono_breath_step_t;
+
 /** Structure holding LED patterns */
 typedef struct {
 	gchar *name;			/**< Pattern name */
@@ -157,8 +169,22 @@ typedef struct {
 	guint setting_id;		/**< Callback ID for GConf entry */
 	guint rgb_color;                /**< RGB24 data for libhybris use */
 	gboolean undecided;		/**< Flag for policy=6 lock in */
+	guint index;			/**< Position in pattern_stack */
+	GSList *rules;			/**< Compiled rules this is used in */
+	mono_breath_step_t *breath_tab;	/**< Sw breathing waveform */
+	guint breath_len;		/**< Number of steps in breath_tab */
 } pattern_struct;
 
+/** Last programming written to a led controller engine */
+typedef struct {
+	/** Engine state: -1 = unknown, 0 = disabled, 1 = running */
+	gint  state;
+	/** Led muxing used for the program */
+	guint mux;
+	/** Program the engine is running */
+	gchar program[CHANNEL_SIZE + 1];
+} led_engine_t;
+
 /** Pattern combination rule struct; this is also used for cross-referencing */
 typedef struct {
 	/** Name of the combined pattern */
@@ -167,6 +193,34 @@ typedef struct {
 	GQueue *pre_requisites;
 } combination_rule_struct;
 
+/** Compiled pattern combination rule */
+typedef struct {
+	/** The combined pattern */
+	pattern_struct *pattern;
+	/** Bitmask of pre-requisite patterns */
+	gulong *mask;
+	/** Some of the pre-requisite patterns do not exist */
+	gboolean impossible;
+} led_rule_t;
+
+/** Number of bits in pattern bitmask words */
+#define LED_MASK_WORD_BITS	(sizeof(gulong) * 8)
+
+/** Number of words in pattern bitmasks */
+static guint led_mask_words = 0;
+
+/** Bitmask of active patterns, indexed by pattern_struct.index */
+static gulong *led_active_mask = NULL;
+
+/** Patterns in pattern_stack order, indexed by pattern_struct.index */
+static pattern_struct **pattern_tab = NULL;
+
+/** Lookup table for patterns by name */
+static GHashTable *pattern_lut = NULL;
+
+/** Compiled pattern combination rules */
+static GSList *led_rule_list = NULL;
+
 /** Pointer to the top pattern */
 static pattern_struct *active_pattern = NULL;
 
@@ -312,6 +366,18 @@ static guint maximum_led_brightness = MAXIMUM_LYSTI_MONOCHROME_LED_CURRENT;
 
 /* Function prototypes */
 static void              disable_reno                   (void);
+static void              led_sysfs_write                (const gchar *path, const gchar *value, gboolean command);
+static void              led_sysfs_cmd                  (const gchar *path, const gchar *value);
+static void              led_sysfs_set                  (const gchar *path, const gchar *value);
+static void              led_sysfs_set_number           (const gchar *path, gulong number);
+static void              led_sysfs_forget               (const gchar *path);
+static void              led_sysfs_init                 (void);
+static void              led_sysfs_quit                 (void);
+static bool              led_engine_write_failed        (void);
+static bool              led_engine_is_running          (guint engine, guint mux, const gchar *program);
+static void              led_engine_set_running         (guint engine, guint mux, const gchar *program);
+static bool              led_engine_is_disabled         (guint count);
+static void              led_engine_set_disabled        (void);
 static led_type_t        get_led_type                   (void);
 static gint              queue_find                     (gconstpointer data, gconstpointer userdata);
 static gint              queue_prio_compare             (gconstpointer entry1, gconstpointer entry2, gpointer userdata);
@@ -332,6 +398,12 @@ static bool              led_pattern_can_breathe        (const pattern_struct *s
 static gboolean          led_pattern_timeout_cb         (gpointer data);
 static void              lysti_program_led              (const pattern_struct *const pattern);
 static void              njoy_program_led               (const pattern_struct *const pattern);
+static void              mono_breath_compile            (pattern_struct *psp);
+static void              mono_breath_schedule           (void);
+static gboolean          mono_breath_timer_cb           (gpointer aptr);
+static void              mono_breath_start              (const pattern_struct *pattern);
+static void              mono_breath_stop               (void);
+static void              mono_set_trigger               (const gchar *trigger);
 static void              mono_program_led               (const pattern_struct *const pattern);
 static void              hybris_program_led             (const pattern_struct *const pattern);
 static void              program_led                    (const pattern_struct *const pattern);
@@ -340,8 +412,8 @@ static void              led_set_active_pattern         (pattern_struct *pattern
 static gboolean          display_off_p                  (display_state_t state);
 static void              led_update_active_pattern      (void);
 static pattern_struct   *find_pattern_struct            (const gchar *const name);
-static void              update_combination_rule        (gpointer name, gpointer data);
-static void              update_combination_rules       (const gchar *const name);
+static void              update_combination_rule        (gpointer data, gpointer aptr);
+static void              update_combination_rules       (pattern_struct *psp);
 static void              led_activate_pattern           (const gchar *const name);
 static void              led_deactivate_pattern         (const gchar *const name);
 static void              led_enable                     (void);
@@ -373,6 +445,12 @@ static void              list_remove_duplicates         (gchar **list);
 static gboolean          list_includes_item             (gchar **list, const gchar *elem);
 static gboolean          init_hybris_patterns           (void);
 static gboolean          init_patterns                  (void);
+static gboolean          led_mask_covers                (const gulong *mask);
+static led_rule_t       *led_rule_create                (pattern_struct *psp, GQueue *names);
+static void              led_rule_delete                (led_rule_t *self);
+static void              led_rule_delete_cb             (gpointer self);
+static void              led_patterns_compile           (void);
+static void              led_patterns_release           (void);
 static void              sw_breathing_rethink           (void);
 static void              sw_breathing_setting_cb        (GConfClient *const gcc, const guint id, GConfEntry *const entry, gpointer const data);
 static void              sw_breathing_quit              (void);
@@ -659,6 +737,215 @@ static gint queue_prio_compare(gconstpointer entry1,
 	return psp1->priority - psp2->priority;
 }
 
+/** Last values written to state-like sysfs attributes: path -> value */
+static GHashTable *led_sysfs_cache = NULL;
+
+/** Number of sysfs writes passed to the worker thread */
+static guint led_sysfs_async_writes = 0;
+
+/** Queue a sysfs write
+ *
+ * Writes to state-like attributes are skipped if the value does not
+ * differ from what was written the last time. Writes to command-like
+ * attributes, such as engine modes and led triggers, are always made.
+ * They can change the values of other attributes in the kernel side,
+ * so callers must use led_sysfs_forget() for the affected attributes.
+ *
+ * Cached values are not trusted for paths where writing has failed.
+ *
+ * Programming LED controller engines can take a while, so the
+ * writes are made in the worker thread, in submission order.
+ * Mono-LED attributes are quick to write, and sw breathing updates
+ * the brightness several times per second, so for mono-LEDs the
+ * writes are made synchronously to avoid worker and notify wakeups.
+ *
+ * @param path    sysfs file path
+ * @param value   value to write
+ * @param command TRUE for command-like attribute, FALSE otherwise
+ */
+static void led_sysfs_write(const gchar *path, const gchar *value,
+			    gboolean command)
+{
+	if( !path || !value || !led_sysfs_cache )
+		goto EXIT;
+
+	if( !command ) {
+		const gchar *prev = g_hash_table_lookup(led_sysfs_cache, path);
+
+		/* Values that could not be written must not be treated
+		 * as already being in place */
+		if( prev && !strcmp(prev, value) &&
+		    !mce_io_write_async_failed(path) )
+			goto EXIT;
+
+		g_hash_table_replace(led_sysfs_cache,
+				     g_strdup(path), g_strdup(value));
+	}
+
+	if( get_led_type() == LED_TYPE_DIRECT_MONO ) {
+		if( !mce_write_string_to_file(path, value) )
+			led_sysfs_forget(path);
+	}
+	else {
+		/* Command writes must not be collapsed, and they must not
+		 * be reordered with respect to state writes */
+		mce_io_write_async_full(path, value, !command);
+		led_sysfs_async_writes += 1;
+	}
+
+EXIT:
+	return;
+}
+
+/** Queue a write to command-like sysfs attribute
+ *
+ * @param path  sysfs file path
+ * @param value value to write
+ */
+static void led_sysfs_cmd(const gchar *path, const gchar *value)
+{
+	led_sysfs_write(path, value, TRUE);
+}
+
+/** Queue a write to state-like sysfs attribute
+ *
+ * @param path  sysfs file path
+ * @param value value to write
+ */
+static void led_sysfs_set(const gchar *path, const gchar *value)
+{
+	led_sysfs_write(path, value, FALSE);
+}
+
+/** Queue a number write to state-like sysfs attribute
+ *
+ * @param path   sysfs file path
+ * @param number value to write
+ */
+static void led_sysfs_set_number(const gchar *path, gulong number)
+{
+	gchar value[32];
+
+	snprintf(value, sizeof value, "%lu", number);
+	led_sysfs_write(path, value, FALSE);
+}
+
+/** Forget the cached value of state-like sysfs attribute
+ *
+ * @param path sysfs file path
+ */
+static void led_sysfs_forget(const gchar *path)
+{
+	if( path && led_sysfs_cache )
+		g_hash_table_remove(led_sysfs_cache, path);
+}
+
+/** Initialize sysfs write state cache
+ */
+static void led_sysfs_init(void)
+{
+	led_sysfs_cache = g_hash_table_new_full(g_str_hash, g_str_equal,
+						g_free, g_free);
+}
+
+/** Release sysfs write state cache
+ */
+static void led_sysfs_quit(void)
+{
+	if( led_sysfs_cache ) {
+		g_hash_table_unref(led_sysfs_cache);
+		led_sysfs_cache = NULL;
+	}
+}
+
+/** Led controller engine states, unknown until first programmed */
+static led_engine_t led_engine[LED_ENGINE_COUNT] = {
+	{ .state = -1 }, { .state = -1 }, { .state = -1 },
+};
+
+/** Check if the latest write to any led controller engine failed
+ *
+ * @return true if engine state is unreliable, false otherwise
+ */
+static bool led_engine_write_failed(void)
+{
+	const gchar *paths[] = {
+		engine1_mode_path, engine1_load_path, engine1_leds_path,
+		engine2_mode_path, engine2_load_path, engine2_leds_path,
+		engine3_mode_path, engine3_load_path, engine3_leds_path,
+	};
+
+	for( size_t i = 0; i < G_N_ELEMENTS(paths); ++i ) {
+		if( mce_io_write_async_failed(paths[i]) )
+			return true;
+	}
+	return false;
+}
+
+/** Check if led controller engine is already running a program
+ *
+ * @param engine  engine index, 0 ... LED_ENGINE_COUNT-1
+ * @param mux     led muxing
+ * @param program engine program
+ *
+ * @return true if the engine runs the program, false otherwise
+ */
+static bool led_engine_is_running(guint engine, guint mux,
+				  const gchar *program)
+{
+	const led_engine_t *self = &led_engine[engine];
+
+	return (self->state == 1 && self->mux == mux &&
+		!strcmp(self->program, program) &&
+		!led_engine_write_failed());
+}
+
+/** Remember the program a led controller engine was set to run
+ *
+ * @param engine  engine index, 0 ... LED_ENGINE_COUNT-1
+ * @param mux     led muxing
+ * @param program engine program
+ */
+static void led_engine_set_running(guint engine, guint mux,
+				   const gchar *program)
+{
+	led_engine_t *self = &led_engine[engine];
+
+	self->state = 1;
+	self->mux   = mux;
+	g_strlcpy(self->program, program, sizeof self->program);
+}
+
+/** Check if led controller engines are already disabled
+ *
+ * @param count number of engines in use
+ *
+ * @return true if all engines are disabled, false otherwise
+ */
+static bool led_engine_is_disabled(guint count)
+{
+	for( guint i = 0; i < count; ++i ) {
+		if( led_engine[i].state != 0 )
+			return false;
+	}
+	return !led_engine_write_failed();
+}
+
+/** Remember that led controller engines were disabled
+ *
+ * Running engines drive the led channels, so the cached
+ * channel brightness values are forgotten too.
+ */
+static void led_engine_set_disabled(void)
+{
+	for( guint i = 0; i < LED_ENGINE_COUNT; ++i )
+		led_engine[i].state = 0;
+
+	led_sysfs_forget(led_brightness_rm_output.path);
+	led_sysfs_forget(led_brightness_g_output.path);
+	led_sysfs_forget(led_brightness_b_output.path);
+}
+
 /**
  * Set Lysti-LED brightness
  *
@@ -717,16 +1004,16 @@ static void lysti_set_brightness(gint brightness)
 
 	if (get_led_type() == LED_TYPE_LYSTI_MONO) {
 		/* If we have a monochrome LED only set one brightness */
-		mce_write_number_string_to_file(&led_current_rm_output, r_brightness);
+		led_sysfs_set_number(led_current_rm_output.path, r_brightness);
 
 		mce_log(LL_DEBUG,
 			"Brightness set to %d",
 			active_brightness);
 	} else if (get_led_type() == LED_TYPE_LYSTI_RGB) {
 		/* If we have an RGB LED set the brightness for all channels */
-		mce_write_number_string_to_file(&led_current_rm_output, r_brightness);
-		mce_write_number_string_to_file(&led_current_g_output, g_brightness);
-		mce_write_number_string_to_file(&led_current_b_output, b_brightness);
+		led_sysfs_set_number(led_current_rm_output.path, r_brightness);
+		led_sysfs_set_number(led_current_g_output.path, g_brightness);
+		led_sysfs_set_number(led_current_b_output.path, b_brightness);
 
 		mce_log(LL_DEBUG,
 			"Brightness set to %d (%d, %d, %d)",
@@ -768,8 +1055,8 @@ static void njoy_set_brightness(gint brightness)
 		active_brightness = brightness;
 	}
 
-	mce_write_number_string_to_file(&led_brightness_rm_output,
-					(unsigned)active_brightness);
+	led_sysfs_set_number(led_brightness_rm_output.path,
+			     (unsigned)active_brightness);
 
 	mce_log(LL_DEBUG, "Brightness set to %d", active_brightness);
 }
@@ -790,8 +1077,12 @@ static void mono_set_brightness(gint brightness)
 		return;
 
 	active_brightness = brightness;
-	mce_write_string_to_file(led_brightness_rm_output.path,
-				 brightness_map[brightness]);
+
+	/* Written synchronously via persistent file descriptor; this
+	 * is done several times per second while breathing */
+	mce_write_number_string_to_file(&led_brightness_rm_output,
+					strtoul(brightness_map[brightness],
+						0, 10));
 
 	mce_log(LL_DEBUG, "Brightness set to %d", brightness);
 }
@@ -832,23 +1123,30 @@ static void hybris_set_brightness(gint brightness)
  */
 static void lysti_disable_led(void)
 {
+	bool rgb = (get_led_type() == LED_TYPE_LYSTI_RGB);
+
+	/* Nothing to do if the engines are already disabled */
+	if (led_engine_is_disabled(rgb ? 2 : 1))
+		goto EXIT;
+
 	/* Disable engine 1 */
-	mce_write_string_to_file(engine1_mode_path,
-				 MCE_LED_DISABLED_MODE);
+	led_sysfs_cmd(engine1_mode_path, MCE_LED_DISABLED_MODE);
 
-	if (get_led_type() == LED_TYPE_LYSTI_MONO) {
-		/* Turn off the led */
-		mce_write_number_string_to_file(&led_brightness_rm_output, 0);
-	} else if (get_led_type() == LED_TYPE_LYSTI_RGB) {
-		/* Disable engine 2 */
-		mce_write_string_to_file(engine2_mode_path,
-					 MCE_LED_DISABLED_MODE);
+	/* Disable engine 2 */
+	if (rgb)
+		led_sysfs_cmd(engine2_mode_path, MCE_LED_DISABLED_MODE);
 
-		/* Turn off all three leds */
-		mce_write_number_string_to_file(&led_brightness_rm_output, 0);
-		mce_write_number_string_to_file(&led_brightness_g_output, 0);
-		mce_write_number_string_to_file(&led_brightness_b_output, 0);
+	led_engine_set_disabled();
+
+	/* Turn off the led / all three leds */
+	led_sysfs_set_number(led_brightness_rm_output.path, 0);
+	if (rgb) {
+		led_sysfs_set_number(led_brightness_g_output.path, 0);
+		led_sysfs_set_number(led_brightness_b_output.path, 0);
 	}
+
+EXIT:
+	return;
 }
 
 /**
@@ -856,27 +1154,32 @@ static void lysti_disable_led(void)
  */
 static void njoy_disable_led(void)
 {
+	bool rgb = (get_led_type() == LED_TYPE_NJOY_RGB);
+
+	/* Nothing to do if the engines are already disabled */
+	if (led_engine_is_disabled(rgb ? 3 : 1))
+		goto EXIT;
+
 	/* Disable engine 1 */
-	mce_write_string_to_file(engine1_mode_path,
-				 MCE_LED_DISABLED_MODE);
+	led_sysfs_cmd(engine1_mode_path, MCE_LED_DISABLED_MODE);
 
-	if (get_led_type() == LED_TYPE_NJOY_MONO) {
-		/* Turn off the led */
-		mce_write_number_string_to_file(&led_brightness_rm_output, 0);
-	} else if (get_led_type() == LED_TYPE_NJOY_RGB) {
-		/* Disable engine 2 */
-		mce_write_string_to_file(engine2_mode_path,
-					 MCE_LED_DISABLED_MODE);
+	/* Disable engines 2 and 3 */
+	if (rgb) {
+		led_sysfs_cmd(engine2_mode_path, MCE_LED_DISABLED_MODE);
+		led_sysfs_cmd(engine3_mode_path, MCE_LED_DISABLED_MODE);
+	}
 
-		/* Disable engine 3 */
-		mce_write_string_to_file(engine3_mode_path,
-					 MCE_LED_DISABLED_MODE);
+	led_engine_set_disabled();
 
-		/* Turn off all three leds */
-		mce_write_number_string_to_file(&led_brightness_rm_output, 0);
-		mce_write_number_string_to_file(&led_brightness_g_output, 0);
-		mce_write_number_string_to_file(&led_brightness_b_output, 0);
+	/* Turn off the led / all three leds */
+	led_sysfs_set_number(led_brightness_rm_output.path, 0);
+	if (rgb) {
+		led_sysfs_set_number(led_brightness_g_output.path, 0);
+		led_sysfs_set_number(led_brightness_b_output.path, 0);
 	}
+
+EXIT:
+	return;
 }
 
 /**
@@ -884,8 +1187,8 @@ static void njoy_disable_led(void)
  */
 static void mono_disable_led(void)
 {
-	mce_write_string_to_file(MCE_LED_TRIGGER_PATH,
-				 MCE_LED_TRIGGER_NONE);
+	mono_breath_stop();
+	mono_set_trigger(MCE_LED_TRIGGER_NONE);
 	mono_set_brightness(0);
 }
 
@@ -960,6 +1263,7 @@ static void led_pattern_delete(pattern_struct *self)
 	mce_hbtimer_delete(self->timeout_id);
 	mce_setting_notifier_remove(self->setting_id);
 	free(self->name);
+	g_free(self->breath_tab);
 
 	g_slice_free(pattern_struct, self);
 
@@ -991,6 +1295,15 @@ static void led_pattern_set_active(pattern_struct *self, gboolean active)
 
 	self->active = active;
 
+	if( led_active_mask ) {
+		gulong bit = 1ul << (self->index % LED_MASK_WORD_BITS);
+
+		if( active )
+			led_active_mask[self->index / LED_MASK_WORD_BITS] |= bit;
+		else
+			led_active_mask[self->index / LED_MASK_WORD_BITS] &= ~bit;
+	}
+
 	if( !self->enabled )
 		goto EXIT;
 
@@ -1141,36 +1454,45 @@ static gboolean led_pattern_timeout_cb(gpointer data)
  */
 static void lysti_program_led(const pattern_struct *const pattern)
 {
+	bool rgb = (get_led_type() == LED_TYPE_LYSTI_RGB);
+
+	/* Skip reprogramming if the engines already run the pattern */
+	if (led_engine_is_running(0, pattern->engine1_mux, pattern->channel1) &&
+	    (!rgb || led_engine_is_running(1, pattern->engine2_mux,
+					   pattern->channel2))) {
+		mce_log(LL_DEBUG, "%s: already programmed", pattern->name);
+		goto EXIT;
+	}
+
 	/* Disable old LED patterns */
 	lysti_disable_led();
 
 	/* Load new patterns, one engine at a time */
 
 	/* Engine 1 */
-	mce_write_string_to_file(engine1_mode_path,
-				 MCE_LED_LOAD_MODE);
-	mce_write_string_to_file(engine1_leds_path,
-				 bin_to_string(pattern->engine1_mux));
-	mce_write_string_to_file(engine1_load_path,
-				 pattern->channel1);
+	led_sysfs_cmd(engine1_mode_path, MCE_LED_LOAD_MODE);
+	led_sysfs_cmd(engine1_leds_path, bin_to_string(pattern->engine1_mux));
+	led_sysfs_cmd(engine1_load_path, pattern->channel1);
 
 	/* Engine 2; if needed */
-	if (get_led_type() == LED_TYPE_LYSTI_RGB) {
-		mce_write_string_to_file(engine2_mode_path,
-					 MCE_LED_LOAD_MODE);
-		mce_write_string_to_file(engine2_leds_path,
-					 bin_to_string(pattern->engine2_mux));
-		mce_write_string_to_file(engine2_load_path,
-					 pattern->channel2);
+	if (rgb) {
+		led_sysfs_cmd(engine2_mode_path, MCE_LED_LOAD_MODE);
+		led_sysfs_cmd(engine2_leds_path,
+			      bin_to_string(pattern->engine2_mux));
+		led_sysfs_cmd(engine2_load_path, pattern->channel2);
 
 		/* Run the new pattern; enable engines in reverse order */
-		mce_write_string_to_file(engine2_mode_path,
-					 MCE_LED_RUN_MODE);
+		led_sysfs_cmd(engine2_mode_path, MCE_LED_RUN_MODE);
 	}
 
-	mce_write_string_to_file(engine1_mode_path,
-				 MCE_LED_RUN_MODE);
+	led_sysfs_cmd(engine1_mode_path, MCE_LED_RUN_MODE);
+
+	led_engine_set_running(0, pattern->engine1_mux, pattern->channel1);
+	if (rgb)
+		led_engine_set_running(1, pattern->engine2_mux,
+				       pattern->channel2);
 
+EXIT:
 	/* Save what colors we are driving */
 	current_lysti_led_pattern = pattern->engine1_mux | pattern->engine2_mux;
 
@@ -1187,44 +1509,261 @@ static void lysti_program_led(const pattern_struct *const pattern)
  */
 static void njoy_program_led(const pattern_struct *const pattern)
 {
+	bool rgb = (get_led_type() == LED_TYPE_NJOY_RGB);
+
+	/* Skip reprogramming if the engines already run the pattern */
+	if (led_engine_is_running(0, 0, pattern->channel1) &&
+	    (!rgb || (led_engine_is_running(1, 0, pattern->channel2) &&
+		      led_engine_is_running(2, 0, pattern->channel3)))) {
+		mce_log(LL_DEBUG, "%s: already programmed", pattern->name);
+		goto EXIT;
+	}
+
 	/* Disable old LED patterns */
 	njoy_disable_led();
 
 	/* Load new patterns */
 
 	/* Engine 1 */
-	mce_write_string_to_file(engine1_mode_path,
-				 MCE_LED_LOAD_MODE);
-	mce_write_string_to_file(engine1_load_path,
-				 pattern->channel1);
+	led_sysfs_cmd(engine1_mode_path, MCE_LED_LOAD_MODE);
+	led_sysfs_cmd(engine1_load_path, pattern->channel1);
 
-	if (get_led_type() == LED_TYPE_NJOY_RGB) {
+	if (rgb) {
 		/* Engine 2 */
-		mce_write_string_to_file(engine2_mode_path,
-					 MCE_LED_LOAD_MODE);
-		mce_write_string_to_file(engine2_load_path,
-					 pattern->channel2);
+		led_sysfs_cmd(engine2_mode_path, MCE_LED_LOAD_MODE);
+		led_sysfs_cmd(engine2_load_path, pattern->channel2);
 
 		/* Engine 3 */
-		mce_write_string_to_file(engine3_mode_path,
-					 MCE_LED_LOAD_MODE);
-		mce_write_string_to_file(engine3_load_path,
-					 pattern->channel3);
+		led_sysfs_cmd(engine3_mode_path, MCE_LED_LOAD_MODE);
+		led_sysfs_cmd(engine3_load_path, pattern->channel3);
 
 		/* Run the new pattern; enable engines in reverse order */
-		mce_write_string_to_file(engine3_mode_path,
-					 MCE_LED_RUN_MODE);
-		mce_write_string_to_file(engine2_mode_path,
-					 MCE_LED_RUN_MODE);
+		led_sysfs_cmd(engine3_mode_path, MCE_LED_RUN_MODE);
+		led_sysfs_cmd(engine2_mode_path, MCE_LED_RUN_MODE);
 	}
 
-	mce_write_string_to_file(engine1_mode_path,
-				 MCE_LED_RUN_MODE);
+	led_sysfs_cmd(engine1_mode_path, MCE_LED_RUN_MODE);
 
+	led_engine_set_running(0, 0, pattern->channel1);
+	if (rgb) {
+		led_engine_set_running(1, 0, pattern->channel2);
+		led_engine_set_running(2, 0, pattern->channel3);
+	}
+
+EXIT:
 	/* Reset brightness */
 	njoy_set_brightness(-1);
 }
 
+/** Flag for: sw breathing of mono-LED is allowed */
+static bool mono_breath_allowed = false;
+
+/** Pattern that is being breathed, or NULL */
+static const pattern_struct *mono_breath_pattern = NULL;
+
+/** Current position in breathing waveform */
+static guint mono_breath_step = 0;
+
+/** Timer for advancing the breathing waveform */
+static guint mono_breath_timer_id = 0;
+
+/** Number of timer wakeups during the current breathing cycle */
+static guint mono_breath_wakeups = 0;
+
+/** Value of led_sysfs_async_writes when the breathing cycle started */
+static guint mono_breath_async_base = 0;
+
+/** When the current breathing cycle was started [ms] */
+static int64_t mono_breath_cycle_tick = 0;
+
+/** Gamma corrected intensity along a breathing curve
+ *
+ * Smoothstep is used for approximating raised cosine and squaring
+ * for approximating gamma correction, so that no floating point
+ * math is needed.
+ *
+ * @param pos  position along the curve, 0 ... 65536
+ *
+ * @return intensity, 0 ... 65536
+ */
+static int64_t mono_breath_intensity(int64_t pos)
+{
+	int64_t lin = (pos * pos * (3 * 65536 - 2 * pos)) >> 32;
+	return (lin * lin) >> 16;
+}
+
+/** Precompute software breathing waveform for a mono-LED pattern
+ *
+ * Brightness rises during the on-period and falls during the
+ * off-period. Only level changes are stored, so that the waveform
+ * can be played back with as few timer wakeups as possible.
+ *
+ * @param psp led pattern object
+ */
+static void mono_breath_compile(pattern_struct *psp)
+{
+	gint  period = psp->on_period + psp->off_period;
+	gint  top    = CLAMP(psp->brightness, 0, 15);
+	guint len    = 0;
+
+	g_free(psp->breath_tab), psp->breath_tab = NULL;
+	psp->breath_len = 0;
+
+	if( psp->on_period <= 0 || psp->off_period <= 0 || top < 1 )
+		goto EXIT;
+
+	/* Rising and falling edge pass each level once */
+	psp->breath_tab = g_new0(mono_breath_step_t, 2 * top + 2);
+
+	for( gint t = 0; t < period; ++t ) {
+		int64_t pos;
+
+		if( t < psp->on_period )
+			pos = (int64_t)t * 65536 / psp->on_period;
+		else
+			pos = 65536 - (int64_t)(t - psp->on_period) * 65536 / psp->off_period;
+
+		gint level = (gint)((mono_breath_intensity(pos) * top + 32768) >> 16);
+
+		if( len == 0 || psp->breath_tab[len-1].level != level ) {
+			psp->breath_tab[len].level    = level;
+			psp->breath_tab[len].duration = 0;
+			++len;
+		}
+		psp->breath_tab[len-1].duration += 1;
+	}
+
+	psp->breath_len = len;
+
+	mce_log(LL_DEBUG, "%s: %u breathing steps per %d ms",
+		psp->name, len, period);
+
+EXIT:
+	return;
+}
+
+/** Program current breathing step and schedule the next one
+ */
+static void mono_breath_schedule(void)
+{
+	const mono_breath_step_t *step =
+		&mono_breath_pattern->breath_tab[mono_breath_step];
+
+	mono_set_brightness(step->level);
+
+	mono_breath_timer_id = g_timeout_add(step->duration,
+					     mono_breath_timer_cb, 0);
+}
+
+/** Timer callback for advancing the breathing waveform
+ *
+ * @param aptr Unused
+ *
+ * @return FALSE to stop the timer from repeating
+ */
+static gboolean mono_breath_timer_cb(gpointer aptr)
+{
+	(void)aptr;
+
+	if( !mono_breath_timer_id )
+		goto EXIT;
+
+	mono_breath_timer_id = 0;
+
+	if( !mono_breath_pattern )
+		goto EXIT;
+
+	++mono_breath_wakeups;
+
+	if( ++mono_breath_step >= mono_breath_pattern->breath_len ) {
+		int64_t now   = mce_lib_get_boot_tick();
+		guint   async = led_sysfs_async_writes - mono_breath_async_base;
+
+		/* Each write passed to the worker thread can cause a
+		 * worker wakeup and a mainloop notify wakeup */
+		mce_log(LL_DEBUG, "%s: breathing cycle took %" G_GINT64_FORMAT " ms,"
+			" %u wakeups (timer=%u worker=%u notify=%u)",
+			mono_breath_pattern->name,
+			now - mono_breath_cycle_tick,
+			mono_breath_wakeups + 2 * async,
+			mono_breath_wakeups, async, async);
+
+		mono_breath_cycle_tick = now;
+		mono_breath_wakeups    = 0;
+		mono_breath_async_base = led_sysfs_async_writes;
+		mono_breath_step       = 0;
+	}
+
+	mono_breath_schedule();
+
+EXIT:
+	return FALSE;
+}
+
+/** Start software breathing of mono-LED pattern
+ *
+ * The mce_led_breathing wakelock is held while breathing.
+ *
+ * @param pattern led pattern object
+ */
+static void mono_breath_start(const pattern_struct *pattern)
+{
+	mono_breath_stop();
+
+	if( !pattern->breath_len )
+		goto EXIT;
+
+	wakelock_lock("mce_led_breathing", -1);
+
+	mce_log(LL_DEBUG, "%s: start breathing", pattern->name);
+
+	mono_breath_pattern    = pattern;
+	mono_breath_step       = 0;
+	mono_breath_wakeups    = 0;
+	mono_breath_async_base = led_sysfs_async_writes;
+	mono_breath_cycle_tick = mce_lib_get_boot_tick();
+
+	mono_breath_schedule();
+
+EXIT:
+	return;
+}
+
+/** Stop software breathing of mono-LED pattern
+ */
+static void mono_breath_stop(void)
+{
+	if( !mono_breath_pattern )
+		goto EXIT;
+
+	mce_log(LL_DEBUG, "%s: stop breathing", mono_breath_pattern->name);
+
+	if( mono_breath_timer_id )
+		g_source_remove(mono_breath_timer_id), mono_breath_timer_id = 0;
+
+	mono_breath_pattern = NULL;
+
+	wakelock_unlock("mce_led_breathing");
+
+EXIT:
+	return;
+}
+
+/** Select mono-LED trigger
+ *
+ * The timer trigger creates its period attributes with
+ * default values, so cached periods are forgotten.
+ *
+ * @param trigger trigger name
+ */
+static void mono_set_trigger(const gchar *trigger)
+{
+	led_sysfs_cmd(MCE_LED_TRIGGER_PATH, trigger);
+
+	led_sysfs_forget(MCE_LED_OFF_PERIOD_PATH);
+	led_sysfs_forget(MCE_LED_ON_PERIOD_PATH);
+}
+
 /**
  * Setup and activate a new mono-LED pattern
  *
@@ -1232,20 +1771,7 @@ static void njoy_program_led(const pattern_struct *const pattern)
  */
 static void mono_program_led(const pattern_struct *const pattern)
 {
-	static output_state_t led_on_period_output =
-	{
-		.context = "led_on_period",
-		.truncate_file = TRUE,
-		.close_on_exit = TRUE,
-		.path = MCE_LED_ON_PERIOD_PATH,
-	};
-	static output_state_t led_off_period_output =
-	{
-		.context = "led_off_period",
-		.truncate_file = TRUE,
-		.close_on_exit = TRUE,
-		.path = MCE_LED_OFF_PERIOD_PATH,
-	};
+	mono_breath_stop();
 
 	/* This shouldn't happen; disable the LED instead */
 	if (pattern->on_period == 0) {
@@ -1253,19 +1779,24 @@ static void mono_program_led(const pattern_struct *const pattern)
 		goto EXIT;
 	}
 
+	/* Breathe in software if allowed and possible */
+	if( mono_breath_allowed && pattern->breath_len ) {
+		mono_set_trigger(MCE_LED_TRIGGER_NONE);
+		mono_breath_start(pattern);
+		goto EXIT;
+	}
+
 	/* If we have a normal, on/off pattern,
 	 * use a timer trigger, otherwise disable the trigger
 	 */
 	if (pattern->off_period != 0) {
-		mce_write_string_to_file(MCE_LED_TRIGGER_PATH,
-					 MCE_LED_TRIGGER_TIMER);
-		mce_write_number_string_to_file(&led_off_period_output,
-						(unsigned)pattern->off_period);
-		mce_write_number_string_to_file(&led_on_period_output,
-						(unsigned)pattern->on_period);
+		mono_set_trigger(MCE_LED_TRIGGER_TIMER);
+		led_sysfs_set_number(MCE_LED_OFF_PERIOD_PATH,
+				     (unsigned)pattern->off_period);
+		led_sysfs_set_number(MCE_LED_ON_PERIOD_PATH,
+				     (unsigned)pattern->on_period);
 	} else {
-		mce_write_string_to_file(MCE_LED_TRIGGER_PATH,
-					 MCE_LED_TRIGGER_NONE);
+		mono_set_trigger(MCE_LED_TRIGGER_NONE);
 	}
 
 	mono_set_brightness(pattern->brightness);
@@ -1335,8 +1866,17 @@ static void allow_sw_breathing(bool enable)
 
 	/* If led backend does not support breathing make sure we do
 	 * not grab a useless wakelock and block suspend unnecessarily */
-	if( !mce_hybris_indicator_can_breathe() )
-		enable = false;
+	switch (get_led_type()) {
+	case LED_TYPE_DIRECT_MONO:
+		/* Breathing engine in this module, the wakelock is
+		 * held only while actually breathing */
+		break;
+
+	default:
+		if( !mce_hybris_indicator_can_breathe() )
+			enable = false;
+		break;
+	}
 
 	if( current == enable )
 		goto EXIT;
@@ -1344,6 +1884,15 @@ static void allow_sw_breathing(bool enable)
 	current = enable;
 
 	switch (get_led_type()) {
+	case LED_TYPE_DIRECT_MONO:
+		/* Switch between timer trigger and sw breathing */
+		mono_breath_allowed = enable;
+		if( active_pattern )
+			mono_program_led(active_pattern);
+		else
+			mono_breath_stop();
+		break;
+
 #ifdef ENABLE_HYBRIS
 	case LED_TYPE_HYBRIS:
 		if( enable )
@@ -1415,21 +1964,34 @@ static gboolean display_off_p(display_state_t state)
 
 /**
  * Recalculate active pattern and update the pattern timer
+ *
+ * Only active patterns are visited, in priority order.
  */
 static void led_update_active_pattern(void)
 {
 	pattern_struct *new_active_pattern = 0;
 
-	if( !pattern_stack )
+	if( !led_active_mask )
 		goto EXIT;
 
-	for( GList *iter = pattern_stack->head; ; iter = iter->next ) {
-		if( !iter ) {
+	for( guint w = 0, b = 0; ; ) {
+		gint nth = -1;
+
+		/* Find next active pattern */
+		while( w < led_mask_words ) {
+			nth = g_bit_nth_lsf(led_active_mask[w], (gint)b - 1);
+			if( nth >= 0 )
+				break;
+			++w, b = 0;
+		}
+
+		if( nth < 0 ) {
 			new_active_pattern = 0;
 			break;
 		}
 
-		new_active_pattern = iter->data;
+		b = (guint)nth + 1;
+		new_active_pattern = pattern_tab[w * LED_MASK_WORD_BITS + nth];
 
 #if 0 /* While this can be useful when actively debugging led
        * activation logic, it creates so much noise that using
@@ -1515,15 +2077,11 @@ EXIT:
 static pattern_struct *find_pattern_struct(const gchar *const name)
 {
 	pattern_struct *psp = NULL;
-	GList *glp;
 
-	if (name == NULL)
+	if (name == NULL || pattern_lut == NULL)
 		goto EXIT;
 
-	if ((glp = g_queue_find_custom(pattern_stack,
-				       name, queue_find)) != NULL) {
-		psp = (pattern_struct *)glp->data;
-	}
+	psp = g_hash_table_lookup(pattern_lut, name);
 
 EXIT:
 	return psp;
@@ -1532,70 +2090,38 @@ EXIT:
 /**
  * Update combination rule
  *
- * @param name The rule to process
- * @param data Unused
+ * @param data The compiled rule to process
+ * @param aptr Unused
  */
-static void update_combination_rule(gpointer name, gpointer data)
+static void update_combination_rule(gpointer data, gpointer aptr)
 {
-	combination_rule_struct *cr;
-	gboolean enabled = TRUE;
-	pattern_struct *psp;
-	GList *glp;
-	gchar *tmp;
-	gint i;
-
-	(void)data;
+	led_rule_t *rule = data;
 
-	if ((glp = g_queue_find_custom(combination_rule_list,
-				       name, queue_find)) == NULL)
-		goto EXIT;
-
-	cr = glp->data;
+	(void)aptr;
 
-	/* If all patterns in the pre_requisite list are enabled,
-	 * then enable this pattern, else disable it
+	/* If all patterns in the pre_requisite list are active,
+	 * then activate this pattern, else deactivate it
 	 */
-	for (i = 0; (tmp = g_queue_peek_nth(cr->pre_requisites, i)) != NULL; i++) {
-		/* We've got a pattern name; check if that pattern is active */
-		if (((psp = find_pattern_struct(tmp)) == NULL) ||
-		    (psp->active == FALSE)) {
-			enabled = FALSE;
-			break;
-		}
-	}
-
-	if ((psp = find_pattern_struct(name)) == NULL)
-		goto EXIT;
-
-	led_pattern_set_active(psp, enabled);
-
-EXIT:
-	return;
+	led_pattern_set_active(rule->pattern,
+			       !rule->impossible &&
+			       led_mask_covers(rule->mask));
 }
 
 /**
  * Update activate patterns based on combination rules
  *
- * @param name THe name of the pattern that changed state
+ * @param psp The pattern that changed state
  */
-static void update_combination_rules(const gchar *const name)
+static void update_combination_rules(pattern_struct *psp)
 {
-	GList *glp;
-
-	if (name == NULL) {
+	if (psp == NULL) {
 		mce_log(LL_CRIT,
-			"called with name == NULL");
+			"called with psp == NULL");
 		goto EXIT;
 	}
 
-	if ((glp = g_queue_find_custom(combination_rule_xref_list, name,
-				       queue_find)) != NULL) {
-		combination_rule_struct *xrf = glp->data;
-
-		/* Update all combination rules that this pattern influences */
-		g_queue_foreach(xrf->pre_requisites,
-				update_combination_rule, NULL);
-	}
+	/* Update all combination rules that this pattern influences */
+	g_slist_foreach(psp->rules, update_combination_rule, NULL);
 
 EXIT:
 	return;
@@ -1620,7 +2146,7 @@ static void led_activate_pattern(const gchar *const name)
 		if( !psp->active && psp->policy == 6 )
 			psp->undecided = TRUE;
 		led_pattern_set_active(psp, TRUE);
-		update_combination_rules(name);
+		update_combination_rules(psp);
 		led_update_active_pattern();
 	} else {
 		mce_log(LL_DEBUG,
@@ -1643,7 +2169,7 @@ static void led_deactivate_pattern(const gchar *const name)
 
 	if ((psp = find_pattern_struct(name)) != NULL) {
 		led_pattern_set_active(psp, FALSE);
-		update_combination_rules(name);
+		update_combination_rules(psp);
 		led_update_active_pattern();
 	} else {
 		mce_log(LL_DEBUG,
@@ -1755,7 +2281,7 @@ static void type6_revert_cb(void *data, void *aptr)
 
 	if( psp->undecided && psp->active && psp->policy == 6 ) {
 		led_pattern_set_active(psp, FALSE);
-		update_combination_rules(psp->name);
+		update_combination_rules(psp);
 		mce_log(LL_DEBUG, "LED pattern %s: reverted", psp->name);
 	}
 	psp->undecided = FALSE;
@@ -1774,7 +2300,7 @@ static void type6_deactivate_cb(void *data, void *aptr)
 
 	if( psp->active && psp->policy == 6 ) {
 		led_pattern_set_active(psp, FALSE);
-		update_combination_rules(psp->name);
+		update_combination_rules(psp);
 		mce_log(LL_DEBUG, "LED pattern %s: deactivated", psp->name);
 	}
 	psp->undecided = FALSE;
@@ -1849,6 +2375,9 @@ static void display_state_curr_trigger(gconstpointer data)
 
 	led_update_active_pattern();
 
+	/* Sw breathing cutoff depends on display state */
+	sw_breathing_rethink();
+
 EXIT:
 	return;
 }
@@ -2221,29 +2750,8 @@ static gboolean init_combination_rules(void)
 
 			for (j = 1; j < length; j++) {
 				gchar *str = strdup(tmp[j]);
-				GList *glp;
-				combination_rule_struct *xrf = NULL;
 
 				g_queue_push_head(cr->pre_requisites, str);
-
-				glp = g_queue_find_custom(combination_rule_xref_list, str, queue_find);
-
-				if ((glp == NULL) || (glp->data == NULL)) {
-					xrf = g_slice_new(combination_rule_struct);
-					xrf->rulename = str;
-					xrf->pre_requisites = g_queue_new();
-					g_queue_push_head(combination_rule_xref_list, xrf);
-				} else {
-					xrf = (combination_rule_struct *)glp->data;
-				}
-
-				/* If the cross reference isn't in the list
-				 * already, add it
-				 */
-				if (g_queue_find_custom(xrf->pre_requisites, cr->rulename, queue_find) == NULL) {
-					g_queue_push_head(xrf->pre_requisites,
-							  cr->rulename);
-				}
 			}
 
 			g_queue_push_head(combination_rule_list, cr);
@@ -2875,12 +3383,165 @@ static gboolean init_patterns(void)
 						   psp->timeout * 1000,
 						   led_pattern_timeout_cb,
 						   psp);
+
+			/* Pattern timeouts are specified in seconds;
+			 * allow them to be served by shared wakeups */
+			mce_hbtimer_set_slack(psp->timeout_id,
+					      LED_PATTERN_TIMEOUT_SLACK_MS);
 		}
 	}
 
 	return status;
 }
 
+/** Check if all patterns in a bitmask are active
+ *
+ * @param mask pattern bitmask
+ *
+ * @return TRUE if all patterns in the mask are active, FALSE otherwise
+ */
+static gboolean led_mask_covers(const gulong *mask)
+{
+	for( guint i = 0; i < led_mask_words; ++i ) {
+		if( (led_active_mask[i] & mask[i]) != mask[i] )
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/** Compile pattern combination rule
+ *
+ * @param psp   The combined pattern
+ * @param names Names of pre-requisite patterns
+ *
+ * @return compiled rule
+ */
+static led_rule_t *led_rule_create(pattern_struct *psp, GQueue *names)
+{
+	led_rule_t *self = g_slice_new0(led_rule_t);
+
+	self->pattern    = psp;
+	self->mask       = g_new0(gulong, led_mask_words);
+	self->impossible = FALSE;
+
+	for( GList *iter = names->head; iter; iter = iter->next ) {
+		pattern_struct *pre = find_pattern_struct(iter->data);
+
+		/* Missing pre-requisite can never be active */
+		if( !pre ) {
+			self->impossible = TRUE;
+			continue;
+		}
+
+		self->mask[pre->index / LED_MASK_WORD_BITS] |=
+			1ul << (pre->index % LED_MASK_WORD_BITS);
+
+		/* Cross reference: pattern -> rules it affects */
+		if( !g_slist_find(pre->rules, self) )
+			pre->rules = g_slist_prepend(pre->rules, self);
+	}
+
+	return self;
+}
+
+/** Release compiled pattern combination rule
+ *
+ * @param self compiled rule, or NULL
+ */
+static void led_rule_delete(led_rule_t *self)
+{
+	if( !self )
+		goto EXIT;
+
+	g_free(self->mask);
+	g_slice_free(led_rule_t, self);
+
+EXIT:
+	return;
+}
+
+/** Type agnostic callback for releasing compiled rules
+ *
+ * @param self compiled rule, or NULL
+ */
+static void led_rule_delete_cb(gpointer self)
+{
+	led_rule_delete(self);
+}
+
+/** Compile patterns and combination rules for fast evaluation
+ *
+ * Patterns get indexed in pattern_stack i.e. priority order, so
+ * that walking set bits of the active pattern bitmask visits
+ * active patterns in priority order. Combination rules are
+ * turned into pre-requisite bitmasks.
+ */
+static void led_patterns_compile(void)
+{
+	guint count = g_queue_get_length(pattern_stack);
+	guint index = 0;
+
+	led_mask_words  = (count + LED_MASK_WORD_BITS - 1) / LED_MASK_WORD_BITS;
+	led_active_mask = g_new0(gulong, led_mask_words ?: 1);
+	pattern_tab     = g_new0(pattern_struct *, count ?: 1);
+	pattern_lut     = g_hash_table_new(g_str_hash, g_str_equal);
+
+	for( GList *iter = pattern_stack->head; iter; iter = iter->next ) {
+		pattern_struct *psp = iter->data;
+
+		psp->index = index++;
+		pattern_tab[psp->index] = psp;
+
+		if( get_led_type() == LED_TYPE_DIRECT_MONO &&
+		    led_pattern_can_breathe(psp) )
+			mono_breath_compile(psp);
+
+		if( psp->active )
+			led_active_mask[psp->index / LED_MASK_WORD_BITS] |=
+				1ul << (psp->index % LED_MASK_WORD_BITS);
+
+		/* In case of duplicate names, the first one is used */
+		if( !g_hash_table_lookup(pattern_lut, psp->name) )
+			g_hash_table_insert(pattern_lut, psp->name, psp);
+	}
+
+	for( GList *iter = combination_rule_list->head; iter; iter = iter->next ) {
+		combination_rule_struct *cr = iter->data;
+		pattern_struct *psp = find_pattern_struct(cr->rulename);
+
+		if( !psp )
+			continue;
+
+		led_rule_list = g_slist_prepend(led_rule_list,
+						led_rule_create(psp,
+								cr->pre_requisites));
+	}
+
+	mce_log(LL_DEBUG, "%u patterns, %u combination rules",
+		count, g_slist_length(led_rule_list));
+}
+
+/** Release compiled pattern data
+ */
+static void led_patterns_release(void)
+{
+	for( GList *iter = pattern_stack ? pattern_stack->head : 0; iter; iter = iter->next ) {
+		pattern_struct *psp = iter->data;
+
+		g_slist_free(psp->rules), psp->rules = NULL;
+	}
+
+	g_slist_free_full(led_rule_list, led_rule_delete_cb);
+	led_rule_list = NULL;
+
+	if( pattern_lut )
+		g_hash_table_unref(pattern_lut), pattern_lut = NULL;
+
+	g_free(pattern_tab), pattern_tab = NULL;
+	g_free(led_active_mask), led_active_mask = NULL;
+	led_mask_words = 0;
+}
+
 /** Flag for: charger connected */
 static charger_state_t charger_state = CHARGER_STATE_UNDEF;
 
@@ -2905,6 +3566,12 @@ static void sw_breathing_rethink(void)
 	if( sw_breathing_enabled ) {
 		breathe = (charger_state == CHARGER_STATE_ON ||
 			   battery_level >= sw_breathing_battery_limit);
+
+		/* Breathing engine in this module keeps the device from
+		 * suspending, which matters only when the display is off */
+		if( get_led_type() == LED_TYPE_DIRECT_MONO &&
+		    !display_off_p(display_state_curr) )
+			breathe = true;
 	}
 
 	/* Check if active pattern can utilize breathing */
@@ -3184,17 +3851,21 @@ const gchar *g_module_check_init(GModule *module)
 	/* Append triggers/filters to datapipes */
 	mce_led_datapipes_init();
 
-	/* Setup a pattern stack,
-	 * a combination rule stack and a cross-refernce for said stack
+	/* Setup sysfs write state cache */
+	led_sysfs_init();
+
+	/* Setup a pattern stack and a combination rule stack
 	 * and initialise the patterns
 	 */
 	pattern_stack = g_queue_new();
 	combination_rule_list = g_queue_new();
-	combination_rule_xref_list = g_queue_new();
 
 	if (init_patterns() == FALSE)
 		goto EXIT;
 
+	/* Index patterns and compile combination rules */
+	led_patterns_compile();
+
 	/* Add dbus handlers */
 	mce_led_init_dbus();
 
@@ -3259,6 +3930,9 @@ void g_module_unload(GModule *module)
 		}
 	}
 
+	/* Release sysfs write state cache */
+	led_sysfs_quit();
+
 	/* Free path strings; this has to be done after
 	 * led_set_active_pattern(0), since it uses these paths
 	 */
@@ -3282,6 +3956,9 @@ void g_module_unload(GModule *module)
 	g_free(engine2_leds_path);
 	g_free(engine3_leds_path);
 
+	/* Free compiled pattern data */
+	led_patterns_release();
+
 	/* Free the pattern stack */
 	if (pattern_stack != NULL) {
 		pattern_struct *psp;
@@ -3315,19 +3992,5 @@ void g_module_unload(GModule *module)
 		combination_rule_list = NULL;
 	}
 
-	/* Free the combination rule cross reference list */
-	if (combination_rule_xref_list != NULL) {
-		combination_rule_struct *xrf;
-
-		while ((xrf = g_queue_pop_head(combination_rule_xref_list)) != NULL) {
-			g_queue_free(xrf->pre_requisites);
-			xrf->pre_requisites = NULL;
-			g_slice_free(combination_rule_struct, xrf);
-		}
-
-		g_queue_free(combination_rule_xref_list);
-		combination_rule_xref_list = NULL;
-	}
-
 	return;
 }
@@ -22,6 +22,8 @@
 #include "memnotify.h"
 
 #include "../mce-log.h"
+#include "../mce-lib.h"
+#include "../mce-conf.h"
 #include "../mce-dbus.h"
 #include "../mce-setting.h"
 
@@ -55,6 +57,7 @@ static guint  memnotify_iowatch_add    (int fd, bool close_on_unref, GIOConditio
  * Note: The ordering must match:
  *       1) memnotify_limit[] array
  *       2) memnotify_dev[] array
+ *       3) memnotify_psi[] array
  */
 typedef enum
 {
@@ -102,6 +105,19 @@ static bool memnotify_limit_exceeded (const memnotify_limit_t *self, const memno
  * STATUS_EVALUATION
  * ========================================================================= */
 
+/** Kernel interfaces that can be used for memory level tracking */
+typedef enum
+{
+    /** No tracking */
+    MEMNOTIFY_BACKEND_NONE,
+
+    /** Vendor specific /dev/memnotify device */
+    MEMNOTIFY_BACKEND_DEV,
+
+    /** Pressure stall information triggers */
+    MEMNOTIFY_BACKEND_PSI,
+} memnotify_backend_t;
+
 static memnotify_level_t memnotify_status_evaluate_level  (void);
 static void              memnotify_status_update_level    (void);
 static void              memnotify_status_update_triggers (void);
@@ -144,6 +160,49 @@ static bool     memnotify_dev_open         (memnotify_level_t lev);
 static bool     memnotify_dev_set_trigger  (memnotify_level_t lev, const memnotify_limit_t *limit);
 static bool     memnotify_dev_get_status   (memnotify_level_t lev, memnotify_limit_t *state);
 
+/* ========================================================================= *
+ * PRESSURE_INTERFACE
+ * ========================================================================= */
+
+/** Structure for holding pressure stall trigger file descriptors etc */
+typedef struct
+{
+    /** Flag for: Slot is not a dummy
+     *
+     * Similarly to memnotify_dev_t, unused slots are left zero
+     * initialized and must be ignored. */
+    bool         mnp_in_use;
+
+    /** Type of stall to track: "some" or "full" */
+    const char  *mnp_type;
+
+    /** Pressure file descriptor with trigger installed
+     *
+     * If mnp_in_use is true, must be initialized to -1.
+     */
+    int          mnp_fd;
+
+    /** Glib io watch id for mnp_fd */
+    guint        mnp_rx_id;
+
+    /** When the trigger last fired [ms], or 0 if not yet */
+    int64_t      mnp_fired_tick;
+} memnotify_psi_t;
+
+static bool              memnotify_psi_is_available     (void);
+static int64_t           memnotify_psi_hold_time        (void);
+static memnotify_level_t memnotify_psi_evaluate_level   (void);
+
+static gboolean          memnotify_psi_recover_cb       (gpointer aptr);
+static void              memnotify_psi_schedule_recover (void);
+
+static gboolean          memnotify_psi_rx_cb            (GIOChannel *chn, GIOCondition cnd, gpointer aptr);
+
+static void              memnotify_psi_close            (memnotify_level_t lev);
+static bool              memnotify_psi_open             (memnotify_level_t lev);
+static void              memnotify_psi_close_all        (void);
+static bool              memnotify_psi_open_all         (void);
+
 /* ========================================================================= *
  * DYNAMIC_SETTINGS
  * ========================================================================= */
@@ -152,6 +211,13 @@ static void memnotify_setting_cb   (GConfClient *const gcc, const guint id, GCon
 static void memnotify_setting_init (void);
 static void memnotify_setting_quit (void);
 
+/* ========================================================================= *
+ * STATIC_CONFIG
+ * ========================================================================= */
+
+static void memnotify_config_init (void);
+static void memnotify_config_quit (void);
+
 /* ========================================================================= *
  * DBUS_INTERFACE
  * ========================================================================= */
@@ -402,11 +468,17 @@ static memnotify_limit_t memnotify_state =
 /** Cached memory use level */
 static memnotify_level_t memnotify_level = MEMNOTIFY_LEVEL_UNKNOWN;
 
+/** Kernel interface in use */
+static memnotify_backend_t memnotify_backend = MEMNOTIFY_BACKEND_NONE;
+
 /** Check current memory status against triggering levels
  */
 static memnotify_level_t
 memnotify_status_evaluate_level(void)
 {
+    if( memnotify_backend == MEMNOTIFY_BACKEND_PSI )
+        return memnotify_psi_evaluate_level();
+
     memnotify_level_t res = MEMNOTIFY_LEVEL_NORMAL;
     memnotify_level_t lev = MEMNOTIFY_LEVEL_NORMAL + 1;
     for( ; lev < G_N_ELEMENTS(memnotify_limit); ++lev ) {
@@ -440,6 +512,17 @@ EXIT:
 static void
 memnotify_status_update_triggers(void)
 {
+    /* Pressure triggers are immutable, re-create them instead */
+    if( memnotify_backend == MEMNOTIFY_BACKEND_PSI ) {
+        memnotify_psi_close_all();
+        memnotify_psi_open_all();
+        memnotify_status_update_level();
+        return;
+    }
+
+    if( memnotify_backend != MEMNOTIFY_BACKEND_DEV )
+        return;
+
     /* Program new limits to kernel side */
     memnotify_dev_set_trigger(MEMNOTIFY_LEVEL_WARNING,
                               memnotify_limit + MEMNOTIFY_LEVEL_WARNING);
@@ -700,6 +783,312 @@ EXIT:
     return res;
 }
 
+/* ========================================================================= *
+ * PRESSURE_INTERFACE
+ * ========================================================================= */
+
+/** Path to pressure stall information file, from static config */
+static gchar *memnotify_psi_path = 0;
+
+/** Stall thresholds for warning/critical levels [ms], from settings */
+static gint memnotify_psi_stall[MEMNOTIFY_LEVEL_COUNT] =
+{
+    [MEMNOTIFY_LEVEL_WARNING]  = MCE_DEFAULT_MEMNOTIFY_WARNING_STALL,
+    [MEMNOTIFY_LEVEL_CRITICAL] = MCE_DEFAULT_MEMNOTIFY_CRITICAL_STALL,
+};
+
+/** Time window for stall thresholds [ms], from settings */
+static gint memnotify_psi_window = MCE_DEFAULT_MEMNOTIFY_STALL_WINDOW;
+
+/** Timer for returning to lower level after pressure has eased */
+static guint memnotify_psi_recover_id = 0;
+
+/** Tracking data for pressure stall triggers */
+static memnotify_psi_t memnotify_psi[MEMNOTIFY_LEVEL_COUNT] =
+{
+    [MEMNOTIFY_LEVEL_WARNING] = {
+        .mnp_in_use     = true,
+        .mnp_type       = "some",
+        .mnp_fd         = -1,
+        .mnp_rx_id      = 0,
+        .mnp_fired_tick = 0,
+    },
+    [MEMNOTIFY_LEVEL_CRITICAL] = {
+        .mnp_in_use     = true,
+        .mnp_type       = "full",
+        .mnp_fd         = -1,
+        .mnp_rx_id      = 0,
+        .mnp_fired_tick = 0,
+    },
+};
+
+/** Probe if the pressure stall information file is present
+ */
+static bool
+memnotify_psi_is_available(void)
+{
+    return (memnotify_psi_path &&
+            access(memnotify_psi_path, R_OK|W_OK) == 0);
+}
+
+/** Get how long a level is held after the trigger fired
+ *
+ * Kernel fires a trigger at most once per window, so two windows
+ * without notifications means the pressure has eased.
+ *
+ * @return hold time [ms]
+ */
+static int64_t
+memnotify_psi_hold_time(void)
+{
+    return 2 * (int64_t)memnotify_psi_window;
+}
+
+/** Evaluate memory level from recently fired pressure triggers
+ */
+static memnotify_level_t
+memnotify_psi_evaluate_level(void)
+{
+    memnotify_level_t res  = MEMNOTIFY_LEVEL_NORMAL;
+    int64_t           now  = mce_lib_get_boot_tick();
+    int64_t           hold = memnotify_psi_hold_time();
+
+    for( memnotify_level_t lev = 0; lev < MEMNOTIFY_LEVEL_COUNT; ++lev ) {
+        const memnotify_psi_t *psi = memnotify_psi + lev;
+
+        if( !psi->mnp_in_use || psi->mnp_fd == -1 || !psi->mnp_fired_tick )
+            continue;
+
+        if( now - psi->mnp_fired_tick < hold )
+            res = lev;
+    }
+
+    return res;
+}
+
+/** Timer callback for re-evaluating level after pressure has eased
+ */
+static gboolean
+memnotify_psi_recover_cb(gpointer aptr)
+{
+    (void)aptr;
+
+    if( !memnotify_psi_recover_id )
+        goto EXIT;
+
+    memnotify_psi_recover_id = 0;
+
+    memnotify_status_update_level();
+    memnotify_psi_schedule_recover();
+
+EXIT:
+    return FALSE;
+}
+
+/** Schedule level re-evaluation for when the latest trigger expires
+ */
+static void
+memnotify_psi_schedule_recover(void)
+{
+    int64_t now    = mce_lib_get_boot_tick();
+    int64_t hold   = memnotify_psi_hold_time();
+    int64_t expiry = 0;
+
+    if( memnotify_psi_recover_id ) {
+        g_source_remove(memnotify_psi_recover_id),
+            memnotify_psi_recover_id = 0;
+    }
+
+    for( memnotify_level_t lev = 0; lev < MEMNOTIFY_LEVEL_COUNT; ++lev ) {
+        const memnotify_psi_t *psi = memnotify_psi + lev;
+
+        if( !psi->mnp_in_use || psi->mnp_fd == -1 || !psi->mnp_fired_tick )
+            continue;
+
+        int64_t t = psi->mnp_fired_tick + hold;
+        if( t > now && (expiry == 0 || t < expiry) )
+            expiry = t;
+    }
+
+    if( expiry )
+        memnotify_psi_recover_id =
+            g_timeout_add((guint)(expiry - now), memnotify_psi_recover_cb, 0);
+}
+
+/** Input watch callback for pressure stall triggers
+ */
+static gboolean
+memnotify_psi_rx_cb(GIOChannel *chn, GIOCondition cnd, gpointer aptr)
+{
+    (void) chn;
+
+    memnotify_level_t lev = GPOINTER_TO_INT(aptr);
+
+    gboolean keep_going = FALSE;
+
+    if( !memnotify_psi[lev].mnp_rx_id )
+        goto EXIT;
+
+    mce_log(LL_DEBUG, "pressure trigger (%s)", memnotify_level_name(lev));
+
+    if( cnd & ~G_IO_PRI ) {
+        mce_log(LL_WARN, "unexpected input watch condition");
+        goto EXIT;
+    }
+
+    keep_going = TRUE;
+
+    memnotify_psi[lev].mnp_fired_tick = mce_lib_get_boot_tick();
+
+    memnotify_status_update_level();
+    memnotify_psi_schedule_recover();
+
+EXIT:
+
+    if( !keep_going && memnotify_psi[lev].mnp_rx_id ) {
+        memnotify_psi[lev].mnp_rx_id = 0;
+        mce_log(LL_CRIT, "disabling input watch");
+
+        /* Release the trigger too, so that the level it might have
+         * raised does not get stuck */
+        memnotify_psi_close(lev);
+        memnotify_status_update_level();
+        memnotify_psi_schedule_recover();
+    }
+    return keep_going;
+}
+
+/** Remove pressure stall trigger and associated io watch
+ */
+static void
+memnotify_psi_close(memnotify_level_t lev)
+{
+    if( !memnotify_psi[lev].mnp_in_use )
+        goto EXIT;
+
+    if( memnotify_psi[lev].mnp_rx_id ) {
+        g_source_remove(memnotify_psi[lev].mnp_rx_id),
+            memnotify_psi[lev].mnp_rx_id = 0;
+    }
+
+    if( memnotify_psi[lev].mnp_fd != -1 ) {
+        close(memnotify_psi[lev].mnp_fd),
+            memnotify_psi[lev].mnp_fd = -1;
+    }
+
+    memnotify_psi[lev].mnp_fired_tick = 0;
+
+EXIT:
+
+    return;
+}
+
+/** Install pressure stall trigger and io watch for it
+ *
+ * Levels with zero stall threshold are left disabled.
+ */
+static bool
+memnotify_psi_open(memnotify_level_t lev)
+{
+    bool res = false;
+
+    char tmp[64];
+
+    if( !memnotify_psi[lev].mnp_in_use )
+        goto EXIT;
+
+    gint stall = memnotify_psi_stall[lev];
+
+    if( stall <= 0 ) {
+        mce_log(LL_DEBUG, "%s: disabled", memnotify_level_name(lev));
+        res = true;
+        goto EXIT;
+    }
+
+    if( stall >= memnotify_psi_window ) {
+        mce_log(LL_WARN, "%s: stall %d ms does not fit in %d ms window",
+                memnotify_level_name(lev), stall, memnotify_psi_window);
+        goto EXIT;
+    }
+
+    memnotify_psi[lev].mnp_fd = open(memnotify_psi_path,
+                                     O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if( memnotify_psi[lev].mnp_fd == -1 ) {
+        mce_log(LL_ERR, "could not open: %s: %m", memnotify_psi_path);
+        goto EXIT;
+    }
+
+    /* Kernel side expects microseconds */
+    snprintf(tmp, sizeof tmp, "%s %d %d", memnotify_psi[lev].mnp_type,
+             stall * 1000, memnotify_psi_window * 1000);
+
+    /* The terminating nul is part of the trigger string */
+    if( write(memnotify_psi[lev].mnp_fd, tmp, strlen(tmp) + 1) == -1 ) {
+        mce_log(LL_ERR, "could not set trigger: %s: %s: %m",
+                memnotify_psi_path, tmp);
+        goto EXIT;
+    }
+
+    mce_log(LL_DEBUG, "write %s -> %s", memnotify_level_name(lev), tmp);
+
+    memnotify_psi[lev].mnp_rx_id =
+        memnotify_iowatch_add(memnotify_psi[lev].mnp_fd,
+                              false,
+                              G_IO_PRI,
+                              memnotify_psi_rx_cb,
+                              GINT_TO_POINTER(lev));
+
+    if( !memnotify_psi[lev].mnp_rx_id ) {
+        mce_log(LL_ERR, "could add iowatch: %s", memnotify_psi_path);
+        goto EXIT;
+    }
+
+    res = true;
+
+EXIT:
+
+    // all or nothing
+    if( !res )
+        memnotify_psi_close(lev);
+
+    return res;
+}
+
+static void
+memnotify_psi_close_all(void)
+{
+    if( memnotify_psi_recover_id ) {
+        g_source_remove(memnotify_psi_recover_id),
+            memnotify_psi_recover_id = 0;
+    }
+
+    for( memnotify_level_t lev = 0; lev < MEMNOTIFY_LEVEL_COUNT; ++lev )
+        memnotify_psi_close(lev);
+}
+
+static bool
+memnotify_psi_open_all(void)
+{
+    bool res = false;
+
+    for( memnotify_level_t lev = 0; lev < MEMNOTIFY_LEVEL_COUNT; ++lev ) {
+        if( !memnotify_psi[lev].mnp_in_use )
+            continue;
+        if( !memnotify_psi_open(lev) )
+            goto EXIT;
+    }
+
+    res = true;
+
+EXIT:
+
+    // all or nothing
+    if( !res )
+        memnotify_psi_close_all();
+
+    return res;
+}
+
 /* ========================================================================= *
  * DYNAMIC_SETTINGS
  * ========================================================================= */
@@ -716,6 +1105,15 @@ static guint memnotify_setting_critical_used_id = 0;
 /** GConf notification id for memnotify.critical.active level */
 static guint memnotify_setting_critical_active_id = 0;
 
+/** GConf notification id for memnotify.warning.stall level */
+static guint memnotify_setting_warning_stall_id = 0;
+
+/** GConf notification id for memnotify.critical.stall level */
+static guint memnotify_setting_critical_stall_id = 0;
+
+/** GConf notification id for memnotify.stall_window */
+static guint memnotify_setting_stall_window_id = 0;
+
 /** GConf callback for memnotify related settings
  *
  * @param gcc    (not used)
@@ -775,6 +1173,33 @@ memnotify_setting_cb(GConfClient *const gcc, const guint id,
             memnotify_status_update_triggers();
         }
     }
+    else if( id == memnotify_setting_warning_stall_id ) {
+        gint old = memnotify_psi_stall[MEMNOTIFY_LEVEL_WARNING];
+        gint val = gconf_value_get_int(gcv);
+        if( old != val ) {
+            mce_log(LL_DEBUG, "memnotify.warning.stall: %d -> %d", old, val);
+            memnotify_psi_stall[MEMNOTIFY_LEVEL_WARNING] = val;
+            memnotify_status_update_triggers();
+        }
+    }
+    else if( id == memnotify_setting_critical_stall_id ) {
+        gint old = memnotify_psi_stall[MEMNOTIFY_LEVEL_CRITICAL];
+        gint val = gconf_value_get_int(gcv);
+        if( old != val ) {
+            mce_log(LL_DEBUG, "memnotify.critical.stall: %d -> %d", old, val);
+            memnotify_psi_stall[MEMNOTIFY_LEVEL_CRITICAL] = val;
+            memnotify_status_update_triggers();
+        }
+    }
+    else if( id == memnotify_setting_stall_window_id ) {
+        gint old = memnotify_psi_window;
+        gint val = gconf_value_get_int(gcv);
+        if( old != val ) {
+            mce_log(LL_DEBUG, "memnotify.stall_window: %d -> %d", old, val);
+            memnotify_psi_window = val;
+            memnotify_status_update_triggers();
+        }
+    }
     else {
         mce_log(LL_WARN, "Spurious GConf value received; confused!");
     }
@@ -824,6 +1249,33 @@ static void memnotify_setting_init(void)
     mce_setting_get_int(MCE_SETTING_MEMNOTIFY_CRITICAL_ACTIVE,
                         &memnotify_limit[MEMNOTIFY_LEVEL_CRITICAL].mnl_active);
 
+    /* memnotify.warning.stall level */
+    mce_setting_notifier_add(MCE_SETTING_MEMNOTIFY_WARNING_PATH,
+                             MCE_SETTING_MEMNOTIFY_WARNING_STALL,
+                             memnotify_setting_cb,
+                             &memnotify_setting_warning_stall_id);
+
+    mce_setting_get_int(MCE_SETTING_MEMNOTIFY_WARNING_STALL,
+                        &memnotify_psi_stall[MEMNOTIFY_LEVEL_WARNING]);
+
+    /* memnotify.critical.stall level */
+    mce_setting_notifier_add(MCE_SETTING_MEMNOTIFY_CRITICAL_PATH,
+                             MCE_SETTING_MEMNOTIFY_CRITICAL_STALL,
+                             memnotify_setting_cb,
+                             &memnotify_setting_critical_stall_id);
+
+    mce_setting_get_int(MCE_SETTING_MEMNOTIFY_CRITICAL_STALL,
+                        &memnotify_psi_stall[MEMNOTIFY_LEVEL_CRITICAL]);
+
+    /* memnotify.stall_window */
+    mce_setting_notifier_add(MCE_SETTING_MEMNOTIFY_PATH,
+                             MCE_SETTING_MEMNOTIFY_STALL_WINDOW,
+                             memnotify_setting_cb,
+                             &memnotify_setting_stall_window_id);
+
+    mce_setting_get_int(MCE_SETTING_MEMNOTIFY_STALL_WINDOW,
+                        &memnotify_psi_window);
+
     memnotify_status_show_triggers();
 }
 
@@ -842,6 +1294,39 @@ static void memnotify_setting_quit(void)
 
     mce_setting_notifier_remove(memnotify_setting_critical_active_id),
         memnotify_setting_critical_active_id = 0;
+
+    mce_setting_notifier_remove(memnotify_setting_warning_stall_id),
+        memnotify_setting_warning_stall_id = 0;
+
+    mce_setting_notifier_remove(memnotify_setting_critical_stall_id),
+        memnotify_setting_critical_stall_id = 0;
+
+    mce_setting_notifier_remove(memnotify_setting_stall_window_id),
+        memnotify_setting_stall_window_id = 0;
+}
+
+/* ========================================================================= *
+ * STATIC_CONFIG
+ * ========================================================================= */
+
+/** Parse memnotify configuration
+ */
+static void
+memnotify_config_init(void)
+{
+    memnotify_psi_path =
+        mce_conf_get_string(MCE_CONF_MEMNOTIFY_GROUP,
+                            MCE_CONF_MEMNOTIFY_PRESSURE_PATH,
+                            DEFAULT_MEMNOTIFY_PRESSURE_PATH);
+}
+
+/** Release memnotify configuration data
+ */
+static void
+memnotify_config_quit(void)
+{
+    g_free(memnotify_psi_path),
+        memnotify_psi_path = 0;
 }
 
 /* ========================================================================= *
@@ -947,10 +1432,23 @@ const gchar *g_module_check_init(GModule *module)
 
     memnotify_dbus_init();
     memnotify_setting_init();
+    memnotify_config_init();
 
-    /* Do not even attempt to set up tracking if the memnotify
-     * device node is not available */
-    if( !memnotify_dev_is_available() ) {
+    /* Prefer vendor specific device when present */
+    if( memnotify_dev_is_available() ) {
+        if( !memnotify_dev_open_all() )
+            goto EXIT;
+
+        memnotify_backend = MEMNOTIFY_BACKEND_DEV;
+        memnotify_status_update_triggers();
+
+        mce_log(LL_NOTICE, "memnotify plugin active");
+        goto EXIT;
+    }
+
+    /* Do not even attempt to set up tracking if neither memnotify
+     * device node nor pressure stall information is available */
+    if( !memnotify_psi_is_available() ) {
         /* Since it is expectional that  /dev/memnotify is present,
          * we must not complain about it missing in default verbosity
          * level
@@ -962,12 +1460,11 @@ const gchar *g_module_check_init(GModule *module)
         goto EXIT;
     }
 
-    if( !memnotify_dev_open_all() )
-        goto EXIT;
-
+    memnotify_backend = MEMNOTIFY_BACKEND_PSI;
     memnotify_status_update_triggers();
 
-    mce_log(LL_NOTICE, "memnotify plugin active");
+    mce_log(LL_NOTICE, "memnotify plugin active; using %s",
+            memnotify_psi_path);
 
 EXIT:
 
@@ -987,6 +1484,8 @@ void g_module_unload(GModule *module)
     memnotify_setting_quit();
     memnotify_dbus_quit();
     memnotify_dev_close_all();
+    memnotify_psi_close_all();
+    memnotify_config_quit();
 
     return;
 }
@@ -1,6 +1,20 @@
 #ifndef MEMNOTIFY_H_
 # define MEMNOTIFY_H_
 
+/* ========================================================================= *
+ * Static configuration
+ * ========================================================================= */
+
+/** Name of memnotify configuration group */
+# define MCE_CONF_MEMNOTIFY_GROUP               "MemNotify"
+
+/** Pressure stall information file to use when /dev/memnotify is missing
+ *
+ * Can be pointed to cgroup v2 memory.pressure file.
+ */
+# define MCE_CONF_MEMNOTIFY_PRESSURE_PATH       "PressurePath"
+# define DEFAULT_MEMNOTIFY_PRESSURE_PATH        "/proc/pressure/memory"
+
 /* ========================================================================= *
  * Settings
  * ========================================================================= */
@@ -30,4 +44,19 @@
 # define MCE_SETTING_MEMNOTIFY_CRITICAL_ACTIVE  MCE_SETTING_MEMNOTIFY_PATH"/critical/active"
 # define MCE_DEFAULT_MEMNOTIFY_CRITICAL_ACTIVE  0 // = disabled
 
+/** Warning threshold for "some" memory stall time within window [ms] */
+# define MCE_SETTING_MEMNOTIFY_WARNING_STALL    MCE_SETTING_MEMNOTIFY_PATH"/warning/stall"
+# define MCE_DEFAULT_MEMNOTIFY_WARNING_STALL    150 // 0 = disabled
+
+/** Critical threshold for "full" memory stall time within window [ms] */
+# define MCE_SETTING_MEMNOTIFY_CRITICAL_STALL   MCE_SETTING_MEMNOTIFY_PATH"/critical/stall"
+# define MCE_DEFAULT_MEMNOTIFY_CRITICAL_STALL   100 // 0 = disabled
+
+/** Time window for memory stall thresholds [ms]
+ *
+ * Kernel accepts values in 500 ... 10000 ms range.
+ */
+# define MCE_SETTING_MEMNOTIFY_STALL_WINDOW     MCE_SETTING_MEMNOTIFY_PATH"/stall_window"
+# define MCE_DEFAULT_MEMNOTIFY_STALL_WINDOW     1000
+
 #endif /* MEMNOTIFY_H_ */
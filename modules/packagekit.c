@@ -171,36 +171,22 @@ xpkgkit_parse_changed_properties(DBusMessageIter *body)
     if( !body )
         goto EXIT;
 
-    DBusMessageIter arr, ent, var;
-    // <arg type="a{sv}" name="changed_properties"/>
-
-    if( !mce_dbus_iter_get_array(body, &arr) )
-        goto EXIT;
+    bool     val  = false;
+    unsigned seen = 0;
 
-    while( !mce_dbus_iter_at_end(&arr) ) {
-        const char *key = 0;
-
-        if( !mce_dbus_iter_get_entry(&arr, &ent) )
-            goto EXIT;
+    const mce_dbus_prop_t props[] = {
+        { .key = "Locked", .type = DBUS_TYPE_BOOLEAN, .dest = &val },
+        { .key = 0, }
+    };
 
-        if( !mce_dbus_iter_get_string(&ent, &key) )
-            goto EXIT;
+    // <arg type="a{sv}" name="changed_properties"/>
 
-        if( !mce_dbus_iter_get_variant(&ent, &var) )
-            goto EXIT;
+    if( !mce_dbus_iter_get_props(body, props, &seen) )
+        goto EXIT;
 
-        if( !strcmp(key, "Locked") ) {
-            bool val = false;
-            if( !mce_dbus_iter_get_bool(&var, &val) )
-                goto EXIT;
-            mce_log(LL_DEBUG, "%s = bool %d", key, val);
-            locked = val;
-        }
-        else {
-            char *val = mce_dbus_message_iter_repr(&var);
-            mce_log(LL_DEBUG, "%s = %s", key, val);
-            free(val);
-        }
+    if( seen & (1u << 0) ) {
+        mce_log(LL_DEBUG, "Locked = bool %d", val);
+        locked = val;
     }
 
 EXIT:
@@ -2944,6 +2944,11 @@ pwrkey_datapipes_keypress_event_cb(gconstpointer const data)
                      * state */
                     pwrkey_ps_override_evaluate();
 
+                    /* Speed up possible display power up */
+                    if( pwrkey_stm_display_state != MCE_DISPLAY_ON )
+                        datapipe_exec_output_triggers(&cpu_boost_event_pipe,
+                                                      ev, USE_INDATA);
+
                     /* Power key pressed */
                     pwrkey_stm_powerkey_pressed();
 
@@ -0,0 +1,274 @@
+#include <check.h>
+#include <glib.h>
+
+#include "common.h"
+
+/* Tested module */
+#include "../../datapipe.c"
+
+/* ------------------------------------------------------------------------- *
+ * STUBS
+ * ------------------------------------------------------------------------- */
+
+EXTERN_STUB (
+void, mce_journal_record, (const datapipe_struct *datapipe,
+			   gconstpointer data, unsigned flags, unsigned depth))
+{
+	(void)datapipe;
+	(void)data;
+	(void)flags;
+	(void)depth;
+}
+
+/* ------------------------------------------------------------------------- *
+ * HELPERS
+ * ------------------------------------------------------------------------- */
+
+static datapipe_struct ut_pipe_a;
+static datapipe_struct ut_pipe_b;
+
+/** Number of input trigger calls */
+static int ut_input_count;
+
+/** Number of output trigger calls */
+static int ut_output_count;
+
+/** Trigger call history: 'a' / 'b' + value */
+static GString *ut_history;
+
+static void ut_input_trigger(gconstpointer data)
+{
+	(void)data;
+	ut_input_count += 1;
+}
+
+static void ut_output_trigger(gconstpointer data)
+{
+	(void)data;
+	ut_output_count += 1;
+}
+
+static void ut_history_a_trigger(gconstpointer data)
+{
+	g_string_append_printf(ut_history, "a%d", GPOINTER_TO_INT(data));
+}
+
+static void ut_history_b_trigger(gconstpointer data)
+{
+	g_string_append_printf(ut_history, "b%d", GPOINTER_TO_INT(data));
+}
+
+/* Posts two values to pipe b; only the latest should get executed */
+static void ut_post_twice_trigger(gconstpointer data)
+{
+	int value = GPOINTER_TO_INT(data);
+
+	datapipe_exec_queued(&ut_pipe_b, GINT_TO_POINTER(value + 10),
+			     CACHE_INDATA);
+	datapipe_exec_queued(&ut_pipe_b, GINT_TO_POINTER(value + 20),
+			     CACHE_INDATA);
+	g_string_append_printf(ut_history, "a%d", value);
+}
+
+/* Posts to pipe a while pipe b is executed from the run queue */
+static void ut_post_back_trigger(gconstpointer data)
+{
+	int value = GPOINTER_TO_INT(data);
+
+	if( value < 100 )
+		datapipe_exec_queued(&ut_pipe_a, GINT_TO_POINTER(100),
+				     CACHE_INDATA);
+	g_string_append_printf(ut_history, "b%d", value);
+}
+
+static void ut_setup(void)
+{
+	ut_input_count  = 0;
+	ut_output_count = 0;
+	ut_history      = g_string_new(0);
+}
+
+static void ut_teardown(void)
+{
+	g_slist_free(ut_pipe_a.input_triggers),  ut_pipe_a.input_triggers  = 0;
+	g_slist_free(ut_pipe_a.output_triggers), ut_pipe_a.output_triggers = 0;
+	g_slist_free(ut_pipe_b.input_triggers),  ut_pipe_b.input_triggers  = 0;
+	g_slist_free(ut_pipe_b.output_triggers), ut_pipe_b.output_triggers = 0;
+	datapipe_free(&ut_pipe_a);
+	datapipe_free(&ut_pipe_b);
+
+	g_string_free(ut_history, TRUE), ut_history = 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * TESTS
+ * ------------------------------------------------------------------------- */
+
+START_TEST (ut_check_fire_always)
+{
+	datapipe_init(&ut_pipe_a, READ_ONLY, DONT_FREE_CACHE, 0,
+		      GINT_TO_POINTER(0));
+	datapipe_add_output_trigger(&ut_pipe_a, ut_output_trigger);
+
+	for( int i = 0; i < 3; ++i )
+		datapipe_exec_full(&ut_pipe_a, GINT_TO_POINTER(1),
+				   USE_INDATA, CACHE_INDATA);
+
+	ck_assert_int_eq(ut_output_count, 3);
+	ck_assert_int_eq(ut_pipe_a.exec_count, 3);
+	ck_assert_int_eq(ut_pipe_a.skip_count, 0);
+}
+END_TEST
+
+START_TEST (ut_check_fire_on_change_read_only)
+{
+	datapipe_init_full(&ut_pipe_a, READ_ONLY, DONT_FREE_CACHE,
+			   FIRE_ON_CHANGE, 0, GINT_TO_POINTER(0));
+	datapipe_add_input_trigger(&ut_pipe_a, ut_input_trigger);
+	datapipe_add_output_trigger(&ut_pipe_a, ut_output_trigger);
+
+	/* The initial value has not been fed to triggers yet */
+	datapipe_exec_full(&ut_pipe_a, GINT_TO_POINTER(0),
+			   USE_INDATA, CACHE_INDATA);
+	ck_assert_int_eq(ut_output_count, 1);
+
+	/* Unchanged value skips the whole execution */
+	datapipe_exec_full(&ut_pipe_a, GINT_TO_POINTER(0),
+			   USE_INDATA, CACHE_INDATA);
+	ck_assert_int_eq(ut_input_count, 1);
+	ck_assert_int_eq(ut_output_count, 1);
+	ck_assert_int_eq(ut_pipe_a.skip_count, 1);
+
+	/* Changed value fires */
+	datapipe_exec_full(&ut_pipe_a, GINT_TO_POINTER(1),
+			   USE_INDATA, CACHE_INDATA);
+	ck_assert_int_eq(ut_output_count, 2);
+	ck_assert_int_eq(datapipe_get_gint(ut_pipe_a), 1);
+
+	/* Explicit re-execution of cached value always fires */
+	datapipe_exec_full(&ut_pipe_a, NULL, USE_CACHE, DONT_CACHE_INDATA);
+	ck_assert_int_eq(ut_output_count, 3);
+	ck_assert_int_eq(ut_pipe_a.exec_count, 4);
+	ck_assert_int_eq(ut_pipe_a.skip_count, 1);
+}
+END_TEST
+
+START_TEST (ut_check_fire_on_change_read_write)
+{
+	datapipe_init_full(&ut_pipe_a, READ_WRITE, DONT_FREE_CACHE,
+			   FIRE_ON_CHANGE, 0, GINT_TO_POINTER(0));
+	datapipe_add_input_trigger(&ut_pipe_a, ut_input_trigger);
+	datapipe_add_output_trigger(&ut_pipe_a, ut_output_trigger);
+
+	datapipe_exec_full(&ut_pipe_a, GINT_TO_POINTER(5),
+			   USE_INDATA, CACHE_INDATA);
+	datapipe_exec_full(&ut_pipe_a, GINT_TO_POINTER(5),
+			   USE_INDATA, CACHE_INDATA);
+
+	/* Input triggers run always, output triggers only on change */
+	ck_assert_int_eq(ut_input_count, 2);
+	ck_assert_int_eq(ut_output_count, 1);
+	ck_assert_int_eq(ut_pipe_a.skip_count, 1);
+}
+END_TEST
+
+START_TEST (ut_check_fire_on_change_dynamic)
+{
+	/* Pointer comparison is meaningless for allocated data */
+	datapipe_init_full(&ut_pipe_a, READ_ONLY, FREE_CACHE,
+			   FIRE_ON_CHANGE, 0, NULL);
+	ck_assert(!ut_pipe_a.change_only);
+}
+END_TEST
+
+START_TEST (ut_check_queued_immediate)
+{
+	datapipe_init(&ut_pipe_a, READ_ONLY, DONT_FREE_CACHE, 0,
+		      GINT_TO_POINTER(0));
+	datapipe_add_output_trigger(&ut_pipe_a, ut_history_a_trigger);
+
+	/* Outside datapipe execution queued mode executes immediately */
+	datapipe_exec_queued(&ut_pipe_a, GINT_TO_POINTER(1), CACHE_INDATA);
+	ck_assert_str_eq(ut_history->str, "a1");
+	ck_assert_int_eq(g_queue_get_length(&datapipe_run_queue), 0);
+}
+END_TEST
+
+START_TEST (ut_check_queued_collapse)
+{
+	datapipe_init(&ut_pipe_a, READ_ONLY, DONT_FREE_CACHE, 0,
+		      GINT_TO_POINTER(0));
+	datapipe_init(&ut_pipe_b, READ_ONLY, DONT_FREE_CACHE, 0,
+		      GINT_TO_POINTER(0));
+	datapipe_add_output_trigger(&ut_pipe_a, ut_post_twice_trigger);
+	datapipe_add_output_trigger(&ut_pipe_b, ut_history_b_trigger);
+
+	guint collapsed = datapipe_collapsed_total;
+
+	datapipe_exec_full(&ut_pipe_a, GINT_TO_POINTER(1),
+			   USE_INDATA, CACHE_INDATA);
+
+	/* Pipe b runs after pipe a triggers are done, latest value only */
+	ck_assert_str_eq(ut_history->str, "a1b21");
+	ck_assert_int_eq(datapipe_get_gint(ut_pipe_b), 21);
+	ck_assert_int_eq(datapipe_collapsed_total - collapsed, 1);
+	ck_assert_int_eq(datapipe_exec_depth, 0);
+	ck_assert_int_eq(g_queue_get_length(&datapipe_run_queue), 0);
+}
+END_TEST
+
+START_TEST (ut_check_queued_cascade)
+{
+	datapipe_init(&ut_pipe_a, READ_ONLY, DONT_FREE_CACHE, 0,
+		      GINT_TO_POINTER(0));
+	datapipe_init(&ut_pipe_b, READ_ONLY, DONT_FREE_CACHE, 0,
+		      GINT_TO_POINTER(0));
+	datapipe_add_output_trigger(&ut_pipe_a, ut_post_twice_trigger);
+	datapipe_add_output_trigger(&ut_pipe_b, ut_post_back_trigger);
+
+	datapipe_exec_full(&ut_pipe_a, GINT_TO_POINTER(1),
+			   USE_INDATA, CACHE_INDATA);
+
+	/* Executions posted while draining the queue are appended to it
+	 * and executed in order without nesting */
+	ck_assert_str_eq(ut_history->str, "a1b21a100b120");
+	ck_assert_int_eq(datapipe_get_gint(ut_pipe_a), 100);
+	ck_assert_int_eq(datapipe_get_gint(ut_pipe_b), 120);
+	ck_assert_int_eq(datapipe_exec_depth, 0);
+	ck_assert_int_eq(g_queue_get_length(&datapipe_run_queue), 0);
+}
+END_TEST
+
+static Suite *ut_datapipe_suite (void)
+{
+	Suite *s = suite_create ("ut_datapipe");
+
+	TCase *tc_core = tcase_create ("core");
+	tcase_add_checked_fixture(tc_core, ut_setup, ut_teardown);
+
+	tcase_add_test (tc_core, ut_check_fire_always);
+	tcase_add_test (tc_core, ut_check_fire_on_change_read_only);
+	tcase_add_test (tc_core, ut_check_fire_on_change_read_write);
+	tcase_add_test (tc_core, ut_check_fire_on_change_dynamic);
+	tcase_add_test (tc_core, ut_check_queued_immediate);
+	tcase_add_test (tc_core, ut_check_queued_collapse);
+	tcase_add_test (tc_core, ut_check_queued_cascade);
+
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
+
+int main(int argc, char **argv)
+{
+	(void)argc;
+	(void)argv;
+
+	int number_failed;
+	Suite *s = ut_datapipe_suite ();
+	SRunner *sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
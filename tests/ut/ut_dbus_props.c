@@ -0,0 +1,240 @@
+#include <check.h>
+#include <glib.h>
+
+#include "common.h"
+
+/* Tested module */
+#include "../../mce-dbus.c"
+
+/* ------------------------------------------------------------------------- *
+ * HELPERS
+ * ------------------------------------------------------------------------- */
+
+/** Message holding the dictionary under test */
+static DBusMessage *ut_msg = 0;
+
+/** Decoded values */
+static const char      *ut_str  = 0;
+static bool             ut_flag = false;
+static dbus_int32_t     ut_num  = 0;
+static DBusMessageIter  ut_any;
+
+/** Decoding table used in all tests */
+static const mce_dbus_prop_t ut_props[] =
+{
+	{ "Str",  DBUS_TYPE_STRING,  &ut_str  },
+	{ "Flag", DBUS_TYPE_BOOLEAN, &ut_flag },
+	{ "Num",  DBUS_TYPE_INT32,   &ut_num  },
+	{ "Any",  DBUS_TYPE_VARIANT, &ut_any  },
+	{ 0,      0,                 0        }
+};
+
+enum
+{
+	UT_SEEN_STR  = 1u << 0,
+	UT_SEEN_FLAG = 1u << 1,
+	UT_SEEN_NUM  = 1u << 2,
+	UT_SEEN_ANY  = 1u << 3,
+};
+
+static void ut_setup(void)
+{
+	ut_msg  = dbus_message_new_signal("/ut", "ut.props", "Changed");
+	ut_str  = 0;
+	ut_flag = false;
+	ut_num  = -1;
+	memset(&ut_any, 0, sizeof ut_any);
+}
+
+static void ut_teardown(void)
+{
+	if( ut_msg )
+		dbus_message_unref(ut_msg), ut_msg = 0;
+}
+
+/* Append dictionary entry with basic type value */
+static void ut_add_entry(DBusMessageIter *arr, const char *key,
+			 int type, const void *val)
+{
+	char sig[] = { (char)type, 0 };
+	DBusMessageIter ent, var;
+
+	dbus_message_iter_open_container(arr, DBUS_TYPE_DICT_ENTRY, 0, &ent);
+	dbus_message_iter_append_basic(&ent, DBUS_TYPE_STRING, &key);
+	dbus_message_iter_open_container(&ent, DBUS_TYPE_VARIANT, sig, &var);
+	dbus_message_iter_append_basic(&var, type, val);
+	dbus_message_iter_close_container(&ent, &var);
+	dbus_message_iter_close_container(arr, &ent);
+}
+
+/* Decode the message content as a{sv} dictionary */
+static bool ut_decode(unsigned *seen)
+{
+	DBusMessageIter iter;
+
+	dbus_message_iter_init(ut_msg, &iter);
+	return mce_dbus_iter_get_props(&iter, ut_props, seen);
+}
+
+/* ------------------------------------------------------------------------- *
+ * TESTS
+ * ------------------------------------------------------------------------- */
+
+START_TEST (ut_check_props_valid)
+{
+	DBusMessageIter iter, arr;
+	const char   *str  = "hello";
+	dbus_bool_t   flag = TRUE;
+	dbus_int32_t  num  = 42;
+	dbus_uint32_t skip = 7;
+	const char   *any  = "whatever";
+	unsigned      seen = 0;
+
+	dbus_message_iter_init_append(ut_msg, &iter);
+	dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "{sv}", &arr);
+	ut_add_entry(&arr, "Skip", DBUS_TYPE_UINT32,  &skip);
+	ut_add_entry(&arr, "Str",  DBUS_TYPE_STRING,  &str);
+	ut_add_entry(&arr, "Flag", DBUS_TYPE_BOOLEAN, &flag);
+	ut_add_entry(&arr, "Num",  DBUS_TYPE_INT32,   &num);
+	ut_add_entry(&arr, "Any",  DBUS_TYPE_STRING,  &any);
+	dbus_message_iter_close_container(&iter, &arr);
+
+	ck_assert(ut_decode(&seen));
+	ck_assert_int_eq(seen, UT_SEEN_STR | UT_SEEN_FLAG |
+			 UT_SEEN_NUM | UT_SEEN_ANY);
+	ck_assert_str_eq(ut_str, "hello");
+	ck_assert(ut_flag);
+	ck_assert_int_eq(ut_num, 42);
+	ck_assert_int_eq(dbus_message_iter_get_arg_type(&ut_any),
+			 DBUS_TYPE_STRING);
+}
+END_TEST
+
+START_TEST (ut_check_props_wrong_type)
+{
+	DBusMessageIter iter, arr;
+	const char   *num  = "42";
+	dbus_bool_t   flag = TRUE;
+	unsigned      seen = 0;
+
+	dbus_message_iter_init_append(ut_msg, &iter);
+	dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "{sv}", &arr);
+	ut_add_entry(&arr, "Num",  DBUS_TYPE_STRING,  &num);
+	ut_add_entry(&arr, "Flag", DBUS_TYPE_BOOLEAN, &flag);
+	dbus_message_iter_close_container(&iter, &arr);
+
+	/* Mistyped values are ignored, the rest is still decoded */
+	ck_assert(ut_decode(&seen));
+	ck_assert_int_eq(seen, UT_SEEN_FLAG);
+	ck_assert_int_eq(ut_num, -1);
+	ck_assert(ut_flag);
+}
+END_TEST
+
+START_TEST (ut_check_props_not_array)
+{
+	const char *str  = "Str";
+	unsigned    seen = 0;
+
+	dbus_message_append_args(ut_msg,
+				 DBUS_TYPE_STRING, &str,
+				 DBUS_TYPE_INVALID);
+
+	ck_assert(!ut_decode(&seen));
+	ck_assert_int_eq(seen, 0);
+}
+END_TEST
+
+START_TEST (ut_check_props_not_dict)
+{
+	DBusMessageIter iter, arr;
+	const char *str  = "Str";
+	unsigned    seen = 0;
+
+	dbus_message_iter_init_append(ut_msg, &iter);
+	dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "s", &arr);
+	dbus_message_iter_append_basic(&arr, DBUS_TYPE_STRING, &str);
+	dbus_message_iter_close_container(&iter, &arr);
+
+	ck_assert(!ut_decode(&seen));
+	ck_assert_int_eq(seen, 0);
+}
+END_TEST
+
+START_TEST (ut_check_props_bad_key)
+{
+	DBusMessageIter iter, arr, ent, var;
+	dbus_int32_t key  = 1;
+	const char  *str  = "hello";
+	unsigned     seen = 0;
+
+	dbus_message_iter_init_append(ut_msg, &iter);
+	dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "{iv}", &arr);
+	dbus_message_iter_open_container(&arr, DBUS_TYPE_DICT_ENTRY, 0, &ent);
+	dbus_message_iter_append_basic(&ent, DBUS_TYPE_INT32, &key);
+	dbus_message_iter_open_container(&ent, DBUS_TYPE_VARIANT, "s", &var);
+	dbus_message_iter_append_basic(&var, DBUS_TYPE_STRING, &str);
+	dbus_message_iter_close_container(&ent, &var);
+	dbus_message_iter_close_container(&arr, &ent);
+	dbus_message_iter_close_container(&iter, &arr);
+
+	ck_assert(!ut_decode(&seen));
+	ck_assert_int_eq(seen, 0);
+	ck_assert(ut_str == 0);
+}
+END_TEST
+
+START_TEST (ut_check_props_bad_value)
+{
+	DBusMessageIter iter, arr, ent;
+	const char   *key  = "Str";
+	const char   *str  = "hello";
+	unsigned      seen = 0;
+
+	/* Entry value without variant wrapping */
+	dbus_message_iter_init_append(ut_msg, &iter);
+	dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "{ss}", &arr);
+	dbus_message_iter_open_container(&arr, DBUS_TYPE_DICT_ENTRY, 0, &ent);
+	dbus_message_iter_append_basic(&ent, DBUS_TYPE_STRING, &key);
+	dbus_message_iter_append_basic(&ent, DBUS_TYPE_STRING, &str);
+	dbus_message_iter_close_container(&arr, &ent);
+	dbus_message_iter_close_container(&iter, &arr);
+
+	ck_assert(!ut_decode(&seen));
+	ck_assert_int_eq(seen, 0);
+	ck_assert(ut_str == 0);
+}
+END_TEST
+
+static Suite *ut_dbus_props_suite (void)
+{
+	Suite *s = suite_create ("ut_dbus_props");
+
+	TCase *tc_core = tcase_create ("core");
+	tcase_add_checked_fixture(tc_core, ut_setup, ut_teardown);
+
+	tcase_add_test (tc_core, ut_check_props_valid);
+	tcase_add_test (tc_core, ut_check_props_wrong_type);
+	tcase_add_test (tc_core, ut_check_props_not_array);
+	tcase_add_test (tc_core, ut_check_props_not_dict);
+	tcase_add_test (tc_core, ut_check_props_bad_key);
+	tcase_add_test (tc_core, ut_check_props_bad_value);
+
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
+
+int main(int argc, char **argv)
+{
+	(void)argc;
+	(void)argv;
+
+	int number_failed;
+	Suite *s = ut_dbus_props_suite ();
+	SRunner *sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
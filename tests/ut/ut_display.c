@@ -848,26 +848,31 @@ void, mce_tklock_show_tklock_ui, (void))
 }
 
 /*
- * libwakelock.c stubs {{{1
+ * mce-wakelock.c and libwakelock.c stubs {{{1
  */
 
 static GHashTable *stub__wakelock_locks = NULL;
 
 EXTERN_STUB (
-void, wakelock_lock, (const char *name, long long ns))
+void, mce_wakelock_obtain, (const char *name, int duration_ms))
 {
-	ck_assert(!g_hash_table_lookup_extended(stub__wakelock_locks, name,
-						NULL, NULL));
-	ck_assert_int_eq(ns, -1);
+	/* Obtain with timeout is used for delayed release */
+	if( duration_ms >= 0 ) {
+		g_hash_table_remove(stub__wakelock_locks, name);
+	}
+	else {
+		ck_assert(!g_hash_table_lookup_extended(stub__wakelock_locks,
+							name, NULL, NULL));
 
-	g_hash_table_insert(stub__wakelock_locks,
-			    g_strdup(name), NULL);
+		g_hash_table_insert(stub__wakelock_locks,
+				    g_strdup(name), NULL);
+	}
 
 	ut_transition_recheck_schedule();
 }
 
 EXTERN_STUB (
-void, wakelock_unlock, (const char *name))
+void, mce_wakelock_release, (const char *name))
 {
 	ck_assert(g_hash_table_lookup_extended(stub__wakelock_locks, name,
 					       NULL, NULL));
@@ -0,0 +1,203 @@
+#include <check.h>
+#include <glib.h>
+
+#include "common.h"
+
+/* Tested module */
+#include "../../mce-timerheap.c"
+
+/* ------------------------------------------------------------------------- *
+ * HELPERS
+ * ------------------------------------------------------------------------- */
+
+#define UT_NODE_COUNT 100
+
+static mce_timerheap_t ut_heap = MCE_TIMERHEAP_INIT;
+static mce_timernode_t ut_node[UT_NODE_COUNT];
+
+static void ut_setup(void)
+{
+	for( int i = 0; i < UT_NODE_COUNT; ++i )
+		mce_timernode_init(&ut_node[i], &ut_node[i]);
+}
+
+static void ut_teardown(void)
+{
+	mce_timerheap_clear(&ut_heap);
+}
+
+/* Pseudo random, but repeatable trigger times */
+static int64_t ut_trigger(int i)
+{
+	return (i * 7919) % 1009;
+}
+
+/* Verify heap property for all queued nodes */
+static void ut_check_heap(void)
+{
+	for( size_t i = 0; i < ut_heap.tmh_count; ++i ) {
+		ck_assert_int_eq(ut_heap.tmh_node[i]->tmn_index, i);
+		if( i > 0 )
+			ck_assert(ut_heap.tmh_node[(i - 1) / 2]->tmn_trigger <=
+				  ut_heap.tmh_node[i]->tmn_trigger);
+	}
+}
+
+/* Pop all nodes, verify that they come out in trigger order */
+static size_t ut_drain(void)
+{
+	size_t           cnt  = 0;
+	int64_t          prev = INT64_MIN;
+	mce_timernode_t *node;
+
+	while( (node = mce_timerheap_pop_expired(&ut_heap, INT64_MAX - 1)) ) {
+		ck_assert(!mce_timernode_is_queued(node));
+		ck_assert(prev <= node->tmn_trigger);
+		prev = node->tmn_trigger;
+		++cnt;
+	}
+
+	ck_assert_int_eq(mce_timerheap_count(&ut_heap), 0);
+	return cnt;
+}
+
+/* ------------------------------------------------------------------------- *
+ * TESTS
+ * ------------------------------------------------------------------------- */
+
+START_TEST (ut_check_insert)
+{
+	ck_assert(mce_timerheap_peek(&ut_heap) == 0);
+	ck_assert(mce_timerheap_next_trigger(&ut_heap) == MCE_TIMERHEAP_NO_TICK);
+
+	for( int i = 0; i < UT_NODE_COUNT; ++i ) {
+		mce_timerheap_schedule(&ut_heap, &ut_node[i], ut_trigger(i));
+		ut_check_heap();
+	}
+
+	ck_assert_int_eq(mce_timerheap_count(&ut_heap), UT_NODE_COUNT);
+	ck_assert(mce_timerheap_next_trigger(&ut_heap) == 0);
+	ck_assert_int_eq(ut_drain(), UT_NODE_COUNT);
+}
+END_TEST
+
+START_TEST (ut_check_pop_expired)
+{
+	for( int i = 0; i < UT_NODE_COUNT; ++i )
+		mce_timerheap_schedule(&ut_heap, &ut_node[i], ut_trigger(i));
+
+	size_t           cnt = 0;
+	mce_timernode_t *node;
+
+	while( (node = mce_timerheap_pop_expired(&ut_heap, 500)) ) {
+		/* Trigger time is retained for bookkeeping */
+		ck_assert(node->tmn_trigger <= 500);
+		++cnt;
+	}
+
+	ck_assert(mce_timerheap_next_trigger(&ut_heap) > 500);
+	ck_assert_int_eq(cnt + ut_drain(), UT_NODE_COUNT);
+}
+END_TEST
+
+START_TEST (ut_check_remove)
+{
+	for( int i = 0; i < UT_NODE_COUNT; ++i )
+		mce_timerheap_schedule(&ut_heap, &ut_node[i], ut_trigger(i));
+
+	/* Remove every third node, including the current head */
+	size_t removed = 0;
+	for( int i = 0; i < UT_NODE_COUNT; i += 3 ) {
+		mce_timerheap_remove(&ut_heap, &ut_node[i]);
+		ck_assert(!mce_timernode_is_queued(&ut_node[i]));
+		ut_check_heap();
+		++removed;
+	}
+
+	/* Removing detached node is a no-op */
+	mce_timerheap_remove(&ut_heap, &ut_node[0]);
+
+	/* Scheduling with NO_TICK removes */
+	mce_timerheap_schedule(&ut_heap, &ut_node[1], MCE_TIMERHEAP_NO_TICK);
+	ck_assert(!mce_timernode_is_queued(&ut_node[1]));
+	++removed;
+
+	ck_assert_int_eq(mce_timerheap_count(&ut_heap), UT_NODE_COUNT - removed);
+	ck_assert_int_eq(ut_drain(), UT_NODE_COUNT - removed);
+}
+END_TEST
+
+START_TEST (ut_check_reorder)
+{
+	for( int i = 0; i < UT_NODE_COUNT; ++i )
+		mce_timerheap_schedule(&ut_heap, &ut_node[i], 1000 + i);
+
+	/* Move last node to the front */
+	mce_timerheap_schedule(&ut_heap, &ut_node[UT_NODE_COUNT - 1], 10);
+	ut_check_heap();
+	ck_assert(mce_timerheap_peek(&ut_heap) == &ut_node[UT_NODE_COUNT - 1]);
+
+	/* Move the front node to the back */
+	mce_timerheap_schedule(&ut_heap, &ut_node[UT_NODE_COUNT - 1], 5000);
+	ut_check_heap();
+	ck_assert(mce_timerheap_peek(&ut_heap) == &ut_node[0]);
+
+	/* Shuffle all nodes */
+	for( int i = 0; i < UT_NODE_COUNT; ++i ) {
+		mce_timerheap_schedule(&ut_heap, &ut_node[i], ut_trigger(i));
+		ut_check_heap();
+	}
+
+	ck_assert_int_eq(mce_timerheap_count(&ut_heap), UT_NODE_COUNT);
+	ck_assert_int_eq(ut_drain(), UT_NODE_COUNT);
+}
+END_TEST
+
+START_TEST (ut_check_clear)
+{
+	for( int i = 0; i < UT_NODE_COUNT; ++i )
+		mce_timerheap_schedule(&ut_heap, &ut_node[i], ut_trigger(i));
+
+	mce_timerheap_clear(&ut_heap);
+
+	ck_assert_int_eq(mce_timerheap_count(&ut_heap), 0);
+	for( int i = 0; i < UT_NODE_COUNT; ++i )
+		ck_assert(!mce_timernode_is_queued(&ut_node[i]));
+
+	/* Heap is usable after clearing */
+	mce_timerheap_schedule(&ut_heap, &ut_node[0], 1);
+	ck_assert_int_eq(ut_drain(), 1);
+}
+END_TEST
+
+static Suite *ut_timerheap_suite (void)
+{
+	Suite *s = suite_create ("ut_timerheap");
+
+	TCase *tc_core = tcase_create ("core");
+	tcase_add_checked_fixture(tc_core, ut_setup, ut_teardown);
+
+	tcase_add_test (tc_core, ut_check_insert);
+	tcase_add_test (tc_core, ut_check_pop_expired);
+	tcase_add_test (tc_core, ut_check_remove);
+	tcase_add_test (tc_core, ut_check_reorder);
+	tcase_add_test (tc_core, ut_check_clear);
+
+	suite_add_tcase (s, tc_core);
+
+	return s;
+}
+
+int main(int argc, char **argv)
+{
+	(void)argc;
+	(void)argv;
+
+	int number_failed;
+	Suite *s = ut_timerheap_suite ();
+	SRunner *sr = srunner_create (s);
+	srunner_run_all (sr, CK_NORMAL);
+	number_failed = srunner_ntests_failed (sr);
+	srunner_free (sr);
+	return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
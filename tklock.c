@@ -4591,7 +4591,7 @@ static guint tklock_dtcalib_timeout_id = 0;
 static void tklock_dtcalib_now(void)
 {
     mce_log(LL_DEBUG, "Recalibrating double tap");
-    mce_write_string_to_file(mce_touchscreen_calibration_control_path, "1");
+    mce_io_write_async(mce_touchscreen_calibration_control_path, "1");
 }
 
 /** Kick the double tap recalibrating sysfs file from heartbeat
@@ -0,0 +1,288 @@
+#!/bin/sh
+
+# Run mce from the build tree in a headless simulated environment
+#
+# Copyright (C) 2017 Jolla Ltd.
+#
+# mce is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License
+# version 2.1 as published by the Free Software Foundation.
+#
+# The script re-executes itself in a private user + mount namespace,
+# where the following are replaced with tmpfs based fakes:
+#
+#   /sys/class/backlight  - one backlight device
+#   /sys/class/leds       - red/green/blue leds
+#   /dev/input            - empty, i.e. no host input devices
+#   /etc, /run, /var/lib  - just what mce needs
+#
+# A private dbus-daemon is started and used as the system bus by both
+# mce and mcetool. Services mce normally talks to (dsme, sensorfwd,
+# ofono, ...) are not present and are seen as not running.
+#
+# Scenario files are executed one line at a time:
+#
+#   # comment
+#   sleep <seconds>
+#   expect display <on|dim|off>    wait until display reaches state
+#   <anything else>                arguments for mcetool
+#
+# Scenario files with .journal suffix are datapipe journals recorded
+# with "mce --journal" and are replayed with "mce --replay-journal".
+#
+# For each scenario mce cpu time, wakeups (voluntary context switches
+# of all mce threads) and command / state transition latencies are
+# reported.
+
+SRCDIR=$(cd "$(dirname "$0")/.." && pwd)
+MCE=$SRCDIR/mce
+MCETOOL=$SRCDIR/tools/mcetool
+MODULEDIR=$SRCDIR/modules
+
+# Seconds to wait for mce to start / state transitions to happen
+TIMEOUT=${MCE_SIM_TIMEOUT:-10}
+
+# Replay speed factor for journal scenarios, empty = without delays
+REPLAY_SPEED=${MCE_SIM_REPLAY_SPEED:-}
+
+# Where mce diagnostic output is collected
+LOGFILE=${MCE_SIM_LOG:-$PWD/mce-simulate.log}
+
+log() {
+  echo >&2 "mce-simulate: $*"
+}
+
+fail() {
+  log "$*"
+  exit 1
+}
+
+now_ms() {
+  echo $(( $(date +%s%N) / 1000000 ))
+}
+
+# ----------------------------------------------------------------------------
+# OUTER: enter private namespace
+# ----------------------------------------------------------------------------
+
+if [ -z "$MCE_SIM_INNER" ]; then
+  [ $# -gt 0 ] || fail "usage: $0 scenario..."
+  [ -x "$MCE" ] || fail "$MCE: not built"
+  [ -x "$MCETOOL" ] || fail "$MCETOOL: not built"
+  MCE_SIM_INNER=1 exec unshare --user --map-root-user --mount --fork \
+    /bin/sh "$0" "$@"
+fi
+
+# ----------------------------------------------------------------------------
+# INNER: set up fake environment
+# ----------------------------------------------------------------------------
+
+ROOT=$(mktemp -d /tmp/mce-sim.XXXXXX) || fail "mktemp failed"
+mount -t tmpfs tmpfs "$ROOT" || fail "can't mount tmpfs"
+
+make_sysfs() {
+  bl=$ROOT/sys/class/backlight/sim
+  mkdir -p "$bl"
+  echo 255 > "$bl/max_brightness"
+  echo 255 > "$bl/brightness"
+  echo 255 > "$bl/actual_brightness"
+  echo 0   > "$bl/bl_power"
+
+  for color in red green blue; do
+    led=$ROOT/sys/class/leds/sim:$color
+    mkdir -p "$led"
+    echo 255 > "$led/max_brightness"
+    echo 0   > "$led/brightness"
+  done
+
+  mount --bind "$ROOT/sys/class/backlight" /sys/class/backlight
+  mount --bind "$ROOT/sys/class/leds" /sys/class/leds
+
+  mkdir -p "$ROOT/dev/input"
+  mount --bind "$ROOT/dev/input" /dev/input
+}
+
+make_etc() {
+  mkdir -p "$ROOT/etc/mce"
+  for f in passwd group localtime machine-id ld.so.cache ld.so.conf; do
+    [ -e "/etc/$f" ] && cp -L "/etc/$f" "$ROOT/etc/"
+  done
+
+  cp "$SRCDIR/inifiles/mce.ini" "$ROOT/etc/mce/10mce.ini"
+  cp "$SRCDIR/inifiles/als-defaults.ini" "$ROOT/etc/mce/20als-defaults.ini"
+  cat > "$ROOT/etc/mce/90simulation.ini" <<EOF
+[Modules]
+ModulePath=$MODULEDIR
+EOF
+
+  mount --bind "$ROOT/etc" /etc
+
+  mkdir -p "$ROOT/run/mce" "$ROOT/var/lib/mce"
+  mount --bind "$ROOT/run" /run
+  mount --bind "$ROOT/var/lib" /var/lib
+}
+
+start_dbus() {
+  cat > "$ROOT/bus.conf" <<EOF
+<!DOCTYPE busconfig PUBLIC "-//freedesktop//DTD D-BUS Bus Configuration 1.0//EN"
+ "http://www.freedesktop.org/standards/dbus/1.0/busconfig.dtd">
+<busconfig>
+  <type>system</type>
+  <listen>unix:path=$ROOT/system_bus_socket</listen>
+  <auth>EXTERNAL</auth>
+  <policy context="default">
+    <allow user="*"/>
+    <allow own="*"/>
+    <allow send_type="method_call"/>
+    <allow send_type="signal"/>
+    <allow send_type="method_return"/>
+    <allow send_type="error"/>
+    <allow receive_type="method_call"/>
+    <allow receive_type="signal"/>
+    <allow receive_type="method_return"/>
+    <allow receive_type="error"/>
+  </policy>
+</busconfig>
+EOF
+  dbus-daemon --config-file="$ROOT/bus.conf" --fork --print-pid > "$ROOT/bus.pid" \
+    || fail "can't start dbus-daemon"
+  DBUS_SYSTEM_BUS_ADDRESS=unix:path=$ROOT/system_bus_socket
+  export DBUS_SYSTEM_BUS_ADDRESS
+}
+
+stop_dbus() {
+  kill "$(cat "$ROOT/bus.pid")" 2>/dev/null
+}
+
+# ----------------------------------------------------------------------------
+# INNER: mce process statistics
+# ----------------------------------------------------------------------------
+
+CLK_TCK=$(getconf CLK_TCK)
+
+# cpu time used by process [ms]
+proc_cpu_ms() {
+  # utime and stime are fields 14 and 15; comm can't contain
+  # spaces here, so plain field splitting works
+  set -- $(cat "/proc/$1/stat" 2>/dev/null)
+  echo $(( (${14:-0} + ${15:-0}) * 1000 / CLK_TCK ))
+}
+
+# voluntary context switches of all threads
+proc_wakeups() {
+  cat /proc/$1/task/*/status 2>/dev/null |
+    awk '/^voluntary_ctxt_switches/ { n += $2 } END { print n + 0 }'
+}
+
+mce_display_state() {
+  dbus-send --system --print-reply=literal --dest=com.nokia.mce \
+    /com/nokia/mce/request com.nokia.mce.request.get_display_status \
+    2>/dev/null | tr -d ' '
+}
+
+wait_display() {
+  t=$(( $(now_ms) + TIMEOUT * 1000 ))
+  while [ "$(mce_display_state)" != "$1" ]; do
+    [ $(now_ms) -lt $t ] || return 1
+    sleep 0.01
+  done
+  return 0
+}
+
+# ----------------------------------------------------------------------------
+# INNER: scenario execution
+# ----------------------------------------------------------------------------
+
+start_mce() {
+  "$MCE" --force-stderr "$@" 2>> "$LOGFILE" &
+  MCE_PID=$!
+}
+
+wait_mce_ready() {
+  t=$(( $(now_ms) + TIMEOUT * 1000 ))
+  while [ -z "$(mce_display_state)" ]; do
+    kill -0 $MCE_PID 2>/dev/null || return 1
+    [ $(now_ms) -lt $t ] || return 1
+    sleep 0.05
+  done
+  return 0
+}
+
+stop_mce() {
+  kill $MCE_PID 2>/dev/null
+  wait $MCE_PID 2>/dev/null
+}
+
+# Execute scenario steps, print one line per step
+run_steps() {
+  prev=$(now_ms)
+  grep -v '^[[:space:]]*\(#\|$\)' "$1" | while read -r cmd arg1 arg2; do
+    t0=$(now_ms)
+    case "$cmd" in
+      sleep)
+        sleep "$arg1"
+        continue
+        ;;
+      expect)
+        # latency is measured from the start of the previous step
+        [ "$arg1" = display ] || fail "$1: unknown expect: $arg1"
+        wait_display "$arg2" || log "$1: display did not reach $arg2"
+        echo "  expect $arg1 $arg2: $(( $(now_ms) - prev )) ms"
+        ;;
+      *)
+        "$MCETOOL" "$cmd" $arg1 $arg2 > /dev/null
+        echo "  $cmd $arg1 $arg2: $(( $(now_ms) - t0 )) ms"
+        ;;
+    esac
+    prev=$t0
+  done
+}
+
+run_scenario() {
+  name=$(basename "$1")
+  echo "scenario $name"
+
+  case "$1" in
+    *.journal)
+      start_mce --replay-journal="$1" ${REPLAY_SPEED:+--replay-speed="$REPLAY_SPEED"}
+      t0=$(now_ms)
+      # mce exits after replay and logs cpu time used by it
+      wait $MCE_PID
+      echo "  replay: $(( $(now_ms) - t0 )) ms (see $LOGFILE)"
+      return
+      ;;
+  esac
+
+  start_mce
+  wait_mce_ready || { log "$name: mce did not start"; stop_mce; return 1; }
+
+  cpu0=$(proc_cpu_ms $MCE_PID)
+  wake0=$(proc_wakeups $MCE_PID)
+  t0=$(now_ms)
+
+  run_steps "$1"
+
+  echo "  total: $(( $(now_ms) - t0 )) ms" \
+       "cpu: $(( $(proc_cpu_ms $MCE_PID) - cpu0 )) ms" \
+       "wakeups: $(( $(proc_wakeups $MCE_PID) - wake0 ))"
+
+  stop_mce
+}
+
+make_sysfs
+make_etc
+start_dbus
+
+: > "$LOGFILE"
+
+RES=0
+for scenario in "$@"; do
+  case "$scenario" in
+    /*) ;;
+    *) scenario=$PWD/$scenario ;;
+  esac
+  run_scenario "$scenario" || RES=1
+done
+
+stop_dbus
+exit $RES
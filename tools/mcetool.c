@@ -19,6 +19,7 @@
  */
 
 #include "../mce-command-line.h"
+#include "../mce-dbus.h"
 #include "../mce-setting.h"
 #include "../tklock.h"
 #include "../powerkey.h"
@@ -39,6 +40,7 @@
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <math.h>
 #include <syslog.h>
 
@@ -124,6 +126,253 @@ static void xdbus_exit(void)
 /** Make sure the cached dbus connection is not used directly */
 #define xdbus_con something_that_will_generate_error
 
+/* ------------------------------------------------------------------------- *
+ * PIPELINED BATCH CALLS
+ *
+ * In batch mode commands are executed twice. During the planning pass
+ * output is muted and method calls are sent to mce without waiting for
+ * replies while the command handlers see the calls as failed. During
+ * the replay pass the same calls are matched against the ones that were
+ * sent ahead and the already available replies are used instead of
+ * making blocking calls.
+ *
+ * Planning stops after a command that might make calls depending on
+ * replies to earlier calls, so that the order in which mce sees the
+ * calls stays the same as when making synchronous calls.
+ * ------------------------------------------------------------------------- */
+
+/** Method call pipelining state */
+typedef enum
+{
+        /** Method calls are made synchronously */
+        XDBUS_BATCH_OFF,
+
+        /** Method calls are sent ahead, handlers see them as failed */
+        XDBUS_BATCH_PLAN,
+
+        /** Method calls are matched against calls sent ahead */
+        XDBUS_BATCH_REPLAY,
+} xdbus_batch_state_t;
+
+/** Method call sent ahead during batch planning */
+typedef struct
+{
+        /** Marshalled copy of the method call, used for matching */
+        char            *data;
+
+        /** Size of marshalled method call */
+        int              size;
+
+        /** Pending reply, or NULL if reply was not requested */
+        DBusPendingCall *pc;
+} xdbus_batch_call_t;
+
+/** Current method call pipelining state */
+static xdbus_batch_state_t xdbus_batch_state = XDBUS_BATCH_OFF;
+
+/** Method calls sent ahead, in the order they were sent */
+static GQueue xdbus_batch_queue = G_QUEUE_INIT;
+
+/** Number of method calls made by the command being planned */
+static int  xdbus_batch_calls   = 0;
+
+/** Flag for: the command being planned is known to make only queries */
+static bool xdbus_batch_query   = false;
+
+/** Flag for: calls after this point can't be sent ahead */
+static bool xdbus_batch_barrier = false;
+
+/** Marshal method call message for comparison purposes
+ *
+ * @param req   method call message
+ * @param size  where to store size of the returned data
+ *
+ * @return marshalled data to be released with dbus_free(), or NULL
+ */
+static char *xdbus_batch_marshal(DBusMessage *req, int *size)
+{
+        /* Marshalling locks the message -> operate on a copy
+         * that does not have serial number assigned either */
+        DBusMessage *tmp  = dbus_message_copy(req);
+        char        *data = 0;
+
+        if( !tmp || !dbus_message_marshal(tmp, &data, size) )
+                data = 0;
+
+        if( tmp )
+                dbus_message_unref(tmp);
+
+        return data;
+}
+
+/** Predicate for: method call is a query without side effects
+ *
+ * @param req   method call message
+ *
+ * @return true if method name implies a query, false otherwise
+ */
+static bool xdbus_batch_is_query(DBusMessage *req)
+{
+        const char *member = dbus_message_get_member(req);
+
+        return member && !strncmp(member, "get_", 4);
+}
+
+/** Release method call that was sent ahead
+ *
+ * @param self  method call object, or NULL
+ */
+static void xdbus_batch_call_delete(xdbus_batch_call_t *self)
+{
+        if( !self )
+                return;
+
+        if( self->pc ) {
+                dbus_pending_call_cancel(self->pc);
+                dbus_pending_call_unref(self->pc);
+        }
+        dbus_free(self->data);
+        g_free(self);
+}
+
+/** Drop all method calls that were sent ahead but not matched
+ */
+static void xdbus_batch_flush(void)
+{
+        xdbus_batch_call_t *call;
+
+        while( (call = g_queue_pop_head(&xdbus_batch_queue)) ) {
+                debugf("dropping unmatched call\n");
+                xdbus_batch_call_delete(call);
+        }
+}
+
+/** Start planning a batch command
+ *
+ * @param query  true if the command is known to make only queries
+ */
+static void xdbus_batch_begin_command(bool query)
+{
+        xdbus_batch_calls = 0;
+        xdbus_batch_query = query;
+}
+
+/** Send method call ahead during batch planning
+ *
+ * The first call made by a command can't depend on replies, and queries
+ * can be sent ahead as they have no side effects. Anything else makes
+ * the rest of the command and commands after it unplannable.
+ *
+ * @param req         method call message
+ * @param want_reply  true if reply is needed, false otherwise
+ */
+static void xdbus_batch_plan(DBusMessage *req, bool want_reply)
+{
+        DBusConnection     *bus   = xdbus_init();
+        xdbus_batch_call_t *call  = 0;
+        bool                first = (xdbus_batch_calls++ == 0);
+
+        if( xdbus_batch_barrier )
+                goto EXIT;
+
+        if( !xdbus_batch_is_query(req) ) {
+                if( !first ) {
+                        xdbus_batch_barrier = true;
+                        goto EXIT;
+                }
+        }
+        else if( !xdbus_batch_query ) {
+                /* What happens after this can depend on the reply */
+                xdbus_batch_barrier = true;
+        }
+
+        call = g_malloc0(sizeof *call);
+
+        if( !(call->data = xdbus_batch_marshal(req, &call->size)) )
+                goto EXIT;
+
+        if( want_reply ) {
+                if( !dbus_connection_send_with_reply(bus, req, &call->pc, -1) )
+                        goto EXIT;
+                if( !call->pc )
+                        goto EXIT;
+        }
+        else if( !dbus_connection_send(bus, req, 0) ) {
+                goto EXIT;
+        }
+
+        g_queue_push_tail(&xdbus_batch_queue, call), call = 0;
+
+EXIT:
+        /* Whatever could not be sent ahead, must not be overtaken */
+        if( call )
+                xdbus_batch_barrier = true;
+
+        xdbus_batch_call_delete(call);
+}
+
+/** Use reply to method call that was sent ahead
+ *
+ * Planned calls that precede the matching one were not made during
+ * replay and are dropped.
+ *
+ * @param req  method call message
+ * @param rsp  where to store reply message, or NULL if not needed
+ * @param err  where to store error details, or NULL if not needed
+ *
+ * @return true if matching call was found, false otherwise
+ */
+static bool xdbus_batch_replay(DBusMessage *req, DBusMessage **rsp,
+                               DBusError *err)
+{
+        bool                ack  = false;
+        xdbus_batch_call_t *call = 0;
+        char               *data = 0;
+        int                 size = 0;
+        GList              *iter;
+
+        if( xdbus_batch_state != XDBUS_BATCH_REPLAY )
+                goto EXIT;
+
+        if( g_queue_is_empty(&xdbus_batch_queue) )
+                goto EXIT;
+
+        if( !(data = xdbus_batch_marshal(req, &size)) )
+                goto EXIT;
+
+        for( iter = xdbus_batch_queue.head; iter; iter = iter->next ) {
+                call = iter->data;
+                if( call->size == size && !memcmp(call->data, data, size) )
+                        break;
+        }
+
+        if( !iter )
+                goto EXIT;
+
+        while( xdbus_batch_queue.head != iter ) {
+                debugf("dropping skipped call\n");
+                xdbus_batch_call_delete(g_queue_pop_head(&xdbus_batch_queue));
+        }
+        call = g_queue_pop_head(&xdbus_batch_queue);
+
+        if( call->pc && rsp ) {
+                dbus_pending_call_block(call->pc);
+                *rsp = dbus_pending_call_steal_reply(call->pc);
+
+                /* Mimic dbus_connection_send_with_reply_and_block() */
+                if( *rsp && dbus_set_error_from_message(err, *rsp) )
+                        dbus_message_unref(*rsp), *rsp = 0;
+        }
+
+        xdbus_batch_call_delete(call);
+        ack = true;
+
+EXIT:
+        dbus_free(data);
+
+        return ack;
+}
+
 /** Generic synchronous D-Bus method call wrapper function
  *
  * If reply pointer is NULL, the method call is sent without
@@ -160,8 +409,17 @@ static gboolean xdbus_call_va(const gchar *const service, const gchar *const pat
 
         dbus_message_set_auto_start(msg, FALSE);
 
+        if( !reply )
+                dbus_message_set_no_reply(msg, TRUE);
+
+        if( xdbus_batch_state == XDBUS_BATCH_PLAN ) {
+                xdbus_batch_plan(msg, reply != 0);
+                goto EXIT;
+        }
+
         if( reply ) {
-                rsp = dbus_connection_send_with_reply_and_block(bus, msg, -1, &err);
+                if( !xdbus_batch_replay(msg, &rsp, &err) )
+                        rsp = dbus_connection_send_with_reply_and_block(bus, msg, -1, &err);
                 if( rsp == 0 ) {
                         errorf("%s.%s send message: %s: %s\n",
                                interface, name, err.name, err.message);
@@ -176,9 +434,7 @@ static gboolean xdbus_call_va(const gchar *const service, const gchar *const pat
                 }
 
         }
-        else {
-                dbus_message_set_no_reply(msg, TRUE);
-
+        else if( !xdbus_batch_replay(msg, 0, 0) ) {
                 if( !dbus_connection_send(bus, msg, NULL) ) {
                         errorf("Failed to send method call\n");
                         goto EXIT;
@@ -542,8 +798,14 @@ static DBusMessage *dbushelper_call_method(DBusMessage *req)
         DBusMessage *rsp = 0;
         DBusError    err = DBUS_ERROR_INIT;
 
-        rsp = dbus_connection_send_with_reply_and_block(xdbus_init(),
-                                                        req, -1, &err);
+        if( xdbus_batch_state == XDBUS_BATCH_PLAN ) {
+                xdbus_batch_plan(req, true);
+                goto EXIT;
+        }
+
+        if( !xdbus_batch_replay(req, &rsp, &err) )
+                rsp = dbus_connection_send_with_reply_and_block(xdbus_init(),
+                                                                req, -1, &err);
 
         if( !rsp ) {
                 errorf("%s.%s: %s: %s\n",
@@ -4630,6 +4892,43 @@ static void xmce_get_display_off_override(void)
         printf("%-"PAD1"s %s \n", "Display off override mode:", txt ?: "unknown");
 }
 
+/* ------------------------------------------------------------------------- *
+ * speculative resume
+ * ------------------------------------------------------------------------- */
+
+/** Lookuptable for speculative resume triggering bits */
+static const symbol_t speculative_resume_lut[] =
+{
+        { "powerkey",  MCE_SPECULATIVE_RESUME_POWERKEY  },
+        { "proximity", MCE_SPECULATIVE_RESUME_PROXIMITY },
+        { "none",      MCE_SPECULATIVE_RESUME_NONE      },
+        { 0,           0                                }
+};
+
+/** Set speculative frame buffer resume triggering mode
+ *
+ * @param args string of comma separated triggering names
+ */
+static bool xmce_set_speculative_resume(const char *args)
+{
+        int mask = mcetool_parse_bitmask(speculative_resume_lut, args);
+        xmce_setting_set_int(MCE_SETTING_DISPLAY_SPECULATIVE_RESUME, mask);
+        return true;
+}
+
+/** Get current speculative resume triggering mode from mce and print it out
+ */
+static void xmce_get_speculative_resume(void)
+{
+        gint mask = 0;
+        char work[64] = "unknown";
+        if( xmce_setting_get_int(MCE_SETTING_DISPLAY_SPECULATIVE_RESUME, &mask) )
+                mcetool_format_bitmask(speculative_resume_lut, mask,
+                                       work, sizeof work);
+
+        printf("%-"PAD1"s %s\n", "Speculative resume:", work);
+}
+
 /* ------------------------------------------------------------------------- *
  * volkey input policy
  * ------------------------------------------------------------------------- */
@@ -5154,6 +5453,42 @@ static bool xmce_set_memnotify_critical_active(const char *args)
         return true;
 }
 
+static bool xmce_set_memnotify_warning_stall(const char *args)
+{
+        xmce_setting_set_int(MCE_SETTING_MEMNOTIFY_WARNING_STALL,
+                             xmce_parse_integer(args));
+        return true;
+}
+
+static bool xmce_set_memnotify_critical_stall(const char *args)
+{
+        xmce_setting_set_int(MCE_SETTING_MEMNOTIFY_CRITICAL_STALL,
+                             xmce_parse_integer(args));
+        return true;
+}
+
+static bool xmce_set_memnotify_stall_window(const char *args)
+{
+        gint val = xmce_parse_integer(args);
+        if( val < 500 || val > 10000 ) {
+                errorf("%d: invalid stall window\n", val);
+                return false;
+        }
+        xmce_setting_set_int(MCE_SETTING_MEMNOTIFY_STALL_WINDOW, val);
+        return true;
+}
+
+static void xmce_get_memnotify_stall_helper(const char *title, const char *key)
+{
+        gint val = 0;
+        if( !xmce_setting_get_int(key, &val) )
+                printf("%-"PAD1"s %s\n", title, "unknown");
+        else if( val <= 0 )
+                printf("%-"PAD1"s %s\n", title, "disabled");
+        else
+                printf("%-"PAD1"s %d (ms)\n", title, (int)val);
+}
+
 static void xmce_get_memnotify_helper(const char *title, const char *key)
 {
         gint val = 0;
@@ -5181,6 +5516,15 @@ static void xmce_get_memnotify_limits(void)
 
         xmce_get_memnotify_helper("Memory use critical [active]:",
                                   MCE_SETTING_MEMNOTIFY_CRITICAL_ACTIVE);
+
+        xmce_get_memnotify_stall_helper("Memory stall warning [some]:",
+                                        MCE_SETTING_MEMNOTIFY_WARNING_STALL);
+
+        xmce_get_memnotify_stall_helper("Memory stall critical [full]:",
+                                        MCE_SETTING_MEMNOTIFY_CRITICAL_STALL);
+
+        xmce_get_memnotify_stall_helper("Memory stall window:",
+                                        MCE_SETTING_MEMNOTIFY_STALL_WINDOW);
 }
 
 static void xmce_get_memnotify_level(void)
@@ -5468,50 +5812,568 @@ EXIT:
         return true;
 }
 
-/* ------------------------------------------------------------------------- *
- * use mouse clicks to emulate touchscreen doubletap policy
- * ------------------------------------------------------------------------- */
-
-#ifdef ENABLE_DOUBLETAP_EMULATION
-static bool xmce_set_fake_doubletap(const char *args)
+/** Get extended display statistics
+ */
+static bool xmce_get_display_stats_extended(const char *args)
 {
-        debugf("%s(%s)\n", __FUNCTION__, args);
-        int val = lookup(fake_doubletap_values, args);
-        if( val < 0 ) {
-                errorf("%s: invalid fake doubletap value\n", args);
-                exit(EXIT_FAILURE);
+        (void)args;
+
+        DBusMessage *rsp  = NULL;
+        DBusError    err  = DBUS_ERROR_INIT;
+        gchar       *name = 0;
+
+        DBusMessageIter body, array, dict;
+
+        if( !xmce_ipc_message_reply(MCE_DISPLAY_STATS_EXTENDED_GET, &rsp, DBUS_TYPE_INVALID) )
+                goto EXIT;
+
+        if( !dbushelper_init_read_iterator(rsp, &body) )
+                goto EXIT;
+
+        if( !dbushelper_require_array_type(&body, DBUS_TYPE_DICT_ENTRY) )
+                goto EXIT;
+
+        if( !dbushelper_read_array(&body, &array) )
+                goto EXIT;
+
+        while( !dbushelper_read_at_end(&array) ) {
+                g_free(name), name = 0;
+
+                int64_t value = 0;
+
+                if( !dbushelper_read_dict(&array, &dict) )
+                        goto EXIT;
+
+                if( !dbushelper_read_string(&dict, &name) ||
+                    !dbushelper_read_int64(&dict, &value) )
+                        goto EXIT;
+
+                printf("%-32s %"PRIi64"\n", name, value);
         }
-        xmce_setting_set_bool(MCE_SETTING_USE_FAKE_DOUBLETAP, val != 0);
+EXIT:
+        g_free(name);
+
+        if( dbus_error_is_set(&err) ) {
+                errorf("%s: %s: %s\n", MCE_DISPLAY_STATS_EXTENDED_GET, err.name, err.message);
+                dbus_error_free(&err);
+        }
+
+        if( rsp ) dbus_message_unref(rsp);
+
         return true;
 }
 
-/** Get current fake double tap policy from mce and print it out
+/* ------------------------------------------------------------------------- *
+ * signal statistics
+ * ------------------------------------------------------------------------- */
+
+/** Get number of signals sent and suppressed by mce
  */
-static void xmce_get_fake_doubletap(void)
+static bool xmce_get_signal_stats(const char *args)
 {
-        gboolean    val = 0;
-        const char *txt = 0;
-        if( xmce_setting_get_bool(MCE_SETTING_USE_FAKE_DOUBLETAP, &val) )
-                txt = rlookup(fake_doubletap_values, val);
-        printf("%-"PAD1"s %s \n", "Use fake doubletap:", txt ?: "unknown");
+        (void)args;
+
+        DBusMessage *rsp = NULL;
+        DBusError    err = DBUS_ERROR_INIT;
+        dbus_int64_t sent       = 0;
+        dbus_int64_t suppressed = 0;
+
+        if( !xmce_ipc_message_reply(MCE_SIGNAL_STATS_GET, &rsp, DBUS_TYPE_INVALID) )
+                goto EXIT;
+
+        if( !dbus_message_get_args(rsp, &err,
+                                   DBUS_TYPE_INT64, &sent,
+                                   DBUS_TYPE_INT64, &suppressed,
+                                   DBUS_TYPE_INVALID) )
+                goto EXIT;
+
+        printf("%-"PAD1"s %"PRIi64"\n", "Signals sent:", (int64_t)sent);
+        printf("%-"PAD1"s %"PRIi64"\n", "Duplicate signals suppressed:",
+               (int64_t)suppressed);
+
+EXIT:
+        if( dbus_error_is_set(&err) ) {
+                errorf("%s: %s: %s\n", MCE_SIGNAL_STATS_GET, err.name, err.message);
+                dbus_error_free(&err);
+        }
+
+        if( rsp ) dbus_message_unref(rsp);
+
+        return true;
 }
-#endif /* ENABLE_DOUBLETAP_EMULATION */
 
 /* ------------------------------------------------------------------------- *
- * tklock
+ * peer credential statistics
  * ------------------------------------------------------------------------- */
 
-/** Lookup table for tklock open values
+/** Get peer credential cache and query queue statistics from mce
  */
-static const symbol_t tklock_open_values[] = {
-#if 0 // DEPRECATED
-        { "none",     TKLOCK_NONE },
-        { "enable",   TKLOCK_ENABLE },
-        { "help",     TKLOCK_HELP },
-        { "select",   TKLOCK_SELECT },
-#endif
-        { "oneinput", TKLOCK_ONEINPUT },
-        { "visual",   TKLOCK_ENABLE_VISUAL },
+static bool xmce_get_peer_credential_stats(const char *args)
+{
+        (void)args;
+
+        DBusMessage *rsp = NULL;
+        DBusError    err = DBUS_ERROR_INIT;
+        dbus_int64_t hits       = 0;
+        dbus_int64_t misses     = 0;
+        dbus_int64_t evictions  = 0;
+        dbus_int64_t queries    = 0;
+        dbus_int64_t wait_total = 0;
+        dbus_int64_t wait_max   = 0;
+        dbus_int64_t batch_max  = 0;
+
+        if( !xmce_ipc_message_reply(MCE_PEER_CREDENTIAL_STATS_GET, &rsp, DBUS_TYPE_INVALID) )
+                goto EXIT;
+
+        if( !dbus_message_get_args(rsp, &err,
+                                   DBUS_TYPE_INT64, &hits,
+                                   DBUS_TYPE_INT64, &misses,
+                                   DBUS_TYPE_INT64, &evictions,
+                                   DBUS_TYPE_INT64, &queries,
+                                   DBUS_TYPE_INT64, &wait_total,
+                                   DBUS_TYPE_INT64, &wait_max,
+                                   DBUS_TYPE_INT64, &batch_max,
+                                   DBUS_TYPE_INVALID) )
+                goto EXIT;
+
+        printf("%-"PAD1"s %"PRIi64"\n", "Credential cache hits:", (int64_t)hits);
+        printf("%-"PAD1"s %"PRIi64"\n", "Credential cache misses:", (int64_t)misses);
+        printf("%-"PAD1"s %"PRIi64"\n", "Credential cache evictions:",
+               (int64_t)evictions);
+        printf("%-"PAD1"s %"PRIi64"\n", "Credential queries sent:",
+               (int64_t)queries);
+        printf("%-"PAD1"s %"PRIi64" (ms)\n", "Total query queue wait:",
+               (int64_t)wait_total);
+        printf("%-"PAD1"s %"PRIi64" (ms)\n", "Longest query queue wait:",
+               (int64_t)wait_max);
+        printf("%-"PAD1"s %"PRIi64"\n", "Largest query batch:",
+               (int64_t)batch_max);
+
+EXIT:
+        if( dbus_error_is_set(&err) ) {
+                errorf("%s: %s: %s\n", MCE_PEER_CREDENTIAL_STATS_GET, err.name, err.message);
+                dbus_error_free(&err);
+        }
+
+        if( rsp ) dbus_message_unref(rsp);
+
+        return true;
+}
+
+/* ------------------------------------------------------------------------- *
+ * cpu keepalive statistics
+ * ------------------------------------------------------------------------- */
+
+/** Get cpu keepalive session statistics from mce
+ */
+static bool xmce_get_cpu_keepalive_stats(const char *args)
+{
+        (void)args;
+
+        DBusMessage *rsp = NULL;
+        DBusError    err = DBUS_ERROR_INIT;
+        dbus_int64_t sessions    = 0;
+        dbus_int64_t renewals    = 0;
+        dbus_int64_t expired     = 0;
+        dbus_int64_t activations = 0;
+        dbus_int64_t held_ms     = 0;
+        dbus_int64_t wakeups     = 0;
+        dbus_int64_t clients     = 0;
+        dbus_int64_t active      = 0;
+
+        if( !xmce_ipc_message_reply(MCE_CPU_KEEPALIVE_STATS_GET, &rsp, DBUS_TYPE_INVALID) )
+                goto EXIT;
+
+        if( !dbus_message_get_args(rsp, &err,
+                                   DBUS_TYPE_INT64, &sessions,
+                                   DBUS_TYPE_INT64, &renewals,
+                                   DBUS_TYPE_INT64, &expired,
+                                   DBUS_TYPE_INT64, &activations,
+                                   DBUS_TYPE_INT64, &held_ms,
+                                   DBUS_TYPE_INT64, &wakeups,
+                                   DBUS_TYPE_INT64, &clients,
+                                   DBUS_TYPE_INT64, &active,
+                                   DBUS_TYPE_INVALID) )
+                goto EXIT;
+
+        printf("%-"PAD1"s %"PRIi64"\n", "Keepalive sessions started:",
+               (int64_t)sessions);
+        printf("%-"PAD1"s %"PRIi64"\n", "Keepalive session renewals:",
+               (int64_t)renewals);
+        printf("%-"PAD1"s %"PRIi64"\n", "Keepalive sessions expired:",
+               (int64_t)expired);
+        printf("%-"PAD1"s %"PRIi64"\n", "Keepalive activations:",
+               (int64_t)activations);
+        printf("%-"PAD1"s %"PRIi64" (ms)\n", "Keepalive held:",
+               (int64_t)held_ms);
+        printf("%-"PAD1"s %"PRIi64"\n", "Keepalive timer wakeups:",
+               (int64_t)wakeups);
+        printf("%-"PAD1"s %"PRIi64"\n", "Keepalive clients:",
+               (int64_t)clients);
+        printf("%-"PAD1"s %"PRIi64"\n", "Keepalive active sessions:",
+               (int64_t)active);
+
+EXIT:
+        if( dbus_error_is_set(&err) ) {
+                errorf("%s: %s: %s\n", MCE_CPU_KEEPALIVE_STATS_GET, err.name, err.message);
+                dbus_error_free(&err);
+        }
+
+        if( rsp ) dbus_message_unref(rsp);
+
+        return true;
+}
+
+/* ------------------------------------------------------------------------- *
+ * state snapshot
+ * ------------------------------------------------------------------------- */
+
+/** Get snapshot of public mce state
+ */
+static bool xmce_get_state_snapshot(const char *args)
+{
+        (void)args;
+
+        DBusMessage *rsp  = NULL;
+        gchar       *name = 0;
+
+        DBusMessageIter body, array, dict, variant;
+
+        if( !xmce_ipc_message_reply(MCE_STATE_SNAPSHOT_GET, &rsp, DBUS_TYPE_INVALID) )
+                goto EXIT;
+
+        if( !dbushelper_init_read_iterator(rsp, &body) )
+                goto EXIT;
+
+        if( !dbushelper_require_array_type(&body, DBUS_TYPE_DICT_ENTRY) )
+                goto EXIT;
+
+        if( !dbushelper_read_array(&body, &array) )
+                goto EXIT;
+
+        while( !dbushelper_read_at_end(&array) ) {
+                g_free(name), name = 0;
+
+                if( !dbushelper_read_dict(&array, &dict) )
+                        goto EXIT;
+
+                if( !dbushelper_read_string(&dict, &name) )
+                        goto EXIT;
+
+                if( !dbushelper_read_variant(&dict, &variant) )
+                        goto EXIT;
+
+                switch( dbus_message_iter_get_arg_type(&variant) ) {
+                case DBUS_TYPE_STRING: {
+                        gchar *str = 0;
+                        if( !dbushelper_read_string(&variant, &str) )
+                                goto EXIT;
+                        printf("%-"PAD1"s %s\n", name, str);
+                        g_free(str);
+                        break;
+                }
+                case DBUS_TYPE_INT32: {
+                        gint num = 0;
+                        if( !dbushelper_read_int(&variant, &num) )
+                                goto EXIT;
+                        printf("%-"PAD1"s %d\n", name, num);
+                        break;
+                }
+                case DBUS_TYPE_BOOLEAN: {
+                        gboolean flag = FALSE;
+                        if( !dbushelper_read_boolean(&variant, &flag) )
+                                goto EXIT;
+                        printf("%-"PAD1"s %s\n", name, flag ? "true" : "false");
+                        break;
+                }
+                default:
+                        printf("%-"PAD1"s %s\n", name, "<unsupported type>");
+                        break;
+                }
+        }
+
+EXIT:
+        g_free(name);
+
+        if( rsp ) dbus_message_unref(rsp);
+
+        return true;
+}
+
+/* ------------------------------------------------------------------------- *
+ * timer wakeup statistics
+ * ------------------------------------------------------------------------- */
+
+/** Get heartbeat and wakelock timer wakeup statistics
+ */
+static bool xmce_get_timer_stats(const char *args)
+{
+        (void)args;
+
+        DBusMessage *rsp  = NULL;
+        DBusError    err  = DBUS_ERROR_INIT;
+        gchar       *name = 0;
+
+        DBusMessageIter body, array, dict, entry;
+
+        if( !xmce_ipc_message_reply(MCE_TIMER_STATS_GET, &rsp, DBUS_TYPE_INVALID) )
+                goto EXIT;
+
+        if( !dbushelper_init_read_iterator(rsp, &body) )
+                goto EXIT;
+
+        if( !dbushelper_require_array_type(&body, DBUS_TYPE_DICT_ENTRY) )
+                goto EXIT;
+
+        if( !dbushelper_read_array(&body, &array) )
+                goto EXIT;
+
+        while( !dbushelper_read_at_end(&array) ) {
+                g_free(name), name = 0;
+
+                if( !dbushelper_read_dict(&array, &dict) )
+                        goto EXIT;
+
+                if( !dbushelper_read_string(&dict, &name) )
+                        goto EXIT;
+
+                if( !dbushelper_read_struct(&dict, &entry) )
+                        goto EXIT;
+
+                int64_t wakeups       = 0;
+                int64_t notifications = 0;
+                int64_t off_wakeups   = 0;
+                int64_t off_notifs    = 0;
+                int64_t off_time_ms   = 0;
+
+                if( !dbushelper_read_int64(&entry, &wakeups) ||
+                    !dbushelper_read_int64(&entry, &notifications) ||
+                    !dbushelper_read_int64(&entry, &off_wakeups) ||
+                    !dbushelper_read_int64(&entry, &off_notifs) ||
+                    !dbushelper_read_int64(&entry, &off_time_ms) )
+                        goto EXIT;
+
+                char   tmp[64];
+                double off_hours = off_time_ms / 3600e3;
+
+                printf("%s:\n", name);
+                printf("  wakeups:                %"PRIi64"\n", wakeups);
+                printf("  notifications:          %"PRIi64"\n", notifications);
+                printf("  coalesced:              %"PRIi64"\n",
+                       notifications - wakeups);
+                printf("  display off time:       %s\n",
+                       elapsed_time_repr(tmp, sizeof tmp, off_time_ms));
+                printf("  display off wakeups:    %"PRIi64"\n", off_wakeups);
+                printf("  display off coalesced:  %"PRIi64"\n",
+                       off_notifs - off_wakeups);
+                if( off_hours > 0 ) {
+                        printf("  display off wakeups/h:  %.1f\n",
+                               off_wakeups / off_hours);
+                        printf("  display off saved/h:    %.1f\n",
+                               (off_notifs - off_wakeups) / off_hours);
+                }
+        }
+EXIT:
+        g_free(name);
+
+        if( dbus_error_is_set(&err) ) {
+                errorf("%s: %s: %s\n", MCE_TIMER_STATS_GET, err.name, err.message);
+                dbus_error_free(&err);
+        }
+
+        if( rsp ) dbus_message_unref(rsp);
+
+        return true;
+}
+
+/* ------------------------------------------------------------------------- *
+ * wakelock statistics
+ * ------------------------------------------------------------------------- */
+
+/** Get wakelock usage statistics
+ */
+static bool xmce_get_wakelock_stats(const char *args)
+{
+        (void)args;
+
+        DBusMessage *rsp  = NULL;
+        DBusError    err  = DBUS_ERROR_INIT;
+        gchar       *name = 0;
+
+        DBusMessageIter body, array, dict, entry;
+
+        if( !xmce_ipc_message_reply(MCE_WAKELOCK_STATS_GET, &rsp, DBUS_TYPE_INVALID) )
+                goto EXIT;
+
+        if( !dbushelper_init_read_iterator(rsp, &body) )
+                goto EXIT;
+
+        if( !dbushelper_require_array_type(&body, DBUS_TYPE_DICT_ENTRY) )
+                goto EXIT;
+
+        if( !dbushelper_read_array(&body, &array) )
+                goto EXIT;
+
+        printf("%-24s %8s %8s %12s %10s %12s %s\n",
+               "wakelock", "acquired", "timeouts",
+               "total_ms", "max_ms", "sole_ms", "active");
+
+        while( !dbushelper_read_at_end(&array) ) {
+                g_free(name), name = 0;
+
+                if( !dbushelper_read_dict(&array, &dict) )
+                        goto EXIT;
+
+                if( !dbushelper_read_string(&dict, &name) )
+                        goto EXIT;
+
+                if( !dbushelper_read_struct(&dict, &entry) )
+                        goto EXIT;
+
+                int64_t  acquired = 0;
+                int64_t  timeouts = 0;
+                int64_t  total_ms = 0;
+                int64_t  max_ms   = 0;
+                int64_t  sole_ms  = 0;
+                gboolean active   = FALSE;
+
+                if( !dbushelper_read_int64(&entry, &acquired) ||
+                    !dbushelper_read_int64(&entry, &timeouts) ||
+                    !dbushelper_read_int64(&entry, &total_ms) ||
+                    !dbushelper_read_int64(&entry, &max_ms) ||
+                    !dbushelper_read_int64(&entry, &sole_ms) ||
+                    !dbushelper_read_boolean(&entry, &active) )
+                        goto EXIT;
+
+                printf("%-24s %8"PRIi64" %8"PRIi64" %12"PRIi64" %10"PRIi64
+                       " %12"PRIi64" %s\n",
+                       name, acquired, timeouts, total_ms, max_ms, sole_ms,
+                       active ? "yes" : "no");
+        }
+EXIT:
+        g_free(name);
+
+        if( dbus_error_is_set(&err) ) {
+                errorf("%s: %s: %s\n", MCE_WAKELOCK_STATS_GET, err.name, err.message);
+                dbus_error_free(&err);
+        }
+
+        if( rsp ) dbus_message_unref(rsp);
+
+        return true;
+}
+
+/* ------------------------------------------------------------------------- *
+ * startup report
+ * ------------------------------------------------------------------------- */
+
+/** Get timing of mce startup phases
+ */
+static bool xmce_get_startup_report(const char *args)
+{
+        (void)args;
+
+        DBusMessage *rsp  = NULL;
+        DBusError    err  = DBUS_ERROR_INIT;
+        gchar       *name = 0;
+
+        DBusMessageIter body, array, entry;
+
+        if( !xmce_ipc_message_reply(MCE_STARTUP_REPORT_GET, &rsp, DBUS_TYPE_INVALID) )
+                goto EXIT;
+
+        if( !dbushelper_init_read_iterator(rsp, &body) )
+                goto EXIT;
+
+        if( !dbushelper_require_array_type(&body, DBUS_TYPE_STRUCT) )
+                goto EXIT;
+
+        if( !dbushelper_read_array(&body, &array) )
+                goto EXIT;
+
+        printf("%-16s %8s %8s\n", "phase", "start_ms", "took_ms");
+
+        int64_t total = 0;
+
+        while( !dbushelper_read_at_end(&array) ) {
+                g_free(name), name = 0;
+
+                if( !dbushelper_read_struct(&array, &entry) )
+                        goto EXIT;
+
+                int64_t start_ms    = 0;
+                int64_t duration_ms = 0;
+
+                if( !dbushelper_read_string(&entry, &name) ||
+                    !dbushelper_read_int64(&entry, &start_ms) ||
+                    !dbushelper_read_int64(&entry, &duration_ms) )
+                        goto EXIT;
+
+                printf("%-16s %8"PRIi64" %8"PRIi64"\n",
+                       name, start_ms, duration_ms);
+
+                if( duration_ms >= 0 )
+                        total = start_ms + duration_ms;
+        }
+
+        printf("%-16s %8s %8"PRIi64"\n", "total", "", total);
+EXIT:
+        g_free(name);
+
+        if( dbus_error_is_set(&err) ) {
+                errorf("%s: %s: %s\n", MCE_STARTUP_REPORT_GET, err.name, err.message);
+                dbus_error_free(&err);
+        }
+
+        if( rsp ) dbus_message_unref(rsp);
+
+        return true;
+}
+
+/* ------------------------------------------------------------------------- *
+ * use mouse clicks to emulate touchscreen doubletap policy
+ * ------------------------------------------------------------------------- */
+
+#ifdef ENABLE_DOUBLETAP_EMULATION
+static bool xmce_set_fake_doubletap(const char *args)
+{
+        debugf("%s(%s)\n", __FUNCTION__, args);
+        int val = lookup(fake_doubletap_values, args);
+        if( val < 0 ) {
+                errorf("%s: invalid fake doubletap value\n", args);
+                exit(EXIT_FAILURE);
+        }
+        xmce_setting_set_bool(MCE_SETTING_USE_FAKE_DOUBLETAP, val != 0);
+        return true;
+}
+
+/** Get current fake double tap policy from mce and print it out
+ */
+static void xmce_get_fake_doubletap(void)
+{
+        gboolean    val = 0;
+        const char *txt = 0;
+        if( xmce_setting_get_bool(MCE_SETTING_USE_FAKE_DOUBLETAP, &val) )
+                txt = rlookup(fake_doubletap_values, val);
+        printf("%-"PAD1"s %s \n", "Use fake doubletap:", txt ?: "unknown");
+}
+#endif /* ENABLE_DOUBLETAP_EMULATION */
+
+/* ------------------------------------------------------------------------- *
+ * tklock
+ * ------------------------------------------------------------------------- */
+
+/** Lookup table for tklock open values
+ */
+static const symbol_t tklock_open_values[] = {
+#if 0 // DEPRECATED
+        { "none",     TKLOCK_NONE },
+        { "enable",   TKLOCK_ENABLE },
+        { "help",     TKLOCK_HELP },
+        { "select",   TKLOCK_SELECT },
+#endif
+        { "oneinput", TKLOCK_ONEINPUT },
+        { "visual",   TKLOCK_ENABLE_VISUAL },
         { "lpm",      TKLOCK_ENABLE_LPM_UI },
         { "pause",    TKLOCK_PAUSE_UI },
         { NULL, -1 }
@@ -5528,10 +6390,8 @@ static bool xmce_tklock_open(const char *args)
                 exit(EXIT_FAILURE);
         }
 
-        DBusConnection *bus = xdbus_init();
         DBusMessage    *rsp = 0;
         DBusMessage    *req = 0;
-        DBusError       err = DBUS_ERROR_INIT;
 
         const char   *cb_service   = MCE_SERVICE;
         const char   *cb_path      = MCE_REQUEST_PATH;
@@ -5557,19 +6417,13 @@ static bool xmce_tklock_open(const char *args)
                                  DBUS_TYPE_BOOLEAN, &flicker_key,
                                  DBUS_TYPE_INVALID);
 
-        rsp = dbus_connection_send_with_reply_and_block(bus, req, -1, &err);
-
-        if( !req ) {
-                errorf("no reply to %s; %s: %s\n", SYSTEMUI_TKLOCK_OPEN_REQ,
-                       err.name, err.message);
+        if( !(rsp = dbushelper_call_method(req)) )
                 goto EXIT;
-        }
         printf("got reply to %s\n", SYSTEMUI_TKLOCK_OPEN_REQ);
 
 EXIT:
         if( rsp ) dbus_message_unref(rsp), rsp = 0;
         if( req ) dbus_message_unref(req), req = 0;
-        dbus_error_free(&err);
         return true;
 }
 
@@ -5581,10 +6435,8 @@ static bool xmce_tklock_close(const char *args)
 
         debugf("%s(%s)\n", __FUNCTION__, args);
 
-        DBusConnection *bus = xdbus_init();
         DBusMessage    *rsp = 0;
         DBusMessage    *req = 0;
-        DBusError       err = DBUS_ERROR_INIT;
 
         dbus_bool_t silent = TRUE;
 
@@ -5598,19 +6450,13 @@ static bool xmce_tklock_close(const char *args)
                                  DBUS_TYPE_BOOLEAN, &silent,
                                  DBUS_TYPE_INVALID);
 
-        rsp = dbus_connection_send_with_reply_and_block(bus, req, -1, &err);
-
-        if( !req ) {
-                errorf("no reply to %s; %s: %s\n", SYSTEMUI_TKLOCK_CLOSE_REQ,
-                       err.name, err.message);
+        if( !(rsp = dbushelper_call_method(req)) )
                 goto EXIT;
-        }
         printf("got reply to %s\n", SYSTEMUI_TKLOCK_CLOSE_REQ);
 
 EXIT:
         if( rsp ) dbus_message_unref(rsp), rsp = 0;
         if( req ) dbus_message_unref(req), req = 0;
-        dbus_error_free(&err);
         return true;
 }
 
@@ -5786,6 +6632,7 @@ static bool xmce_get_status(const char *args)
         xmce_get_ps_override_count();
         xmce_get_ps_override_timeout();
         xmce_get_display_off_override();
+        xmce_get_speculative_resume();
         xmce_get_low_power_mode();
         xmce_get_lpmui_triggering();
         xmce_get_als_mode();
@@ -5906,6 +6753,7 @@ static bool xmce_set_demo_mode(const char *args)
 static bool mcetool_do_help(const char *arg);
 static bool mcetool_do_long_help(const char *arg);
 static bool mcetool_do_version(const char *arg);
+static bool mcetool_do_batch(const char *arg);
 
 static bool mcetool_do_unblank_screen(const char *arg)
 {
@@ -5977,6 +6825,45 @@ static const mce_opt_t options[] =
                         "the currently running mce process gets accounted\n"
                         "as UNDEF.\n"
         },
+        {
+                .name        = "get-signal-stats",
+                .without_arg = xmce_get_signal_stats,
+                .usage       =
+                        "get number of signals sent by mce and number of\n"
+                        "duplicate signals that were not sent\n"
+        },
+        {
+                .name        = "get-peer-credential-stats",
+                .without_arg = xmce_get_peer_credential_stats,
+                .usage       =
+                        "get peer credential cache hit/miss counts and\n"
+                        "credential query queue wait times\n"
+        },
+        {
+                .name        = "get-cpu-keepalive-stats",
+                .without_arg = xmce_get_cpu_keepalive_stats,
+                .usage       =
+                        "get cpu keepalive session, renewal and expiry\n"
+                        "counts and total keepalive time\n"
+        },
+        {
+                .name        = "get-state-snapshot",
+                .without_arg = xmce_get_state_snapshot,
+                .usage       =
+                        "get snapshot of public mce state with one\n"
+                        "method call\n"
+        },
+        {
+                .name        = "get-display-stats-extended",
+                .without_arg = xmce_get_display_stats_extended,
+                .usage       =
+                        "get extended display statistics: brightness\n"
+                        "integral per display state, fade counts, blank\n"
+                        "and unblank latency histograms, etc\n"
+                        "\n"
+                        "The same data is available also from the\n"
+                        "memory mappable file " MCE_DISPLAY_STATS_FILE "\n"
+        },
         {
                 .name        = "blank-prevent",
                 .flag        = 'P',
@@ -6436,6 +7323,19 @@ static const mce_opt_t options[] =
                         "set the display off request override; valid modes are:\n"
                         "'disabled', 'use-lpm'\n"
         },
+        {
+                .name        = "set-speculative-resume",
+                .with_arg    = xmce_set_speculative_resume,
+                .values      = "bit1[,bit2][...]",
+                .usage       =
+                        "set events that start frame buffer resume before it is\n"
+                        "known whether the display is going to be turned on\n"
+                        "\n"
+                        "Valid triggers are:\n"
+                        "  none      - resume only when display is turned on\n"
+                        "  powerkey  - resume when power key is pressed down\n"
+                        "  proximity - resume when proximity sensor is uncovered\n"
+        },
         {
                 .name        = "enable-radio",
                 .flag        = 'r',
@@ -6525,6 +7425,28 @@ static const mce_opt_t options[] =
                 .usage       =
                         "get device uptime and time spent in suspend\n"
         },
+        {
+                .name        = "get-timer-stats",
+                .without_arg = xmce_get_timer_stats,
+                .usage       =
+                        "get number of wakeups caused by suspend proof and\n"
+                        "suspend blocking timers, and how many timer\n"
+                        "notifications were coalesced to shared wakeups\n"
+        },
+        {
+                .name        = "get-wakelock-stats",
+                .without_arg = xmce_get_wakelock_stats,
+                .usage       =
+                        "get acquire counts, hold times and timeouts of mce\n"
+                        "internal wakelocks; sole_ms is the time a wakelock\n"
+                        "was the only thing keeping the device awake\n"
+        },
+        {
+                .name        = "get-startup-report",
+                .without_arg = xmce_get_startup_report,
+                .usage       =
+                        "show how long each phase of mce startup took\n"
+        },
         {
                 .name        = "set-cpu-scaling-governor",
                 .flag        = 'S',
@@ -7026,6 +7948,26 @@ static const mce_opt_t options[] =
                 .usage       =
                         "end notification ui exception\n"
         },
+        {
+                .name        = "batch",
+                .without_arg = mcetool_do_batch,
+                .with_arg    = mcetool_do_batch,
+                .values      = "file",
+                .usage       =
+                        "execute commands read from file, or from stdin\n"
+                        "if no file is given\n"
+                        "\n"
+                        "Each line holds one long option, with or without\n"
+                        "the leading dashes, and optional argument separated\n"
+                        "by '=' or white space. Empty lines and lines\n"
+                        "starting with '#' are ignored. For example:\n"
+                        "  set-brightness-fade-default=150\n"
+                        "  get-display-stats machine\n"
+                        "\n"
+                        "Method calls that do not depend on replies to\n"
+                        "earlier calls are sent to mce without waiting\n"
+                        "for replies in between.\n"
+        },
         {
                 .name        = "status",
                 .flag        = 'N',
@@ -7120,6 +8062,35 @@ static const mce_opt_t options[] =
                 .usage       =
                         "set critical limit for active memory pages; zero=disabled\n"
         },
+        {
+                .name        = "set-memuse-warning-stall",
+                .with_arg    = xmce_set_memnotify_warning_stall,
+                .values      = "ms",
+                .usage       =
+                        "set warning limit for memory stall time within stall window\n"
+                        "\n"
+                        "Used when /dev/memnotify is not available and memory use\n"
+                        "level is tracked via kernel pressure stall information.\n"
+                        "The limit applies to time when some tasks are stalled.\n"
+                        "Zero=disabled.\n"
+        },
+        {
+                .name        = "set-memuse-critical-stall",
+                .with_arg    = xmce_set_memnotify_critical_stall,
+                .values      = "ms",
+                .usage       =
+                        "set critical limit for memory stall time within stall window\n"
+                        "\n"
+                        "The limit applies to time when all tasks are stalled.\n"
+                        "Zero=disabled.\n"
+        },
+        {
+                .name        = "set-memuse-stall-window",
+                .with_arg    = xmce_set_memnotify_stall_window,
+                .values      = "ms",
+                .usage       =
+                        "set time window for memory stall limits; 500 ... 10000 ms\n"
+        },
         {
                 .name        = "set-exception-length-call-in",
                 .with_arg    = xmce_set_exception_length_call_in,
@@ -7292,6 +8263,341 @@ static bool mcetool_do_long_help(const char *arg)
         return mcetool_do_help(arg ?: "all");
 }
 
+/* ========================================================================= *
+ * BATCH MODE
+ * ========================================================================= */
+
+/** Command parsed from batch input */
+typedef struct
+{
+        /** Option to execute */
+        const mce_opt_t *opt;
+
+        /** Option argument, or NULL */
+        char            *arg;
+} mcetool_batch_cmd_t;
+
+/** Saved stdout while output is muted, or -1 */
+static int mcetool_batch_stdout = -1;
+
+/** Saved stderr while output is muted, or -1 */
+static int mcetool_batch_stderr = -1;
+
+/** Temporary file for stdout output while muted, or -1 */
+static int mcetool_batch_outlog = -1;
+
+/** Temporary file for stderr output while muted, or -1 */
+static int mcetool_batch_errlog = -1;
+
+/** Copy output captured while muted to file descriptor
+ *
+ * @param log  temporary file holding captured output
+ * @param fd   file descriptor to copy to
+ */
+static void mcetool_batch_replay(int log, int fd)
+{
+        char    buf[256];
+        ssize_t rc;
+
+        if( lseek(log, 0, SEEK_SET) != 0 )
+                return;
+
+        while( (rc = read(log, buf, sizeof buf)) > 0 ) {
+                if( write(fd, buf, rc) != rc )
+                        break;
+        }
+}
+
+/** Stop muting output
+ *
+ * @param replay true to copy captured output to stdout and stderr
+ */
+static void mcetool_batch_unmute(bool replay)
+{
+        if( mcetool_batch_stdout == -1 )
+                return;
+
+        fflush(stdout);
+        fflush(stderr);
+
+        dup2(mcetool_batch_stdout, STDOUT_FILENO);
+        dup2(mcetool_batch_stderr, STDERR_FILENO);
+        close(mcetool_batch_stdout), mcetool_batch_stdout = -1;
+        close(mcetool_batch_stderr), mcetool_batch_stderr = -1;
+
+        if( replay ) {
+                mcetool_batch_replay(mcetool_batch_outlog, STDOUT_FILENO);
+                mcetool_batch_replay(mcetool_batch_errlog, STDERR_FILENO);
+        }
+
+        close(mcetool_batch_outlog), mcetool_batch_outlog = -1;
+        close(mcetool_batch_errlog), mcetool_batch_errlog = -1;
+}
+
+/** Make sure output is not lost if planning pass exits
+ */
+static void mcetool_batch_atexit(void)
+{
+        mcetool_batch_unmute(true);
+}
+
+/** Start muting output
+ *
+ * Both stdout and stderr are captured, so that the output can be
+ * shown if a command handler exits during the planning pass.
+ * Otherwise the captured output is discarded.
+ */
+static void mcetool_batch_mute(void)
+{
+        static bool atexit_done = false;
+
+        FILE *outlog = 0;
+        FILE *errlog = 0;
+
+        if( mcetool_batch_stdout != -1 )
+                goto EXIT;
+
+        if( !atexit_done )
+                atexit_done = true, atexit(mcetool_batch_atexit);
+
+        if( !(outlog = tmpfile()) || !(errlog = tmpfile()) )
+                goto EXIT;
+
+        fflush(stdout);
+        fflush(stderr);
+
+        mcetool_batch_stdout = dup(STDOUT_FILENO);
+        mcetool_batch_stderr = dup(STDERR_FILENO);
+        mcetool_batch_outlog = dup(fileno(outlog));
+        mcetool_batch_errlog = dup(fileno(errlog));
+
+        dup2(mcetool_batch_outlog, STDOUT_FILENO);
+        dup2(mcetool_batch_errlog, STDERR_FILENO);
+
+EXIT:
+        if( outlog )
+                fclose(outlog);
+
+        if( errlog )
+                fclose(errlog);
+}
+
+/** Predicate for: batch command asks for confirmation from user
+ *
+ * @param opt  option
+ *
+ * @return true for options that read stdin; false otherwise
+ */
+static bool mcetool_batch_is_interactive(const mce_opt_t *opt)
+{
+        return opt->with_arg == xmce_set_devicelock_in_lockscreen;
+}
+
+/** Predicate for: batch command can be executed in planning pass
+ *
+ * @param opt  option
+ *
+ * @return false for options that block, exit, recurse or prompt;
+ *         true otherwise
+ */
+static bool mcetool_batch_is_plannable(const mce_opt_t *opt)
+{
+        return (opt->without_arg != mcetool_block &&
+                opt->without_arg != mcetool_do_help &&
+                opt->without_arg != mcetool_do_long_help &&
+                opt->without_arg != mcetool_do_version &&
+                !mcetool_batch_is_interactive(opt));
+}
+
+/** Predicate for: batch command makes only queries
+ *
+ * @param opt  option
+ *
+ * @return true for status and get-xxx options, false otherwise
+ */
+static bool mcetool_batch_is_query(const mce_opt_t *opt)
+{
+        return (!strcmp(opt->name, "status") ||
+                !strncmp(opt->name, "get-", 4));
+}
+
+/** Execute batch command
+ *
+ * @param cmd  command to execute
+ *
+ * @return value returned by the option handler
+ */
+static bool mcetool_batch_exec(const mcetool_batch_cmd_t *cmd)
+{
+        if( cmd->arg )
+                return cmd->opt->with_arg(cmd->arg);
+
+        return cmd->opt->without_arg(0);
+}
+
+/** Send method calls of batch commands ahead
+ *
+ * @param cmds  array of commands
+ * @param head  index of the first command to plan
+ * @param count number of commands in the array
+ *
+ * @return index of the first command that was not planned
+ */
+static size_t mcetool_batch_plan(const mcetool_batch_cmd_t *cmds,
+                                 size_t head, size_t count)
+{
+        size_t tail = head;
+
+        /* Commands that can't be planned are executed synchronously
+         * in rounds of their own */
+        if( !mcetool_batch_is_plannable(cmds[tail].opt) )
+                return tail + 1;
+
+        mcetool_batch_mute();
+
+        xdbus_batch_barrier = false;
+        xdbus_batch_state   = XDBUS_BATCH_PLAN;
+
+        while( tail < count && !xdbus_batch_barrier ) {
+                const mcetool_batch_cmd_t *cmd = cmds + tail;
+
+                if( !mcetool_batch_is_plannable(cmd->opt) )
+                        break;
+
+                xdbus_batch_begin_command(mcetool_batch_is_query(cmd->opt));
+                mcetool_batch_exec(cmd);
+                ++tail;
+        }
+
+        xdbus_batch_state = XDBUS_BATCH_OFF;
+
+        mcetool_batch_unmute(false);
+
+        return tail;
+}
+
+/** Parse batch input line
+ *
+ * @param line  input line, modified in place
+ * @param cmd   where to store the command
+ *
+ * @return true if command was parsed, false for empty / comment lines
+ *         and errors; in which case *err is set
+ */
+static bool mcetool_batch_parse_line(char *line, mcetool_batch_cmd_t *cmd,
+                                     bool *err)
+{
+        char *name = g_strstrip(line);
+        char *arg  = 0;
+
+        if( *name == 0 || *name == '#' )
+                return false;
+
+        if( !strncmp(name, "--", 2) )
+                name += 2;
+
+        if( (arg = strpbrk(name, "= \t")) ) {
+                *arg++ = 0;
+                arg = g_strstrip(arg);
+                if( *arg == 0 )
+                        arg = 0;
+        }
+
+        const mce_opt_t *opt = options;
+
+        while( opt->name && strcmp(opt->name, name) )
+                ++opt;
+
+        if( !opt->name )
+                errorf("%s: unknown option\n", name);
+        else if( opt->with_arg == mcetool_do_batch )
+                errorf("%s: nested batches are not supported\n", name);
+        else if( arg ? !opt->with_arg : !opt->without_arg )
+                errorf("%s: argument %s\n", name,
+                       arg ? "not allowed" : "required");
+        else {
+                cmd->opt = opt;
+                cmd->arg = g_strdup(arg);
+                return true;
+        }
+
+        return *err = true, false;
+}
+
+/** Handle --batch command line option
+ *
+ * @param arg  path to batch file, or NULL for stdin
+ */
+static bool mcetool_do_batch(const char *arg)
+{
+        bool     res  = false;
+        FILE    *file = stdin;
+        GArray  *cmds = g_array_new(false, true, sizeof(mcetool_batch_cmd_t));
+        char    *line = 0;
+        size_t   size = 0;
+        unsigned lnum = 0;
+
+        if( arg && strcmp(arg, "-") && !(file = fopen(arg, "r")) ) {
+                errorf("%s: can't open: %m\n", arg);
+                goto EXIT;
+        }
+
+        while( getline(&line, &size, file) != -1 ) {
+                mcetool_batch_cmd_t cmd = { .opt = 0, .arg = 0 };
+                bool err = false;
+
+                ++lnum;
+
+                if( mcetool_batch_parse_line(line, &cmd, &err) ) {
+                        /* Confirmation prompt would read batch input */
+                        if( file == stdin && mcetool_batch_is_interactive(cmd.opt) ) {
+                                errorf("%s:%u: %s: not allowed in batch read from stdin\n",
+                                       "stdin", lnum, cmd.opt->name);
+                                goto EXIT;
+                        }
+                        g_array_append_val(cmds, cmd);
+                }
+                else if( err ) {
+                        errorf("%s:%u: invalid command\n", arg ?: "stdin", lnum);
+                        goto EXIT;
+                }
+        }
+
+        mcetool_batch_cmd_t *vec = (mcetool_batch_cmd_t *)cmds->data;
+
+        for( size_t head = 0; head < cmds->len; ) {
+                size_t tail = mcetool_batch_plan(vec, head, cmds->len);
+
+                xdbus_batch_state = XDBUS_BATCH_REPLAY;
+
+                while( head < tail ) {
+                        if( !mcetool_batch_exec(vec + head++) ) {
+                                xdbus_batch_state = XDBUS_BATCH_OFF;
+                                goto EXIT;
+                        }
+                }
+
+                xdbus_batch_state = XDBUS_BATCH_OFF;
+                xdbus_batch_flush();
+        }
+
+        res = true;
+
+EXIT:
+        xdbus_batch_flush();
+
+        for( guint i = 0; i < cmds->len; ++i )
+                g_free(g_array_index(cmds, mcetool_batch_cmd_t, i).arg);
+        g_array_free(cmds, true);
+
+        free(line);
+
+        if( file && file != stdin )
+                fclose(file);
+
+        return res;
+}
+
 /* ========================================================================= *
  * MCETOOL ENTRY POINT
  * ========================================================================= */